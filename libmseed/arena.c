@@ -0,0 +1,420 @@
+/***************************************************************************
+ * Memory arena for library contexts.
+ *
+ * Small allocations are carved from large blocks with a bump pointer
+ * and rounded up to power-of-two size classes.  Freed small chunks are
+ * kept on per-class free lists and reused, which suits the repeated
+ * allocation and release of records, extra headers, trace segments and
+ * record pointers.  Large allocations, such as read buffers and sample
+ * buffers that grow with realloc(), are passed to the system allocator
+ * and tracked so the whole arena can be released at once.
+ *
+ * This file is part of the miniSEED Library.
+ *
+ * Copyright (c) 2026 Chad Trabant, EarthScope Data Services
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "internalstate.h"
+
+/* Default size of arena blocks */
+#define LM_ARENA_BLOCKSIZE 1048576
+
+/* Size classes of small chunks, including the chunk header, are powers
+ * of two from 2^LM_ARENA_MINSHIFT to 2^(LM_ARENA_MINSHIFT + LM_ARENA_CLASSES - 1) */
+#define LM_ARENA_MINSHIFT 5
+#define LM_ARENA_CLASSES 10
+#define LM_ARENA_MAXCHUNK ((size_t)1 << (LM_ARENA_MINSHIFT + LM_ARENA_CLASSES - 1))
+
+/* Size class marker for large allocations */
+#define LM_ARENA_LARGE LM_ARENA_CLASSES
+
+/* Alignment of all returned memory */
+#define LM_ARENA_ALIGN 16
+#define LM_ARENA_ROUNDUP(X) (((X) + (LM_ARENA_ALIGN - 1)) & ~(size_t)(LM_ARENA_ALIGN - 1))
+
+/* Header preceding every allocation */
+typedef struct LMArenaHeader
+{
+  size_t size;      /* Requested size in bytes */
+  size_t sizeclass; /* Size class, or LM_ARENA_LARGE */
+} LMArenaHeader;
+
+#define LM_ARENA_HEADER LM_ARENA_ROUNDUP (sizeof (LMArenaHeader))
+
+/* Links of large allocations, preceding the header */
+typedef struct LMArenaLarge
+{
+  struct LMArenaLarge *prev;
+  struct LMArenaLarge *next;
+} LMArenaLarge;
+
+#define LM_ARENA_LINKS LM_ARENA_ROUNDUP (sizeof (LMArenaLarge))
+
+/* Block of memory for small chunks, followed by the chunk area */
+typedef struct LMArenaBlock
+{
+  struct LMArenaBlock *next;
+  size_t size; /* Size of the chunk area in bytes */
+  size_t used; /* Bytes of the chunk area in use */
+} LMArenaBlock;
+
+#define LM_ARENA_BLOCKHEADER LM_ARENA_ROUNDUP (sizeof (LMArenaBlock))
+
+struct LMArena
+{
+  lmp_mutex_t lock;                     /* Serializes use by threads sharing a context */
+  size_t blocksize;                     /* Size of new blocks */
+  LMArenaBlock *blocks;                 /* List of blocks, in order of use */
+  LMArenaBlock *current;                /* Block small chunks are carved from */
+  void *freelist[LM_ARENA_CLASSES];     /* Free small chunks per size class */
+  LMArenaLarge *large;                  /* List of large allocations */
+};
+
+/* Return the size class for a chunk of 'chunksize' bytes */
+static inline size_t
+arena_sizeclass (size_t chunksize)
+{
+  size_t sizeclass = 0;
+
+  while (((size_t)1 << (LM_ARENA_MINSHIFT + sizeclass)) < chunksize)
+    sizeclass++;
+
+  return sizeclass;
+}
+
+#define ARENA_CHUNKSIZE(C) ((size_t)1 << (LM_ARENA_MINSHIFT + (C)))
+#define ARENA_HEADER(P) ((LMArenaHeader *)((char *)(P) - LM_ARENA_HEADER))
+
+/* Put the unused end of the current block on the free lists */
+static void
+arena_retire_block (LMArena *arena)
+{
+  LMArenaBlock *block = arena->current;
+  char *base = (char *)block + LM_ARENA_BLOCKHEADER;
+  size_t sizeclass = LM_ARENA_CLASSES;
+
+  while (sizeclass-- > 0)
+  {
+    while (block->size - block->used >= ARENA_CHUNKSIZE (sizeclass))
+    {
+      void *chunk = base + block->used + LM_ARENA_HEADER;
+
+      *(void **)chunk = arena->freelist[sizeclass];
+      arena->freelist[sizeclass] = chunk;
+      block->used += ARENA_CHUNKSIZE (sizeclass);
+    }
+  }
+}
+
+/* Allocate a small chunk of the specified size class */
+static void *
+arena_small (LMArena *arena, size_t sizeclass)
+{
+  size_t chunksize = ARENA_CHUNKSIZE (sizeclass);
+  LMArenaBlock *block;
+  void *chunk;
+
+  if ((chunk = arena->freelist[sizeclass]) != NULL)
+  {
+    arena->freelist[sizeclass] = *(void **)chunk;
+    return chunk;
+  }
+
+  block = arena->current;
+
+  if (!block || block->size - block->used < chunksize)
+  {
+    if (block)
+      arena_retire_block (arena);
+
+    /* Reuse the next block, retained by a reset, or add a new one */
+    if (block && block->next)
+    {
+      block = block->next;
+    }
+    else
+    {
+      if (!(block = (LMArenaBlock *)malloc (LM_ARENA_BLOCKHEADER + arena->blocksize)))
+        return NULL;
+
+      block->next = NULL;
+      block->size = arena->blocksize;
+
+      if (arena->current)
+        arena->current->next = block;
+      else
+        arena->blocks = block;
+    }
+
+    block->used = 0;
+    arena->current = block;
+  }
+
+  chunk = (char *)block + LM_ARENA_BLOCKHEADER + block->used + LM_ARENA_HEADER;
+  block->used += chunksize;
+
+  return chunk;
+}
+
+/* Allocate from the arena, the caller holds the lock */
+static void *
+arena_malloc (LMArena *arena, size_t size)
+{
+  LMArenaHeader *header;
+  LMArenaLarge *large;
+  size_t sizeclass;
+  void *ptr;
+
+  if (size <= LM_ARENA_MAXCHUNK - LM_ARENA_HEADER)
+  {
+    sizeclass = arena_sizeclass (size + LM_ARENA_HEADER);
+
+    if (!(ptr = arena_small (arena, sizeclass)))
+      return NULL;
+  }
+  else
+  {
+    if (size > SIZE_MAX - LM_ARENA_LINKS - LM_ARENA_HEADER)
+      return NULL;
+
+    if (!(large = (LMArenaLarge *)malloc (LM_ARENA_LINKS + LM_ARENA_HEADER + size)))
+      return NULL;
+
+    large->prev = NULL;
+    large->next = arena->large;
+    if (arena->large)
+      arena->large->prev = large;
+    arena->large = large;
+
+    sizeclass = LM_ARENA_LARGE;
+    ptr = (char *)large + LM_ARENA_LINKS + LM_ARENA_HEADER;
+  }
+
+  header = ARENA_HEADER (ptr);
+  header->size = size;
+  header->sizeclass = sizeclass;
+
+  return ptr;
+}
+
+/* Release to the arena, the caller holds the lock */
+static void
+arena_free (LMArena *arena, void *ptr)
+{
+  LMArenaHeader *header = ARENA_HEADER (ptr);
+  LMArenaLarge *large;
+
+  if (header->sizeclass == LM_ARENA_LARGE)
+  {
+    large = (LMArenaLarge *)((char *)header - LM_ARENA_LINKS);
+
+    if (large->prev)
+      large->prev->next = large->next;
+    else
+      arena->large = large->next;
+    if (large->next)
+      large->next->prev = large->prev;
+
+    free (large);
+  }
+  else
+  {
+    *(void **)ptr = arena->freelist[header->sizeclass];
+    arena->freelist[header->sizeclass] = ptr;
+  }
+}
+
+/* Resize a large allocation in place with the system allocator */
+static void *
+arena_realloc_large (LMArena *arena, void *ptr, size_t size)
+{
+  LMArenaLarge *large = (LMArenaLarge *)((char *)ptr - LM_ARENA_HEADER - LM_ARENA_LINKS);
+
+  if (size > SIZE_MAX - LM_ARENA_LINKS - LM_ARENA_HEADER)
+    return NULL;
+
+  if (!(large = (LMArenaLarge *)realloc (large, LM_ARENA_LINKS + LM_ARENA_HEADER + size)))
+    return NULL;
+
+  /* Relink neighbors to the possibly moved allocation */
+  if (large->prev)
+    large->prev->next = large;
+  else
+    arena->large = large;
+  if (large->next)
+    large->next->prev = large;
+
+  ptr = (char *)large + LM_ARENA_LINKS + LM_ARENA_HEADER;
+  ARENA_HEADER (ptr)->size = size;
+
+  return ptr;
+}
+
+/***************************************************************************
+ * Create an arena with blocks of 'blocksize' bytes, 0 selects the
+ * default.  The arena structure is allocated with the system allocator.
+ *
+ * Returns a new arena on success and NULL on error.
+ ***************************************************************************/
+LMArena *
+lm_arena_create (size_t blocksize)
+{
+  LMArena *arena;
+
+  if (blocksize == 0)
+    blocksize = LM_ARENA_BLOCKSIZE;
+
+  /* Blocks must hold at least one chunk of every size class */
+  if (blocksize < LM_ARENA_MAXCHUNK)
+    blocksize = LM_ARENA_MAXCHUNK;
+
+  if (!(arena = (LMArena *)malloc (sizeof (LMArena))))
+    return NULL;
+
+  memset (arena, 0, sizeof (LMArena));
+  arena->blocksize = LM_ARENA_ROUNDUP (blocksize);
+
+  if (lmp_mutex_init (&arena->lock))
+  {
+    free (arena);
+    return NULL;
+  }
+
+  return arena;
+}
+
+/***************************************************************************
+ * Release all allocations from an arena at once.  The blocks are
+ * retained and reused for later allocations.
+ ***************************************************************************/
+void
+lm_arena_reset (LMArena *arena)
+{
+  LMArenaLarge *large;
+  LMArenaBlock *block;
+
+  if (!arena)
+    return;
+
+  lmp_mutex_lock (&arena->lock);
+
+  while ((large = arena->large) != NULL)
+  {
+    arena->large = large->next;
+    free (large);
+  }
+
+  for (block = arena->blocks; block; block = block->next)
+    block->used = 0;
+
+  arena->current = arena->blocks;
+  memset (arena->freelist, 0, sizeof (arena->freelist));
+
+  lmp_mutex_unlock (&arena->lock);
+}
+
+/***************************************************************************
+ * Release all allocations from an arena and the arena itself.
+ ***************************************************************************/
+void
+lm_arena_destroy (LMArena *arena)
+{
+  LMArenaBlock *block;
+
+  if (!arena)
+    return;
+
+  lm_arena_reset (arena);
+
+  while ((block = arena->blocks) != NULL)
+  {
+    arena->blocks = block->next;
+    free (block);
+  }
+
+  lmp_mutex_destroy (&arena->lock);
+  free (arena);
+}
+
+/***************************************************************************
+ * Memory management functions allocating from the arena of the library
+ * context bound to the calling thread, for use in LIBMSEED_MEMORY.
+ ***************************************************************************/
+void *
+lm_arena_malloc (size_t size)
+{
+  LMArena *arena = lm_currentcontext->arena;
+  void *ptr;
+
+  lmp_mutex_lock (&arena->lock);
+  ptr = arena_malloc (arena, size);
+  lmp_mutex_unlock (&arena->lock);
+
+  return ptr;
+}
+
+void *
+lm_arena_realloc (void *ptr, size_t size)
+{
+  LMArena *arena = lm_currentcontext->arena;
+  LMArenaHeader *header;
+  void *newptr = NULL;
+
+  if (!ptr)
+    return lm_arena_malloc (size);
+
+  header = ARENA_HEADER (ptr);
+
+  lmp_mutex_lock (&arena->lock);
+
+  /* Grow or shrink large allocations with the system allocator */
+  if (header->sizeclass == LM_ARENA_LARGE && size > LM_ARENA_MAXCHUNK - LM_ARENA_HEADER)
+  {
+    newptr = arena_realloc_large (arena, ptr, size);
+  }
+  /* Keep small chunks with room for the new size */
+  else if (header->sizeclass != LM_ARENA_LARGE &&
+           size <= ARENA_CHUNKSIZE (header->sizeclass) - LM_ARENA_HEADER)
+  {
+    header->size = size;
+    newptr = ptr;
+  }
+  /* Otherwise move to a new allocation */
+  else if ((newptr = arena_malloc (arena, size)) != NULL)
+  {
+    memcpy (newptr, ptr, (header->size < size) ? header->size : size);
+    arena_free (arena, ptr);
+  }
+
+  lmp_mutex_unlock (&arena->lock);
+
+  return newptr;
+}
+
+void
+lm_arena_free (void *ptr)
+{
+  LMArena *arena = lm_currentcontext->arena;
+
+  if (!ptr)
+    return;
+
+  lmp_mutex_lock (&arena->lock);
+  arena_free (arena, ptr);
+  lmp_mutex_unlock (&arena->lock);
+}
@@ -0,0 +1,247 @@
+/***************************************************************************
+ * A benchmark of library memory management with and without an arena.
+ *
+ * A buffer of miniSEED records for many channels is generated, then
+ * read into a trace list and released repeatedly.  With the default
+ * memory management functions the trace list is freed structure by
+ * structure, with a context arena all memory is released at once.
+ * The average time per record is reported.
+ *
+ * This file is part of the miniSEED Library.
+ *
+ * Copyright (c) 2026 Chad Trabant, EarthScope Data Services
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libmseed.h>
+
+#define VERSION "[libmseed " LIBMSEED_VERSION " bench]"
+#define PACKAGE "lm_bench_arena"
+
+#define RECLEN 512
+#define CHANNELS 200
+#define CHANNELSAMPLES 4000
+
+static int iterations = 50;
+static uint32_t readflags = MSF_UNPACKDATA;
+
+static int parameter_proc (int argcount, char **argvec);
+static void usage (void);
+
+typedef struct
+{
+  char *buffer;
+  size_t length;
+  size_t size;
+} RecordBuffer;
+
+/* Append each generated record to the buffer */
+static void
+record_handler (char *record, int reclen, void *handlerdata)
+{
+  RecordBuffer *rb = (RecordBuffer *)handlerdata;
+
+  if (rb->length + reclen <= rb->size)
+  {
+    memcpy (rb->buffer + rb->length, record, reclen);
+    rb->length += reclen;
+  }
+}
+
+/***************************************************************************
+ * Read the buffer into a trace list and release it 'iterations' times,
+ * with an arena context when 'ctx' is not NULL.  Returns the average
+ * nanoseconds per record, or -1 on error.
+ ***************************************************************************/
+static double
+time_read (RecordBuffer *rb, int64_t records, LMContext *ctx)
+{
+  MS3TraceList *mstl = NULL;
+  nstime_t start;
+  nstime_t end;
+  int iteration;
+
+  ms_context_bind (ctx);
+
+  start = lmp_systemtime ();
+  for (iteration = 0; iteration < iterations; iteration++)
+  {
+    mstl = NULL;
+    if (mstl3_readbuffer (&mstl, rb->buffer, rb->length, 0, readflags, NULL, 0) != records)
+    {
+      ms_context_bind (NULL);
+      return -1.0;
+    }
+
+    if (ctx)
+      ms_context_resetarena (ctx);
+    else
+      mstl3_free (&mstl, 1);
+  }
+  end = lmp_systemtime ();
+
+  ms_context_bind (NULL);
+
+  return (double)(end - start) / ((double)iterations * records);
+}
+
+int
+main (int argc, char **argv)
+{
+  MS3Record *msr = NULL;
+  LMContext *ctx = NULL;
+  RecordBuffer rb = {NULL, 0, 0};
+  int32_t *samples = NULL;
+  int64_t records = 0;
+  int64_t packed;
+  double defaultns;
+  double arenans;
+  int channel;
+  int idx;
+
+  if (parameter_proc (argc, argv) < 0)
+    return 1;
+
+  rb.size = (size_t)CHANNELS * CHANNELSAMPLES * sizeof (int32_t);
+  rb.buffer = (char *)malloc (rb.size);
+  samples = (int32_t *)malloc (CHANNELSAMPLES * sizeof (int32_t));
+  msr = msr3_init (NULL);
+
+  if (!rb.buffer || !samples || !msr)
+  {
+    ms_log (2, "Cannot allocate memory\n");
+    return 1;
+  }
+
+  for (idx = 0; idx < CHANNELSAMPLES; idx++)
+    samples[idx] = (idx * 7919) % 2001 - 1000;
+
+  /* Generate Steim-2 records for each channel */
+  msr->reclen = RECLEN;
+  msr->encoding = DE_STEIM2;
+  msr->samprate = 100.0;
+  msr->starttime = ms_timestr2nstime ("2026-01-01T00:00:00Z");
+  msr->datasamples = samples;
+  msr->sampletype = 'i';
+  msr->formatversion = 3;
+
+  for (channel = 0; channel < CHANNELS; channel++)
+  {
+    snprintf (msr->sid, sizeof (msr->sid), "FDSN:XX_S%03d_00_B_H_Z", channel);
+    msr->numsamples = CHANNELSAMPLES;
+    msr->samplecnt = CHANNELSAMPLES;
+
+    if ((packed = msr3_pack (msr, record_handler, &rb, NULL, MSF_FLUSHDATA, 0)) < 0)
+    {
+      ms_log (2, "Cannot pack records\n");
+      return 1;
+    }
+
+    records += packed;
+  }
+
+  msr->datasamples = NULL;
+  msr3_free (&msr);
+
+  if (!(ctx = ms_context_create ()) || ms_context_setarena (ctx, 0))
+    return 1;
+
+  printf ("%s: %" PRId64 " records of %d channels, %d iterations\n", PACKAGE, records, CHANNELS,
+          iterations);
+
+  if ((defaultns = time_read (&rb, records, NULL)) < 0 ||
+      (arenans = time_read (&rb, records, ctx)) < 0)
+  {
+    ms_log (2, "Cannot read records\n");
+    return 1;
+  }
+
+  printf ("%-20s %12s\n", "Memory", "ns/record");
+  printf ("%-20s %12.1f\n", "default", defaultns);
+  printf ("%-20s %12.1f\n", "arena", arenans);
+
+  ms_context_free (&ctx);
+  free (samples);
+  free (rb.buffer);
+
+  return 0;
+} /* End of main() */
+
+/***************************************************************************
+ * parameter_proc():
+ * Process the command line parameters.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+parameter_proc (int argcount, char **argvec)
+{
+  int optind;
+
+  for (optind = 1; optind < argcount; optind++)
+  {
+    if (strcmp (argvec[optind], "-V") == 0)
+    {
+      ms_log (1, "%s version: %s\n", PACKAGE, VERSION);
+      exit (0);
+    }
+    else if (strcmp (argvec[optind], "-h") == 0)
+    {
+      usage ();
+      exit (0);
+    }
+    else if (strcmp (argvec[optind], "-n") == 0 && optind + 1 < argcount)
+    {
+      iterations = (int)strtol (argvec[++optind], NULL, 10);
+    }
+    else if (strcmp (argvec[optind], "-H") == 0)
+    {
+      readflags = 0;
+    }
+    else
+    {
+      ms_log (2, "Unknown option: %s\n", argvec[optind]);
+      return -1;
+    }
+  }
+
+  if (iterations < 1)
+  {
+    ms_log (2, "Iterations must be positive: %d\n", iterations);
+    return -1;
+  }
+
+  return 0;
+} /* End of parameter_proc() */
+
+/***************************************************************************
+ * usage():
+ * Print the usage message.
+ ***************************************************************************/
+static void
+usage (void)
+{
+  fprintf (stderr, "%s - Benchmark memory management with an arena %s\n\n", PACKAGE, VERSION);
+  fprintf (stderr, "Usage: %s [options]\n\n", PACKAGE);
+  fprintf (stderr, " ## Options ##\n"
+                   " -V          Report program version\n"
+                   " -h          Show this usage message\n"
+                   " -n count    Number of times to read the records, default 50\n"
+                   " -H          Read headers only, do not unpack data samples\n"
+                   "\n");
+} /* End of usage() */
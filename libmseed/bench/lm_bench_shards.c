@@ -0,0 +1,274 @@
+/***************************************************************************
+ * A benchmark of concurrent trace list insertion with a sharded trace list.
+ *
+ * Records for many channels are generated in memory and added to a
+ * trace list by 1 to 32 threads, each thread adding the records of a
+ * subset of channels in time order.  Insertion into a single trace list
+ * protected by one lock is compared to a MS3TraceListShards.  The
+ * throughput in records per second is reported for each thread count.
+ *
+ * Windows is not supported.
+ *
+ * This file is part of the miniSEED Library.
+ *
+ * Copyright (c) 2026 Chad Trabant, EarthScope Data Services
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libmseed.h>
+
+#define VERSION "[libmseed " LIBMSEED_VERSION " bench]"
+#define PACKAGE "lm_bench_shards"
+
+#define SAMPLES 100
+#define MAXTHREADS 32
+
+static int channels = 512;
+static int records = 200;
+static int iterations = 5;
+
+static int parameter_proc (int argcount, char **argvec);
+static void usage (void);
+
+/* Insertion target, a locked trace list or shards */
+typedef struct Target
+{
+  MS3TraceList *mstl;
+  pthread_mutex_t lock;
+  MS3TraceListShards *shards;
+} Target;
+
+typedef struct Worker
+{
+  Target *target;
+  int thread;
+  int nthreads;
+  int errors;
+} Worker;
+
+static int32_t samples[SAMPLES];
+
+/* Add the records of every nthreads'th channel, starting at the thread number */
+static void *
+add_thread (void *arg)
+{
+  Worker *worker = (Worker *)arg;
+  MS3Record msr = MS3Record_INITIALIZER;
+  nstime_t starttime = ms_timestr2nstime ("2026-01-01T00:00:00Z");
+  int channel;
+  int record;
+
+  msr.pubversion = 1;
+  msr.samprate = 100.0;
+  msr.datasamples = samples;
+  msr.sampletype = 'i';
+  msr.numsamples = SAMPLES;
+  msr.samplecnt = SAMPLES;
+
+  for (record = 0; record < records; record++)
+  {
+    msr.starttime = starttime + (nstime_t)record * SAMPLES * (NSTMODULUS / 100);
+
+    for (channel = worker->thread; channel < channels; channel += worker->nthreads)
+    {
+      snprintf (msr.sid, sizeof (msr.sid), "FDSN:XX_S%04d__B_H_Z", channel);
+
+      if (worker->target->shards)
+      {
+        if (mstl3_shards_addmsr (worker->target->shards, &msr, 0, 1, 0, NULL))
+          worker->errors++;
+      }
+      else
+      {
+        pthread_mutex_lock (&worker->target->lock);
+        if (!mstl3_addmsr (worker->target->mstl, &msr, 0, 1, 0, NULL))
+          worker->errors++;
+        pthread_mutex_unlock (&worker->target->lock);
+      }
+    }
+  }
+
+  return NULL;
+}
+
+/***************************************************************************
+ * Add all records with 'nthreads' threads 'iterations' times, to shards
+ * if 'sharded' is set and otherwise to a single locked trace list.
+ * Returns records per second, or -1 on error.
+ ***************************************************************************/
+static double
+time_insert (int nthreads, int sharded)
+{
+  Target target;
+  Worker workers[MAXTHREADS];
+  pthread_t tids[MAXTHREADS];
+  nstime_t elapsed = 0;
+  nstime_t start;
+  int iteration;
+  int thread;
+  int errors = 0;
+
+  for (iteration = 0; iteration < iterations; iteration++)
+  {
+    memset (&target, 0, sizeof (target));
+    pthread_mutex_init (&target.lock, NULL);
+
+    if (sharded)
+      target.shards = mstl3_shards_init (0);
+    else
+      target.mstl = mstl3_init (NULL);
+
+    if (!target.shards && !target.mstl)
+      return -1.0;
+
+    start = lmp_systemtime ();
+    for (thread = 0; thread < nthreads; thread++)
+    {
+      workers[thread].target = &target;
+      workers[thread].thread = thread;
+      workers[thread].nthreads = nthreads;
+      workers[thread].errors = 0;
+
+      if (pthread_create (&tids[thread], NULL, add_thread, &workers[thread]))
+        return -1.0;
+    }
+
+    for (thread = 0; thread < nthreads; thread++)
+    {
+      pthread_join (tids[thread], NULL);
+      errors += workers[thread].errors;
+    }
+    elapsed += lmp_systemtime () - start;
+
+    if (sharded)
+      mstl3_shards_free (&target.shards, 0);
+    else
+      mstl3_free (&target.mstl, 0);
+
+    pthread_mutex_destroy (&target.lock);
+  }
+
+  if (errors)
+    return -1.0;
+
+  return (double)iterations * channels * records / ((double)elapsed / NSTMODULUS);
+}
+
+int
+main (int argc, char **argv)
+{
+  double lockedrate;
+  double shardedrate;
+  int nthreads;
+  int idx;
+
+  if (parameter_proc (argc, argv) < 0)
+    return 1;
+
+  for (idx = 0; idx < SAMPLES; idx++)
+    samples[idx] = (idx * 7919) % 2001 - 1000;
+
+  printf ("%s: %d channels of %d records, %d iterations\n", PACKAGE, channels, records,
+          iterations);
+  printf ("%-8s %16s %16s %8s\n", "Threads", "locked rec/s", "sharded rec/s", "ratio");
+
+  for (nthreads = 1; nthreads <= MAXTHREADS; nthreads *= 2)
+  {
+    if ((lockedrate = time_insert (nthreads, 0)) < 0 ||
+        (shardedrate = time_insert (nthreads, 1)) < 0)
+    {
+      ms_log (2, "Cannot insert records\n");
+      return 1;
+    }
+
+    printf ("%-8d %16.0f %16.0f %8.2f\n", nthreads, lockedrate, shardedrate,
+            shardedrate / lockedrate);
+  }
+
+  return 0;
+} /* End of main() */
+
+/***************************************************************************
+ * parameter_proc():
+ * Process the command line parameters.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+parameter_proc (int argcount, char **argvec)
+{
+  int optind;
+
+  for (optind = 1; optind < argcount; optind++)
+  {
+    if (strcmp (argvec[optind], "-V") == 0)
+    {
+      ms_log (1, "%s version: %s\n", PACKAGE, VERSION);
+      exit (0);
+    }
+    else if (strcmp (argvec[optind], "-h") == 0)
+    {
+      usage ();
+      exit (0);
+    }
+    else if (strcmp (argvec[optind], "-n") == 0 && optind + 1 < argcount)
+    {
+      iterations = (int)strtol (argvec[++optind], NULL, 10);
+    }
+    else if (strcmp (argvec[optind], "-c") == 0 && optind + 1 < argcount)
+    {
+      channels = (int)strtol (argvec[++optind], NULL, 10);
+    }
+    else if (strcmp (argvec[optind], "-r") == 0 && optind + 1 < argcount)
+    {
+      records = (int)strtol (argvec[++optind], NULL, 10);
+    }
+    else
+    {
+      ms_log (2, "Unknown option: %s\n", argvec[optind]);
+      return -1;
+    }
+  }
+
+  if (iterations < 1 || channels < 1 || records < 1)
+  {
+    ms_log (2, "Iterations, channels and records must be positive\n");
+    return -1;
+  }
+
+  return 0;
+} /* End of parameter_proc() */
+
+/***************************************************************************
+ * usage():
+ * Print the usage message.
+ ***************************************************************************/
+static void
+usage (void)
+{
+  fprintf (stderr, "%s - Benchmark concurrent trace list insertion %s\n\n", PACKAGE, VERSION);
+  fprintf (stderr, "Usage: %s [options]\n\n", PACKAGE);
+  fprintf (stderr, " ## Options ##\n"
+                   " -V          Report program version\n"
+                   " -h          Show this usage message\n"
+                   " -n count    Number of times to insert the records, default 5\n"
+                   " -c count    Number of channels, default 512\n"
+                   " -r count    Number of records per channel, default 200\n"
+                   "\n");
+} /* End of usage() */
@@ -0,0 +1,206 @@
+/***************************************************************************
+ * A benchmark of time string parsing.
+ *
+ * Random times are formatted in a number of common shapes and then
+ * repeatedly parsed with ms_timestr2nstime().  The average time per
+ * call and the parsing throughput are reported.
+ *
+ * This file is part of the miniSEED Library.
+ *
+ * Copyright (c) 2026 Chad Trabant, EarthScope Data Services
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libmseed.h>
+
+#define VERSION "[libmseed " LIBMSEED_VERSION " bench]"
+#define PACKAGE "lm_bench_timeparse"
+
+#define SERIESLENGTH 4096
+#define TIMESTRSIZE 40
+
+static int iterations = 500;
+
+static int parameter_proc (int argcount, char **argvec);
+static void usage (void);
+
+/***************************************************************************
+ * Parse each time string in 'series' 'iterations' times and return the
+ * average nanoseconds per call, or -1 on error.
+ ***************************************************************************/
+static double
+time_parse (const char (*series)[TIMESTRSIZE], const nstime_t *expected)
+{
+  nstime_t start;
+  nstime_t end;
+  int iteration;
+  int idx;
+
+  start = lmp_systemtime ();
+  for (iteration = 0; iteration < iterations; iteration++)
+  {
+    for (idx = 0; idx < SERIESLENGTH; idx++)
+    {
+      if (ms_timestr2nstime (series[idx]) != expected[idx])
+      {
+        ms_log (2, "Unexpected result for '%s'\n", series[idx]);
+        return -1.0;
+      }
+    }
+  }
+  end = lmp_systemtime ();
+
+  return (double)(end - start) / ((double)iterations * SERIESLENGTH);
+}
+
+int
+main (int argc, char **argv)
+{
+  static const struct
+  {
+    ms_timeformat_t timeformat;
+    ms_subseconds_t subseconds;
+    const char *name;
+  } formats[] = {
+      {ISOMONTHDAY, NONE, "YYYY-MM-DDThh:mm:ss"},
+      {ISOMONTHDAY_Z, NANO_MICRO_NONE, "YYYY-MM-DDThh:mm:ss.fZ"},
+      {ISOMONTHDAY_SPACE, MICRO, "YYYY-MM-DD hh:mm:ss.f"},
+      {SEEDORDINAL, NANO_MICRO_NONE, "YYYY,DDD,hh:mm:ss.f"},
+      {UNIXEPOCH, NANO_MICRO_NONE, "Epoch seconds"},
+  };
+
+  char (*series)[TIMESTRSIZE] = NULL;
+  nstime_t *times = NULL;
+  nstime_t *expected = NULL;
+  double parsens;
+  int format;
+  int idx;
+
+  if (parameter_proc (argc, argv) < 0)
+    return 1;
+
+  series = malloc (SERIESLENGTH * sizeof (*series));
+  times = (nstime_t *)malloc (SERIESLENGTH * sizeof (nstime_t));
+  expected = (nstime_t *)malloc (SERIESLENGTH * sizeof (nstime_t));
+
+  if (!series || !times || !expected)
+  {
+    ms_log (2, "Cannot allocate memory\n");
+    return 1;
+  }
+
+  /* Random times with microsecond precision between 1980 and 2040 */
+  srand (42);
+  for (idx = 0; idx < SERIESLENGTH; idx++)
+  {
+    times[idx] = (nstime_t)315532800 * NSTMODULUS +
+                 (((nstime_t)rand () * RAND_MAX + rand ()) % ((nstime_t)1893456000 * 1000000)) *
+                     1000;
+  }
+
+  printf ("%s: %d times, %d iterations\n", PACKAGE, SERIESLENGTH, iterations);
+  printf ("%-24s %12s %14s\n", "Format", "ns/parse", "Million/sec");
+
+  for (format = 0; format < (int)(sizeof (formats) / sizeof (formats[0])); format++)
+  {
+    for (idx = 0; idx < SERIESLENGTH; idx++)
+    {
+      if (!ms_nstime2timestr_n (times[idx], series[idx], TIMESTRSIZE, formats[format].timeformat,
+                                formats[format].subseconds))
+      {
+        ms_log (2, "Cannot format time as %s\n", formats[format].name);
+        return 1;
+      }
+
+      /* Expected values account for subseconds omitted by the format */
+      expected[idx] = (formats[format].subseconds == NONE)
+                          ? times[idx] - (times[idx] % NSTMODULUS)
+                          : times[idx];
+    }
+
+    if ((parsens = time_parse ((const char (*)[TIMESTRSIZE])series, expected)) < 0)
+      return 1;
+
+    printf ("%-24s %12.1f %14.2f\n", formats[format].name, parsens, 1000.0 / parsens);
+  }
+
+  free (series);
+  free (times);
+  free (expected);
+
+  return 0;
+} /* End of main() */
+
+/***************************************************************************
+ * parameter_proc():
+ * Process the command line parameters.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+parameter_proc (int argcount, char **argvec)
+{
+  int optind;
+
+  for (optind = 1; optind < argcount; optind++)
+  {
+    if (strcmp (argvec[optind], "-V") == 0)
+    {
+      ms_log (1, "%s version: %s\n", PACKAGE, VERSION);
+      exit (0);
+    }
+    else if (strcmp (argvec[optind], "-h") == 0)
+    {
+      usage ();
+      exit (0);
+    }
+    else if (strcmp (argvec[optind], "-n") == 0 && optind + 1 < argcount)
+    {
+      iterations = (int)strtol (argvec[++optind], NULL, 10);
+    }
+    else
+    {
+      ms_log (2, "Unknown option: %s\n", argvec[optind]);
+      return -1;
+    }
+  }
+
+  if (iterations < 1)
+  {
+    ms_log (2, "Iterations must be positive: %d\n", iterations);
+    return -1;
+  }
+
+  return 0;
+} /* End of parameter_proc() */
+
+/***************************************************************************
+ * usage():
+ * Print the usage message.
+ ***************************************************************************/
+static void
+usage (void)
+{
+  fprintf (stderr, "%s - Benchmark time string parsing %s\n\n", PACKAGE, VERSION);
+  fprintf (stderr, "Usage: %s [options]\n\n", PACKAGE);
+  fprintf (stderr, " ## Options ##\n"
+                   " -V          Report program version\n"
+                   " -h          Show this usage message\n"
+                   " -n count    Number of times to parse each series, default 500\n"
+                   "\n");
+} /* End of usage() */
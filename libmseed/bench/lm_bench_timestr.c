@@ -0,0 +1,204 @@
+/***************************************************************************
+ * A benchmark of time string formatting.
+ *
+ * Times are formatted with ms_nstime2timestr_n() in each time format for
+ * two series: consecutive record start times, where successive times
+ * usually share the day, and times spread randomly over many years.
+ * The average time per call is reported.
+ *
+ * This file is part of the miniSEED Library.
+ *
+ * Copyright (c) 2026 Chad Trabant, EarthScope Data Services
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libmseed.h>
+
+#define VERSION "[libmseed " LIBMSEED_VERSION " bench]"
+#define PACKAGE "lm_bench_timestr"
+
+#define SERIESLENGTH 4096
+
+static int iterations = 500;
+
+static int parameter_proc (int argcount, char **argvec);
+static void usage (void);
+
+/***************************************************************************
+ * Format each time in 'series' 'iterations' times and return the
+ * average nanoseconds per call, or -1 on error.
+ ***************************************************************************/
+static double
+time_format (const nstime_t *series, ms_timeformat_t timeformat, ms_subseconds_t subseconds)
+{
+  char timestr[40];
+  nstime_t start;
+  nstime_t end;
+  size_t checksum = 0;
+  int iteration;
+  int idx;
+
+  start = lmp_systemtime ();
+  for (iteration = 0; iteration < iterations; iteration++)
+  {
+    for (idx = 0; idx < SERIESLENGTH; idx++)
+    {
+      if (!ms_nstime2timestr_n (series[idx], timestr, sizeof (timestr), timeformat, subseconds))
+        return -1.0;
+
+      checksum += (unsigned char)timestr[idx % 17];
+    }
+  }
+  end = lmp_systemtime ();
+
+  /* Use the checksum so the work cannot be optimized away */
+  if (checksum == 0)
+    return -1.0;
+
+  return (double)(end - start) / ((double)iterations * SERIESLENGTH);
+}
+
+int
+main (int argc, char **argv)
+{
+  static const struct
+  {
+    ms_timeformat_t timeformat;
+    ms_subseconds_t subseconds;
+    const char *name;
+  } formats[] = {
+      {ISOMONTHDAY_Z, NANO_MICRO_NONE, "ISOMONTHDAY_Z"},
+      {ISOMONTHDAY_DOY_Z, NANO_MICRO_NONE, "ISOMONTHDAY_DOY_Z"},
+      {ISOMONTHDAY_SPACE, MICRO, "ISOMONTHDAY_SPACE"},
+      {SEEDORDINAL, NANO_MICRO_NONE, "SEEDORDINAL"},
+      {UNIXEPOCH, NANO_MICRO_NONE, "UNIXEPOCH"},
+  };
+
+  nstime_t *sequential = NULL;
+  nstime_t *random = NULL;
+  nstime_t time;
+  double sequentialns;
+  double randomns;
+  int idx;
+
+  if (parameter_proc (argc, argv) < 0)
+    return 1;
+
+  sequential = (nstime_t *)malloc (SERIESLENGTH * sizeof (nstime_t));
+  random = (nstime_t *)malloc (SERIESLENGTH * sizeof (nstime_t));
+
+  if (!sequential || !random)
+  {
+    ms_log (2, "Cannot allocate memory\n");
+    return 1;
+  }
+
+  /* Record start times of 40 Hz data in 512-byte records, and random
+   * times with microsecond precision between 1980 and 2040 */
+  time = ms_timestr2nstime ("2026-01-01T23:50:00.012500");
+  srand (42);
+  for (idx = 0; idx < SERIESLENGTH; idx++)
+  {
+    sequential[idx] = time;
+    time += (nstime_t)NSTMODULUS * 410 / 40;
+
+    random[idx] = (nstime_t)315532800 * NSTMODULUS +
+                  (((nstime_t)rand () * RAND_MAX + rand ()) % ((nstime_t)1893456000 * 1000000)) *
+                      1000;
+  }
+
+  printf ("%s: %d times, %d iterations\n", PACKAGE, SERIESLENGTH, iterations);
+  printf ("%-20s %16s %16s\n", "Format", "Sequential ns", "Random ns");
+
+  for (idx = 0; idx < (int)(sizeof (formats) / sizeof (formats[0])); idx++)
+  {
+    if ((sequentialns = time_format (sequential, formats[idx].timeformat,
+                                     formats[idx].subseconds)) < 0 ||
+        (randomns = time_format (random, formats[idx].timeformat, formats[idx].subseconds)) < 0)
+    {
+      ms_log (2, "Cannot format times as %s\n", formats[idx].name);
+      return 1;
+    }
+
+    printf ("%-20s %16.1f %16.1f\n", formats[idx].name, sequentialns, randomns);
+  }
+
+  free (sequential);
+  free (random);
+
+  return 0;
+} /* End of main() */
+
+/***************************************************************************
+ * parameter_proc():
+ * Process the command line parameters.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+parameter_proc (int argcount, char **argvec)
+{
+  int optind;
+
+  for (optind = 1; optind < argcount; optind++)
+  {
+    if (strcmp (argvec[optind], "-V") == 0)
+    {
+      ms_log (1, "%s version: %s\n", PACKAGE, VERSION);
+      exit (0);
+    }
+    else if (strcmp (argvec[optind], "-h") == 0)
+    {
+      usage ();
+      exit (0);
+    }
+    else if (strcmp (argvec[optind], "-n") == 0 && optind + 1 < argcount)
+    {
+      iterations = (int)strtol (argvec[++optind], NULL, 10);
+    }
+    else
+    {
+      ms_log (2, "Unknown option: %s\n", argvec[optind]);
+      return -1;
+    }
+  }
+
+  if (iterations < 1)
+  {
+    ms_log (2, "Iterations must be positive: %d\n", iterations);
+    return -1;
+  }
+
+  return 0;
+} /* End of parameter_proc() */
+
+/***************************************************************************
+ * usage():
+ * Print the usage message.
+ ***************************************************************************/
+static void
+usage (void)
+{
+  fprintf (stderr, "%s - Benchmark time string formatting %s\n\n", PACKAGE, VERSION);
+  fprintf (stderr, "Usage: %s [options]\n\n", PACKAGE);
+  fprintf (stderr, " ## Options ##\n"
+                   " -V          Report program version\n"
+                   " -h          Show this usage message\n"
+                   " -n count    Number of times to format each series, default 500\n"
+                   "\n");
+} /* End of usage() */
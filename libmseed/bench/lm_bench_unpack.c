@@ -0,0 +1,289 @@
+/***************************************************************************
+ * A benchmark of data sample decoding for aligned and unaligned record
+ * payloads.
+ *
+ * A record is packed for each encoding and placed in memory at two
+ * locations: one where the data payload is aligned to 8 bytes and one
+ * where it is offset by a single byte.  The samples are repeatedly
+ * unpacked from each location and the time per record is reported.
+ *
+ * This file is part of the miniSEED Library.
+ *
+ * Copyright (c) 2026 Chad Trabant, EarthScope Data Services
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libmseed.h>
+
+#define VERSION "[libmseed " LIBMSEED_VERSION " bench]"
+#define PACKAGE "lm_bench_unpack"
+
+#define RECLEN 4096
+#define MAXSAMPLES 4000
+
+static int iterations = 20000;
+static int msformat   = 3;
+
+static int parameter_proc (int argcount, char **argvec);
+static void usage (void);
+
+/* Capture the first record created by the packer */
+static void
+record_handler (char *record, int reclen, void *handlerdata)
+{
+  char *buffer = (char *)handlerdata;
+
+  if (buffer[0] == '\0')
+    memcpy (buffer, record, reclen);
+}
+
+/***************************************************************************
+ * Unpack the record at 'record' 'iterations' times and return the
+ * average nanoseconds per record, or -1 on error.
+ ***************************************************************************/
+static double
+time_unpack (const char *record, int reclen, int64_t *samplecount)
+{
+  MS3Record *msr = NULL;
+  nstime_t start;
+  nstime_t end;
+  int idx;
+
+  if (msr3_parse (record, reclen, &msr, 0, 0))
+  {
+    ms_log (2, "Cannot parse record\n");
+    return -1.0;
+  }
+
+  /* Warm up and allocate the sample buffer */
+  if (msr3_unpack_data (msr, 0) != msr->samplecnt)
+  {
+    msr3_free (&msr);
+    return -1.0;
+  }
+
+  start = lmp_systemtime ();
+  for (idx = 0; idx < iterations; idx++)
+  {
+    msr->numsamples = 0;
+
+    if (msr3_unpack_data (msr, 0) != msr->samplecnt)
+    {
+      msr3_free (&msr);
+      return -1.0;
+    }
+  }
+  end = lmp_systemtime ();
+
+  *samplecount = msr->samplecnt;
+  msr3_free (&msr);
+
+  return (double)(end - start) / iterations;
+}
+
+int
+main (int argc, char **argv)
+{
+  static const struct
+  {
+    int8_t encoding;
+    char sampletype;
+  } encodings[] = {
+      {DE_INT16, 'i'},   {DE_INT32, 'i'},  {DE_FLOAT32, 'f'},
+      {DE_FLOAT64, 'd'}, {DE_STEIM1, 'i'}, {DE_STEIM2, 'i'},
+  };
+
+  MS3Record *msr = NULL;
+  MS3Record *pmsr = NULL;
+  int32_t *idata = NULL;
+  float *fdata = NULL;
+  double *ddata = NULL;
+  char *packed = NULL;
+  char *memory = NULL;
+  char *aligned;
+  char *unaligned;
+  uint32_t dataoffset;
+  int64_t samplecount = 0;
+  double alignedns;
+  double unalignedns;
+  int32_t value = 0;
+  size_t idx;
+  int eidx;
+
+  if (parameter_proc (argc, argv) < 0)
+    return 1;
+
+  idata = (int32_t *)malloc (MAXSAMPLES * sizeof (int32_t));
+  fdata = (float *)malloc (MAXSAMPLES * sizeof (float));
+  ddata = (double *)malloc (MAXSAMPLES * sizeof (double));
+  packed = (char *)malloc (RECLEN);
+  memory = (char *)malloc (2 * RECLEN + 64);
+
+  if (!idata || !fdata || !ddata || !packed || !memory || !(msr = msr3_init (NULL)))
+  {
+    ms_log (2, "Cannot allocate memory\n");
+    return 1;
+  }
+
+  /* A random walk with small steps, representable in all encodings */
+  srand (42);
+  for (idx = 0; idx < MAXSAMPLES; idx++)
+  {
+    value += (rand () % 201) - 100;
+    idata[idx] = value;
+    fdata[idx] = (float)value / 10.0f;
+    ddata[idx] = (double)value / 10.0;
+  }
+
+  strcpy (msr->sid, "FDSN:XX_BENCH_00_B_H_Z");
+  msr->formatversion = (uint8_t)msformat;
+  msr->reclen = RECLEN;
+  msr->starttime = ms_timestr2nstime ("2026-01-01T00:00:00");
+  msr->samprate = 100.0;
+  msr->numsamples = MAXSAMPLES;
+  msr->samplecnt = MAXSAMPLES;
+
+  printf ("%s: miniSEED %d, %d byte records, %d iterations\n", PACKAGE, msformat, RECLEN,
+          iterations);
+  printf ("%-24s %8s %14s %14s %8s\n", "Encoding", "Samples", "Aligned ns", "Unaligned ns",
+          "Ratio");
+
+  for (eidx = 0; eidx < (int)(sizeof (encodings) / sizeof (encodings[0])); eidx++)
+  {
+    msr->encoding = encodings[eidx].encoding;
+    msr->sampletype = encodings[eidx].sampletype;
+    msr->datasamples = (msr->sampletype == 'f')   ? (void *)fdata
+                       : (msr->sampletype == 'd') ? (void *)ddata
+                                                  : (void *)idata;
+
+    packed[0] = '\0';
+    if (msr3_pack (msr, record_handler, packed, NULL, MSF_FLUSHDATA, 0) < 1)
+    {
+      ms_log (2, "Cannot pack %s record\n", ms_encodingstr (msr->encoding));
+      return 1;
+    }
+
+    /* Data payload offset in the record, the payload is at the end */
+    if (msr3_parse (packed, RECLEN, &pmsr, 0, 0))
+    {
+      ms_log (2, "Cannot parse packed record\n");
+      return 1;
+    }
+
+    dataoffset = (uint32_t)(pmsr->reclen - pmsr->datalength);
+
+    /* Place the record so the payload is 8-byte aligned, and then offset by one */
+    aligned = memory + ((8 - ((uintptr_t)(memory + dataoffset) % 8)) % 8);
+    unaligned = aligned + RECLEN + 8 + 1;
+
+    memcpy (aligned, packed, RECLEN);
+    memcpy (unaligned, packed, RECLEN);
+
+    if ((alignedns = time_unpack (aligned, RECLEN, &samplecount)) < 0 ||
+        (unalignedns = time_unpack (unaligned, RECLEN, &samplecount)) < 0)
+    {
+      ms_log (2, "Cannot unpack %s record\n", ms_encodingstr (msr->encoding));
+      return 1;
+    }
+
+    printf ("%-24.24s %8" PRId64 " %14.1f %14.1f %8.3f\n", ms_encodingstr (msr->encoding),
+            samplecount, alignedns, unalignedns, unalignedns / alignedns);
+  }
+
+  msr->datasamples = NULL;
+  msr3_free (&msr);
+  msr3_free (&pmsr);
+  free (idata);
+  free (fdata);
+  free (ddata);
+  free (packed);
+  free (memory);
+
+  return 0;
+} /* End of main() */
+
+/***************************************************************************
+ * parameter_proc():
+ * Process the command line parameters.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+parameter_proc (int argcount, char **argvec)
+{
+  int optind;
+
+  for (optind = 1; optind < argcount; optind++)
+  {
+    if (strcmp (argvec[optind], "-V") == 0)
+    {
+      ms_log (1, "%s version: %s\n", PACKAGE, VERSION);
+      exit (0);
+    }
+    else if (strcmp (argvec[optind], "-h") == 0)
+    {
+      usage ();
+      exit (0);
+    }
+    else if (strcmp (argvec[optind], "-n") == 0 && optind + 1 < argcount)
+    {
+      iterations = (int)strtol (argvec[++optind], NULL, 10);
+    }
+    else if (strcmp (argvec[optind], "-F") == 0 && optind + 1 < argcount)
+    {
+      msformat = (int)strtol (argvec[++optind], NULL, 10);
+    }
+    else
+    {
+      ms_log (2, "Unknown option: %s\n", argvec[optind]);
+      return -1;
+    }
+  }
+
+  if (iterations < 1)
+  {
+    ms_log (2, "Iterations must be positive: %d\n", iterations);
+    return -1;
+  }
+
+  if (msformat != 2 && msformat != 3)
+  {
+    ms_log (2, "Unrecognized format version: %d\n", msformat);
+    return -1;
+  }
+
+  return 0;
+} /* End of parameter_proc() */
+
+/***************************************************************************
+ * usage():
+ * Print the usage message.
+ ***************************************************************************/
+static void
+usage (void)
+{
+  fprintf (stderr, "%s - Benchmark decoding of aligned and unaligned payloads %s\n\n", PACKAGE,
+           VERSION);
+  fprintf (stderr, "Usage: %s [options]\n\n", PACKAGE);
+  fprintf (stderr, " ## Options ##\n"
+                   " -V          Report program version\n"
+                   " -h          Show this usage message\n"
+                   " -n count    Number of times to unpack each record, default 20000\n"
+                   " -F format   miniSEED format version to create, 2 or 3 (default)\n"
+                   "\n");
+} /* End of usage() */
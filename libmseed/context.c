@@ -0,0 +1,304 @@
+/***************************************************************************
+ * Library context routines, independent sets of library state that
+ * are bound to threads.
+ *
+ * This file is part of the miniSEED Library.
+ *
+ * Copyright (c) 2026 Chad Trabant, EarthScope Data Services
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "internalstate.h"
+#include "libmseed.h"
+
+/* Context bound to each thread, NULL selects the default (global) state */
+lm_thread_local LMContext *lm_currentcontext = NULL;
+
+/** ************************************************************************
+ * @brief Create a new library context
+ *
+ * The context is initialized with the system malloc(), realloc() and
+ * free(), the platform default pre-allocation block size, default
+ * logging parameters, the leap second list embedded in the library
+ * and unset URL settings.
+ *
+ * The context itself is allocated with the global ::libmseed_memory
+ * functions.
+ *
+ * @returns a pointer to the new context on success and NULL on error.
+ *
+ * @ref MessageOnError - this function logs a message on error
+ *
+ * @see ms_context_bind()
+ * @see ms_context_free()
+ ***************************************************************************/
+LMContext *
+ms_context_create (void)
+{
+  LMContext *ctx;
+
+  if ((ctx = (LMContext *)libmseed_memory.malloc (sizeof (LMContext))) == NULL)
+  {
+    ms_log (2, "Cannot allocate memory\n");
+    return NULL;
+  }
+
+  memset (ctx, 0, sizeof (LMContext));
+
+  ctx->memory.malloc = malloc;
+  ctx->memory.realloc = realloc;
+  ctx->memory.free = free;
+#if defined(LMP_WIN)
+  ctx->prealloc_block_size = 1048576;
+#else
+  ctx->prealloc_block_size = 0;
+#endif
+
+  ctx->logparam = (MSLogParam)MSLogParam_INITIALIZER;
+  ctx->leapsecondlist = lm_embedded_leapsecondlist ();
+  ctx->url = (LMURLSettings)LMURLSettings_INITIALIZER;
+  ctx->readparam = (MS3FileParam)MS3FileParam_INITIALIZER;
+
+  if (lmp_mutex_init (&ctx->logmutex))
+  {
+    ms_log (2, "Cannot initialize context lock\n");
+    libmseed_memory.free (ctx);
+    return NULL;
+  }
+
+  return ctx;
+} /* End of ms_context_create() */
+
+/** ************************************************************************
+ * @brief Free a library context and all state held by it
+ *
+ * The stream used by ms3_readmsr() is closed, and the leap second
+ * list, log message registry, URL settings and memory arena are
+ * released.  If the
+ * context is bound to the calling thread the thread reverts to the
+ * default context.  The context must not be bound to any other thread.
+ *
+ * @param[in,out] ppctx Pointer-to-pointer of the context to free,
+ * set to NULL on return
+ ***************************************************************************/
+void
+ms_context_free (LMContext **ppctx)
+{
+  LMContext *ctx;
+  LMContext *previous;
+
+  if (!ppctx || !*ppctx)
+    return;
+
+  ctx = *ppctx;
+
+  /* Release state with the context bound, so it is freed with the
+   * functions that allocated it */
+  previous = ms_context_bind (ctx);
+
+  if (ctx->readparam.input.handle != NULL || ctx->readparam.readbuffer != NULL)
+  {
+    MS3FileParam *msfp = &ctx->readparam;
+    ms3_readmsr_r (&msfp, NULL, NULL, 0, 0);
+  }
+
+  lm_free_fileprefetch (&ctx->fileprefetch);
+  ms_rlog_free (&ctx->logparam);
+  lm_free_leapsecondlist (&ctx->leapsecondlist, &ctx->memory);
+  lm_free_urlsettings (&ctx->url);
+
+  ms_context_bind ((previous == ctx) ? NULL : previous);
+
+  lm_arena_destroy (ctx->arena);
+  lmp_mutex_destroy (&ctx->logmutex);
+  libmseed_memory.free (ctx);
+
+  *ppctx = NULL;
+} /* End of ms_context_free() */
+
+/** ************************************************************************
+ * @brief Bind a library context to the calling thread
+ *
+ * All subsequent library calls by the thread use the state in @p ctx,
+ * until another context is bound.  A context may be bound to more than
+ * one thread, in which case those threads share its state.
+ *
+ * @param[in] ctx Context to bind, NULL selects the default (global) state
+ *
+ * @returns the context previously bound to the thread, NULL for the default.
+ ***************************************************************************/
+LMContext *
+ms_context_bind (LMContext *ctx)
+{
+  LMContext *previous = lm_currentcontext;
+
+  lm_currentcontext = ctx;
+
+  return previous;
+} /* End of ms_context_bind() */
+
+/** ************************************************************************
+ * @brief Return the library context bound to the calling thread
+ *
+ * @returns the bound context, or NULL if the thread uses the default
+ * (global) state.
+ ***************************************************************************/
+LMContext *
+ms_context_current (void)
+{
+  return lm_currentcontext;
+} /* End of ms_context_current() */
+
+/** ************************************************************************
+ * @brief Set the memory management functions of a library context
+ *
+ * This must be done before the context is used to allocate memory.
+ *
+ * @param[in] ctx Context to configure
+ * @param[in] memory Memory management functions, NULL selects the
+ * system malloc(), realloc() and free()
+ * @param[in] prealloc_block_size Re-allocation block size as
+ * described for ::libmseed_prealloc_block_size, 0 disables
+ *
+ * @returns 0 on success and -1 on error.
+ *
+ * @ref MessageOnError - this function logs a message on error
+ ***************************************************************************/
+int
+ms_context_setmemory (LMContext *ctx, const LIBMSEED_MEMORY *memory, size_t prealloc_block_size)
+{
+  if (!ctx)
+  {
+    ms_log (2, "%s(): Required input not defined: 'ctx'\n", __func__);
+    return -1;
+  }
+
+  if (memory && (!memory->malloc || !memory->realloc || !memory->free))
+  {
+    ms_log (2, "%s(): All memory management functions must be defined\n", __func__);
+    return -1;
+  }
+
+  if (memory)
+  {
+    ctx->memory = *memory;
+  }
+  else
+  {
+    ctx->memory.malloc = malloc;
+    ctx->memory.realloc = realloc;
+    ctx->memory.free = free;
+  }
+
+  ctx->prealloc_block_size = prealloc_block_size;
+
+  return 0;
+} /* End of ms_context_setmemory() */
+
+/** ************************************************************************
+ * @brief Allocate memory for a library context from a memory arena
+ *
+ * The memory management functions of the context are set to allocate
+ * from an arena owned by the context.  Small allocations, such as
+ * records, extra headers, trace list entries and record pointers, are
+ * carved from blocks of @p blocksize bytes and are recycled when freed
+ * without returning to the system allocator.  Large allocations, such
+ * as read buffers and sample buffers, use the system allocator.
+ *
+ * All memory allocated from the arena is released at once by
+ * ms_context_resetarena() or ms_context_free(), without freeing
+ * individual structures.  This must be done before the context is used
+ * to allocate memory.
+ *
+ * @param[in] ctx Context to configure
+ * @param[in] blocksize Size of arena blocks in bytes, 0 selects the
+ * default of 1 MiB
+ *
+ * @returns 0 on success and -1 on error.
+ *
+ * @ref MessageOnError - this function logs a message on error
+ *
+ * @see ms_context_resetarena()
+ ***************************************************************************/
+int
+ms_context_setarena (LMContext *ctx, size_t blocksize)
+{
+  if (!ctx)
+  {
+    ms_log (2, "%s(): Required input not defined: 'ctx'\n", __func__);
+    return -1;
+  }
+
+  if (ctx->arena)
+  {
+    ms_log (2, "%s(): Context already uses an arena\n", __func__);
+    return -1;
+  }
+
+  if ((ctx->arena = lm_arena_create (blocksize)) == NULL)
+  {
+    ms_log (2, "Cannot allocate memory for arena\n");
+    return -1;
+  }
+
+  ctx->memory.malloc = lm_arena_malloc;
+  ctx->memory.realloc = lm_arena_realloc;
+  ctx->memory.free = lm_arena_free;
+
+  return 0;
+} /* End of ms_context_setarena() */
+
+/** ************************************************************************
+ * @brief Release all memory allocated from the arena of a library context
+ *
+ * Every structure allocated by the library while the context was bound,
+ * such as records, trace lists, selections and file parameters, becomes
+ * invalid and must not be used or freed afterwards.  State of the
+ * context itself that is allocated from the arena is cleared: the
+ * ms3_readmsr() stream is closed, the log message registry is emptied
+ * and a leap second list read from a file reverts to the embedded list.
+ *
+ * Memory blocks of the arena are retained for reuse.  The context must
+ * not be in use by any other thread.
+ *
+ * @param[in] ctx Context with an arena set by ms_context_setarena()
+ ***************************************************************************/
+void
+ms_context_resetarena (LMContext *ctx)
+{
+  LMContext *previous;
+
+  if (!ctx || !ctx->arena)
+    return;
+
+  previous = ms_context_bind (ctx);
+
+  if (ctx->readparam.input.handle != NULL || ctx->readparam.readbuffer != NULL)
+  {
+    MS3FileParam *msfp = &ctx->readparam;
+    ms3_readmsr_r (&msfp, NULL, NULL, 0, 0);
+  }
+
+  lm_free_fileprefetch (&ctx->fileprefetch);
+  ms_rlog_free (&ctx->logparam);
+  lm_free_leapsecondlist (&ctx->leapsecondlist, &ctx->memory);
+  ctx->leapsecondlist = lm_embedded_leapsecondlist ();
+
+  lm_arena_reset (ctx->arena);
+
+  ms_context_bind (previous);
+} /* End of ms_context_resetarena() */
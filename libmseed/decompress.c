@@ -0,0 +1,1050 @@
+/***************************************************************************
+ * Streaming decompression of compressed input.
+ *
+ * Files compressed with gzip, xz or zstd are identified by the magic
+ * bytes at the start of the file and read through a decompressor that
+ * wraps the handle of the compressed data, see msio_fopen().  Support
+ * for each format is included by building the library with the
+ * LIBMSEED_GZIP (zlib), LIBMSEED_XZ (liblzma) or LIBMSEED_ZSTD (libzstd)
+ * variables defined.
+ *
+ * The start of each gzip member or zstd frame is kept in a frame index
+ * that maps offsets in the decompressed data to the compressed data.
+ * Files in the zstd seekable format list all frames in a seek table at
+ * the end of the file, which is read when the file is opened.  Their
+ * reading starts at the frame containing the start offset, and frames
+ * are decompressed as a whole, in batches divided among threads.
+ *
+ * This file is part of the miniSEED Library.
+ *
+ * Copyright (c) 2026 Chad Trabant, EarthScope Data Services
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include <string.h>
+
+#include "internalstate.h"
+#include "msio.h"
+#include "threadutils.h"
+
+#if defined(LIBMSEED_GZIP)
+#include <zlib.h>
+#endif
+#if defined(LIBMSEED_XZ)
+#include <lzma.h>
+#endif
+#if defined(LIBMSEED_ZSTD)
+#include <zstd.h>
+#endif
+
+/* Size of the buffer of compressed data read from the source */
+#define LM_DECOMPRESS_BUFSIZE 1048576
+
+/* Maximum number of jobs decompressing a batch of seekable frames */
+#define LM_DECOMPRESS_JOBS 8
+
+/* Length of decompressed data of each job of a batch, at least a frame */
+#define LM_DECOMPRESS_JOBSIZE 1048576
+
+/* Maximum size of a seekable frame decompressed as a whole */
+#define LM_DECOMPRESS_MAXFRAME 16777216
+
+/* Start of a gzip member, xz stream or zstd frame */
+typedef struct LMDecompressFrame
+{
+  int64_t compressed;   /* Offset in the compressed data */
+  int64_t decompressed; /* Offset in the decompressed data */
+} LMDecompressFrame;
+
+#if defined(LIBMSEED_ZSTD)
+/* Consecutive seekable frames of a batch decompressed by one thread */
+typedef struct LMDecompressJob
+{
+  ZSTD_DCtx *dctx;                 /* Decompression context of the job */
+  const LMDecompressFrame *frames; /* First frame, followed by the start of the next */
+  int framecount;                  /* Number of frames */
+  const uint8_t *input;            /* Compressed data of the frames */
+  uint8_t *output;                 /* Decompressed data of the frames */
+  int error;                       /* Decompression failed */
+} LMDecompressJob;
+#endif
+
+/* Decompressor of a compressed stream */
+typedef struct LMDecompress
+{
+  LMIO source;               /* Handle of the compressed data */
+  int format;                /* One of the LM_DECOMPRESS_* formats */
+  uint8_t *input;            /* Compressed data read from the source */
+  size_t inputlen;           /* Length of data in input buffer */
+  size_t inputpos;           /* Position of data not yet decompressed */
+  int64_t inputbase;         /* Offset of the input buffer in the compressed data */
+  int64_t outputpos;         /* Offset of the next data decompressed */
+  int inputeof;              /* End of the source has been reached */
+  int streamend;             /* End of a compressed stream was decoded last */
+  int eof;                   /* All data has been decompressed */
+  int error;                 /* Decompression failed */
+  LMDecompressFrame *frames; /* Index of frames, in order */
+  int framecount;            /* Number of frames in index */
+  int framemax;              /* Number of frames allocated */
+  int seekable;              /* Frames are listed by a seek table, followed by the end */
+  lmp_mutex_t framelock;     /* Lock of frames added while reading */
+#if defined(LIBMSEED_GZIP)
+  z_stream gzip;
+#endif
+#if defined(LIBMSEED_XZ)
+  lzma_stream xz;
+#endif
+#if defined(LIBMSEED_ZSTD)
+  ZSTD_DStream *zstd;
+  int wholeframes;       /* Seekable frames are decompressed as a whole */
+  int nextframe;         /* Next seekable frame to decompress */
+  uint8_t *batchinput;   /* Compressed data of a batch */
+  size_t batchinputsize; /* Size of batch input buffer */
+  uint8_t *batch;        /* Decompressed data of a batch */
+  size_t batchsize;      /* Size of batch buffer */
+  size_t batchlen;       /* Length of data in batch buffer */
+  size_t batchpos;       /* Position of data not yet read */
+  int jobcount;          /* Maximum number of jobs of a batch */
+  LMDecompressJob jobs[LM_DECOMPRESS_JOBS];
+#endif
+} LMDecompress;
+
+/* Name of a compression format for messages */
+static const char *
+format_name (int format)
+{
+  switch (format)
+  {
+  case LM_DECOMPRESS_GZIP:
+    return "gzip";
+  case LM_DECOMPRESS_XZ:
+    return "xz";
+  case LM_DECOMPRESS_ZSTD:
+    return "zstd";
+  }
+
+  return "unknown";
+}
+
+/***************************************************************************
+ * Identify the compression format of data from its first bytes.
+ *
+ * Returns one of the LM_DECOMPRESS_* formats, LM_DECOMPRESS_NONE when the
+ * data is not compressed in a known format.
+ ***************************************************************************/
+int
+lm_decompress_format (const uint8_t *header, size_t length)
+{
+  static const uint8_t xzmagic[6] = {0xFD, '7', 'z', 'X', 'Z', 0x00};
+
+  if (!header)
+    return LM_DECOMPRESS_NONE;
+
+  if (length >= 2 && header[0] == 0x1F && header[1] == 0x8B)
+    return LM_DECOMPRESS_GZIP;
+
+  if (length >= 6 && memcmp (header, xzmagic, 6) == 0)
+    return LM_DECOMPRESS_XZ;
+
+  /* zstd frame, or the skippable frame that may precede one */
+  if (length >= 4 && header[0] == 0x28 && header[1] == 0xB5 && header[2] == 0x2F &&
+      header[3] == 0xFD)
+    return LM_DECOMPRESS_ZSTD;
+
+  if (length >= 4 && (header[0] & 0xF0) == 0x50 && header[1] == 0x2A && header[2] == 0x4D &&
+      header[3] == 0x18)
+    return LM_DECOMPRESS_ZSTD;
+
+  return LM_DECOMPRESS_NONE;
+} /* End of lm_decompress_format() */
+
+/***************************************************************************
+ * Return non-zero if decompression of a format is included in the library.
+ ***************************************************************************/
+int
+lm_decompress_support (int format)
+{
+  switch (format)
+  {
+#if defined(LIBMSEED_GZIP)
+  case LM_DECOMPRESS_GZIP:
+    return 1;
+#endif
+#if defined(LIBMSEED_XZ)
+  case LM_DECOMPRESS_XZ:
+    return 1;
+#endif
+#if defined(LIBMSEED_ZSTD)
+  case LM_DECOMPRESS_ZSTD:
+    return 1;
+#endif
+  }
+
+  return 0;
+} /* End of lm_decompress_support() */
+
+/* Release the decoder state of a decompressor */
+static void
+decompress_end (LMDecompress *dc)
+{
+#if defined(LIBMSEED_GZIP)
+  if (dc->format == LM_DECOMPRESS_GZIP)
+    inflateEnd (&dc->gzip);
+#endif
+#if defined(LIBMSEED_XZ)
+  if (dc->format == LM_DECOMPRESS_XZ)
+    lzma_end (&dc->xz);
+#endif
+#if defined(LIBMSEED_ZSTD)
+  int idx;
+
+  if (dc->format == LM_DECOMPRESS_ZSTD && dc->zstd)
+    ZSTD_freeDStream (dc->zstd);
+
+  for (idx = 0; idx < LM_DECOMPRESS_JOBS; idx++)
+  {
+    if (dc->jobs[idx].dctx)
+      ZSTD_freeDCtx (dc->jobs[idx].dctx);
+  }
+#endif
+}
+
+/* Release a decompressor and all of its buffers */
+static void
+decompress_free (LMDecompress *dc)
+{
+  decompress_end (dc);
+  lmp_mutex_destroy (&dc->framelock);
+
+#if defined(LIBMSEED_ZSTD)
+  lm_memory ()->free (dc->batchinput);
+  lm_memory ()->free (dc->batch);
+#endif
+  lm_memory ()->free (dc->frames);
+  lm_memory ()->free (dc->input);
+  lm_memory ()->free (dc);
+}
+
+/* Add the start of a frame to the index, replacing the last frame when it
+ * contains no decompressed data.  Returns 0 on success and -1 on error. */
+static int
+decompress_addframe (LMDecompress *dc, int64_t compressed, int64_t decompressed)
+{
+  LMDecompressFrame *frames;
+  int framemax;
+  int rv = 0;
+
+  lmp_mutex_lock (&dc->framelock);
+
+  if (dc->framecount > 0 && dc->frames[dc->framecount - 1].decompressed == decompressed)
+  {
+    dc->frames[dc->framecount - 1].compressed = compressed;
+  }
+  else
+  {
+    if (dc->framecount >= dc->framemax)
+    {
+      framemax = (dc->framemax > 0) ? dc->framemax * 2 : 16;
+
+      if ((frames = (LMDecompressFrame *)lm_memory ()->realloc (
+               dc->frames, (size_t)framemax * sizeof (LMDecompressFrame))) == NULL)
+        rv = -1;
+      else
+      {
+        dc->frames = frames;
+        dc->framemax = framemax;
+      }
+    }
+
+    if (rv == 0)
+    {
+      dc->frames[dc->framecount].compressed = compressed;
+      dc->frames[dc->framecount].decompressed = decompressed;
+      dc->framecount++;
+    }
+  }
+
+  lmp_mutex_unlock (&dc->framelock);
+
+  return rv;
+}
+
+/* Find the last of a count of frames starting at or before an offset in
+ * the decompressed data, the first frame when none do */
+static int
+decompress_findframe (const LMDecompressFrame *frames, int count, int64_t offset)
+{
+  int low = 0;
+  int high = count - 1;
+  int mid;
+
+  while (low < high)
+  {
+    mid = low + (high - low + 1) / 2;
+
+    if (frames[mid].decompressed <= offset)
+      low = mid;
+    else
+      high = mid - 1;
+  }
+
+  return low;
+}
+
+#if defined(LIBMSEED_ZSTD)
+/* Read a length of compressed data from the source completely.
+ * Returns 0 on success and -1 on error or at the end of the source. */
+static int
+decompress_readsource (LMDecompress *dc, uint8_t *buffer, size_t length)
+{
+  int64_t readcount;
+
+  while (length > 0)
+  {
+    if ((readcount = msio_fread (&dc->source, buffer, length)) <= 0)
+      return -1;
+
+    buffer += readcount;
+    length -= (size_t)readcount;
+  }
+
+  return 0;
+}
+
+/* Return a little-endian 32-bit value */
+static uint32_t
+decompress_le32 (const uint8_t *bytes)
+{
+  return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) |
+         ((uint32_t)bytes[3] << 24);
+}
+
+/* Read the seek table at the end of data in the zstd seekable format,
+ * a skippable frame that lists the sizes of the frames before it, and
+ * index all frames followed by the end of the frames.  Data without a
+ * valid seek table is read as a stream.  The source is positioned at the
+ * start of the data afterwards.
+ * Returns 0 on success, including when there is no seek table, and -1 on
+ * error. */
+static int
+decompress_seektable (LMDecompress *dc)
+{
+  LMDecompressFrame *frames = NULL;
+  uint8_t footer[9];
+  uint8_t *table = NULL;
+  const uint8_t *entry;
+  int64_t length;
+  int64_t tablestart;
+  int64_t compressed = 0;
+  int64_t decompressed = 0;
+  uint32_t count;
+  uint32_t idx;
+  size_t entrysize;
+  size_t tablesize;
+  int wholeframes = 1;
+  int rv = 0;
+
+  /* Only files and prefetched files can be positioned, others are streams */
+  if ((length = msio_fseek (&dc->source, 0, SEEK_END)) < 0)
+    return 0;
+
+  /* Footer: number of frames, descriptor and seekable magic number */
+  if (length < 17 || msio_fseek (&dc->source, length - 9, SEEK_SET) < 0 ||
+      decompress_readsource (dc, footer, sizeof (footer)))
+  {
+    rv = (length < 17) ? 0 : -1;
+    goto rewind;
+  }
+
+  if (decompress_le32 (footer + 5) != 0x8F92EAB1 || (footer[4] & 0x7C))
+    goto rewind;
+
+  count = decompress_le32 (footer);
+  entrysize = (footer[4] & 0x80) ? 12 : 8;
+
+  if ((int64_t)count * (int64_t)entrysize + 17 > length || count > INT32_MAX - 1)
+    goto rewind;
+
+  /* Skippable frame header and entries of the seek table */
+  tablesize = (size_t)count * entrysize + 9;
+  tablestart = length - (int64_t)tablesize - 8;
+
+  if (!(table = (uint8_t *)lm_memory ()->malloc (tablesize - 1)) ||
+      !(frames = (LMDecompressFrame *)lm_memory ()->malloc (((size_t)count + 1) *
+                                                              sizeof (LMDecompressFrame))))
+  {
+    ms_log (2, "Cannot allocate memory for decompression\n");
+    rv = -1;
+    goto rewind;
+  }
+
+  if (msio_fseek (&dc->source, tablestart, SEEK_SET) < 0 ||
+      decompress_readsource (dc, table, tablesize - 1))
+  {
+    rv = -1;
+    goto rewind;
+  }
+
+  if (decompress_le32 (table) != 0x184D2A5E || decompress_le32 (table + 4) != tablesize)
+    goto rewind;
+
+  for (idx = 0, entry = table + 8; idx < count; idx++, entry += entrysize)
+  {
+    frames[idx].compressed = compressed;
+    frames[idx].decompressed = decompressed;
+
+    compressed += decompress_le32 (entry);
+    decompressed += decompress_le32 (entry + 4);
+
+    if (decompress_le32 (entry) > LM_DECOMPRESS_MAXFRAME ||
+        decompress_le32 (entry + 4) > LM_DECOMPRESS_MAXFRAME)
+      wholeframes = 0;
+  }
+
+  frames[count].compressed = compressed;
+  frames[count].decompressed = decompressed;
+
+  /* Frames fill the data before the seek table */
+  if (compressed != tablestart)
+    goto rewind;
+
+  lm_memory ()->free (dc->frames);
+  dc->frames = frames;
+  dc->framecount = (int)count;
+  dc->framemax = (int)count + 1;
+  dc->seekable = 1;
+  dc->wholeframes = wholeframes;
+  frames = NULL;
+
+rewind:
+  lm_memory ()->free (table);
+  lm_memory ()->free (frames);
+
+  if (msio_fseek (&dc->source, 0, SEEK_SET) < 0)
+    rv = -1;
+
+  return rv;
+}
+
+/* Decompress the frames of a job, run by helper threads */
+static void *
+decompress_job (void *arg)
+{
+  LMDecompressJob *job = (LMDecompressJob *)arg;
+  const LMDecompressFrame *frame;
+  size_t outputlen;
+  size_t rv;
+  int idx;
+
+  for (idx = 0; idx < job->framecount && !job->error; idx++)
+  {
+    frame = &job->frames[idx];
+    outputlen = (size_t)(frame[1].decompressed - frame->decompressed);
+
+    rv = ZSTD_decompressDCtx (job->dctx,
+                              job->output + (frame->decompressed - job->frames->decompressed),
+                              outputlen,
+                              job->input + (frame->compressed - job->frames->compressed),
+                              (size_t)(frame[1].compressed - frame->compressed));
+
+    if (ZSTD_isError (rv) || rv != outputlen)
+      job->error = 1;
+  }
+
+  return NULL;
+}
+
+/* Decompress the next batch of seekable frames.  Consecutive frames are
+ * divided among jobs of about LM_DECOMPRESS_JOBSIZE decompressed bytes,
+ * with jobs beyond the first run by helper threads when available.
+ * Returns 0 on success and -1 on error. */
+static int
+decompress_batch (LMDecompress *dc)
+{
+  lmp_thread_t threads[LM_DECOMPRESS_JOBS];
+  int started[LM_DECOMPRESS_JOBS];
+  const LMDecompressFrame *first = &dc->frames[dc->nextframe];
+  const LMDecompressFrame *next = first;
+  const LMDecompressFrame *end = &dc->frames[dc->framecount];
+  LMDecompressJob *job;
+  size_t inputlen;
+  size_t outputlen;
+  uint8_t *buffer;
+  int jobcount;
+  int idx;
+  int rv = 0;
+
+  for (jobcount = 0; jobcount < dc->jobcount && next < end; jobcount++)
+  {
+    job = &dc->jobs[jobcount];
+    job->frames = next;
+    job->framecount = 0;
+    job->error = 0;
+
+    do
+    {
+      next++;
+      job->framecount++;
+    } while (next < end && next->decompressed - job->frames->decompressed < LM_DECOMPRESS_JOBSIZE);
+  }
+
+  inputlen = (size_t)(next->compressed - first->compressed);
+  outputlen = (size_t)(next->decompressed - first->decompressed);
+
+  if (inputlen > dc->batchinputsize)
+  {
+    if (!(buffer = (uint8_t *)lm_memory ()->realloc (dc->batchinput, inputlen)))
+    {
+      ms_log (2, "Cannot allocate memory for decompression\n");
+      return -1;
+    }
+
+    dc->batchinput = buffer;
+    dc->batchinputsize = inputlen;
+  }
+
+  if (outputlen > dc->batchsize)
+  {
+    if (!(buffer = (uint8_t *)lm_memory ()->realloc (dc->batch, outputlen)))
+    {
+      ms_log (2, "Cannot allocate memory for decompression\n");
+      return -1;
+    }
+
+    dc->batch = buffer;
+    dc->batchsize = outputlen;
+  }
+
+  if (decompress_readsource (dc, dc->batchinput, inputlen))
+  {
+    ms_log (2, "Error reading compressed input\n");
+    return -1;
+  }
+
+  for (idx = 0; idx < jobcount; idx++)
+  {
+    job = &dc->jobs[idx];
+    job->input = dc->batchinput + (job->frames->compressed - first->compressed);
+    job->output = dc->batch + (job->frames->decompressed - first->decompressed);
+  }
+
+  /* Jobs that cannot be run by a helper thread are run in this thread */
+  for (idx = 1; idx < jobcount; idx++)
+    started[idx] = (lmp_thread_create (&threads[idx], decompress_job, &dc->jobs[idx]) == 0);
+
+  decompress_job (&dc->jobs[0]);
+
+  for (idx = 1; idx < jobcount; idx++)
+  {
+    if (started[idx])
+      lmp_thread_join (threads[idx]);
+    else
+      decompress_job (&dc->jobs[idx]);
+  }
+
+  for (idx = 0; idx < jobcount; idx++)
+  {
+    if (dc->jobs[idx].error)
+    {
+      ms_log (2, "Error decompressing zstd input, data is corrupt\n");
+      rv = -1;
+      break;
+    }
+  }
+
+  dc->nextframe = (int)(next - dc->frames);
+  dc->batchlen = (rv == 0) ? outputlen : 0;
+  dc->batchpos = 0;
+
+  return rv;
+}
+#endif
+
+/* Read more compressed data from the source when all has been consumed.
+ * Returns 0 on success, including at the end of the source, and -1 on
+ * error. */
+static int
+decompress_refill (LMDecompress *dc)
+{
+  int64_t readcount;
+
+  if (dc->inputpos < dc->inputlen || dc->inputeof)
+    return 0;
+
+  dc->inputbase += (int64_t)dc->inputlen;
+
+  readcount = msio_fread (&dc->source, dc->input, LM_DECOMPRESS_BUFSIZE);
+
+  dc->inputlen = (readcount > 0) ? (size_t)readcount : 0;
+  dc->inputpos = 0;
+
+  if (readcount <= 0)
+  {
+    if (!msio_feof (&dc->source))
+      return -1;
+
+    dc->inputeof = 1;
+  }
+
+  return 0;
+}
+
+/* Decompress into a buffer from the compressed data available.
+ * Returns the number of bytes produced, 0 when more input is needed or
+ * at the end of the data, and -1 on error. */
+static int64_t
+decompress_step (LMDecompress *dc, uint8_t *buffer, size_t size)
+{
+  size_t available = dc->inputlen - dc->inputpos;
+  size_t produced = 0;
+
+  /* Index the start of the next gzip member or zstd frame */
+  if (dc->streamend && available > 0 && !dc->seekable &&
+      decompress_addframe (dc, dc->inputbase + (int64_t)dc->inputpos, dc->outputpos))
+    return -1;
+
+#if defined(LIBMSEED_GZIP)
+  if (dc->format == LM_DECOMPRESS_GZIP)
+  {
+    int rv;
+
+    /* Start the next member of concatenated gzip data */
+    if (dc->streamend)
+    {
+      if (available == 0)
+        return 0;
+
+      if (inflateReset (&dc->gzip) != Z_OK)
+        return -1;
+
+      dc->streamend = 0;
+    }
+
+    dc->gzip.next_in = dc->input + dc->inputpos;
+    dc->gzip.avail_in = (uInt)available;
+    dc->gzip.next_out = buffer;
+    dc->gzip.avail_out = (uInt)size;
+
+    rv = inflate (&dc->gzip, Z_NO_FLUSH);
+
+    dc->inputpos += available - dc->gzip.avail_in;
+    produced = size - dc->gzip.avail_out;
+
+    if (rv == Z_STREAM_END)
+      dc->streamend = 1;
+    else if (rv != Z_OK && !(rv == Z_BUF_ERROR && produced == 0))
+      return -1;
+
+    return (int64_t)produced;
+  }
+#endif
+
+#if defined(LIBMSEED_XZ)
+  if (dc->format == LM_DECOMPRESS_XZ)
+  {
+    lzma_ret rv;
+
+    dc->xz.next_in = dc->input + dc->inputpos;
+    dc->xz.avail_in = available;
+    dc->xz.next_out = buffer;
+    dc->xz.avail_out = size;
+
+    /* Concatenated streams are decoded until finished at the end of input */
+    rv = lzma_code (&dc->xz, (dc->inputeof) ? LZMA_FINISH : LZMA_RUN);
+
+    dc->inputpos += available - dc->xz.avail_in;
+    produced = size - dc->xz.avail_out;
+
+    if (rv == LZMA_STREAM_END)
+      dc->streamend = 1;
+    else if (rv != LZMA_OK && !(rv == LZMA_BUF_ERROR && produced == 0 && !dc->inputeof))
+      return -1;
+
+    return (int64_t)produced;
+  }
+#endif
+
+#if defined(LIBMSEED_ZSTD)
+  if (dc->format == LM_DECOMPRESS_ZSTD)
+  {
+    ZSTD_inBuffer in = {dc->input + dc->inputpos, available, 0};
+    ZSTD_outBuffer out = {buffer, size, 0};
+    size_t rv;
+
+    rv = ZSTD_decompressStream (dc->zstd, &out, &in);
+
+    if (ZSTD_isError (rv))
+      return -1;
+
+    dc->inputpos += in.pos;
+    produced = out.pos;
+
+    /* A frame is complete, further frames may follow */
+    dc->streamend = (rv == 0);
+
+    return (int64_t)produced;
+  }
+#endif
+
+  (void)buffer;
+  (void)size;
+  (void)available;
+  (void)produced;
+
+  return -1;
+}
+
+/***************************************************************************
+ * Read an IO handle through a decompressor for the specified format.
+ *
+ * The handle of the compressed data, positioned at its start, is moved
+ * into the decompressor and the IO handle becomes an LMIO_DECOMPRESS
+ * handle.  When a start offset is specified, that many bytes of the
+ * decompressed data are skipped.  For seekable zstd data reading starts
+ * at the frame containing the start offset, and only the data of that
+ * frame before the offset is skipped.
+ *
+ * Returns 0 on success and -1 on error, leaving the IO handle unchanged.
+ *
+ * @ref MessageOnError - this function logs a message on error
+ ***************************************************************************/
+int
+lm_decompress_open (LMIO *io, int format, const char *path, int64_t startoffset)
+{
+  LMDecompress *dc;
+  int initialized = 0;
+  int idx;
+
+  if (!io || !io->handle)
+    return -1;
+
+  if (!lm_decompress_support (format))
+  {
+    ms_log (2, "Cannot read %s: %s compressed input is not supported by this build\n", path,
+            format_name (format));
+    return -1;
+  }
+
+  if (!(dc = (LMDecompress *)lm_memory ()->malloc (sizeof (LMDecompress))))
+  {
+    ms_log (2, "Cannot allocate memory for decompression\n");
+    return -1;
+  }
+
+  memset (dc, 0, sizeof (LMDecompress));
+  dc->format = format;
+  lmp_mutex_init (&dc->framelock);
+
+  if (!(dc->input = (uint8_t *)lm_memory ()->malloc (LM_DECOMPRESS_BUFSIZE)))
+  {
+    ms_log (2, "Cannot allocate memory for decompression\n");
+    decompress_free (dc);
+    return -1;
+  }
+
+#if defined(LIBMSEED_GZIP)
+  if (format == LM_DECOMPRESS_GZIP)
+    initialized = (inflateInit2 (&dc->gzip, 15 + 16) == Z_OK);
+#endif
+#if defined(LIBMSEED_XZ)
+  if (format == LM_DECOMPRESS_XZ)
+  {
+    dc->xz = (lzma_stream)LZMA_STREAM_INIT;
+    initialized = (lzma_stream_decoder (&dc->xz, UINT64_MAX, LZMA_CONCATENATED) == LZMA_OK);
+  }
+#endif
+#if defined(LIBMSEED_ZSTD)
+  if (format == LM_DECOMPRESS_ZSTD)
+  {
+    dc->zstd = ZSTD_createDStream ();
+    initialized = (dc->zstd && !ZSTD_isError (ZSTD_initDStream (dc->zstd)));
+  }
+#endif
+
+  /* The first frame starts at the start of the data */
+  if (!initialized || decompress_addframe (dc, 0, 0))
+  {
+    ms_log (2, "Cannot initialize %s decompression for %s\n", format_name (format), path);
+    decompress_free (dc);
+    return -1;
+  }
+
+  dc->source = *io;
+
+#if defined(LIBMSEED_ZSTD)
+  if (format == LM_DECOMPRESS_ZSTD)
+  {
+    if (decompress_seektable (dc))
+    {
+      ms_log (2, "Cannot read seek table of %s\n", path);
+      decompress_free (dc);
+      return -1;
+    }
+
+    /* Seekable frames are decompressed as a whole by up to LM_DECOMPRESS_JOBS jobs */
+    if (dc->wholeframes)
+    {
+      dc->jobcount = lm_resolve_threads (0);
+
+      if (dc->jobcount > LM_DECOMPRESS_JOBS)
+        dc->jobcount = LM_DECOMPRESS_JOBS;
+
+      for (idx = 0; idx < dc->jobcount && initialized; idx++)
+        initialized = ((dc->jobs[idx].dctx = ZSTD_createDCtx ()) != NULL);
+
+      if (!initialized)
+      {
+        ms_log (2, "Cannot initialize %s decompression for %s\n", format_name (format), path);
+          decompress_free (dc);
+        return -1;
+      }
+    }
+  }
+#endif
+
+  /* Start reading at the seekable frame containing the start offset */
+  if (dc->seekable && startoffset > 0)
+  {
+    if (startoffset >= dc->frames[dc->framecount].decompressed)
+      idx = dc->framecount;
+    else
+      idx = decompress_findframe (dc->frames, dc->framecount, startoffset);
+
+    if (msio_fseek (&dc->source, dc->frames[idx].compressed, SEEK_SET) < 0)
+    {
+      ms_log (2, "Cannot seek in %s to offset %" PRId64 "\n", path, dc->frames[idx].compressed);
+      decompress_free (dc);
+      return -1;
+    }
+
+    dc->inputbase = dc->frames[idx].compressed;
+    dc->outputpos = dc->frames[idx].decompressed;
+#if defined(LIBMSEED_ZSTD)
+    dc->nextframe = idx;
+#endif
+    startoffset -= dc->frames[idx].decompressed;
+  }
+
+  io->type = LMIO_DECOMPRESS;
+  io->handle = dc;
+  io->handle2 = NULL;
+
+  /* Skip decompressed data before the start offset */
+  while (startoffset > 0)
+  {
+    char discard[16384];
+    int64_t readcount;
+
+    readcount = lm_decompress_read (io, discard,
+                                    (startoffset < (int64_t)sizeof (discard))
+                                        ? (size_t)startoffset
+                                        : sizeof (discard));
+
+    if (readcount <= 0)
+    {
+      if (readcount < 0 || !lm_decompress_eof (io))
+      {
+        ms_log (2, "Cannot skip to offset in decompressed %s\n", path);
+        *io = dc->source;
+        decompress_free (dc);
+        return -1;
+      }
+
+      break;
+    }
+
+    startoffset -= readcount;
+  }
+
+  return 0;
+} /* End of lm_decompress_open() */
+
+/***************************************************************************
+ * Read decompressed data from an LMIO_DECOMPRESS handle.
+ *
+ * Returns the number of bytes read, 0 at the end of the data and -1 on
+ * error.
+ *
+ * @ref MessageOnError - this function logs a message on error
+ ***************************************************************************/
+int64_t
+lm_decompress_read (LMIO *io, void *buffer, size_t size)
+{
+  LMDecompress *dc = (LMDecompress *)io->handle;
+  int64_t total = 0;
+  int64_t produced;
+
+  if (dc->error)
+    return -1;
+
+#if defined(LIBMSEED_ZSTD)
+  /* Seekable frames decompressed in batches */
+  while (dc->wholeframes && (size_t)total < size && !dc->eof)
+  {
+    if (dc->batchpos >= dc->batchlen)
+    {
+      if (dc->nextframe >= dc->framecount)
+      {
+        dc->eof = 1;
+        break;
+      }
+
+      if (decompress_batch (dc))
+      {
+        dc->error = 1;
+        break;
+      }
+
+      continue;
+    }
+
+    produced = (int64_t)(dc->batchlen - dc->batchpos);
+
+    if (produced > (int64_t)size - total)
+      produced = (int64_t)size - total;
+
+    memcpy ((uint8_t *)buffer + total, dc->batch + dc->batchpos, (size_t)produced);
+
+    dc->batchpos += (size_t)produced;
+    total += produced;
+  }
+#endif
+
+  while ((size_t)total < size && !dc->eof && !dc->error)
+  {
+    if (decompress_refill (dc))
+    {
+      ms_log (2, "Error reading compressed input\n");
+      dc->error = 1;
+      break;
+    }
+
+    /* End of the data once the source is exhausted at the end of a stream */
+    if (dc->inputeof && dc->inputpos >= dc->inputlen && dc->streamend)
+    {
+      dc->eof = 1;
+      break;
+    }
+
+    produced = decompress_step (dc, (uint8_t *)buffer + total, size - (size_t)total);
+
+    if (produced < 0)
+    {
+      ms_log (2, "Error decompressing %s input, data is corrupt\n", format_name (dc->format));
+      dc->error = 1;
+      break;
+    }
+
+    total += produced;
+
+    lmp_mutex_lock (&dc->framelock);
+    dc->outputpos += produced;
+    lmp_mutex_unlock (&dc->framelock);
+
+    /* No progress with the source exhausted, the compressed data is truncated */
+    if (produced == 0 && dc->inputeof && dc->inputpos >= dc->inputlen && !dc->streamend)
+    {
+      ms_log (2, "Error decompressing %s input, data is truncated\n", format_name (dc->format));
+      dc->error = 1;
+      break;
+    }
+  }
+
+  if (dc->error && total == 0)
+    return -1;
+
+  return total;
+} /* End of lm_decompress_read() */
+
+/***************************************************************************
+ * Return non-zero when all data of an LMIO_DECOMPRESS handle has been
+ * read.
+ ***************************************************************************/
+int
+lm_decompress_eof (LMIO *io)
+{
+  return ((LMDecompress *)io->handle)->eof;
+} /* End of lm_decompress_eof() */
+
+/***************************************************************************
+ * Map an offset in the decompressed data of an LMIO_DECOMPRESS handle to
+ * the frame containing it: the offset of the frame in the compressed
+ * data and the offset within the decompressed data of the frame.
+ *
+ * The frames of seekable zstd data are known from the seek table, others
+ * are indexed as they are decompressed and the offset must be of data
+ * decompressed already.  Concatenated xz streams are not distinguished.
+ *
+ * This may be called while another thread reads from the handle.
+ *
+ * Returns 0 on success and -1 when the offset is not known.
+ ***************************************************************************/
+int
+lm_decompress_offset (LMIO *io, int64_t offset, int64_t *compressed, int64_t *skip)
+{
+  LMDecompress *dc = (LMDecompress *)io->handle;
+  int idx;
+  int rv = -1;
+
+  if (offset < 0)
+    return -1;
+
+  /* The frames of a seek table are not changed while reading */
+  if (dc->seekable)
+  {
+    if (offset >= dc->frames[dc->framecount].decompressed)
+      return -1;
+
+    idx = decompress_findframe (dc->frames, dc->framecount, offset);
+    *compressed = dc->frames[idx].compressed;
+    *skip = offset - dc->frames[idx].decompressed;
+
+    return 0;
+  }
+
+  lmp_mutex_lock (&dc->framelock);
+
+  if (offset < dc->outputpos)
+  {
+    idx = decompress_findframe (dc->frames, dc->framecount, offset);
+    *compressed = dc->frames[idx].compressed;
+    *skip = offset - dc->frames[idx].decompressed;
+    rv = 0;
+  }
+
+  lmp_mutex_unlock (&dc->framelock);
+
+  return rv;
+} /* End of lm_decompress_offset() */
+
+/***************************************************************************
+ * Close an LMIO_DECOMPRESS handle, closing the handle of the compressed
+ * data and releasing the decompressor.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+int
+lm_decompress_close (LMIO *io)
+{
+  LMDecompress *dc = (LMDecompress *)io->handle;
+  int rv;
+
+  rv = msio_fclose (&dc->source);
+
+  decompress_free (dc);
+
+  io->handle = NULL;
+
+  return rv;
+} /* End of lm_decompress_close() */
@@ -100,6 +100,7 @@ int
 main (int argc, char **argv)
 {
   FileEntry *fe    = NULL;
+  MS3TraceList *mstl = NULL;
   int idx;
 
   /* Simplistic argument parsing */
@@ -174,15 +175,29 @@ main (int argc, char **argv)
     pthread_join(fe->tid, NULL);
   }
 
-  /* Report details for each file */
+  if ((mstl = mstl3_init (NULL)) == NULL)
+    return -1;
+
+  /* Report details for each file and merge trace lists */
   for (fe = files; fe; fe = fe->next)
   {
     ms_log (0, "%s: records: %" PRIu64" result: %d\n",
             fe->filename, fe->recordcount, fe->result);
 
     if (fe->result == MS_NOERROR || fe->result == MS_ENDOFFILE)
-      mstl3_printtracelist (fe->mstl, ISOMONTHDAY, 1, 1, 0);
+    {
+      if (mstl3_merge (mstl, &fe->mstl, 0, 1, 0, NULL))
+      {
+        ms_log (2, "Error merging trace list of %s\n", fe->filename);
+        return -1;
+      }
+    }
   }
 
+  /* Print the combined trace list */
+  mstl3_printtracelist (mstl, ISOMONTHDAY, 1, 1, 0);
+
+  mstl3_free (&mstl, 0);
+
   return 0;
 } /* End of main() */
@@ -21,6 +21,7 @@
 #include <float.h>
 
 #include "extraheaders.h"
+#include "internalstate.h"
 #include "libmseed.h"
 
 /* Private allocation wrappers for yyjson's allocator definition */
@@ -28,7 +29,7 @@ void *
 _priv_malloc (void *ctx, size_t size)
 {
   UNUSED (ctx);
-  return libmseed_memory.malloc (size);
+  return lm_memory ()->malloc (size);
 }
 
 void *
@@ -36,14 +37,14 @@ _priv_realloc (void *ctx, void *ptr, size_t oldsize, size_t size)
 {
   UNUSED (ctx);
   UNUSED (oldsize);
-  return libmseed_memory.realloc (ptr, size);
+  return lm_memory ()->realloc (ptr, size);
 }
 
 void
 _priv_free (void *ctx, void *ptr)
 {
   UNUSED (ctx);
-  libmseed_memory.free (ptr);
+  lm_memory ()->free (ptr);
 }
 
 /* Mark a real for single-precision serialization, but only when the
@@ -81,7 +82,7 @@ parse_json (char *jsonstring, size_t length, LM_PARSED_JSON *parsed)
   /* Allocate parsed state if needed */
   if (!parsed)
   {
-    if ((parsed = libmseed_memory.malloc (sizeof (LM_PARSED_JSON))) == NULL)
+    if ((parsed = lm_memory ()->malloc (sizeof (LM_PARSED_JSON))) == NULL)
     {
       ms_log (2, "%s() Cannot allocate memory for internal JSON parsing state\n", __func__);
       return NULL;
@@ -174,6 +175,10 @@ mseh_get_ptr_type (const MS3Record *msr, const char *ptr, LM_PARSED_JSON **parse
     return MS_GENERROR;
   }
 
+  /* Map deferred miniSEED 2 extra headers */
+  if (lm_extrapending (msr) && msr3_unpack_extra ((MS3Record *)msr, 0) < 0)
+    return MS_GENERROR;
+
   /* Nothing can be found without extra headers or a populated parse state */
   if (!msr->extralength && (parsed == NULL || (parsed->doc == NULL && parsed->mut_doc == NULL)))
   {
@@ -333,6 +338,10 @@ mseh_get_ptr_r (const MS3Record *msr, const char *ptr, void *value, char type, u
     return MS_GENERROR;
   }
 
+  /* Map deferred miniSEED 2 extra headers */
+  if (lm_extrapending (msr) && msr3_unpack_extra ((MS3Record *)msr, 0) < 0)
+    return MS_GENERROR;
+
   /* Nothing can be found without extra headers or a populated parse state */
   if (!msr->extralength && (statep == NULL || (statep->doc == NULL && statep->mut_doc == NULL)))
   {
@@ -483,6 +492,10 @@ mseh_set_ptr_r (MS3Record *msr, const char *ptr, void *value, char type,
     return MS_GENERROR;
   }
 
+  /* Map deferred miniSEED 2 extra headers */
+  if (lm_extrapending (msr) && msr3_unpack_extra (msr, 0) < 0)
+    return MS_GENERROR;
+
   /* Detect invalid JSON Pointer, i.e. with no root '/' designation */
   if (ptr[0] != '/' && ptr[0] != '\0' && type != 'M')
   {
@@ -1249,13 +1262,13 @@ mseh_serialize (MS3Record *msr, LM_PARSED_JSON **parsestate)
   {
     ms_log (2, "%s() New serialization size exceeds limit of %d bytes: %" PRIu64 "\n", __func__,
             UINT16_MAX, (uint64_t)serialsize);
-    libmseed_memory.free (serialized);
+    lm_memory ()->free (serialized);
     return MS_GENERROR;
   }
 
   /* Set new extra headers, replacing existing headers */
   if (msr->extra)
-    libmseed_memory.free (msr->extra);
+    lm_memory ()->free (msr->extra);
   msr->extra = serialized;
   msr->extralength = (uint16_t)serialsize;
 
@@ -1289,7 +1302,7 @@ mseh_free_parsestate (LM_PARSED_JSON **parsestate)
   if (parsed->mut_doc)
     yyjson_mut_doc_free (parsed->mut_doc);
 
-  libmseed_memory.free (parsed);
+  lm_memory ()->free (parsed);
 
   *parsestate = NULL;
 }
@@ -1356,16 +1369,17 @@ mseh_replace (MS3Record *msr, char *jsonstring)
     {
       ms_log (2, "%s() New serialization size exceeds limit of %d bytes: %" PRIu64 "\n", __func__,
               UINT16_MAX, (uint64_t)serialsize);
-      libmseed_memory.free (serialized);
+      lm_memory ()->free (serialized);
       return MS_GENERROR;
     }
   }
 
   /* Set new extra headers, replacing existing headers */
   if (msr->extra)
-    libmseed_memory.free (msr->extra);
+    lm_memory ()->free (msr->extra);
   msr->extra = serialized;
   msr->extralength = (uint16_t)serialsize;
+  lm_extrapending_set (msr, 0);
 
   return msr->extralength;
 }
@@ -1392,6 +1406,10 @@ mseh_print (const MS3Record *msr, int indent)
   if (!msr)
     return MS_GENERROR;
 
+  /* Map deferred miniSEED 2 extra headers */
+  if (lm_extrapending (msr) && msr3_unpack_extra ((MS3Record *)msr, 0) < 0)
+    return MS_GENERROR;
+
   if (!msr->extra || !msr->extralength)
     return MS_NOERROR;
 
@@ -0,0 +1,796 @@
+/***************************************************************************
+ * Prefetching of local files.
+ *
+ * Reading many small files one after another is limited by the latency
+ * of opening and reading each file.  Files named with ms3_file_prefetch()
+ * are read completely into memory in the background, with many opens
+ * and reads in flight, and the buffer is handed to the parser when the
+ * file is opened for reading.
+ *
+ * On Linux the files are read with io_uring when it is available,
+ * otherwise a small pool of threads opens and reads files concurrently.
+ *
+ * This file is part of the miniSEED Library.
+ *
+ * Copyright (c) 2026 Chad Trabant, EarthScope Data Services
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "internalstate.h"
+
+#if !defined(LMP_WIN)
+#include <unistd.h>
+#endif
+
+/* Use io_uring on Linux if the kernel header is available */
+#if defined(__linux__) && !defined(LIBMSEED_NO_THREADING) && !defined(LIBMSEED_NO_IO_URING) && \
+    defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define LM_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+#if defined(LMP_WIN)
+#define lm_open _open
+#define lm_read _read
+#define lm_close _close
+#define lm_stat _stat64
+#define lm_fstat _fstat64
+#define lm_stat_t struct _stat64
+#define lm_isregular(mode) (((mode) & _S_IFMT) == _S_IFREG)
+#define LM_OPENFLAGS (_O_RDONLY | _O_BINARY)
+#else
+#define lm_open open
+#define lm_read read
+#define lm_close close
+#define lm_stat stat
+#define lm_fstat fstat
+#define lm_stat_t struct stat
+#define lm_isregular(mode) S_ISREG (mode)
+#define LM_OPENFLAGS (O_RDONLY | O_CLOEXEC)
+#endif
+
+/* Maximum number of prefetched files not yet read, the size of the
+ * largest file prefetched and the number of threads reading files when
+ * io_uring is not used */
+#define LM_FILEPREFETCH_MAX 64
+#define LM_FILEPREFETCH_MAXSIZE 16777216
+#define LM_FILEPREFETCH_THREADS 8
+
+/* States of a prefetched file */
+#define LM_PREFETCH_QUEUED 0
+#define LM_PREFETCH_LOADING 1
+#define LM_PREFETCH_DONE 2
+#define LM_PREFETCH_FAILED 3
+
+/* Prefetched file */
+typedef struct LMPrefetchFile
+{
+  struct LMPrefetchFile *next;
+  char *path;     /* Path of the file */
+  int state;      /* One of the LM_PREFETCH_* states */
+  int detached;   /* Removed from the list while loading, freed by the loader */
+  int nocache;    /* Drop the file from the page cache once read */
+  int fd;         /* Descriptor while loading, -1 otherwise */
+  char *buffer;   /* Contents of the file */
+  int64_t size;   /* Size of the file */
+  int64_t length; /* Bytes read into buffer */
+} LMPrefetchFile;
+
+#if defined(LM_IO_URING)
+/* Submission and completion queues of an io_uring instance */
+typedef struct LMURing
+{
+  int fd;
+  unsigned entries;
+  unsigned *sqtail;
+  unsigned *sqmask;
+  unsigned *sqarray;
+  struct io_uring_sqe *sqes;
+  unsigned *cqhead;
+  unsigned *cqtail;
+  unsigned *cqmask;
+  struct io_uring_cqe *cqes;
+  void *sqring;
+  size_t sqringsize;
+  void *cqring;
+  size_t cqringsize;
+  size_t sqessize;
+  unsigned unsubmitted; /* Entries queued and not yet submitted */
+} LMURing;
+#endif
+
+struct LMFilePrefetch
+{
+  lmp_mutex_t lock;
+  lmp_cond_t cond;
+  LMPrefetchFile *head; /* Prefetched files in order of request */
+  LMPrefetchFile *tail;
+  int count; /* Number of files in the list */
+  int stop;  /* Request for the loader threads to stop */
+  int nthreads;
+  lmp_thread_t threads[LM_FILEPREFETCH_THREADS];
+#if defined(LM_IO_URING)
+  LMURing ring;
+  int useuring;
+#endif
+};
+
+/* Global prefetch state, used by threads without a bound library context */
+static LMFilePrefetch *gFilePrefetch = NULL;
+
+/* Serializes creation of the prefetch state */
+static lmp_staticmutex_t prefetch_lock = LMP_STATICMUTEX_INITIALIZER;
+
+/* Prefetch state of the library context bound to the calling thread */
+static LMFilePrefetch **
+prefetch_state (void)
+{
+  return (lm_currentcontext) ? &lm_currentcontext->fileprefetch : &gFilePrefetch;
+}
+
+static void
+prefetch_freefile (LMPrefetchFile *file)
+{
+  if (file->fd >= 0)
+    lm_close (file->fd);
+
+  lm_memory ()->free (file->buffer);
+  lm_memory ()->free (file->path);
+  lm_memory ()->free (file);
+}
+
+/* Remove a file from the list, it is freed when not being loaded and
+ * otherwise when loading finishes */
+static void
+prefetch_remove (LMFilePrefetch *fp, LMPrefetchFile *file, LMPrefetchFile *prev)
+{
+  if (prev)
+    prev->next = file->next;
+  else
+    fp->head = file->next;
+
+  if (fp->tail == file)
+    fp->tail = prev;
+
+  fp->count--;
+
+  if (file->state == LM_PREFETCH_LOADING)
+    file->detached = 1;
+  else
+    prefetch_freefile (file);
+}
+
+/* Allocate the buffer for the contents of an open file.  Only regular
+ * files with a known, non-zero size are prefetched, others such as pipes
+ * and FIFOs are left to be read directly.
+ * Returns 0 on success and -1 on error or when the file is not prefetched. */
+static int
+prefetch_allocate (LMPrefetchFile *file)
+{
+  lm_stat_t st;
+
+  if (lm_fstat (file->fd, &st) || !lm_isregular (st.st_mode) || st.st_size <= 0 ||
+      st.st_size > LM_FILEPREFETCH_MAXSIZE)
+    return -1;
+
+  file->size = (int64_t)st.st_size;
+  file->length = 0;
+
+  if (!(file->buffer = (char *)lm_memory ()->malloc ((size_t)file->size)))
+    return -1;
+
+  return 0;
+}
+
+/* Record the outcome of loading a file, must be called with the lock held */
+static void
+prefetch_finish (LMFilePrefetch *fp, LMPrefetchFile *file, int success)
+{
+  if (file->fd >= 0)
+  {
+#if defined(POSIX_FADV_DONTNEED)
+    if (success && file->nocache)
+      posix_fadvise (file->fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+    lm_close (file->fd);
+    file->fd = -1;
+  }
+
+  if (file->detached)
+  {
+    prefetch_freefile (file);
+    return;
+  }
+
+  file->state = (success) ? LM_PREFETCH_DONE : LM_PREFETCH_FAILED;
+  lmp_cond_broadcast (&fp->cond);
+}
+
+/* Return the first queued file in the list, NULL if none */
+static LMPrefetchFile *
+prefetch_queued (LMFilePrefetch *fp)
+{
+  LMPrefetchFile *file;
+
+  for (file = fp->head; file; file = file->next)
+  {
+    if (file->state == LM_PREFETCH_QUEUED)
+      return file;
+  }
+
+  return NULL;
+}
+
+/* Loader thread, open and read queued files with blocking calls */
+static void *
+prefetch_thread (void *arg)
+{
+  LMFilePrefetch *fp = (LMFilePrefetch *)arg;
+  LMPrefetchFile *file;
+  int success;
+  int readcount;
+
+  for (;;)
+  {
+    lmp_mutex_lock (&fp->lock);
+    while (!fp->stop && (file = prefetch_queued (fp)) == NULL)
+      lmp_cond_wait (&fp->cond, &fp->lock);
+
+    if (fp->stop)
+    {
+      lmp_mutex_unlock (&fp->lock);
+      break;
+    }
+
+    file->state = LM_PREFETCH_LOADING;
+    lmp_mutex_unlock (&fp->lock);
+
+    success = 0;
+
+    if ((file->fd = lm_open (file->path, LM_OPENFLAGS)) >= 0 && !prefetch_allocate (file))
+    {
+      success = 1;
+
+      while (file->length < file->size)
+      {
+        readcount = (int)lm_read (file->fd, file->buffer + file->length,
+                                  (unsigned int)(file->size - file->length));
+
+        if (readcount < 0 && errno == EINTR)
+          continue;
+
+        if (readcount < 0)
+          success = 0;
+
+        if (readcount <= 0)
+          break;
+
+        file->length += readcount;
+      }
+    }
+
+    lmp_mutex_lock (&fp->lock);
+    prefetch_finish (fp, file, success);
+    lmp_mutex_unlock (&fp->lock);
+  }
+
+  return NULL;
+} /* End of prefetch_thread() */
+
+#if defined(LM_IO_URING)
+/***************************************************************************
+ * Set up an io_uring instance supporting the open and read operations.
+ *
+ * Returns 0 on success and -1 when io_uring is not available.
+ ***************************************************************************/
+static int
+uring_init (LMURing *ring, unsigned entries)
+{
+  struct io_uring_params params;
+  struct io_uring_probe *probe;
+  size_t probesize = sizeof (struct io_uring_probe) + 256 * sizeof (struct io_uring_probe_op);
+  int supported = 0;
+
+  memset (ring, 0, sizeof (LMURing));
+  memset (&params, 0, sizeof (params));
+
+  if ((ring->fd = (int)syscall (__NR_io_uring_setup, entries, &params)) < 0)
+    return -1;
+
+  /* Require support for the operations used */
+  if ((probe = (struct io_uring_probe *)lm_memory ()->malloc (probesize)) != NULL)
+  {
+    memset (probe, 0, probesize);
+
+    if (syscall (__NR_io_uring_register, ring->fd, IORING_REGISTER_PROBE, probe, 256) == 0 &&
+        probe->last_op >= IORING_OP_READ &&
+        (probe->ops[IORING_OP_OPENAT].flags & IO_URING_OP_SUPPORTED) &&
+        (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED))
+      supported = 1;
+
+    lm_memory ()->free (probe);
+  }
+
+  if (!supported)
+  {
+    close (ring->fd);
+    return -1;
+  }
+
+  ring->entries = params.sq_entries;
+  ring->sqringsize = params.sq_off.array + params.sq_entries * sizeof (unsigned);
+  ring->cqringsize = params.cq_off.cqes + params.cq_entries * sizeof (struct io_uring_cqe);
+  ring->sqessize = params.sq_entries * sizeof (struct io_uring_sqe);
+
+  /* Map both queues with a single mapping when supported */
+  if (params.features & IORING_FEAT_SINGLE_MMAP)
+  {
+    if (ring->cqringsize > ring->sqringsize)
+      ring->sqringsize = ring->cqringsize;
+    ring->cqringsize = 0;
+  }
+
+  ring->sqring = mmap (NULL, ring->sqringsize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       ring->fd, IORING_OFF_SQ_RING);
+  ring->cqring = (ring->cqringsize)
+                     ? mmap (NULL, ring->cqringsize, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING)
+                     : ring->sqring;
+  ring->sqes = (struct io_uring_sqe *)mmap (NULL, ring->sqessize, PROT_READ | PROT_WRITE,
+                                            MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+
+  if (ring->sqring == MAP_FAILED || ring->cqring == MAP_FAILED || ring->sqes == MAP_FAILED)
+  {
+    if (ring->sqring != MAP_FAILED)
+      munmap (ring->sqring, ring->sqringsize);
+    if (ring->cqringsize && ring->cqring != MAP_FAILED)
+      munmap (ring->cqring, ring->cqringsize);
+    if (ring->sqes != MAP_FAILED)
+      munmap (ring->sqes, ring->sqessize);
+    close (ring->fd);
+    return -1;
+  }
+
+  ring->sqtail = (unsigned *)((char *)ring->sqring + params.sq_off.tail);
+  ring->sqmask = (unsigned *)((char *)ring->sqring + params.sq_off.ring_mask);
+  ring->sqarray = (unsigned *)((char *)ring->sqring + params.sq_off.array);
+  ring->cqhead = (unsigned *)((char *)ring->cqring + params.cq_off.head);
+  ring->cqtail = (unsigned *)((char *)ring->cqring + params.cq_off.tail);
+  ring->cqmask = (unsigned *)((char *)ring->cqring + params.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe *)((char *)ring->cqring + params.cq_off.cqes);
+
+  return 0;
+} /* End of uring_init() */
+
+static void
+uring_free (LMURing *ring)
+{
+  munmap (ring->sqes, ring->sqessize);
+  if (ring->cqringsize)
+    munmap (ring->cqring, ring->cqringsize);
+  munmap (ring->sqring, ring->sqringsize);
+  close (ring->fd);
+}
+
+/* Queue an operation, at most ring->entries operations may be in flight */
+static struct io_uring_sqe *
+uring_sqe (LMURing *ring, LMPrefetchFile *file)
+{
+  unsigned tail = *ring->sqtail;
+  unsigned index = tail & *ring->sqmask;
+  struct io_uring_sqe *sqe = &ring->sqes[index];
+
+  memset (sqe, 0, sizeof (struct io_uring_sqe));
+  sqe->user_data = (uint64_t)(uintptr_t)file;
+
+  ring->sqarray[index] = index;
+  __atomic_store_n (ring->sqtail, tail + 1, __ATOMIC_RELEASE);
+  ring->unsubmitted++;
+
+  return sqe;
+}
+
+static void
+uring_open (LMURing *ring, LMPrefetchFile *file)
+{
+  struct io_uring_sqe *sqe = uring_sqe (ring, file);
+
+  sqe->opcode = IORING_OP_OPENAT;
+  sqe->fd = AT_FDCWD;
+  sqe->addr = (uint64_t)(uintptr_t)file->path;
+  sqe->open_flags = LM_OPENFLAGS;
+}
+
+static void
+uring_read (LMURing *ring, LMPrefetchFile *file)
+{
+  struct io_uring_sqe *sqe = uring_sqe (ring, file);
+
+  sqe->opcode = IORING_OP_READ;
+  sqe->fd = file->fd;
+  sqe->addr = (uint64_t)(uintptr_t)(file->buffer + file->length);
+  sqe->len = (uint32_t)(file->size - file->length);
+  sqe->off = (uint64_t)file->length;
+}
+
+/* Loader thread using io_uring, keep opens and reads of all queued files
+ * in flight and continue each file as its operations complete */
+static void *
+prefetch_uring_thread (void *arg)
+{
+  LMFilePrefetch *fp = (LMFilePrefetch *)arg;
+  LMURing *ring = &fp->ring;
+  LMPrefetchFile *file;
+  struct io_uring_cqe *cqe;
+  unsigned inflight = 0;
+  unsigned head;
+  unsigned tail;
+  int result;
+  int done;
+  long rv;
+
+  for (;;)
+  {
+    lmp_mutex_lock (&fp->lock);
+    while (!fp->stop && inflight == 0 && prefetch_queued (fp) == NULL)
+      lmp_cond_wait (&fp->cond, &fp->lock);
+
+    if (fp->stop && inflight == 0)
+    {
+      lmp_mutex_unlock (&fp->lock);
+      break;
+    }
+
+    /* Start opening queued files */
+    while (!fp->stop && inflight < ring->entries && (file = prefetch_queued (fp)) != NULL)
+    {
+      file->state = LM_PREFETCH_LOADING;
+      uring_open (ring, file);
+      inflight++;
+    }
+    lmp_mutex_unlock (&fp->lock);
+
+    /* Submit queued operations and wait for at least one completion */
+    rv = syscall (__NR_io_uring_enter, ring->fd, ring->unsubmitted, 1, IORING_ENTER_GETEVENTS,
+                  NULL, 0);
+
+    if (rv < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+    {
+      ms_log (2, "Cannot submit file prefetch operations: %s\n", strerror (errno));
+
+      /* Fail the files being loaded, leaving their buffers to the kernel */
+      lmp_mutex_lock (&fp->lock);
+      for (file = fp->head; file; file = file->next)
+      {
+        if (file->state == LM_PREFETCH_LOADING)
+        {
+          file->buffer = NULL;
+          file->state = LM_PREFETCH_FAILED;
+        }
+      }
+      fp->stop = 1;
+      lmp_cond_broadcast (&fp->cond);
+      lmp_mutex_unlock (&fp->lock);
+      break;
+    }
+
+    if (rv > 0)
+      ring->unsubmitted -= (unsigned)rv;
+
+    head = *ring->cqhead;
+    tail = __atomic_load_n (ring->cqtail, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; head++)
+    {
+      cqe = &ring->cqes[head & *ring->cqmask];
+      file = (LMPrefetchFile *)(uintptr_t)cqe->user_data;
+      result = cqe->res;
+      done = 1;
+
+      /* Completed open, allocate the buffer and start reading */
+      if (file->fd < 0)
+      {
+        if (result >= 0)
+        {
+          file->fd = result;
+
+          if (!prefetch_allocate (file))
+          {
+            uring_read (ring, file);
+            done = 0;
+          }
+          else
+          {
+            result = -1;
+          }
+        }
+      }
+      /* Completed read, continue until the file is read */
+      else if (result > 0)
+      {
+        file->length += result;
+
+        if (file->length < file->size)
+        {
+          uring_read (ring, file);
+          done = 0;
+        }
+      }
+      /* Resubmit an interrupted read */
+      else if (result == -EINTR || result == -EAGAIN)
+      {
+        uring_read (ring, file);
+        done = 0;
+      }
+
+      if (done)
+      {
+        lmp_mutex_lock (&fp->lock);
+        prefetch_finish (fp, file, (result >= 0));
+        lmp_mutex_unlock (&fp->lock);
+        inflight--;
+      }
+    }
+
+    __atomic_store_n (ring->cqhead, head, __ATOMIC_RELEASE);
+  }
+
+  return NULL;
+} /* End of prefetch_uring_thread() */
+#endif /* defined(LM_IO_URING) */
+
+/* Create the prefetch state and start its loader threads.
+ * Returns the state or NULL when prefetching is not possible. */
+static LMFilePrefetch *
+prefetch_create (void)
+{
+  LMFilePrefetch *fp;
+
+  if (!(fp = (LMFilePrefetch *)lm_memory ()->malloc (sizeof (LMFilePrefetch))))
+    return NULL;
+
+  memset (fp, 0, sizeof (LMFilePrefetch));
+
+  if (lmp_mutex_init (&fp->lock))
+  {
+    lm_memory ()->free (fp);
+    return NULL;
+  }
+
+  if (lmp_cond_init (&fp->cond))
+  {
+    lmp_mutex_destroy (&fp->lock);
+    lm_memory ()->free (fp);
+    return NULL;
+  }
+
+#if defined(LM_IO_URING)
+  if (!uring_init (&fp->ring, LM_FILEPREFETCH_MAX))
+  {
+    if (lmp_thread_create (&fp->threads[0], prefetch_uring_thread, fp))
+      uring_free (&fp->ring);
+    else
+      fp->useuring = fp->nthreads = 1;
+  }
+#endif
+
+  /* Otherwise read files with blocking calls in a pool of threads */
+  if (fp->nthreads == 0)
+  {
+    while (fp->nthreads < LM_FILEPREFETCH_THREADS &&
+           !lmp_thread_create (&fp->threads[fp->nthreads], prefetch_thread, fp))
+      fp->nthreads++;
+  }
+
+  if (fp->nthreads == 0)
+  {
+    lmp_cond_destroy (&fp->cond);
+    lmp_mutex_destroy (&fp->lock);
+    lm_memory ()->free (fp);
+    return NULL;
+  }
+
+  return fp;
+} /* End of prefetch_create() */
+
+/***************************************************************************
+ * Start reading a local file into memory before it is opened.  Files
+ * already prefetched are ignored, the oldest file not yet taken is
+ * dropped when the maximum is reached.  With MSF_NOCACHE in flags the
+ * file is dropped from the page cache once read.  Only regular files are
+ * prefetched.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+int
+lm_fileprefetch_add (const char *path, uint32_t flags)
+{
+  LMFilePrefetch **state = prefetch_state ();
+  LMFilePrefetch *fp;
+  LMPrefetchFile *file;
+  lm_stat_t st;
+
+  if (!path)
+    return -1;
+
+  /* Pipes, FIFOs and devices are not opened, opening a FIFO can block
+   * or consume data, leave them and missing files to be read directly */
+  if (lm_stat (path, &st) || !lm_isregular (st.st_mode))
+    return 0;
+
+  lmp_staticmutex_lock (&prefetch_lock);
+  if (*state == NULL)
+    *state = prefetch_create ();
+  fp = *state;
+  lmp_staticmutex_unlock (&prefetch_lock);
+
+  /* Nothing is prefetched without threading support */
+  if (!fp)
+    return 0;
+
+  if (!(file = (LMPrefetchFile *)lm_memory ()->malloc (sizeof (LMPrefetchFile))))
+    return -1;
+
+  memset (file, 0, sizeof (LMPrefetchFile));
+  file->fd = -1;
+  file->nocache = (flags & MSF_NOCACHE) ? 1 : 0;
+
+  if (!(file->path = (char *)lm_memory ()->malloc (strlen (path) + 1)))
+  {
+    lm_memory ()->free (file);
+    return -1;
+  }
+
+  strcpy (file->path, path);
+
+  lmp_mutex_lock (&fp->lock);
+
+  for (LMPrefetchFile *existing = fp->head; existing; existing = existing->next)
+  {
+    if (!strcmp (existing->path, path))
+    {
+      lmp_mutex_unlock (&fp->lock);
+      prefetch_freefile (file);
+      return 0;
+    }
+  }
+
+  if (fp->count >= LM_FILEPREFETCH_MAX)
+    prefetch_remove (fp, fp->head, NULL);
+
+  if (fp->tail)
+    fp->tail->next = file;
+  else
+    fp->head = file;
+  fp->tail = file;
+  fp->count++;
+
+  lmp_cond_broadcast (&fp->cond);
+  lmp_mutex_unlock (&fp->lock);
+
+  return 0;
+} /* End of lm_fileprefetch_add() */
+
+/***************************************************************************
+ * Take the contents of a prefetched file, waiting for the file to be
+ * read if needed.  The buffer is allocated with the memory functions of
+ * the calling thread's context and owned by the caller.
+ *
+ * Returns 0 when the contents are returned and -1 when the file was not
+ * prefetched or could not be read, to be opened and read directly.
+ ***************************************************************************/
+int
+lm_fileprefetch_take (const char *path, char **buffer, int64_t *length)
+{
+  LMFilePrefetch *fp = *prefetch_state ();
+  LMPrefetchFile *file;
+  LMPrefetchFile *prev = NULL;
+  int rv = -1;
+
+  if (!fp || !path || !buffer || !length)
+    return -1;
+
+  lmp_mutex_lock (&fp->lock);
+
+  for (file = fp->head; file; prev = file, file = file->next)
+  {
+    if (!strcmp (file->path, path))
+      break;
+  }
+
+  if (file)
+  {
+    while (file->state == LM_PREFETCH_QUEUED || file->state == LM_PREFETCH_LOADING)
+      lmp_cond_wait (&fp->cond, &fp->lock);
+
+    /* Find the preceding file again, the list may have changed while waiting */
+    prev = NULL;
+    for (LMPrefetchFile *scan = fp->head; scan != file; scan = scan->next)
+      prev = scan;
+
+    if (file->state == LM_PREFETCH_DONE)
+    {
+      *buffer = file->buffer;
+      *length = file->length;
+      file->buffer = NULL;
+      rv = 0;
+    }
+
+    prefetch_remove (fp, file, prev);
+  }
+
+  lmp_mutex_unlock (&fp->lock);
+
+  return rv;
+} /* End of lm_fileprefetch_take() */
+
+/***************************************************************************
+ * Cancel all prefetched files, stop the loader threads and release the
+ * prefetch state.
+ ***************************************************************************/
+void
+lm_free_fileprefetch (LMFilePrefetch **pfp)
+{
+  LMFilePrefetch *fp;
+  int idx;
+
+  if (!pfp || !*pfp)
+    return;
+
+  fp = *pfp;
+
+  lmp_mutex_lock (&fp->lock);
+  while (fp->head)
+    prefetch_remove (fp, fp->head, NULL);
+  fp->stop = 1;
+  lmp_cond_broadcast (&fp->cond);
+  lmp_mutex_unlock (&fp->lock);
+
+  for (idx = 0; idx < fp->nthreads; idx++)
+    lmp_thread_join (fp->threads[idx]);
+
+#if defined(LM_IO_URING)
+  if (fp->useuring)
+    uring_free (&fp->ring);
+#endif
+
+  lmp_cond_destroy (&fp->cond);
+  lmp_mutex_destroy (&fp->lock);
+  lm_memory ()->free (fp);
+
+  *pfp = NULL;
+} /* End of lm_free_fileprefetch() */
+
+/***************************************************************************
+ * Cancel all prefetched files of the calling thread's context.
+ ***************************************************************************/
+void
+lm_fileprefetch_cancel (void)
+{
+  LMFilePrefetch **state = prefetch_state ();
+
+  lmp_staticmutex_lock (&prefetch_lock);
+  lm_free_fileprefetch (state);
+  lmp_staticmutex_unlock (&prefetch_lock);
+} /* End of lm_fileprefetch_cancel() */
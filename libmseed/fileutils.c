@@ -26,6 +26,7 @@
 #include <sys/types.h>
 #include <time.h>
 
+#include "internalstate.h"
 #include "libmseed.h"
 #include "msio.h"
 
@@ -35,6 +36,14 @@
 /* Initialize the global file reading parameters */
 MS3FileParam gMS3FileParam = MS3FileParam_INITIALIZER;
 
+/* File reading parameters used by ms3_readmsr(), those of the library
+ * context bound to the calling thread or the global parameters */
+static MS3FileParam *
+lm_readparam (void)
+{
+  return (lm_currentcontext) ? &lm_currentcontext->readparam : &gMS3FileParam;
+}
+
 /* Stream state flags */
 #define MSFP_RANGEAPPLIED 0x0001 //!< Byte ranging has been applied
 
@@ -55,6 +64,72 @@ libmseed_url_support (void)
 #endif
 } /* End of libmseed_url_support() */
 
+/** ************************************************************************
+ * @brief Run-time test for decompression support in libmseed.
+ *
+ * @param[in] format Compression format: "gzip", "xz" or "zstd"
+ *
+ * @returns 0 when decompression of @p format is not included, non-zero
+ * otherwise.
+ ***************************************************************************/
+int
+libmseed_decompress_support (const char *format)
+{
+  if (!format)
+    return 0;
+
+  if (!strcmp (format, "gzip"))
+    return lm_decompress_support (LM_DECOMPRESS_GZIP);
+  if (!strcmp (format, "xz"))
+    return lm_decompress_support (LM_DECOMPRESS_XZ);
+  if (!strcmp (format, "zstd"))
+    return lm_decompress_support (LM_DECOMPRESS_ZSTD);
+
+  return 0;
+} /* End of libmseed_decompress_support() */
+
+/** ************************************************************************
+ * @brief Map an offset in a compressed file read with ms3_readmsr() to
+ * the compressed data
+ *
+ * Offsets of records read from compressed files, e.g.
+ * ::MS3FileParam.streampos less the record length after a record is
+ * read, refer to the decompressed data.  This maps an @p offset in the
+ * decompressed data to the gzip member or zstd frame containing it,
+ * where decompression can start: @p compressed is the offset of the
+ * frame in the compressed file and @p skip the offset within the
+ * decompressed data of the frame.
+ *
+ * The frames of files in the zstd seekable format are listed in the
+ * seek table of the file.  Other frames are known once read, so @p
+ * offset must be of data already read.  Concatenated xz streams are not
+ * distinguished and map to the start of the file.
+ *
+ * @param[in] msfp ::MS3FileParam of a file being read
+ * @param[in] offset Offset in the decompressed data
+ * @param[out] compressed Offset of the frame in the compressed file
+ * @param[out] skip Offset of @p offset in the decompressed frame
+ *
+ * @returns 0 on success, 1 when the file is not compressed, in which
+ * case @p compressed is @p offset and @p skip is 0, and -1 when the
+ * offset is not known.
+ ***************************************************************************/
+int
+ms3_compressed_offset (MS3FileParam *msfp, int64_t offset, int64_t *compressed, int64_t *skip)
+{
+  if (!msfp || !compressed || !skip || !msfp->input.handle)
+    return -1;
+
+  if (msfp->input.type != LMIO_DECOMPRESS)
+  {
+    *compressed = offset;
+    *skip = 0;
+    return 1;
+  }
+
+  return lm_decompress_offset (&msfp->input, offset, compressed, skip);
+} /* End of ms3_compressed_offset() */
+
 /** ************************************************************************
  * @brief Initialize ::MS3FileParam parameters for a file descriptor
  *
@@ -111,7 +186,7 @@ ms3_msfp_init (int64_t startoffset, int64_t endoffset, int fd)
   MS3FileParam *msfp;
 
   /* Initialize the read parameters if needed */
-  msfp = (MS3FileParam *)libmseed_memory.malloc (sizeof (MS3FileParam));
+  msfp = (MS3FileParam *)lm_memory ()->malloc (sizeof (MS3FileParam));
 
   if (msfp == NULL)
   {
@@ -141,7 +216,7 @@ ms3_msfp_init (int64_t startoffset, int64_t endoffset, int fd)
     if (myfd < 0)
     {
       ms_log (2, "%s(): Cannot dup file descriptor %d\n", __func__, fd);
-      libmseed_memory.free (msfp);
+      lm_memory ()->free (msfp);
       return NULL;
     }
 
@@ -150,7 +225,7 @@ ms3_msfp_init (int64_t startoffset, int64_t endoffset, int fd)
     {
       ms_log (2, "%s(): Cannot fdopen file descriptor %d\n", __func__, fd);
       close (myfd);
-      libmseed_memory.free (msfp);
+      lm_memory ()->free (msfp);
       return NULL;
     }
 
@@ -165,7 +240,7 @@ ms3_msfp_init (int64_t startoffset, int64_t endoffset, int fd)
         ms_log (2, "%s(): Cannot seek file descriptor %d to offset %" PRId64 "\n", __func__, fd,
                 msfp->startoffset);
         msio_fclose (&msfp->input);
-        libmseed_memory.free (msfp);
+        lm_memory ()->free (msfp);
         return NULL;
       }
 
@@ -222,16 +297,75 @@ ms3_shift_msfp (MS3FileParam *msfp, int shift)
 /* Macro to return current reading position */
 #define MSFPREADPTR(MSFP) (MSFP->readbuffer + MSFP->readoffset)
 
+/* Macro to test for the end of input, of the read-ahead ring if used */
+#define MSFPEOF(MSFP) (LM_READAHEAD (MSFP) ? lm_readahead_eof (MSFP) : msio_feof (&MSFP->input))
+
+/* Return value of readmsr_int() when continuing a batch would read more
+ * data, moving the contents of the read buffer */
+#define MSFP_BATCHEND 2
+
+/***************************************************************************
+ * Return the reader state of a MS3FileParam, allocating it if needed.
+ *
+ * Returns a pointer to the reader state or NULL on error.
+ ***************************************************************************/
+LMReader *
+lm_reader (MS3FileParam *msfp)
+{
+  LMReader *reader;
+
+  if (msfp->reader)
+    return (LMReader *)msfp->reader;
+
+  if (!(reader = (LMReader *)lm_memory ()->malloc (sizeof (LMReader))))
+  {
+    ms_log (2, "Cannot allocate memory for reader state\n");
+    return NULL;
+  }
+
+  memset (reader, 0, sizeof (LMReader));
+  msfp->reader = reader;
+
+  return reader;
+} /* End of lm_reader() */
+
+/* Stop read-ahead and free the reader state of a MS3FileParam */
+static void
+lm_reader_free (MS3FileParam *msfp)
+{
+  LMReader *reader = (LMReader *)msfp->reader;
+  int idx;
+
+  if (!reader)
+    return;
+
+  lm_readahead_stop (msfp);
+
+  for (idx = 0; idx < reader->poolsize; idx++)
+    msr3_free (&reader->recordpool[idx]);
+
+  if (reader->recordpool)
+    lm_memory ()->free (reader->recordpool);
+
+  lm_memory ()->free (reader);
+  msfp->reader = NULL;
+}
+
 /***************************************************************************
  * Implementation of MS3Record reading functions
  *
+ * If @p batchcontinue is non-zero, MSFP_BATCHEND is returned instead of
+ * reading more data into the read buffer, which would invalidate the
+ * record data of records already returned from the buffer.
+ *
  * @see ms3_readmsr()
  * @see ms3_readmsr_r()
  * @see ms3_readmsr_selection()
+ * @see ms3_readmsr_batch()
  ***************************************************************************/
-int
-_ms3_readmsr_impl (MS3FileParam **ppmsfp, MS3Record **ppmsr, const char *mspath, uint32_t flags,
-                   const MS3Selections *selections, int8_t verbose)
+static int
+readmsr_int (MS3FileParam **ppmsfp, MS3Record **ppmsr, const char *mspath, uint32_t flags,
+             const MS3Selections *selections, int8_t verbose, int batchcontinue)
 {
   MS3FileParam *msfp;
   uint32_t pflags = flags;
@@ -242,6 +376,7 @@ _ms3_readmsr_impl (MS3FileParam **ppmsfp, MS3Record **ppmsr, const char *mspath,
   int readcount = 0;
   int retcode = MS_NOERROR;
   int atrangeend = 0;
+  int opened = 0;
 
   if (!ppmsr || !ppmsfp)
   {
@@ -254,7 +389,7 @@ _ms3_readmsr_impl (MS3FileParam **ppmsfp, MS3Record **ppmsr, const char *mspath,
   /* Initialize the read parameters if needed */
   if (!msfp)
   {
-    msfp = (MS3FileParam *)libmseed_memory.malloc (sizeof (MS3FileParam));
+    msfp = (MS3FileParam *)lm_memory ()->malloc (sizeof (MS3FileParam));
 
     if (msfp == NULL)
     {
@@ -273,40 +408,34 @@ _ms3_readmsr_impl (MS3FileParam **ppmsfp, MS3Record **ppmsr, const char *mspath,
   {
     msr3_free (ppmsr);
 
+    lm_reader_free (msfp);
+
     if (msfp->input.handle != NULL)
       msio_fclose (&msfp->input);
 
     if (msfp->readbuffer != NULL)
-      libmseed_memory.free (msfp->readbuffer);
+      lm_memory ()->free (msfp->readbuffer);
 
-    /* If the parameters are the global parameters reset them */
-    if (*ppmsfp == &gMS3FileParam)
+    /* If the parameters are the global or context parameters reset them */
+    if (*ppmsfp == &gMS3FileParam || (lm_currentcontext && *ppmsfp == &lm_currentcontext->readparam))
     {
-      gMS3FileParam = (struct MS3FileParam)MS3FileParam_INITIALIZER;
+      **ppmsfp = (struct MS3FileParam)MS3FileParam_INITIALIZER;
     }
     /* Otherwise free the MS3FileParam */
     else
     {
-      libmseed_memory.free (*ppmsfp);
+      lm_memory ()->free (*ppmsfp);
       *ppmsfp = NULL;
     }
 
     return MS_NOERROR;
   }
 
-  /* Allocate reading buffer */
-  if (msfp->readbuffer == NULL)
-  {
-    if (!(msfp->readbuffer = (char *)libmseed_memory.malloc (MAXRECLEN)))
-    {
-      ms_log (2, "Cannot allocate memory for read buffer\n");
-      return MS_GENERROR;
-    }
-  }
-
   /* Open the stream if needed, use stdin if path is "-" */
   if (msfp->input.handle == NULL)
   {
+    opened = 1;
+
     /* Reject a path/URL that will not fit, rather than silently truncating it */
     if (strlen (mspath) >= sizeof (msfp->path))
     {
@@ -383,9 +512,36 @@ _ms3_readmsr_impl (MS3FileParam **ppmsfp, MS3Record **ppmsr, const char *mspath,
       {
         msfp->streampos = msfp->startoffset;
       }
+
+      /* Parse the contents of a prefetched file in place as the read buffer */
+      if (msfp->input.type == LMIO_BUFFER)
+      {
+        int64_t length = 0;
+
+        if (msfp->readbuffer)
+          lm_memory ()->free (msfp->readbuffer);
+
+        msfp->readbuffer = msio_buffer_take (&msfp->input, &length);
+        msfp->readlength = (int)length;
+        msfp->readoffset = 0;
+      }
     }
   }
 
+  /* Allocate reading buffer */
+  if (msfp->readbuffer == NULL)
+  {
+    if (!(msfp->readbuffer = (char *)lm_memory ()->malloc (MAXRECLEN)))
+    {
+      ms_log (2, "Cannot allocate memory for read buffer\n");
+      return MS_GENERROR;
+    }
+  }
+
+  /* Read ahead with a helper thread if requested, otherwise read directly */
+  if (opened && (flags & MSF_READAHEAD) && lm_readahead_start (msfp, flags) && verbose > 1)
+    ms_log (0, "Cannot read ahead, reading directly: %s\n", msfp->path);
+
   /* Defer data unpacking if selections are used by unsetting MSF_UNPACKDATA */
   if ((flags & MSF_UNPACKDATA) && selections)
     pflags &= ~(MSF_UNPACKDATA);
@@ -402,50 +558,73 @@ _ms3_readmsr_impl (MS3FileParam **ppmsfp, MS3Record **ppmsr, const char *mspath,
 
     /* Read more data into buffer if not at EOF and buffer has less than MINRECLEN
      * or more data is needed for the current record detected in buffer. */
-    if (!msio_feof (&msfp->input) && (MSFPBUFLEN (msfp) < MINRECLEN || parseval > 0))
+    if (!MSFPEOF (msfp) && (MSFPBUFLEN (msfp) < MINRECLEN || parseval > 0))
     {
-      /* Reset offsets if no unprocessed data in buffer */
-      if (MSFPBUFLEN (msfp) <= 0)
-      {
-        msfp->readlength = 0;
-        msfp->readoffset = 0;
-      }
-      /* Otherwise shift existing data to beginning of buffer */
-      else if (msfp->readoffset > 0)
+      if (batchcontinue)
       {
-        ms3_shift_msfp (msfp, msfp->readoffset);
-      }
-
-      /* Determine read size */
-      readsize = (MAXRECLEN - msfp->readlength);
-
-      /* Do not read beyond a known end offset, for local files only.
-       * URL reads must request at least a curl receive-chunk of data
-       * (see msio_fread()); the end offset is enforced below instead,
-       * once the data has been buffered, via the atrangeend check. */
-      if (msfp->endoffset && msfp->input.type != LMIO_URL)
-      {
-        int64_t inrange = msfp->endoffset - (msfp->streampos + MSFPBUFLEN (msfp));
-        if (inrange < (readsize - 1))
-          readsize = (inrange >= 0) ? (int)(inrange + 1) : 0;
+        retcode = MSFP_BATCHEND;
+        break;
       }
 
-      /* Read data into record buffer only when there is room; a full buffer
-       * (readsize == 0) means the buffer is exhausted for the current record
-       * and is handled by the oversized-record logic below, not a read error. */
-      if (readsize > 0)
+      /* Take data from the read-ahead ring, which keeps the unprocessed data */
+      if (LM_READAHEAD (msfp))
       {
-        readcount = (int)msio_fread (&msfp->input, msfp->readbuffer + msfp->readlength, readsize);
-
-        if (readcount <= 0 && !msio_feof (&msfp->input))
+        if (lm_readahead_fill (msfp) < 0)
         {
           ms_log (2, "Error reading %s at offset %" PRId64 "\n", msfp->path, msfp->streampos);
           retcode = MS_GENERROR;
           break;
         }
+      }
+      else
+      {
+        /* Reset offsets if no unprocessed data in buffer */
+        if (MSFPBUFLEN (msfp) <= 0)
+        {
+          msfp->readlength = 0;
+          msfp->readoffset = 0;
+        }
+        /* Otherwise shift existing data to beginning of buffer */
+        else if (msfp->readoffset > 0)
+        {
+          ms3_shift_msfp (msfp, msfp->readoffset);
+        }
+
+        /* Determine read size */
+        readsize = (MAXRECLEN - msfp->readlength);
+
+        /* Do not read beyond a known end offset, for local files only.
+         * URL reads must request at least a curl receive-chunk of data
+         * (see msio_fread()); the end offset is enforced below instead,
+         * once the data has been buffered, via the atrangeend check. */
+        if (msfp->endoffset && msfp->input.type != LMIO_URL)
+        {
+          int64_t inrange = msfp->endoffset - (msfp->streampos + MSFPBUFLEN (msfp));
+          if (inrange < (readsize - 1))
+            readsize = (inrange >= 0) ? (int)(inrange + 1) : 0;
+        }
+
+        /* Read data into record buffer only when there is room; a full buffer
+         * (readsize == 0) means the buffer is exhausted for the current record
+         * and is handled by the oversized-record logic below, not a read error. */
+        if (readsize > 0)
+        {
+          readcount =
+              (int)msio_fread (&msfp->input, msfp->readbuffer + msfp->readlength, readsize);
+
+          if (flags & MSF_NOCACHE)
+            msio_dropcache (&msfp->input, (readcount > 0) ? readcount : 0);
 
-        /* Update read buffer length */
-        msfp->readlength += readcount;
+          if (readcount <= 0 && !msio_feof (&msfp->input))
+          {
+            ms_log (2, "Error reading %s at offset %" PRId64 "\n", msfp->path, msfp->streampos);
+            retcode = MS_GENERROR;
+            break;
+          }
+
+          /* Update read buffer length */
+          msfp->readlength += readcount;
+        }
       }
     }
 
@@ -456,7 +635,7 @@ _ms3_readmsr_impl (MS3FileParam **ppmsfp, MS3Record **ppmsr, const char *mspath,
     if (MSFPBUFLEN (msfp) >= MINRECLEN)
     {
       /* Set end of file flag if at EOF or a known end offset */
-      if (msio_feof (&msfp->input) || atrangeend)
+      if (MSFPEOF (msfp) || atrangeend)
         pflags |= MSF_ATENDOFFILE;
 
       parseval = msr3_parse (MSFPREADPTR (msfp), MSFPBUFLEN (msfp), ppmsr, pflags, verbose);
@@ -569,7 +748,7 @@ _ms3_readmsr_impl (MS3FileParam **ppmsfp, MS3Record **ppmsr, const char *mspath,
           }
         }
         /* End of file or known end offset check */
-        else if (msio_feof (&msfp->input) || atrangeend)
+        else if (MSFPEOF (msfp) || atrangeend)
         {
           if (verbose)
             ms_log (0, "Truncated record at byte offset %" PRId64 ", end offset %" PRId64 ": %s\n",
@@ -582,7 +761,7 @@ _ms3_readmsr_impl (MS3FileParam **ppmsfp, MS3Record **ppmsr, const char *mspath,
     } /* End of record detection */
 
     /* Finished when at end-of-stream or end offset and buffer contains less than MINRECLEN */
-    if ((msio_feof (&msfp->input) || atrangeend) && MSFPBUFLEN (msfp) < MINRECLEN)
+    if ((MSFPEOF (msfp) || atrangeend) && MSFPBUFLEN (msfp) < MINRECLEN)
     {
       if (msfp->recordcount == 0)
       {
@@ -599,13 +778,20 @@ _ms3_readmsr_impl (MS3FileParam **ppmsfp, MS3Record **ppmsr, const char *mspath,
   } /* End of reading, record detection and parsing loop */
 
   /* Cleanup target MS3Record if returning an error */
-  if (retcode != MS_NOERROR)
+  if (retcode != MS_NOERROR && retcode != MSFP_BATCHEND)
   {
     msr3_free (ppmsr);
   }
 
   return retcode;
-} /* End of ms3_readmsr_selection() */
+} /* End of readmsr_int() */
+
+int
+_ms3_readmsr_impl (MS3FileParam **ppmsfp, MS3Record **ppmsr, const char *mspath, uint32_t flags,
+                   const MS3Selections *selections, int8_t verbose)
+{
+  return readmsr_int (ppmsfp, ppmsr, mspath, flags, selections, verbose, 0);
+}
 
 /** ************************************************************************
  * @brief Read miniSEED records from a file or URL
@@ -626,6 +812,21 @@ _ms3_readmsr_impl (MS3FileParam **ppmsfp, MS3Record **ppmsr, const char *mspath,
  *  - ::MSF_UNPACKDATA data samples will be unpacked
  *  - ::MSF_VALIDATECRC Validate CRC (if present in format)
  *  - ::MSF_PNAMERANGE Parse byte range suffix from @p mspath
+ *  - ::MSF_READAHEAD Read input ahead of parsing with a helper thread
+ *  - ::MSF_NOCACHE Drop file input from the page cache once read
+ *
+ * If ::MSF_READAHEAD is set in @p flags when a stream is opened, a
+ * helper thread reads the input into a ring of large buffers while
+ * records are parsed, overlapping I/O with parsing.  Read-ahead is not
+ * used for prefetched URLs (see ms3_url_prefetch()) or when the library
+ * is built without threading, the stream is then read directly.
+ *
+ * If ::MSF_NOCACHE is set in @p flags, data read from a local file is
+ * dropped from the page cache of the system in portions of 8 MiB, and
+ * the remainder of the file at its end, using posix_fadvise().  This
+ * keeps a single scan through a large amount of data from evicting
+ * data cached for other uses.  Parsing is not affected, and the flag is
+ * ignored for other input and on systems without posix_fadvise().
  *
  * If ::MSF_PNAMERANGE is set in @p flags, the @p mspath will be
  * searched for start and end byte offsets for the file or URL in the
@@ -660,7 +861,7 @@ _ms3_readmsr_impl (MS3FileParam **ppmsfp, MS3Record **ppmsr, const char *mspath,
 int
 ms3_readmsr (MS3Record **ppmsr, const char *mspath, uint32_t flags, int8_t verbose)
 {
-  MS3FileParam *msfp = &gMS3FileParam;
+  MS3FileParam *msfp = lm_readparam ();
 
   return ms3_readmsr_selection (&msfp, ppmsr, mspath, flags, NULL, verbose);
 } /* End of ms3_readmsr() */
@@ -706,6 +907,121 @@ ms3_readmsr_selection (MS3FileParam **ppmsfp, MS3Record **ppmsr, const char *msp
   return _ms3_readmsr_impl (ppmsfp, ppmsr, mspath, flags, selections, verbose);
 }
 
+/** ************************************************************************
+ * @brief Read a batch of miniSEED records from a file or URL
+ *
+ * This routine reads up to @p maxrecords records per call from the
+ * specified stream and places pointers to them in the caller-owned
+ * @p records array.  It is otherwise equivalent to
+ * ms3_readmsr_selection(), including the use of @p ppmsfp, @p flags and
+ * @p selections.
+ *
+ * The records are owned by a pool in the ::MS3FileParam and are reused,
+ * including any data sample buffers, by the next call.  The raw record
+ * data, referenced by ::MS3Record.record, is not copied but refers to
+ * the large read buffer of the stream.  A batch ends early when further
+ * records would require more data to be read into the buffer, so a
+ * batch contains fewer than @p maxrecords records before the end of a
+ * stream.  All records, and their record data, are valid until the next
+ * call with the same @p ppmsfp.  Records that must be kept longer must
+ * be copied, e.g. with msr3_duplicate().
+ *
+ * After reading all the records in a stream the calling program should
+ * call this routine a final time with @p mspath set to NULL.  This
+ * will close the input stream and free allocated memory, including the
+ * record pool.
+ *
+ * @param[out] ppmsfp Pointer-to-pointer of an ::MS3FileParam, which
+ * contains the state of stream reading across iterative calls of this
+ * function.  A ::MS3FileParam container will be allocated if @p *ppmsfp
+ * is @c NULL.
+ * @param[out] records Array of at least @p maxrecords record pointers
+ * @param[in] maxrecords Maximum number of records to return
+ * @param[in] mspath File or URL to read
+ * @param[in] flags Flags used to control parsing, see @ref control-flags
+ * @param[in] selections Specify limits to which data should be
+ * returned, see @ref data-selections
+ * @param[in] verbose Controls verbosity, 0 means no diagnostic output
+ *
+ * @returns The number of records placed in @p records, 0 at the end of
+ * the stream or after cleanup, and a (negative) libmseed error code on
+ * error.  An error that follows records read in the same call is
+ * returned by the next call.
+ *
+ * @ref MessageOnError - this function logs a message on error
+ *
+ * @see ms3_readmsr_selection()
+ ***************************************************************************/
+int
+ms3_readmsr_batch (MS3FileParam **ppmsfp, MS3Record **records, int maxrecords, const char *mspath,
+                   uint32_t flags, const MS3Selections *selections, int8_t verbose)
+{
+  LMReader *reader;
+  MS3Record **pool;
+  MS3Record *msr = NULL;
+  int count;
+  int retcode;
+
+  if (!ppmsfp)
+  {
+    ms_log (2, "%s(): Required input not defined: 'ppmsfp'\n", __func__);
+    return MS_GENERROR;
+  }
+
+  /* Cleanup */
+  if (mspath == NULL)
+  {
+    retcode = readmsr_int (ppmsfp, &msr, NULL, flags, selections, verbose, 0);
+    return (retcode == MS_NOERROR) ? 0 : retcode;
+  }
+
+  if (!records || maxrecords <= 0)
+  {
+    ms_log (2, "%s(): Required input not defined: 'records' or 'maxrecords'\n", __func__);
+    return MS_GENERROR;
+  }
+
+  if (*ppmsfp == NULL && (*ppmsfp = ms3_msfp_init (0, 0, -1)) == NULL)
+    return MS_GENERROR;
+
+  if ((reader = lm_reader (*ppmsfp)) == NULL)
+    return MS_GENERROR;
+
+  /* Grow the record pool as needed */
+  if (reader->poolsize < maxrecords)
+  {
+    if (!(pool = (MS3Record **)lm_memory ()->realloc (reader->recordpool,
+                                                      sizeof (MS3Record *) * maxrecords)))
+    {
+      ms_log (2, "Cannot allocate memory for record pool\n");
+      return MS_GENERROR;
+    }
+
+    memset (pool + reader->poolsize, 0, sizeof (MS3Record *) * (maxrecords - reader->poolsize));
+    reader->recordpool = pool;
+    reader->poolsize = maxrecords;
+  }
+
+  /* Parse records into the pool, a record is freed and reset to NULL on error */
+  for (count = 0; count < maxrecords; count++)
+  {
+    retcode = readmsr_int (ppmsfp, &reader->recordpool[count], mspath, flags, selections, verbose,
+                           (count > 0));
+
+    if (retcode != MS_NOERROR)
+    {
+      if (count > 0)
+        break;
+
+      return (retcode == MS_ENDOFFILE) ? 0 : retcode;
+    }
+
+    records[count] = reader->recordpool[count];
+  }
+
+  return count;
+} /* End of ms3_readmsr_batch() */
+
 /** ************************************************************************
  * @brief Read miniSEED from a file into a trace list
  *
@@ -847,9 +1163,13 @@ ms3_readtracelist_selection (MS3TraceList **ppmstl, const char *mspath,
     }
   }
 
-  /* Loop over the input file and add each record to trace list */
-  while ((retcode = ms3_readmsr_selection (&msfp, &msr, mspath, flags, selections, verbose)) ==
-         MS_NOERROR)
+  /* Loop over the input file and add each record to trace list, data samples
+   * are decoded directly into the trace segments by mstl3_addmsr() and
+   * extra headers are only mapped from miniSEED 2 blockettes if copied
+   * into a record list */
+  while ((retcode = ms3_readmsr_selection (&msfp, &msr, mspath,
+                                           (flags & ~(MSF_UNPACKDATA)) | MSF_DEFEREXTRA,
+                                           selections, verbose)) == MS_NOERROR)
   {
     if (flags & MSF_SKIPADJACENTDUPLICATES)
     {
@@ -971,6 +1291,154 @@ ms3_url_timeout (long connecttimeout, long stalltimeout)
 #endif
 } /* End of ms3_url_timeout() */
 
+/** ************************************************************************
+ * @brief Set concurrent byte-range requests for URL-based requests.
+ *
+ * When @p connections is greater than 1, a URL is read by first
+ * determining its length with a HEAD request, then fetching the
+ * requested byte range in chunks of @p rangesize bytes with up to
+ * @p connections concurrent requests.  The chunks are returned to the
+ * reader in order and at most @p connections chunks are held in
+ * memory.  URLs of servers that do not report a length or accept byte
+ * ranges, and ranges no larger than a single chunk, are read with a
+ * single request.
+ *
+ * A @p connections value of 0 or 1 disables concurrent requests and a
+ * negative value leaves it unchanged, the maximum is 64.  A
+ * @p rangesize of 0 or less leaves it unchanged, the default is 4 MiB.
+ * If not set, the number of connections can be set with the
+ * \b LIBMSEED_URL_PARALLEL environment variable.
+ *
+ * An error will be returned when the library was not compiled with
+ * URL support.
+ *
+ * @param[in] connections Number of concurrent requests, negative to leave unchanged
+ * @param[in] rangesize Size of each range request in bytes, 0 to leave unchanged
+ *
+ * @returns 0 on succes and a negative library error code on error.
+ *
+ * @ref MessageOnError - this function logs a message on error
+ ***************************************************************************/
+int
+ms3_url_parallel (int connections, int64_t rangesize)
+{
+#if !defined(LIBMSEED_URL)
+  (void)connections; /* Unused */
+  (void)rangesize;   /* Unused */
+  ms_log (2, "URL support not included in library\n");
+  return -1;
+#else
+  return msio_url_parallel (connections, rangesize);
+#endif
+} /* End of ms3_url_parallel() */
+
+/** ************************************************************************
+ * @brief Start the transfer of a URL before it is read
+ *
+ * Reading many small URLs one after another is limited by the time to
+ * establish each connection rather than by transfer speed.  A transfer
+ * started with this function proceeds while other inputs are read and
+ * is used when the same URL is opened by the same thread with
+ * ms3_readmsr(), ms3_readmsr_r() or ms3_readtracelist(), up to 1 MiB is
+ * buffered before the transfer waits to be read.
+ *
+ * URLs opened without a byte range by the first thread to read a URL
+ * with the current URL settings, including prefetched URLs, are
+ * transferred with a persistent connection cache, so that later
+ * requests to the same server reuse open connections.
+ *
+ * If ::MSF_PNAMERANGE is set in @p flags and @p url includes a byte
+ * range suffix it is not prefetched, byte ranges are requested when
+ * the URL is opened.  Paths that are not URLs and URLs already
+ * prefetched are ignored.  Up to 64 URLs may be prefetched, starting
+ * another cancels the oldest.  A NULL @p url cancels all prefetched
+ * transfers that have not been read.
+ *
+ * An error will be returned when the library was not compiled with
+ * URL support.
+ *
+ * @param[in] url URL to prefetch, or NULL to cancel all prefetches
+ * @param[in] flags Flags used when reading: ::MSF_PNAMERANGE, ::MSF_NOCACHE
+ *
+ * @returns 0 on succes and a negative library error code on error.
+ *
+ * @ref MessageOnError - this function logs a message on error
+ ***************************************************************************/
+int
+ms3_url_prefetch (const char *url, uint32_t flags)
+{
+  int64_t start = 0;
+  int64_t end = 0;
+
+  /* A byte range is requested when opened */
+  if (url && (flags & MSF_PNAMERANGE) && parse_pathname_range (url, &start, &end))
+    return 0;
+
+  return msio_url_prefetch (url);
+} /* End of ms3_url_prefetch() */
+
+/** ************************************************************************
+ * @brief Start reading a local file before it is read
+ *
+ * Reading many small files one after another is limited by the latency
+ * of opening and reading each file rather than by throughput.  A file
+ * prefetched with this function is read completely into memory in the
+ * background, concurrently with other prefetched files, and its
+ * contents are parsed in place when the same path is opened with
+ * ms3_readmsr(), ms3_readmsr_r() or ms3_readtracelist() by a thread
+ * using the same library context.
+ *
+ * On Linux files are read with io_uring when supported by the kernel,
+ * keeping the opens and reads of all prefetched files in flight,
+ * otherwise with a pool of threads.  Files larger than 16 MiB are not
+ * loaded into memory and are read normally when opened.
+ *
+ * If ::MSF_PNAMERANGE is set in @p flags and @p path includes a byte
+ * range suffix it is not prefetched.  URLs, stdin ("-") and files
+ * already prefetched are ignored, see ms3_url_prefetch() for URLs.  Up
+ * to 64 files may be prefetched, starting another drops the oldest.  A
+ * NULL @p path cancels all prefetched files that have not been read
+ * and stops the background reading.  Without threading support files
+ * are not prefetched.
+ *
+ * @param[in] path File to prefetch, or NULL to cancel all prefetches
+ * @param[in] flags Flags used when reading: ::MSF_PNAMERANGE
+ *
+ * @returns 0 on succes and a negative library error code on error.
+ *
+ * @ref MessageOnError - this function logs a message on error
+ ***************************************************************************/
+int
+ms3_file_prefetch (const char *path, uint32_t flags)
+{
+  int64_t start = 0;
+  int64_t end = 0;
+
+  if (!path)
+  {
+    lm_fileprefetch_cancel ();
+    return 0;
+  }
+
+  /* Treat "file://" specifications as local files, as when opened */
+  if (lmp_strncasecmp (path, "file://", 7) == 0)
+    path += 7;
+  else if (strstr (path, "://"))
+    return 0;
+
+  /* A byte range is read when opened */
+  if (!strcmp (path, "-") || ((flags & MSF_PNAMERANGE) && parse_pathname_range (path, &start, &end)))
+    return 0;
+
+  if (lm_fileprefetch_add (path, flags))
+  {
+    ms_log (2, "Cannot prefetch %s\n", path);
+    return MS_GENERROR;
+  }
+
+  return 0;
+} /* End of ms3_file_prefetch() */
+
 /** ************************************************************************
  * @brief Set authentication credentials for URL-based requests.
  *
@@ -1080,14 +1548,8 @@ int64_t
 msr3_writemseed (MS3Record *msr, const char *mspath, int8_t overwrite, uint32_t flags,
                  int8_t verbose)
 {
-  FILE *ofp;
-  const char *perms = (overwrite) ? "wb" : "ab";
-  int64_t packedrecords = 0;
-
-  MS3RecordPacker *packer;
-  char *record = NULL;
-  int32_t reclen = 0;
-  int result;
+  MS3Writer *writer;
+  int64_t packedrecords;
 
   if (!msr || !mspath)
   {
@@ -1095,68 +1557,22 @@ msr3_writemseed (MS3Record *msr, const char *mspath, int8_t overwrite, uint32_t
     return -1;
   }
 
-  /* Open output file or use stdout */
-  if (strcmp (mspath, "-") == 0)
-  {
-    ofp = stdout;
-  }
-  else if ((ofp = fopen (mspath, perms)) == NULL)
-  {
-    ms_log (2, "Cannot open output file %s: %s\n", mspath, strerror (errno));
-    return -1;
-  }
-
-  /* Initialize packer */
-  packer = msr3_pack_init (msr, flags, verbose);
-  if (!packer)
-  {
-    if (ofp != stdout)
-      fclose (ofp);
+  /* Buffer a single record, a larger buffer is not worth allocating for
+   * the few records of one call */
+  if (!(writer = lm_writer_open (mspath, overwrite,
+                                 (msr->reclen > 0) ? (size_t)msr->reclen
+                                                   : MS_PACK_DEFAULT_RECLEN)))
     return -1;
-  }
-
-  /* Pack the MS3Record */
-  while ((result = msr3_pack_next (packer, &record, &reclen)) == 1)
-  {
-    if (fwrite (record, reclen, 1, (FILE *)ofp) != 1)
-    {
-      ms_log (2, "Error writing to output file\n");
-      packedrecords = -1;
-      break;
-    }
 
-    packedrecords++;
-  }
-
-  /* A negative result indicates a packing error */
-  if (result < 0 && packedrecords >= 0)
-    packedrecords = -1;
-
-  /* Free packer and get total packed samples */
-  msr3_pack_free (&packer, NULL);
+  packedrecords = msr3_writemseed_w (writer, msr, flags, verbose);
 
   /* Close file and return record count */
-  if (ofp != stdout)
-    fclose (ofp);
+  if (ms3_writer_close (&writer) && packedrecords >= 0)
+    packedrecords = -1;
 
   return packedrecords;
 } /* End of msr3_writemseed() */
 
-/***************************************************************************
- *
- * Internal record handler.  The handler data should be a pointer to
- * an open file descriptor to which records will be written.
- *
- ***************************************************************************/
-static void
-ms_record_handler_int (char *record, int reclen, void *ofp)
-{
-  if (fwrite (record, reclen, 1, (FILE *)ofp) != 1)
-  {
-    ms_log (2, "Error writing to output file\n");
-  }
-} /* End of ms_record_handler_int() */
-
 /** ************************************************************************
  * @brief Write miniSEED from an ::MS3TraceList container to a file
  *
@@ -1188,9 +1604,8 @@ int64_t
 mstl3_writemseed (MS3TraceList *mstl, const char *mspath, int8_t overwrite, int maxreclen,
                   int8_t encoding, uint32_t flags, int8_t verbose)
 {
-  FILE *ofp;
-  const char *perms = (overwrite) ? "wb" : "ab";
-  int64_t packedrecords = 0;
+  MS3Writer *writer;
+  int64_t packedrecords;
 
   if (!mstl || !mspath)
   {
@@ -1198,44 +1613,14 @@ mstl3_writemseed (MS3TraceList *mstl, const char *mspath, int8_t overwrite, int
     return -1;
   }
 
-  /* Open output file or use stdout */
-  if (strcmp (mspath, "-") == 0)
-  {
-    ofp = stdout;
-  }
-  else if ((ofp = fopen (mspath, perms)) == NULL)
-  {
-    ms_log (2, "Cannot open output file %s: %s\n", mspath, strerror (errno));
+  if (!(writer = ms3_writer_open (mspath, overwrite)))
     return -1;
-  }
-
-  /* Do not modify the trace list during packing */
-  flags |= MSF_MAINTAINMSTL;
-
-  /* Pack all data */
-  flags |= MSF_FLUSHDATA;
-
-  packedrecords = mstl3_pack (mstl, &ms_record_handler_int, ofp, maxreclen, encoding, NULL, flags,
-                              verbose, NULL);
 
-  /* The record handler cannot signal a write failure, so flush and check
-   * the stream directly.  A full or read-only filesystem may not surface
-   * an error until buffered data is flushed. */
-  if (packedrecords >= 0 && (fflush (ofp) != 0 || ferror (ofp)))
-  {
-    ms_log (2, "Error writing to output file %s\n", mspath);
-    packedrecords = -1;
-  }
+  packedrecords = mstl3_writemseed_w (writer, mstl, maxreclen, encoding, flags, verbose);
 
   /* Close file and return record count */
-  if (ofp != stdout)
-  {
-    if (fclose (ofp) != 0 && packedrecords >= 0)
-    {
-      ms_log (2, "Error closing output file %s: %s\n", mspath, strerror (errno));
-      packedrecords = -1;
-    }
-  }
+  if (ms3_writer_close (&writer) && packedrecords >= 0)
+    packedrecords = -1;
 
   return packedrecords;
 } /* End of mstl3_writemseed() */
@@ -24,7 +24,7 @@
 #include <string.h>
 #include <time.h>
 
-#include "gmtime64.h"
+#include "internalstate.h"
 #include "libmseed.h"
 
 static nstime_t ms_time2nstime_int (int year, int day, int hour, int min, int sec, uint32_t nsec);
@@ -41,17 +41,19 @@ size_t libmseed_prealloc_block_size = 1048576;
 size_t libmseed_prealloc_block_size = 0;
 #endif
 
-/* Internal realloc() wrapper that allocates in libmseed_prealloc_block_size blocks */
+/* Internal realloc() wrapper that allocates in blocks of the pre-allocation block size
+ * of the calling thread's context, libmseed_prealloc_block_size by default */
 void *
 libmseed_memory_prealloc (void *ptr, size_t size, size_t *currentsize)
 {
+  size_t blocksize = lm_prealloc_block_size ();
   size_t newsize;
   void *newptr;
 
   if (!currentsize)
     return NULL;
 
-  if (libmseed_prealloc_block_size == 0)
+  if (blocksize == 0)
     return NULL;
 
   /* No additional memory needed if request already satisfied */
@@ -59,18 +61,18 @@ libmseed_memory_prealloc (void *ptr, size_t size, size_t *currentsize)
     return ptr;
 
   /* Calculate new size needed for request by adding blocks */
-  if (*currentsize > SIZE_MAX - libmseed_prealloc_block_size)
+  if (*currentsize > SIZE_MAX - blocksize)
     return NULL;
 
-  newsize = *currentsize + libmseed_prealloc_block_size;
+  newsize = *currentsize + blocksize;
   while (newsize < size)
   {
-    if (newsize > SIZE_MAX - libmseed_prealloc_block_size)
+    if (newsize > SIZE_MAX - blocksize)
       return NULL;
-    newsize += libmseed_prealloc_block_size;
+    newsize += blocksize;
   }
 
-  newptr = libmseed_memory.realloc (ptr, newsize);
+  newptr = lm_memory ()->realloc (ptr, newsize);
 
   if (newptr)
     *currentsize = newsize;
@@ -170,6 +172,36 @@ static LeapSecond embedded_leapsecondlist[] = {
 /* Global variable to hold a leap second list */
 LeapSecond *leapsecondlist = &embedded_leapsecondlist[0];
 
+/* Leap second list of the calling thread's context */
+LeapSecond **
+lm_leapsecondlist (void)
+{
+  return (lm_currentcontext) ? &lm_currentcontext->leapsecondlist : &leapsecondlist;
+}
+
+/* Head of the leap second list embedded in the library */
+LeapSecond *
+lm_embedded_leapsecondlist (void)
+{
+  return &embedded_leapsecondlist[0];
+}
+
+/* Free a leap second list with the specified memory management
+ * functions, the embedded list is detached but not freed */
+void
+lm_free_leapsecondlist (LeapSecond **list, LIBMSEED_MEMORY *memory)
+{
+  if (*list == &embedded_leapsecondlist[0])
+    *list = NULL;
+
+  while (*list != NULL)
+  {
+    LeapSecond *next = (*list)->next;
+    memory->free (*list);
+    *list = next;
+  }
+}
+
 /* Days in each month, for non-leap and leap years */
 static const int monthdays[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
 static const int monthdays_leap[] = {31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
@@ -282,7 +314,7 @@ ms_sid2nslc_n (const char *sid, char *net, size_t netsize, char *sta, size_t sta
     }
 
     idlen = strlen (sid) + 1;
-    if (!(id = libmseed_memory.malloc (idlen)))
+    if (!(id = lm_memory ()->malloc (idlen)))
     {
       ms_log (2, "Error duplicating identifier\n");
       return -1;
@@ -345,7 +377,7 @@ ms_sid2nslc_n (const char *sid, char *net, size_t netsize, char *sta, size_t sta
 
     /* Free duplicated ID */
     if (id)
-      libmseed_memory.free (id);
+      lm_memory ()->free (id);
   }
   else
   {
@@ -963,6 +995,166 @@ ms_md2doy (int year, int month, int mday, int *yday)
   return 0;
 } /* End of ms_md2doy() */
 
+/***************************************************************************
+ * INTERNAL Calendar conversion between day counts and civil dates.
+ *
+ * Days are counted from 1970-01-01 in the proleptic Gregorian
+ * calendar using the integer-only algorithms described by Howard
+ * Hinnant (https://howardhinnant.github.io/date_algorithms.html),
+ * valid far beyond the range of ::nstime_t.
+ ***************************************************************************/
+static int64_t
+lm_days_from_civil (int64_t year, int month, int mday)
+{
+  int64_t era;
+  int64_t yoe;
+  int64_t doy;
+  int64_t doe;
+
+  year -= (month <= 2);
+  era = ((year >= 0) ? year : year - 399) / 400;
+  yoe = year - era * 400;
+  doy = (153 * ((month > 2) ? month - 3 : month + 9) + 2) / 5 + mday - 1;
+  doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+  return era * 146097 + doe - 719468;
+} /* End of lm_days_from_civil() */
+
+static void
+lm_civil_from_days (int64_t days, int *year, int *month, int *mday, int *yday)
+{
+  int64_t z = days + 719468;
+  int64_t era;
+  int64_t doe;
+  int64_t yoe;
+  int64_t doy;
+  int64_t mp;
+  int64_t y;
+
+  era = ((z >= 0) ? z : z - 146096) / 146097;
+  doe = z - era * 146097;
+  yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  mp = (5 * doy + 2) / 153;
+
+  *mday = (int)(doy - (153 * mp + 2) / 5 + 1);
+  *month = (int)((mp < 10) ? mp + 3 : mp - 9);
+  y = yoe + era * 400 + (*month <= 2);
+  *year = (int)y;
+  *yday = (int)(days - lm_days_from_civil (y, 1, 1)) + 1;
+} /* End of lm_civil_from_days() */
+
+/* Calendar fields and formatted strings for the most recently converted
+ * epoch second, and the day containing it */
+typedef struct LMTimeCache
+{
+  int8_t valid;
+  int64_t isec;       /* Epoch second of the cached time */
+  int64_t day;        /* Days since the epoch of the cached date */
+  int year;           /* Year, like 2018 */
+  int month;          /* Month, 1 - 12 */
+  int mday;           /* Day of month, 1 - 31 */
+  int yday;           /* Day of year, 1 - 366 */
+  int hour;           /* Hour, 0 - 23 */
+  int min;            /* Minute, 0 - 59 */
+  int sec;            /* Second, 0 - 59 */
+  char isodate[11];   /* YYYY-MM-DD */
+  char seeddate[9];   /* YYYY,DDD */
+  char hms[9];        /* HH:MM:SS */
+} LMTimeCache;
+
+/* Each thread keeps its own cache, consecutive times printed by a thread
+ * usually share the day and often the second.  Without thread-local
+ * storage a cache would be shared, times are converted directly. */
+#if !defined(LIBMSEED_NO_THREADING)
+static lm_thread_local LMTimeCache lm_timecache = {0};
+#endif
+
+/* Write 'count' decimal digits of 'value', zero padded, to 'dest' */
+static inline char *
+lm_putdigits (char *dest, uint32_t value, int count)
+{
+  int idx;
+
+  for (idx = count - 1; idx >= 0; idx--)
+  {
+    dest[idx] = (char)('0' + (value % 10));
+    value /= 10;
+  }
+
+  return dest + count;
+}
+
+/***************************************************************************
+ * INTERNAL Convert epoch seconds to calendar fields and formatted
+ * strings, reusing the thread's cached results for the same second or
+ * day.  When built without threading the caller's @p local storage is
+ * used instead, keeping conversions reentrant.
+ *
+ * Returns a pointer to the thread's cache or @p local.
+ ***************************************************************************/
+static const LMTimeCache *
+lm_epoch2time (int64_t isec, LMTimeCache *local)
+{
+#if defined(LIBMSEED_NO_THREADING)
+  LMTimeCache *cache = local;
+  cache->valid = 0;
+#else
+  LMTimeCache *cache = &lm_timecache;
+  (void)local;
+#endif
+  int64_t day;
+  int sod;
+
+  if (cache->valid && cache->isec == isec)
+    return cache;
+
+  /* Floor division into day and second of day */
+  day = isec / 86400;
+  sod = (int)(isec - day * 86400);
+  if (sod < 0)
+  {
+    sod += 86400;
+    day -= 1;
+  }
+
+  if (!cache->valid || cache->day != day)
+  {
+    lm_civil_from_days (day, &cache->year, &cache->month, &cache->mday, &cache->yday);
+
+    /* Years are always 4 digits within the range of nstime_t */
+    lm_putdigits (cache->isodate, (uint32_t)cache->year, 4);
+    cache->isodate[4] = '-';
+    lm_putdigits (cache->isodate + 5, (uint32_t)cache->month, 2);
+    cache->isodate[7] = '-';
+    lm_putdigits (cache->isodate + 8, (uint32_t)cache->mday, 2);
+    cache->isodate[10] = '\0';
+
+    memcpy (cache->seeddate, cache->isodate, 4);
+    cache->seeddate[4] = ',';
+    lm_putdigits (cache->seeddate + 5, (uint32_t)cache->yday, 3);
+    cache->seeddate[8] = '\0';
+
+    cache->day = day;
+  }
+
+  cache->hour = sod / 3600;
+  cache->min = (sod / 60) % 60;
+  cache->sec = sod % 60;
+
+  lm_putdigits (cache->hms, (uint32_t)cache->hour, 2);
+  cache->hms[2] = ':';
+  lm_putdigits (cache->hms + 3, (uint32_t)cache->min, 2);
+  cache->hms[5] = ':';
+  lm_putdigits (cache->hms + 6, (uint32_t)cache->sec, 2);
+  cache->hms[8] = '\0';
+
+  cache->isec = isec;
+  cache->valid = 1;
+
+  return cache;
+} /* End of lm_epoch2time() */
+
 /** ************************************************************************
  * @brief Convert an ::nstime_t to individual date-time components
  *
@@ -984,7 +1176,8 @@ int
 ms_nstime2time (nstime_t nstime, uint16_t *year, uint16_t *yday, uint8_t *hour, uint8_t *min,
                 uint8_t *sec, uint32_t *nsec)
 {
-  struct tm tms;
+  const LMTimeCache *tc = NULL;
+  LMTimeCache local;
   int64_t isec;
   int32_t ifract;
 
@@ -1000,23 +1193,22 @@ ms_nstime2time (nstime_t nstime, uint16_t *year, uint16_t *yday, uint8_t *hour,
   }
 
   if (year || yday || hour || min || sec)
-    if (!(ms_gmtime64_r (&isec, &tms)))
-      return -1;
+    tc = lm_epoch2time (isec, &local);
 
   if (year)
-    *year = tms.tm_year + 1900;
+    *year = tc->year;
 
   if (yday)
-    *yday = tms.tm_yday + 1;
+    *yday = tc->yday;
 
   if (hour)
-    *hour = tms.tm_hour;
+    *hour = tc->hour;
 
   if (min)
-    *min = tms.tm_min;
+    *min = tc->min;
 
   if (sec)
-    *sec = tms.tm_sec;
+    *sec = tc->sec;
 
   if (nsec)
     *nsec = ifract;
@@ -1053,15 +1245,19 @@ char *
 ms_nstime2timestr_n (nstime_t nstime, char *timestr, size_t timestrsize, ms_timeformat_t timeformat,
                      ms_subseconds_t subseconds)
 {
-  struct tm tms = {0};
+  const LMTimeCache *tc = NULL;
+  LMTimeCache local;
+  char buffer[48];
+  char *cp = buffer;
   int64_t rawisec;
   int rawnanosec;
   int64_t isec;
   int nanosec;
   int microsec;
   int submicro;
+  int subdigits;
   int printed = 0;
-  int expected = 0;
+  int isoformat = 0;
 
   if (!timestr)
   {
@@ -1097,143 +1293,22 @@ ms_nstime2timestr_n (nstime_t nstime, char *timestr, size_t timestrsize, ms_time
   microsec = nanosec / 1000;
   submicro = nanosec - (microsec * 1000);
 
-  /* Calculate date-time parts if needed by format */
-  if (timeformat == ISOMONTHDAY || timeformat == ISOMONTHDAY_Z || timeformat == ISOMONTHDAY_DOY ||
-      timeformat == ISOMONTHDAY_DOY_Z || timeformat == ISOMONTHDAY_SPACE ||
-      timeformat == ISOMONTHDAY_SPACE_Z || timeformat == SEEDORDINAL)
-  {
-    if (!(ms_gmtime64_r (&isec, &tms)))
-    {
-      ms_log (2, "Error converting epoch-time of (%" PRId64 ") to date-time components\n", isec);
-      return NULL;
-    }
-  }
-
-  /* Print no subseconds */
+  /* Determine number of subsecond digits to print: none, micro or nano */
   if (subseconds == NONE || (subseconds == MICRO_NONE && microsec == 0) ||
       (subseconds == NANO_NONE && nanosec == 0) || (subseconds == NANO_MICRO_NONE && nanosec == 0))
   {
-    switch (timeformat)
-    {
-    case ISOMONTHDAY:
-    case ISOMONTHDAY_Z:
-    case ISOMONTHDAY_SPACE:
-    case ISOMONTHDAY_SPACE_Z:
-      expected = (timeformat == ISOMONTHDAY_Z || timeformat == ISOMONTHDAY_SPACE_Z) ? 20 : 19;
-      printed = snprintf (
-          timestr, timestrsize, "%4d-%02d-%02d%c%02d:%02d:%02d%s", tms.tm_year + 1900,
-          tms.tm_mon + 1, tms.tm_mday,
-          (timeformat == ISOMONTHDAY_SPACE || timeformat == ISOMONTHDAY_SPACE_Z) ? ' ' : 'T',
-          tms.tm_hour, tms.tm_min, tms.tm_sec,
-          (timeformat == ISOMONTHDAY_Z || timeformat == ISOMONTHDAY_SPACE_Z) ? "Z" : "");
-      break;
-    case ISOMONTHDAY_DOY:
-    case ISOMONTHDAY_DOY_Z:
-      expected = (timeformat == ISOMONTHDAY_DOY_Z) ? 26 : 25;
-      printed =
-          snprintf (timestr, timestrsize, "%4d-%02d-%02dT%02d:%02d:%02d%s (%03d)",
-                    tms.tm_year + 1900, tms.tm_mon + 1, tms.tm_mday, tms.tm_hour, tms.tm_min,
-                    tms.tm_sec, (timeformat == ISOMONTHDAY_DOY_Z) ? "Z" : "", tms.tm_yday + 1);
-      break;
-    case SEEDORDINAL:
-      expected = 17;
-      printed = snprintf (timestr, timestrsize, "%4d,%03d,%02d:%02d:%02d", tms.tm_year + 1900,
-                          tms.tm_yday + 1, tms.tm_hour, tms.tm_min, tms.tm_sec);
-      break;
-    case UNIXEPOCH:
-      expected = -1;
-      printed = snprintf (timestr, timestrsize, "%" PRId64, isec);
-      break;
-    case NANOSECONDEPOCH:
-      expected = -1;
-      printed = snprintf (timestr, timestrsize, "%" PRId64, nstime);
-      break;
-    }
+    subdigits = 0;
   }
-  /* Print microseconds */
   else if (subseconds == MICRO || (subseconds == MICRO_NONE && microsec) ||
            (subseconds == NANO_MICRO && submicro == 0) ||
            (subseconds == NANO_MICRO_NONE && submicro == 0))
   {
-    switch (timeformat)
-    {
-    case ISOMONTHDAY:
-    case ISOMONTHDAY_Z:
-    case ISOMONTHDAY_SPACE:
-    case ISOMONTHDAY_SPACE_Z:
-      expected = (timeformat == ISOMONTHDAY_Z || timeformat == ISOMONTHDAY_SPACE_Z) ? 27 : 26;
-      printed = snprintf (
-          timestr, timestrsize, "%4d-%02d-%02d%c%02d:%02d:%02d.%06d%s", tms.tm_year + 1900,
-          tms.tm_mon + 1, tms.tm_mday,
-          (timeformat == ISOMONTHDAY_SPACE || timeformat == ISOMONTHDAY_SPACE_Z) ? ' ' : 'T',
-          tms.tm_hour, tms.tm_min, tms.tm_sec, microsec,
-          (timeformat == ISOMONTHDAY_Z || timeformat == ISOMONTHDAY_SPACE_Z) ? "Z" : "");
-      break;
-    case ISOMONTHDAY_DOY:
-    case ISOMONTHDAY_DOY_Z:
-      expected = (timeformat == ISOMONTHDAY_DOY_Z) ? 33 : 32;
-      printed = snprintf (timestr, timestrsize, "%4d-%02d-%02dT%02d:%02d:%02d.%06d%s (%03d)",
-                          tms.tm_year + 1900, tms.tm_mon + 1, tms.tm_mday, tms.tm_hour, tms.tm_min,
-                          tms.tm_sec, microsec, (timeformat == ISOMONTHDAY_DOY_Z) ? "Z" : "",
-                          tms.tm_yday + 1);
-      break;
-    case SEEDORDINAL:
-      expected = 24;
-      printed = snprintf (timestr, timestrsize, "%4d,%03d,%02d:%02d:%02d.%06d", tms.tm_year + 1900,
-                          tms.tm_yday + 1, tms.tm_hour, tms.tm_min, tms.tm_sec, microsec);
-      break;
-    case UNIXEPOCH:
-      expected = -1;
-      printed = snprintf (timestr, timestrsize, "%s%" PRId64 ".%06d",
-                          (nstime < 0 && rawisec == 0) ? "-" : "", rawisec, rawnanosec / 1000);
-      break;
-    case NANOSECONDEPOCH:
-      expected = -1;
-      printed = snprintf (timestr, timestrsize, "%" PRId64, nstime);
-      break;
-    }
+    subdigits = 6;
   }
-  /* Print nanoseconds */
   else if (subseconds == NANO || (subseconds == NANO_NONE && nanosec) ||
            (subseconds == NANO_MICRO && submicro) || (subseconds == NANO_MICRO_NONE && submicro))
   {
-    switch (timeformat)
-    {
-    case ISOMONTHDAY:
-    case ISOMONTHDAY_Z:
-    case ISOMONTHDAY_SPACE:
-    case ISOMONTHDAY_SPACE_Z:
-      expected = (timeformat == ISOMONTHDAY_Z || timeformat == ISOMONTHDAY_SPACE_Z) ? 30 : 29;
-      printed = snprintf (
-          timestr, timestrsize, "%4d-%02d-%02d%c%02d:%02d:%02d.%09d%s", tms.tm_year + 1900,
-          tms.tm_mon + 1, tms.tm_mday,
-          (timeformat == ISOMONTHDAY_SPACE || timeformat == ISOMONTHDAY_SPACE_Z) ? ' ' : 'T',
-          tms.tm_hour, tms.tm_min, tms.tm_sec, nanosec,
-          (timeformat == ISOMONTHDAY_Z || timeformat == ISOMONTHDAY_SPACE_Z) ? "Z" : "");
-      break;
-    case ISOMONTHDAY_DOY:
-    case ISOMONTHDAY_DOY_Z:
-      expected = (timeformat == ISOMONTHDAY_DOY_Z) ? 36 : 35;
-      printed = snprintf (timestr, timestrsize, "%4d-%02d-%02dT%02d:%02d:%02d.%09d%s (%03d)",
-                          tms.tm_year + 1900, tms.tm_mon + 1, tms.tm_mday, tms.tm_hour, tms.tm_min,
-                          tms.tm_sec, nanosec, (timeformat == ISOMONTHDAY_DOY_Z) ? "Z" : "",
-                          tms.tm_yday + 1);
-      break;
-    case SEEDORDINAL:
-      expected = 27;
-      printed = snprintf (timestr, timestrsize, "%4d,%03d,%02d:%02d:%02d.%09d", tms.tm_year + 1900,
-                          tms.tm_yday + 1, tms.tm_hour, tms.tm_min, tms.tm_sec, nanosec);
-      break;
-    case UNIXEPOCH:
-      expected = -1;
-      printed = snprintf (timestr, timestrsize, "%s%" PRId64 ".%09d",
-                          (nstime < 0 && rawisec == 0) ? "-" : "", rawisec, rawnanosec);
-      break;
-    case NANOSECONDEPOCH:
-      expected = -1;
-      printed = snprintf (timestr, timestrsize, "%" PRId64, nstime);
-      break;
-    }
+    subdigits = 9;
   }
   /* Otherwise this is a unhandled combination of values, timeformat and subseconds */
   else
@@ -1246,8 +1321,91 @@ ms_nstime2timestr_n (nstime_t nstime, char *timestr, size_t timestrsize, ms_time
     return NULL;
   }
 
-  if (expected == 0 || printed < 0 || printed >= (int)timestrsize ||
-      (expected > 0 && printed != expected))
+  /* Calendar formats are assembled from the cached date and time-of-day
+   * strings of the second, only the subseconds are formatted per call */
+  switch (timeformat)
+  {
+  case ISOMONTHDAY:
+  case ISOMONTHDAY_Z:
+  case ISOMONTHDAY_DOY:
+  case ISOMONTHDAY_DOY_Z:
+  case ISOMONTHDAY_SPACE:
+  case ISOMONTHDAY_SPACE_Z:
+    isoformat = 1;
+    /* Fall through */
+  case SEEDORDINAL:
+    tc = lm_epoch2time (isec, &local);
+
+    if (isoformat)
+    {
+      memcpy (cp, tc->isodate, 10);
+      cp += 10;
+      *cp++ = (timeformat == ISOMONTHDAY_SPACE || timeformat == ISOMONTHDAY_SPACE_Z) ? ' ' : 'T';
+    }
+    else
+    {
+      memcpy (cp, tc->seeddate, 8);
+      cp += 8;
+      *cp++ = ',';
+    }
+
+    memcpy (cp, tc->hms, 8);
+    cp += 8;
+
+    if (subdigits == 6)
+    {
+      *cp++ = '.';
+      cp = lm_putdigits (cp, (uint32_t)microsec, 6);
+    }
+    else if (subdigits == 9)
+    {
+      *cp++ = '.';
+      cp = lm_putdigits (cp, (uint32_t)nanosec, 9);
+    }
+
+    if (timeformat == ISOMONTHDAY_Z || timeformat == ISOMONTHDAY_DOY_Z ||
+        timeformat == ISOMONTHDAY_SPACE_Z)
+      *cp++ = 'Z';
+
+    if (timeformat == ISOMONTHDAY_DOY || timeformat == ISOMONTHDAY_DOY_Z)
+    {
+      memcpy (cp, " (", 2);
+      memcpy (cp + 2, tc->seeddate + 5, 3);
+      cp[5] = ')';
+      cp += 6;
+    }
+
+    *cp = '\0';
+    printed = (int)(cp - buffer);
+    break;
+  case UNIXEPOCH:
+    if (subdigits == 0)
+      printed = snprintf (buffer, sizeof (buffer), "%" PRId64, isec);
+    else if (subdigits == 6)
+      printed = snprintf (buffer, sizeof (buffer), "%s%" PRId64 ".%06d",
+                          (nstime < 0 && rawisec == 0) ? "-" : "", rawisec, rawnanosec / 1000);
+    else
+      printed = snprintf (buffer, sizeof (buffer), "%s%" PRId64 ".%09d",
+                          (nstime < 0 && rawisec == 0) ? "-" : "", rawisec, rawnanosec);
+    break;
+  case NANOSECONDEPOCH:
+    printed = snprintf (buffer, sizeof (buffer), "%" PRId64, nstime);
+    break;
+  default:
+    ms_log (2, "Time string not generated with the expected length\n");
+    return NULL;
+  }
+
+  /* Copy to the destination, truncating as snprintf() would if too small */
+  if (printed >= 0 && timestrsize > 0)
+  {
+    size_t length = ((size_t)printed < timestrsize) ? (size_t)printed : timestrsize - 1;
+
+    memcpy (timestr, buffer, length);
+    timestr[length] = '\0';
+  }
+
+  if (printed < 0 || printed >= (int)timestrsize)
   {
     ms_log (2, "Time string not generated with the expected length\n");
     return NULL;
@@ -1431,6 +1589,123 @@ ms_frac2nsec (const char *frac)
   return nsec;
 } /* End of ms_frac2nsec() */
 
+/* Parse 'count' decimal digits at 'str' into 'value', returns 0 if all are digits */
+static inline int
+lm_parsedigits (const char *str, int count, int *value)
+{
+  int idx;
+
+  *value = 0;
+  for (idx = 0; idx < count; idx++)
+  {
+    if (str[idx] < '0' || str[idx] > '9')
+      return -1;
+
+    *value = *value * 10 + (str[idx] - '0');
+  }
+
+  return 0;
+}
+
+/***************************************************************************
+ * INTERNAL Single-pass parser for the most common time string shapes:
+ *
+ *   ISO month-day: "YYYY-MM-DD[{T| }hh:mm:ss[.fffffffff]][Z]"
+ *   ISO ordinal:   "YYYY-DDD[{T| }hh:mm:ss[.fffffffff]][Z]"
+ *   SEED ordinal:  "YYYY,DDD[{,|T| }hh{:|,}mm{:|,}ss[.fffffffff]][Z]"
+ *
+ * Only strings with exactly these field widths and in-range values are
+ * handled, the result is identical to that of the general parsing in
+ * ms_timestr2nstime().  Anything else, including all strings that are
+ * errors, is declined and left to the general parsing so that error
+ * reporting is unchanged.
+ *
+ * Returns 0 and sets @p nstime when handled, otherwise -1.
+ ***************************************************************************/
+static int
+lm_timestr2nstime_fast (const char *timestr, nstime_t *nstime)
+{
+  static const int cumdays[] = {0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334};
+  const char *cp = timestr;
+  int year;
+  int mon;
+  int mday;
+  int yday;
+  int hour = 0;
+  int min = 0;
+  int sec = 0;
+  uint32_t nsec = 0;
+  int seed;
+  int digits;
+
+  if (lm_parsedigits (cp, 4, &year) || !VALIDYEAR (year))
+    return -1;
+
+  seed = (cp[4] == ',');
+  if (cp[4] != '-' && !seed)
+    return -1;
+
+  /* Month-day, "YYYY-MM-DD" */
+  if (!seed && lm_parsedigits (cp + 5, 2, &mon) == 0 && cp[7] == '-')
+  {
+    if (!VALIDMONTH (mon) || lm_parsedigits (cp + 8, 2, &mday) ||
+        !VALIDMONTHDAY (year, mon, mday))
+      return -1;
+
+    yday = cumdays[mon - 1] + mday + ((mon > 2 && LEAPYEAR (year)) ? 1 : 0);
+    cp += 10;
+  }
+  /* Ordinal, "YYYY-DDD" or "YYYY,DDD" */
+  else
+  {
+    if (lm_parsedigits (cp + 5, 3, &yday) || !VALIDYEARDAY (year, yday))
+      return -1;
+
+    cp += 8;
+  }
+
+  /* Time of day, ISO strings must use a 'T' or space separator */
+  if (*cp == 'T' || *cp == ' ' || (seed && *cp == ','))
+  {
+    if (lm_parsedigits (cp + 1, 2, &hour) || !VALIDHOUR (hour) ||
+        !(cp[3] == ':' || (seed && cp[3] == ',')) || lm_parsedigits (cp + 4, 2, &min) ||
+        !VALIDMIN (min) || !(cp[6] == ':' || (seed && cp[6] == ',')) ||
+        lm_parsedigits (cp + 7, 2, &sec) || !VALIDSEC (sec))
+      return -1;
+
+    cp += 9;
+
+    if (*cp == '.')
+    {
+      nsec = ms_frac2nsec (cp);
+
+      for (cp++, digits = 0; *cp >= '0' && *cp <= '9'; cp++)
+        digits++;
+
+      if (digits == 0)
+        return -1;
+
+      /* A fractional second that rounds up to a full second is carried */
+      if (nsec >= 1000000000)
+      {
+        nsec = 0;
+        sec += 1;
+      }
+    }
+  }
+
+  if (*cp == 'Z' || *cp == 'z')
+    cp++;
+
+  /* Must be at the end and no longer than the general parsing allows */
+  if (*cp != '\0' || (cp - timestr) > 32)
+    return -1;
+
+  *nstime = ms_time2nstime_int (year, yday, hour, min, sec, nsec);
+
+  return 0;
+} /* End of lm_timestr2nstime_fast() */
+
 /** ************************************************************************
  * @brief Convert a time string to a high precision epoch time.
  *
@@ -1485,6 +1760,10 @@ ms_timestr2nstime (const char *timestr)
     return NSTERROR;
   }
 
+  /* Common ISO and SEED shapes are parsed directly */
+  if (lm_timestr2nstime_fast (timestr, &nstime) == 0)
+    return nstime;
+
   /* Determine first delimiter,
    * delimiter count before date-time separator,
    * number-like character count,
@@ -1866,7 +2145,7 @@ nstime_t
 ms_sampletime (nstime_t time, int64_t offset, double samprate)
 {
   nstime_t span = 0;
-  LeapSecond *lslist = leapsecondlist;
+  LeapSecond *lslist = *lm_leapsecondlist ();
   double spandouble = 0.0;
 
   if (offset < 0)
@@ -1936,7 +2215,8 @@ ms_bigendianhost (void)
 /** ************************************************************************
  * @brief Read leap second file specified by an environment variable
  *
- * Leap seconds are loaded into the library's global leapsecond list.
+ * Leap seconds are loaded into the leap second list of the calling
+ * thread's library context, the global ::leapsecondlist by default.
  *
  * @param[in] envvarname Environment variable that identifies the leap second file
  *
@@ -1962,7 +2242,8 @@ ms_readleapseconds (const char *envvarname)
 /** ************************************************************************
  * @brief Read leap second from the specified file
  *
- * Leap seconds are loaded into the library's global leapsecond list.
+ * Leap seconds are loaded into the leap second list of the calling
+ * thread's library context, the global ::leapsecondlist by default.
  *
  * The file is expected to be in NTP leap second list format. Some locations
  * where this file can be obtained are indicated in RFC 8633 section 3.7:
@@ -1978,6 +2259,7 @@ ms_readleapseconds (const char *envvarname)
 int
 ms_readleapsecondfile (const char *filename)
 {
+  LeapSecond **list = lm_leapsecondlist ();
   FILE *fp = NULL;
   LeapSecond *ls = NULL;
   LeapSecond *lastls = NULL;
@@ -2001,19 +2283,8 @@ ms_readleapsecondfile (const char *filename)
     return -1;
   }
 
-  /* Detatch embedded leap second list */
-  if (leapsecondlist == &embedded_leapsecondlist[0])
-  {
-    leapsecondlist = NULL;
-  }
-
-  /* Free existing leapsecondlist */
-  while (leapsecondlist != NULL)
-  {
-    LeapSecond *next = leapsecondlist->next;
-    libmseed_memory.free (leapsecondlist);
-    leapsecondlist = next;
-  }
+  /* Detach embedded leap second list and free any existing list */
+  lm_free_leapsecondlist (list, lm_memory ());
 
   while (fgets (readline, sizeof (readline) - 1, fp))
   {
@@ -2069,7 +2340,7 @@ ms_readleapsecondfile (const char *filename)
         return -1;
       }
 
-      if ((ls = (LeapSecond *)libmseed_memory.malloc (sizeof (LeapSecond))) == NULL)
+      if ((ls = (LeapSecond *)lm_memory ()->malloc (sizeof (LeapSecond))) == NULL)
       {
         ms_log (2, "Cannot allocate LeapSecond entry, out of memory?\n");
         fclose (fp);
@@ -2081,10 +2352,10 @@ ms_readleapsecondfile (const char *filename)
       ls->next = NULL;
       count++;
 
-      /* Add leap second to global list */
-      if (!leapsecondlist)
+      /* Add leap second to list */
+      if (!*list)
       {
-        leapsecondlist = ls;
+        *list = ls;
         lastls = ls;
       }
       else
@@ -26,6 +26,183 @@ extern "C" {
 #endif
 
 #include "libmseed.h"
+#include "threadutils.h"
+
+/* Thread-local storage-class for per-thread library state
+ *
+ * If not disabled by a defined LIBMSEED_NO_THREADING, use options for
+ * thread-local storage, otherwise state is shared by all threads.
+ *
+ * Windows has its own designation for TLS.
+ * Otherwise, C11 defines the standardized _Thread_local storage-class.
+ * Otherwise fallback to the commonly supported __thread keyword.
+ */
+#if !defined(LIBMSEED_NO_THREADING)
+#if defined(LMP_WIN)
+#define lm_thread_local __declspec (thread)
+#elif __STDC_VERSION__ >= 201112L
+#define lm_thread_local _Thread_local
+#else
+#define lm_thread_local __thread
+#endif
+#else
+#define lm_thread_local
+#endif
+
+/* URL connection settings, negative values are unset and resolved from
+ * environment variables or defaults when a connection is opened */
+typedef struct LMURLSettings
+{
+  int debug;              /* Enable libcurl verbose output */
+  long ssl_noverify;      /* Disable SSL peer and host verification */
+  long connecttimeout;    /* Connection timeout in seconds, 0 disables */
+  long stalltimeout;      /* Stall timeout in seconds, 0 disables */
+  void *easy;             /* libcurl easy handle holding credentials, duplicated per connection */
+  void *headers;          /* libcurl list of custom headers */
+  int parallel;           /* Number of concurrent range requests, 0 or 1 disables */
+  int64_t rangesize;      /* Size of each concurrent range request in bytes */
+  void *share;            /* DNS cache and TLS sessions shared by all requests */
+  void *multi;            /* libcurl multi handle keeping connections open between requests */
+  const void *multiowner; /* Identifies the only thread using multi */
+  void *prefetch;         /* Prefetched transfers not yet opened, oldest first */
+  int prefetchcount;      /* Number of prefetched transfers not yet opened */
+} LMURLSettings;
+
+#define LMURLSettings_INITIALIZER                                                 \
+  {.debug = -1, .ssl_noverify = -1, .connecttimeout = -1, .stalltimeout = -1,      \
+   .easy = NULL, .headers = NULL, .parallel = -1, .rangesize = 0, .share = NULL,   \
+   .multi = NULL, .multiowner = NULL, .prefetch = NULL, .prefetchcount = 0}
+
+/* Memory arena, see arena.c */
+typedef struct LMArena LMArena;
+
+extern LMArena *lm_arena_create (size_t blocksize);
+extern void lm_arena_reset (LMArena *arena);
+extern void lm_arena_destroy (LMArena *arena);
+extern void *lm_arena_malloc (size_t size);
+extern void *lm_arena_realloc (void *ptr, size_t size);
+extern void lm_arena_free (void *ptr);
+
+/* Read-ahead of input streams by a helper thread, see readahead.c */
+typedef struct LMReadAhead LMReadAhead;
+
+/* Reader state of a MS3FileParam, kept behind the opaque MS3FileParam.reader
+ * and allocated when first needed, see fileutils.c */
+typedef struct LMReader
+{
+  LMReadAhead *readahead; /* Read-ahead state, see MSF_READAHEAD */
+  MS3Record **recordpool; /* Records reused by ms3_readmsr_batch() */
+  int poolsize;           /* Number of entries in record pool */
+} LMReader;
+
+#define LM_READAHEAD(MSFP) ((MSFP)->reader ? ((LMReader *)(MSFP)->reader)->readahead : NULL)
+
+extern LMReader *lm_reader (MS3FileParam *msfp);
+
+extern int lm_readahead_start (MS3FileParam *msfp, uint32_t flags);
+extern int lm_readahead_fill (MS3FileParam *msfp);
+extern int lm_readahead_eof (MS3FileParam *msfp);
+extern void lm_readahead_stop (MS3FileParam *msfp);
+
+/* Prefetching of local files, see fileprefetch.c */
+typedef struct LMFilePrefetch LMFilePrefetch;
+
+extern int lm_fileprefetch_add (const char *path, uint32_t flags);
+extern int lm_fileprefetch_take (const char *path, char **buffer, int64_t *length);
+extern void lm_fileprefetch_cancel (void);
+extern void lm_free_fileprefetch (LMFilePrefetch **prefetch);
+
+/* Buffered writer with a buffer of a specified size, see writer.c */
+extern MS3Writer *lm_writer_open (const char *mspath, int8_t overwrite, size_t bufsize);
+
+/* Streaming decompression of compressed input, see decompress.c */
+#define LM_DECOMPRESS_NONE 0
+#define LM_DECOMPRESS_GZIP 1
+#define LM_DECOMPRESS_XZ 2
+#define LM_DECOMPRESS_ZSTD 3
+
+extern int lm_decompress_format (const uint8_t *header, size_t length);
+extern int lm_decompress_support (int format);
+extern int lm_decompress_open (LMIO *io, int format, const char *path, int64_t startoffset);
+extern int64_t lm_decompress_read (LMIO *io, void *buffer, size_t size);
+extern int lm_decompress_eof (LMIO *io);
+extern int lm_decompress_offset (LMIO *io, int64_t offset, int64_t *compressed, int64_t *skip);
+extern int lm_decompress_close (LMIO *io);
+
+/* Records for which mapping miniSEED 2 header flags and blockettes to
+ * extra headers is deferred by MSF_DEFEREXTRA, tracked outside of the
+ * public record structure.  See msr3_unpack_extra(). */
+extern int lm_extrapending (const MS3Record *msr);
+extern int lm_extrapending_set (const MS3Record *msr, int pending);
+
+/* Library context (opaque in public header).
+ *
+ * Holds the state that is otherwise global: memory management functions,
+ * logging parameters, the leap second list, URL settings and the stream
+ * used by ms3_readmsr().  A context is used by the threads it is bound
+ * to with ms_context_bind(), threads without a bound context use the
+ * global state, which serves as the default context. */
+struct LMContext
+{
+  LIBMSEED_MEMORY memory;       /* Memory management functions */
+  LMArena *arena;               /* Arena used by the lm_arena_* memory functions, or NULL */
+  size_t prealloc_block_size;   /* Re-allocation block size, 0 disables */
+  MSLogParam logparam;          /* Logging parameters */
+  lmp_mutex_t logmutex;         /* Serializes use of the message registry */
+  LeapSecond *leapsecondlist;   /* Leap second list, initially the embedded list */
+  LMURLSettings url;            /* URL connection settings */
+  LMFilePrefetch *fileprefetch; /* Prefetched files, or NULL */
+  MS3FileParam readparam;       /* Stream state for ms3_readmsr() */
+};
+
+/* Context bound to the calling thread, NULL for the default context */
+extern lm_thread_local LMContext *lm_currentcontext;
+
+/* Memory management functions of the calling thread's context */
+static inline LIBMSEED_MEMORY *
+lm_memory (void)
+{
+  return (lm_currentcontext) ? &lm_currentcontext->memory : &libmseed_memory;
+}
+
+/* Re-allocation block size of the calling thread's context */
+static inline size_t
+lm_prealloc_block_size (void)
+{
+  return (lm_currentcontext) ? lm_currentcontext->prealloc_block_size
+                             : libmseed_prealloc_block_size;
+}
+
+/* FNV-1a hash of a source identifier, used by SID interning and the
+ * trace ID index and shards of trace lists */
+static inline uint32_t
+lm_sid_hash (const char *sid)
+{
+  uint32_t hash = 2166136261u;
+
+  while (*sid)
+  {
+    hash ^= (uint8_t)*sid++;
+    hash *= 16777619u;
+  }
+
+  return hash;
+}
+
+/* SID interning that does not log errors, see ms_sid_intern() */
+extern uint32_t lm_sid_intern (const char *sid);
+
+/* Leap second list of the calling thread's context */
+extern LeapSecond **lm_leapsecondlist (void);
+extern LeapSecond *lm_embedded_leapsecondlist (void);
+extern void lm_free_leapsecondlist (LeapSecond **list, LIBMSEED_MEMORY *memory);
+
+/* Logging parameters of the calling thread's context */
+extern MSLogParam *lm_logparam (void);
+
+/* URL settings of the calling thread's context, and release of their resources */
+extern LMURLSettings *lm_urlsettings (void);
+extern void lm_free_urlsettings (LMURLSettings *url);
 
 /* Generator-style packing context for MS3Record (opaque in public header) */
 struct MS3RecordPacker
@@ -52,6 +229,11 @@ struct MS3RecordPacker
   uint8_t finished;            /* Packing complete flag */
 };
 
+/* Position a packer to continue at the specified sample offset, records
+ * packed from there are identical to those of a packer that reached the
+ * offset sequentially */
+extern int lm_pack_seek (MS3RecordPacker *packer, int64_t sampleoffset);
+
 /* Generator-style packing context for MS3TraceList (opaque in public header) */
 struct MS3TraceListPacker
 {
@@ -75,7 +257,7 @@ struct MS3TraceListPacker
 };
 
 /* Number of most-recently-active segments tracked per MS3TraceID, used to
- * bound the segment-list search in _mstl3_addmsr_impl() */
+ * bound the segment-list search in lm_addmsr() */
 #define LM_RECENTSEGS 4
 
 /* Maximum hops walked when resolving list order among recent segments or
@@ -83,6 +265,13 @@ struct MS3TraceListPacker
  * refused in favor of a full scan */
 #define LM_RECENTSEGS_MAXWALK 8
 
+/* Entry of the index of trace IDs by source ID, see lm_findID_index() */
+typedef struct LMIDIndexSlot
+{
+  uint32_t hash;  /* Hash of the source ID */
+  MS3TraceID *id; /* First trace ID with the source ID, NULL if unused */
+} LMIDIndexSlot;
+
 /* Private extension of MS3TraceList (opaque in public header).
  *
  * The public struct is the first member so public pointers, sizeof, and
@@ -91,8 +280,30 @@ typedef struct
 {
   MS3TraceList mstl;
   int8_t foreignid; /* Set if an MS3TraceID not allocated by this library may be present */
+  int8_t noidindex;       /* Set if idindex is not maintained */
+  LMIDIndexSlot *idindex; /* Hash table of trace IDs by source ID, see lm_findID_index() */
+  uint32_t idindexsize;   /* Number of slots allocated at idindex, a power of two */
+  uint32_t idindexcount;  /* Number of used slots at idindex */
 } LMTraceListNode;
 
+/* Default number of shards of a MS3TraceListShards */
+#define LM_DEFAULT_SHARDS 64
+
+/* A shard of a MS3TraceListShards, a trace list and its lock */
+typedef struct LMTraceShard
+{
+  lmp_mutex_t lock;
+  MS3TraceList *mstl;
+} LMTraceShard;
+
+/* Trace list sharded by source ID for concurrent insertion (opaque in public header) */
+struct MS3TraceListShards
+{
+  LMTraceShard *shard; /* Array of shards */
+  int nshards;         /* Number of shards */
+  MS3TraceList *view;  /* Combined trace list while acquired, otherwise NULL */
+};
+
 /* Private extension of MS3TraceID (opaque in public header).
  *
  * Tracks the most-recently-active segments of a trace ID (the "recent set")
@@ -29,8 +29,8 @@ extern "C"
 {
 #endif
 
-#define LIBMSEED_VERSION "3.5.3"    //!< Library version
-#define LIBMSEED_RELEASE "2026.211" //!< Library release date
+#define LIBMSEED_VERSION "3.6.0"    //!< Library version
+#define LIBMSEED_RELEASE "2026.291" //!< Library release date
 
 /** @defgroup io-functions File and URL I/O */
 /** @defgroup miniseed-record Record Handling */
@@ -43,6 +43,7 @@ extern "C"
 /** @defgroup logging Central Logging */
 /** @defgroup utility-functions General Utility Functions */
 /** @defgroup leapsecond Leap Second Handling */
+/** @defgroup library-context Library Context */
 
 /** @defgroup low-level Low level definitions
     @brief The low-down, the nitty gritty, the basics */
@@ -445,6 +446,8 @@ extern int msr3_pack_header2 (const MS3Record *msr, char *record, uint32_t recbu
 
 extern int64_t msr3_unpack_data (MS3Record *msr, int8_t verbose);
 
+extern int msr3_unpack_extra (MS3Record *msr, int8_t verbose);
+
 extern int msr3_data_bounds (const MS3Record *msr, uint32_t *dataoffset, uint32_t *datasize);
 
 extern int64_t ms_decode_data (const void *input, uint64_t inputsize, uint8_t encoding,
@@ -603,6 +606,7 @@ typedef struct MS3RecordList
     \sa ms3_readtracelist_timewin()
     \sa ms3_readtracelist_selection()
     \sa mstl3_writemseed()
+    \sa ms3_writer_open()
     @{ */
 
 /** @brief Maximum skip list height for MSTraceIDs */
@@ -699,6 +703,11 @@ extern MS3TraceSeg *mstl3_addmsr_recordptr (MS3TraceList *mstl, const MS3Record
                                             MS3RecordPtr **pprecptr, int8_t splitversion,
                                             int8_t autoheal, uint32_t flags,
                                             const MS3Tolerance *tolerance);
+extern int64_t mstl3_addmsr_batch (MS3TraceList *mstl, MS3Record **msrs, int64_t count,
+                                   int8_t splitversion, int8_t autoheal, uint32_t flags,
+                                   const MS3Tolerance *tolerance);
+extern int mstl3_merge (MS3TraceList *mstl, MS3TraceList **ppsrc, int8_t splitversion,
+                        int8_t autoheal, uint32_t flags, const MS3Tolerance *tolerance);
 extern int64_t mstl3_readbuffer (MS3TraceList **ppmstl, const char *buffer, uint64_t bufferlength,
                                  int8_t splitversion, uint32_t flags, const MS3Tolerance *tolerance,
                                  int8_t verbose);
@@ -730,6 +739,12 @@ extern int64_t mstl3_pack_ppupdate_flushidle (MS3TraceList *mstl,
                                               int8_t verbose, char *extra,
                                               uint32_t flush_idle_seconds);
 
+extern int64_t mstl3_pack_parallel (MS3TraceList *mstl,
+                                    void (*record_handler) (char *, int, void *),
+                                    void *handlerdata, int reclen, int8_t encoding,
+                                    int64_t *packedsamples, uint32_t flags, int8_t verbose,
+                                    char *extra, int nthreads);
+
 extern int64_t mstl3_pack_segment (MS3TraceList *mstl, MS3TraceID *id, MS3TraceSeg *seg,
                                    void (*record_handler) (char *, int, void *), void *handlerdata,
                                    int reclen, int8_t encoding, int64_t *packedsamples,
@@ -743,6 +758,17 @@ extern void mstl3_printsynclist (const MS3TraceList *mstl, const char *dccid,
                                  ms_subseconds_t subseconds);
 extern void mstl3_printgaplist (const MS3TraceList *mstl, ms_timeformat_t timeformat,
                                 double *mingap, double *maxgap);
+
+/** @brief Opaque trace list sharded by source ID for concurrent insertion */
+typedef struct MS3TraceListShards MS3TraceListShards;
+
+extern MS3TraceListShards *mstl3_shards_init (int nshards);
+extern void mstl3_shards_free (MS3TraceListShards **ppshards, int8_t freeprvtptr);
+extern int mstl3_shards_addmsr (MS3TraceListShards *shards, const MS3Record *msr,
+                                int8_t splitversion, int8_t autoheal, uint32_t flags,
+                                const MS3Tolerance *tolerance);
+extern MS3TraceList *mstl3_shards_acquire (MS3TraceListShards *shards);
+extern int mstl3_shards_release (MS3TraceListShards *shards);
 /** @} */
 
 /** @addtogroup io-functions
@@ -752,6 +778,24 @@ extern void mstl3_printgaplist (const MS3TraceList *mstl, ms_timeformat_t timefo
     URLs (if optional support is included).  The miniSEED writing
     interfaces write to regular files.
 
+    Many small local files can be read into memory in the background,
+    before they are opened, with @ref ms3_file_prefetch().
+
+    Local files compressed with gzip, xz or zstd are identified by their
+    first bytes and decompressed while reading, if support for the format
+    is included by building the library with the \b LIBMSEED_GZIP (zlib),
+    \b LIBMSEED_XZ (liblzma) or \b LIBMSEED_ZSTD (libzstd) variables
+    defined.  Byte offsets, including those of byte ranges, refer to the
+    decompressed data, and @ref ms3_compressed_offset() maps them to the
+    compressed file.  Files in the zstd seekable format are read from the
+    frame containing the start of a byte range, with frames decompressed
+    in parallel.  The function @ref libmseed_decompress_support() can be
+    used as a run-time test for each format.
+
+    Many records, or the records of many calls, can be written to one
+    file with a buffered writer opened with @ref ms3_writer_open(), which
+    keeps the file open and writes records in large blocks.
+
     URL support for reading is included by building the library with the
     \b LIBMSEED_URL variable defined. URL path-specified resources can only be
     read, e.g. HTTP GET requests.  More advanced POST or form-based requests are
@@ -766,6 +810,9 @@ extern void mstl3_printgaplist (const MS3TraceList *mstl, ms_timeformat_t timefo
     - set arbitrary headers with @ref ms3_url_addheader()
     - set connection and stall timeouts with @ref ms3_url_timeout(), or the stall timeout with
    the \b LIBMSEED_URL_TIMEOUT environment variable
+    - fetch with concurrent byte-range requests with @ref ms3_url_parallel(), or the \b
+   LIBMSEED_URL_PARALLEL environment variable
+    - start transfers of URLs before they are read with @ref ms3_url_prefetch()
     - disable TLS/SSL peer and host verficiation by setting \b LIBMSEED_SSL_NOVERIFY environment
    variable
 
@@ -774,6 +821,7 @@ extern void mstl3_printgaplist (const MS3TraceList *mstl, ms_timeformat_t timefo
 
     \sa ms3_readmsr()
     \sa ms3_readmsr_selection()
+    \sa ms3_readmsr_batch()
     \sa ms3_readtracelist()
     \sa ms3_readtracelist_selection()
     \sa msr3_writemseed()
@@ -790,10 +838,14 @@ typedef struct LMIO
 {
   enum
   {
-    LMIO_NULL = 0,   //!< IO handle type is undefined
-    LMIO_FILE = 1,   //!< IO handle is FILE-type
-    LMIO_URL = 2,    //!< IO handle is URL-type
-    LMIO_FD = 3      //!< IO handle is a provided file descriptor
+    LMIO_NULL = 0,        //!< IO handle type is undefined
+    LMIO_FILE = 1,        //!< IO handle is FILE-type
+    LMIO_URL = 2,         //!< IO handle is URL-type
+    LMIO_FD = 3,          //!< IO handle is a provided file descriptor
+    LMIO_URLRANGES = 4,   //!< IO handle is URL-type read with concurrent range requests
+    LMIO_URLTRANSFER = 5, //!< IO handle is URL-type read from a buffered transfer
+    LMIO_BUFFER = 6,      //!< IO handle is a prefetched file read from memory
+    LMIO_DECOMPRESS = 7   //!< IO handle is a compressed file read through a decompressor
   } type;            //!< IO handle type
   void *handle;      //!< Primary IO handle, either file or URL
   void *handle2;     //!< Secondary IO handle for URL
@@ -827,6 +879,8 @@ typedef struct MS3FileParam
   int readoffset;   //!< INTERNAL: Read offset in read buffer
   uint32_t flags;   //!< INTERNAL: Stream reading state flags
   LMIO input;       //!< INTERNAL: IO handle, file or URL
+
+  void *reader;     //!< INTERNAL: Reader state for read-ahead and ms3_readmsr_batch()
 } MS3FileParam;
 
 /** @def MS3FileParam_INITIALIZER
@@ -841,13 +895,17 @@ typedef struct MS3FileParam
    .readlength = 0,                                                                                \
    .readoffset = 0,                                                                                \
    .flags = 0,                                                                                     \
-   .input = LMIO_INITIALIZER}
+   .input = LMIO_INITIALIZER,                                                                      \
+   .reader = NULL}
 
 extern int ms3_readmsr (MS3Record **ppmsr, const char *mspath, uint32_t flags, int8_t verbose);
 extern int ms3_readmsr_r (MS3FileParam **ppmsfp, MS3Record **ppmsr, const char *mspath,
                           uint32_t flags, int8_t verbose);
 extern int ms3_readmsr_selection (MS3FileParam **ppmsfp, MS3Record **ppmsr, const char *mspath,
                                   uint32_t flags, const MS3Selections *selections, int8_t verbose);
+extern int ms3_readmsr_batch (MS3FileParam **ppmsfp, MS3Record **records, int maxrecords,
+                              const char *mspath, uint32_t flags, const MS3Selections *selections,
+                              int8_t verbose);
 extern int ms3_readtracelist (MS3TraceList **ppmstl, const char *mspath,
                               const MS3Tolerance *tolerance, int8_t splitversion, uint32_t flags,
                               int8_t verbose);
@@ -859,8 +917,11 @@ extern int ms3_readtracelist_selection (MS3TraceList **ppmstl, const char *mspat
                                         const MS3Tolerance *tolerance,
                                         const MS3Selections *selections, int8_t splitversion,
                                         uint32_t flags, int8_t verbose);
+extern int ms3_file_prefetch (const char *path, uint32_t flags);
 extern int ms3_url_useragent (const char *program, const char *version);
 extern int ms3_url_timeout (long connecttimeout, long stalltimeout);
+extern int ms3_url_parallel (int connections, int64_t rangesize);
+extern int ms3_url_prefetch (const char *url, uint32_t flags);
 extern int ms3_url_userpassword (const char *userpassword);
 extern int ms3_url_addheader (const char *header);
 extern void ms3_url_freeheaders (void);
@@ -868,7 +929,25 @@ extern int64_t msr3_writemseed (MS3Record *msr, const char *mspath, int8_t overw
                                 uint32_t flags, int8_t verbose);
 extern int64_t mstl3_writemseed (MS3TraceList *mstl, const char *mspath, int8_t overwrite,
                                  int maxreclen, int8_t encoding, uint32_t flags, int8_t verbose);
+
+/** @brief Buffered writer of miniSEED records to a file, see ms3_writer_open() */
+typedef struct MS3Writer MS3Writer;
+
+extern MS3Writer *ms3_writer_open (const char *mspath, int8_t overwrite);
+extern int ms3_writer_preallocate (MS3Writer *writer, int64_t size);
+extern int ms3_writer_write (MS3Writer *writer, const char *record, int reclen);
+extern void ms3_writer_handler (char *record, int reclen, void *writer);
+extern int ms3_writer_flush (MS3Writer *writer);
+extern int ms3_writer_close (MS3Writer **ppwriter);
+extern int64_t msr3_writemseed_w (MS3Writer *writer, MS3Record *msr, uint32_t flags,
+                                  int8_t verbose);
+extern int64_t mstl3_writemseed_w (MS3Writer *writer, MS3TraceList *mstl, int maxreclen,
+                                   int8_t encoding, uint32_t flags, int8_t verbose);
+
 extern int libmseed_url_support (void);
+extern int libmseed_decompress_support (const char *format);
+extern int ms3_compressed_offset (MS3FileParam *msfp, int64_t offset, int64_t *compressed,
+                                  int64_t *skip);
 extern MS3FileParam *ms3_msfp_init (int64_t startoffset, int64_t endoffset, int fd);
 extern MS3FileParam *ms3_msfp_init_fd (int fd);
 /** Backwards compatibility alias for misnamed ms3_msfp_init_fd() */
@@ -883,6 +962,11 @@ extern MS3FileParam *ms3_msfp_init_fd (int fd);
     For data identified with FDSN codes, the SID is usally a simple
     combination of the codes.
 
+    Source identifiers may be interned with ms_sid_intern() to obtain
+    a small integer handle that is unique to each identifier, allowing
+    identifiers to be compared as integers and derived values, such
+    as the codes from ms_sid2nslc_interned(), to be cached.
+
     @{ */
 extern int ms_sid2nslc_n (const char *sid, char *net, size_t netsize, char *sta, size_t stasize,
                           char *loc, size_t locsize, char *chan, size_t chansize);
@@ -894,6 +978,10 @@ extern int ms_xchan2seedchan (char *seedchan, const char *xchan);
 extern int ms_strncpclean (char *dest, const char *source, int length);
 extern int ms_strncpcleantail (char *dest, const char *source, int length);
 extern int ms_strncpopen (char *dest, const char *source, int length);
+extern uint32_t ms_sid_intern (const char *sid);
+extern const char *ms_sid_interned (uint32_t handle);
+extern int ms_sid2nslc_interned (uint32_t handle, const char **net, const char **sta,
+                                 const char **loc, const char **chan);
 /** @} */
 
 /** @addtogroup extra-headers
@@ -1225,6 +1313,10 @@ extern int mseh_print (const MS3Record *msr, int indent);
     unless the system does not support the necessary thread-local
     storage directives.
 
+    Threads with a bound \ref library-context use the logging
+    parameters of that context instead, which are shared by all
+    threads the context is bound to.
+
     @anchor MessageOnError
     Message on Error
     ----------------
@@ -1567,6 +1659,64 @@ extern void *libmseed_memory_prealloc (void *ptr, size_t size, size_t *currentsi
 
 /** @} */
 
+/** @addtogroup library-context
+    @brief Independent sets of library state for multi-threaded use
+
+    By default the library uses global state: the memory management
+    functions in ::libmseed_memory and ::libmseed_prealloc_block_size,
+    the leap second list in ::leapsecondlist, the URL settings set with
+    the ms3_url_* functions and the stream used by ms3_readmsr().
+    Logging parameters are per-thread by default.
+
+    A library context holds an independent copy of all of this state.
+    A context is used by the threads it is bound to with
+    ms_context_bind(), all library calls in those threads use the state
+    of the context, including the configuration calls such as
+    ms_loginit(), ms_readleapsecondfile() and ms3_url_addheader().
+    Worker threads started by the library use the context of the
+    thread that started them.  Threads with distinct contexts share no
+    mutable library state.
+
+    Memory allocated by the library while a context is bound must be
+    freed while the same context, or one with the same memory
+    management functions, is bound.
+
+    A context can allocate from a built-in memory arena, see
+    ms_context_setarena().  This isolates the memory of one processing
+    pipeline, avoids contention on the system allocator between
+    threads with separate contexts, and allows all memory of the
+    pipeline to be released at once with ms_context_resetarena().
+    Memory of a single trace list can be isolated the same way by
+    building it with a dedicated context bound.
+
+    \code
+    LMContext *ctx = ms_context_create ();
+
+    ms_context_bind (ctx);
+    ms_readleapsecondfile ("leap-seconds.list");
+    ms3_readtracelist (&mstl, path, NULL, 0, MSF_UNPACKDATA, 0);
+    mstl3_free (&mstl, 1);
+    ms_context_bind (NULL);
+
+    ms_context_free (&ctx);
+    \endcode
+
+    @{ */
+
+/** @brief Opaque library context, see ms_context_create() */
+typedef struct LMContext LMContext;
+
+extern LMContext *ms_context_create (void);
+extern void ms_context_free (LMContext **ppctx);
+extern LMContext *ms_context_bind (LMContext *ctx);
+extern LMContext *ms_context_current (void);
+extern int ms_context_setmemory (LMContext *ctx, const LIBMSEED_MEMORY *memory,
+                                 size_t prealloc_block_size);
+extern int ms_context_setarena (LMContext *ctx, size_t blocksize);
+extern void ms_context_resetarena (LMContext *ctx);
+
+/** @} */
+
 #define DE_ASCII DE_TEXT //!< Mapping of legacy DE_ASCII to DE_TEXT
 
 /** @addtogroup encoding-values
@@ -1596,6 +1746,7 @@ extern void *libmseed_memory_prealloc (void *ptr, size_t size, size_t *currentsi
     @brief Flags indicating whether the header or payload needed byte swapping
 
     These are bit flags normally used to set/test the ::MS3Record.swapflag value.
+    Other bits of the value are reserved for internal use.
 
     @{ */
 #define MSSWAP_HEADER 0x01  //!< Header needed byte swapping
@@ -1639,6 +1790,9 @@ extern void *libmseed_memory_prealloc (void *ptr, size_t size, size_t *currentsi
 #define MSF_SPLITISVERSION 0x0800 //!< [TraceList] Use the splitversion value as version instead of record version
 #define MSF_SKIPADJACENTDUPLICATES 0x1000 //!< [TraceList] Skip adjacent duplicate records
 #define MSF_RECORDLIST_NOEXTRAS 0x2000 //!< [TraceList] Do not copy extra headers to the record list
+#define MSF_DEFEREXTRA 0x4000 //!< [Parsing] Defer mapping miniSEED 2 blockettes to extra headers, see msr3_unpack_extra()
+#define MSF_READAHEAD 0x8000 //!< [Parsing] Read input ahead of parsing with a helper thread, see ms3_readmsr()
+#define MSF_NOCACHE 0x10000 //!< [Parsing] Drop file input from the page cache once read, see ms3_readmsr()
 /** @} */
 
 #ifdef __cplusplus
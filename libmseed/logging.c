@@ -23,6 +23,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "internalstate.h"
 #include "libmseed.h"
 
 void rloginit_int (MSLogParam *logp, void (*log_print) (const char *), const char *logprefix,
@@ -36,27 +37,42 @@ void print_message_int (MSLogParam *logp, int level, const char *message, char *
 
 /* Initialize the global logging parameters
  *
- * If not disabled by a defined LIBMSEED_NO_THREADING, use options for
- * thread-local storage.  In this default case each thread will have
- * it's own "global" logging parameters initialized to the library
- * default settings.
- *
- * Windows has its own designation for TLS.
- * Otherwise, C11 defines the standardized _Thread_local storage-class.
- * Otherwise fallback to the commonly supported __thread keyword.
+ * If not disabled by a defined LIBMSEED_NO_THREADING, thread-local
+ * storage is used.  In this default case each thread will have it's
+ * own "global" logging parameters initialized to the library default
+ * settings.
  */
-#if !defined(LIBMSEED_NO_THREADING)
-#if defined(LMP_WIN)
-#define lm_thread_local __declspec (thread)
-#elif __STDC_VERSION__ >= 201112L
-#define lm_thread_local _Thread_local
-#else
-#define lm_thread_local __thread
-#endif
 lm_thread_local MSLogParam gMSLogParam = MSLogParam_INITIALIZER;
-#else
-MSLogParam gMSLogParam = MSLogParam_INITIALIZER;
-#endif
+
+/* Logging parameters of the library context bound to the calling
+ * thread, or the thread's "global" parameters by default */
+MSLogParam *
+lm_logparam (void)
+{
+  return (lm_currentcontext) ? &lm_currentcontext->logparam : &gMSLogParam;
+}
+
+/* Lock the message registry of logging parameters that belong to the
+ * bound context, which may be shared by multiple threads.  Returns the
+ * lock to release, or NULL when the parameters are private. */
+static lmp_mutex_t *
+registry_lock (MSLogParam *logp)
+{
+  if (lm_currentcontext && logp == &lm_currentcontext->logparam)
+  {
+    lmp_mutex_lock (&lm_currentcontext->logmutex);
+    return &lm_currentcontext->logmutex;
+  }
+
+  return NULL;
+}
+
+static void
+registry_unlock (lmp_mutex_t *lock)
+{
+  if (lock)
+    lmp_mutex_unlock (lock);
+}
 
 /** ************************************************************************
  * @brief Initialize the global logging parameters.
@@ -88,7 +104,7 @@ void
 ms_rloginit (void (*log_print) (const char *), const char *logprefix,
              void (*diag_print) (const char *), const char *errprefix, int maxmessages)
 {
-  rloginit_int (&gMSLogParam, log_print, logprefix, diag_print, errprefix, maxmessages);
+  rloginit_int (lm_logparam (), log_print, logprefix, diag_print, errprefix, maxmessages);
 } /* End of ms_rloginit() */
 
 /** ************************************************************************
@@ -132,7 +148,7 @@ ms_rloginit_l (MSLogParam *logp, void (*log_print) (const char *), const char *l
 
   if (logp == NULL)
   {
-    llog = (MSLogParam *)libmseed_memory.malloc (sizeof (MSLogParam));
+    llog = (MSLogParam *)lm_memory ()->malloc (sizeof (MSLogParam));
 
     if (llog == NULL)
     {
@@ -251,7 +267,7 @@ ms_rlog (const char *function, int level, const char *format, ...)
 
   va_start (varlist, format);
 
-  retval = rlog_int (&gMSLogParam, function, level, format, &varlist);
+  retval = rlog_int (lm_logparam (), function, level, format, &varlist);
 
   va_end (varlist);
 
@@ -302,7 +318,7 @@ ms_rlog_l (MSLogParam *logp, const char *function, int level, const char *format
   va_list varlist;
 
   if (!logp)
-    logp = &gMSLogParam;
+    logp = lm_logparam ();
 
   va_start (varlist, format);
 
@@ -331,6 +347,7 @@ int
 rlog_int (MSLogParam *logp, const char *function, int level, const char *format, va_list *varlist)
 {
   char message[MAX_LOG_MSG_LENGTH];
+  lmp_mutex_t *lock;
   int presize = 0;
   int printed = 0;
 
@@ -408,7 +425,9 @@ rlog_int (MSLogParam *logp, const char *function, int level, const char *format,
       printed -= 1;
     }
 
+    lock = registry_lock (logp);
     add_message_int (&logp->registry, function, level, message);
+    registry_unlock (lock);
   }
   else
   {
@@ -442,7 +461,7 @@ add_message_int (MSLogRegistry *logreg, const char *function, int level, const c
     return -1;
 
   /* Allocate new entry */
-  logentry = (MSLogEntry *)libmseed_memory.malloc (sizeof (MSLogEntry));
+  logentry = (MSLogEntry *)lm_memory ()->malloc (sizeof (MSLogEntry));
 
   if (logentry == NULL)
   {
@@ -484,7 +503,7 @@ add_message_int (MSLogRegistry *logreg, const char *function, int level, const c
 
       if (count > logreg->maxmessages)
       {
-        libmseed_memory.free (logentry);
+        lm_memory ()->free (logentry);
         logreg->messagecnt -= 1;
       }
 
@@ -567,17 +586,20 @@ ms_rlog_emit (MSLogParam *logp, int count, int context)
   MSLogEntry *logprint = NULL;
   char local_message[MAX_LOG_MSG_LENGTH];
   char *message = NULL;
+  lmp_mutex_t *lock;
   int emit = (count > 0) ? count : -1;
   int emitted = 0;
 
   if (!logp)
-    logp = &gMSLogParam;
+    logp = lm_logparam ();
 
   /* Pop off count entries (or all if count <= 0), and invert into print list */
+  lock = registry_lock (logp);
   logentry = logp->registry.messages;
   while (logentry && emit)
   {
     logp->registry.messages = logentry->next;
+    logp->registry.messagecnt -= 1;
 
     logentry->next = logprint;
     logprint = logentry;
@@ -587,6 +609,7 @@ ms_rlog_emit (MSLogParam *logp, int count, int context)
 
     logentry = logp->registry.messages;
   }
+  registry_unlock (lock);
 
   /* Print and free entries */
   logentry = logprint;
@@ -607,13 +630,11 @@ ms_rlog_emit (MSLogParam *logp, int count, int context)
     print_message_int (logp, logprint->level, message, "\n");
 
     logentry = logprint->next;
-    libmseed_memory.free (logprint);
+    lm_memory ()->free (logprint);
     logprint = logentry;
     emitted++;
   }
 
-  logp->registry.messagecnt -= emitted;
-
   return emitted;
 } /* End of ms_rlog_emit() */
 
@@ -643,14 +664,16 @@ ms_rlog_pop (MSLogParam *logp, char *message, size_t size, int context)
   MSLogEntry *logprint = NULL;
   char local_message[MAX_LOG_MSG_LENGTH];
   char *message_ptr = NULL;
+  lmp_mutex_t *lock;
   size_t length = 0;
 
   if (!message || size == 0)
     return -1;
 
   if (!logp)
-    logp = &gMSLogParam;
+    logp = lm_logparam ();
 
+  lock = registry_lock (logp);
   logprint = logp->registry.messages;
 
   /* Copy and free message */
@@ -676,8 +699,9 @@ ms_rlog_pop (MSLogParam *logp, char *message, size_t size, int context)
     /* Remove message from registry */
     logp->registry.messages = logprint->next;
     logp->registry.messagecnt -= 1;
-    libmseed_memory.free (logprint);
+    lm_memory ()->free (logprint);
   }
+  registry_unlock (lock);
 
   return (int)length;
 } /* End of ms_rlog_pop() */
@@ -693,11 +717,13 @@ int
 ms_rlog_free (MSLogParam *logp)
 {
   MSLogEntry *logentry = NULL;
+  lmp_mutex_t *lock;
   int freed = 0;
 
   if (!logp)
-    logp = &gMSLogParam;
+    logp = lm_logparam ();
 
+  lock = registry_lock (logp);
   logentry = logp->registry.messages;
 
   while (logentry)
@@ -705,11 +731,12 @@ ms_rlog_free (MSLogParam *logp)
     freed++;
 
     logp->registry.messages = logentry->next;
-    libmseed_memory.free (logentry);
+    lm_memory ()->free (logentry);
     logentry = logp->registry.messages;
   }
 
   logp->registry.messagecnt = 0;
+  registry_unlock (lock);
 
   return freed;
 } /* End of ms_rlog_free() */
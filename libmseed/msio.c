@@ -22,8 +22,10 @@
 #define _LARGEFILE_SOURCE 1
 
 #include <errno.h>
+#include <fcntl.h>
 #include <stddef.h>
 
+#include "internalstate.h"
 #include "msio.h"
 
 /* Include libcurl library header if URL supported is requested */
@@ -35,21 +37,75 @@
 #define LIBMSEED_URL_CONNECTTIMEOUT_DEFAULT 60
 #define LIBMSEED_URL_STALLTIMEOUT_DEFAULT 300
 
-/* Control for enabling debugging information */
-int libmseed_url_debug = -1;
+/* Default size of each concurrent range request, and maximum number of
+ * concurrent range requests */
+#define LIBMSEED_URL_RANGESIZE_DEFAULT (4 * 1048576)
+#define LIBMSEED_URL_PARALLEL_MAX 64
 
-/* Control for SSL peer and host verification */
-long libmseed_ssl_noverify = -1;
+/* Maximum number of prefetched transfers not yet opened, and the amount
+ * of data buffered by each before its transfer is paused */
+#define LIBMSEED_URL_PREFETCH_MAX 64
+#define LIBMSEED_URL_PREFETCH_BUFSIZE 1048576
 
-/* Timeouts, in seconds, for URL connections; negative means unset */
-long libmseed_url_connecttimeout = -1;
-long libmseed_url_stalltimeout = -1;
+static void prefetch_cancel (LMURLSettings *url);
+static void share_free (void *share);
 
-/* A global libcurl easy handle for configuration options */
-CURL *gCURLeasy = NULL;
+#endif /* defined(LIBMSEED_URL) */
+
+/* Size of the portions of a file dropped from the page cache after reading */
+#define LMIO_DROPCACHE_SIZE (8 * 1048576)
+
+/* Contents of a prefetched file read from memory, see fileprefetch.c */
+typedef struct LMIOBuffer
+{
+  char *buffer;   /* File contents, NULL once taken by msio_buffer_take() */
+  int64_t length; /* Length of contents */
+  int64_t offset; /* Read offset */
+} LMIOBuffer;
+
+/* Global URL settings, used by threads without a bound library context.
+ * Debugging, SSL verification and timeouts are negative when unset. */
+static LMURLSettings gURLSettings = LMURLSettings_INITIALIZER;
+
+/* URL settings of the library context bound to the calling thread, or
+ * the global settings by default */
+LMURLSettings *
+lm_urlsettings (void)
+{
+  return (lm_currentcontext) ? &lm_currentcontext->url : &gURLSettings;
+}
+
+/* Release the libcurl resources held by URL settings */
+void
+lm_free_urlsettings (LMURLSettings *url)
+{
+  if (!url)
+    return;
+
+#if defined(LIBMSEED_URL)
+  prefetch_cancel (url);
+
+  if (url->multi)
+    curl_multi_cleanup ((CURLM *)url->multi);
 
-/* A global libcurl list of headers */
-struct curl_slist *gCURLheaders = NULL;
+  if (url->easy)
+    curl_easy_cleanup ((CURL *)url->easy);
+
+  if (url->headers)
+    curl_slist_free_all ((struct curl_slist *)url->headers);
+
+  if (url->share)
+    share_free (url->share);
+#endif
+
+  url->easy = NULL;
+  url->headers = NULL;
+  url->share = NULL;
+  url->multi = NULL;
+  url->multiowner = NULL;
+}
+
+#if defined(LIBMSEED_URL)
 
 /* Receving callback parameters */
 struct recv_callback_parameters
@@ -173,34 +229,1133 @@ header_callback (char *buffer, size_t size, size_t num, void *userdata)
 
     if (enddigits)
     {
-      endval = strtoull (endstr, NULL, 10);
+      endval = strtoull (endstr, NULL, 10);
+
+      if (endval > INT64_MAX)
+      {
+        startdigits = 0;
+        enddigits = 0;
+      }
+    }
+
+    /* The range is only honored if an offset was actually applied */
+    if (hcp->startoffset && startdigits)
+    {
+      *hcp->startoffset = (int64_t)startval;
+      hcp->range_honored = 1;
+    }
+
+    if (hcp->endoffset && enddigits)
+    {
+      *hcp->endoffset = (int64_t)endval;
+      hcp->range_honored = 1;
+    }
+  }
+
+  return size;
+}
+
+/*********************************************************************
+ * Resolve unset URL settings from environment variables or defaults.
+ *********************************************************************/
+static void
+url_resolve_settings (LMURLSettings *url)
+{
+  /* Check for URL debugging environment variable */
+  if (url->debug < 0)
+  {
+    if (getenv ("LIBMSEED_URL_DEBUG"))
+      url->debug = 1;
+    else
+      url->debug = 0;
+  }
+
+  /* Check for SSL peer/host verify environment variable */
+  if (url->ssl_noverify < 0)
+  {
+    if (getenv ("LIBMSEED_SSL_NOVERIFY"))
+      url->ssl_noverify = 1;
+    else
+      url->ssl_noverify = 0;
+  }
+
+  /* Check for stall (low-speed) timeout environment variable */
+  if (url->stalltimeout < 0)
+  {
+    char *timeoutstr = getenv ("LIBMSEED_URL_TIMEOUT");
+    long timeoutval;
+
+    if (timeoutstr && (timeoutval = strtol (timeoutstr, NULL, 10)) > 0)
+      url->stalltimeout = timeoutval;
+    else
+      url->stalltimeout = LIBMSEED_URL_STALLTIMEOUT_DEFAULT;
+  }
+
+  if (url->connecttimeout < 0)
+    url->connecttimeout = LIBMSEED_URL_CONNECTTIMEOUT_DEFAULT;
+
+  /* Check for concurrent range requests environment variable */
+  if (url->parallel < 0)
+  {
+    char *parallelstr = getenv ("LIBMSEED_URL_PARALLEL");
+    long parallelval;
+
+    if (parallelstr && (parallelval = strtol (parallelstr, NULL, 10)) > 1 &&
+        parallelval <= LIBMSEED_URL_PARALLEL_MAX)
+      url->parallel = (int)parallelval;
+    else
+      url->parallel = 0;
+  }
+
+  if (url->rangesize <= 0)
+    url->rangesize = LIBMSEED_URL_RANGESIZE_DEFAULT;
+}
+
+/* DNS cache and TLS sessions shared by all libcurl handles of URL
+ * settings, with a lock per shared data type as the settings may be
+ * used by multiple threads.  Connections are not shared across threads,
+ * libcurl does not support it. */
+typedef struct LMURLShare
+{
+  CURLSH *share;
+  lmp_mutex_t locks[CURL_LOCK_DATA_LAST];
+} LMURLShare;
+
+/* Serializes creation of the shared handles of URL settings */
+static lmp_staticmutex_t settings_lock = LMP_STATICMUTEX_INITIALIZER;
+
+static void
+share_lock (CURL *handle, curl_lock_data data, curl_lock_access access, void *userptr)
+{
+  (void)handle; /* Unused */
+  (void)access; /* Unused */
+
+  lmp_mutex_lock (&((LMURLShare *)userptr)->locks[data]);
+}
+
+static void
+share_unlock (CURL *handle, curl_lock_data data, void *userptr)
+{
+  (void)handle; /* Unused */
+
+  lmp_mutex_unlock (&((LMURLShare *)userptr)->locks[data]);
+}
+
+/*********************************************************************
+ * Release a shared handle.
+ *********************************************************************/
+static void
+share_free (void *share)
+{
+  LMURLShare *urlshare = (LMURLShare *)share;
+  int idx;
+
+  if (!urlshare)
+    return;
+
+  if (urlshare->share)
+    curl_share_cleanup (urlshare->share);
+
+  for (idx = 0; idx < CURL_LOCK_DATA_LAST; idx++)
+    lmp_mutex_destroy (&urlshare->locks[idx]);
+
+  lm_memory ()->free (urlshare);
+}
+
+/*********************************************************************
+ * Return the shared handle of URL settings, creating it if needed.
+ *
+ * Later requests to the same host, by any reader using the same
+ * settings, avoid DNS lookups and resume TLS sessions.
+ *
+ * Returns the libcurl share handle on success and NULL on error.
+ *********************************************************************/
+static CURLSH *
+share_get (LMURLSettings *url)
+{
+  LMURLShare *urlshare;
+  int idx;
+
+  lmp_staticmutex_lock (&settings_lock);
+
+  if (url->share == NULL)
+  {
+    if ((urlshare = (LMURLShare *)lm_memory ()->malloc (sizeof (LMURLShare))) == NULL)
+    {
+      lmp_staticmutex_unlock (&settings_lock);
+      ms_log (2, "Cannot allocate memory\n");
+      return NULL;
+    }
+
+    memset (urlshare, 0, sizeof (LMURLShare));
+
+    for (idx = 0; idx < CURL_LOCK_DATA_LAST; idx++)
+      lmp_mutex_init (&urlshare->locks[idx]);
+
+    if ((urlshare->share = curl_share_init ()) == NULL ||
+        curl_share_setopt (urlshare->share, CURLSHOPT_LOCKFUNC, share_lock) != CURLSHE_OK ||
+        curl_share_setopt (urlshare->share, CURLSHOPT_UNLOCKFUNC, share_unlock) != CURLSHE_OK ||
+        curl_share_setopt (urlshare->share, CURLSHOPT_USERDATA, (void *)urlshare) != CURLSHE_OK ||
+        curl_share_setopt (urlshare->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS) != CURLSHE_OK ||
+        curl_share_setopt (urlshare->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION) !=
+            CURLSHE_OK)
+    {
+      lmp_staticmutex_unlock (&settings_lock);
+      ms_log (2, "Cannot initialize CURL share handle\n");
+      share_free (urlshare);
+      return NULL;
+    }
+
+    url->share = urlshare;
+  }
+
+  lmp_staticmutex_unlock (&settings_lock);
+
+  return ((LMURLShare *)url->share)->share;
+}
+
+/*********************************************************************
+ * Create a libcurl easy handle configured with the URL settings for
+ * the specified URL, duplicating the handle holding credentials if
+ * present.
+ *
+ * Returns the handle on success and NULL on error.
+ *********************************************************************/
+static CURL *
+url_easy_init (LMURLSettings *url, const char *path)
+{
+  CURLSH *share;
+  CURL *easy;
+
+  /* Configure the libcurl easy handle, duplicate global options if present */
+  easy = (url->easy) ? curl_easy_duphandle ((CURL *)url->easy) : curl_easy_init ();
+
+  if (easy == NULL)
+  {
+    ms_log (2, "Cannot initialize CURL handle\n");
+    return NULL;
+  }
+
+  /* URL debug */
+  if (url->debug && curl_easy_setopt (easy, CURLOPT_VERBOSE, 1L) != CURLE_OK)
+  {
+    ms_log (2, "Cannot set CURLOPT_VERBOSE\n");
+    goto failed;
+  }
+
+  /* SSL peer and host verification */
+  if (url->ssl_noverify &&
+      (curl_easy_setopt (easy, CURLOPT_SSL_VERIFYPEER, 0L) != CURLE_OK ||
+       curl_easy_setopt (easy, CURLOPT_SSL_VERIFYHOST, 0L) != CURLE_OK))
+  {
+    ms_log (2, "Cannot set CURLOPT_SSL_VERIFYPEER and/or CURLOPT_SSL_VERIFYHOST\n");
+    goto failed;
+  }
+
+  /* Set URL */
+  if (curl_easy_setopt (easy, CURLOPT_URL, path) != CURLE_OK)
+  {
+    ms_log (2, "Cannot set CURLOPT_URL\n");
+    goto failed;
+  }
+
+  /* Set default User-Agent header, can be overridden via custom header */
+  if (curl_easy_setopt (easy, CURLOPT_USERAGENT,
+                        "libmseed/" LIBMSEED_VERSION " libcurl/" LIBCURL_VERSION) != CURLE_OK)
+  {
+    ms_log (2, "Cannot set default CURLOPT_USERAGENT\n");
+    goto failed;
+  }
+
+  /* Disable signals */
+  if (curl_easy_setopt (easy, CURLOPT_NOSIGNAL, 1L) != CURLE_OK)
+  {
+    ms_log (2, "Cannot set CURLOPT_NOSIGNAL\n");
+    goto failed;
+  }
+
+  /* Connection timeout, 0 disables */
+  if (url->connecttimeout > 0 &&
+      curl_easy_setopt (easy, CURLOPT_CONNECTTIMEOUT, url->connecttimeout) !=
+          CURLE_OK)
+  {
+    ms_log (2, "Cannot set CURLOPT_CONNECTTIMEOUT\n");
+    goto failed;
+  }
+
+  /* Abort the transfer if it stalls below 1 byte/second, 0 disables */
+  if (url->stalltimeout > 0 &&
+      (curl_easy_setopt (easy, CURLOPT_LOW_SPEED_LIMIT, 1L) != CURLE_OK ||
+       curl_easy_setopt (easy, CURLOPT_LOW_SPEED_TIME, url->stalltimeout) !=
+           CURLE_OK))
+  {
+    ms_log (2, "Cannot set CURLOPT_LOW_SPEED_LIMIT and/or CURLOPT_LOW_SPEED_TIME\n");
+    goto failed;
+  }
+
+  /* Return failure codes on errors */
+  if (curl_easy_setopt (easy, CURLOPT_FAILONERROR, 1L) != CURLE_OK)
+  {
+    ms_log (2, "Cannot set CURLOPT_FAILONERROR\n");
+    goto failed;
+  }
+
+  /* Follow HTTP redirects */
+  if (curl_easy_setopt (easy, CURLOPT_FOLLOWLOCATION, 1L) != CURLE_OK)
+  {
+    ms_log (2, "Cannot set CURLOPT_FOLLOWLOCATION\n");
+    goto failed;
+  }
+
+  /* Set custom headers */
+  if (url->headers &&
+      curl_easy_setopt (easy, CURLOPT_HTTPHEADER, (struct curl_slist *)url->headers) != CURLE_OK)
+  {
+    ms_log (2, "Cannot set CURLOPT_HTTPHEADER\n");
+    goto failed;
+  }
+
+  /* Reuse DNS lookups and TLS sessions of previous requests */
+  if ((share = share_get (url)) == NULL || curl_easy_setopt (easy, CURLOPT_SHARE, share) != CURLE_OK)
+  {
+    ms_log (2, "Cannot set CURLOPT_SHARE\n");
+    goto failed;
+  }
+
+  return easy;
+
+failed:
+  curl_easy_cleanup (easy);
+  return NULL;
+}
+
+/* A range request slot of a concurrent range reader */
+typedef struct LMURLRange
+{
+  CURL *easy;     /* Handle for requests of this slot, reusing its connection */
+  char *buffer;   /* Data of the range */
+  size_t length;  /* Bytes of the range received */
+  size_t size;    /* Bytes in the range */
+  int64_t chunk;  /* Index of the chunk being fetched */
+  int done;       /* Set when the range has been completely received */
+} LMURLRange;
+
+/* State of a URL read with concurrent range requests.
+ *
+ * The requested byte range is divided into chunks of 'rangesize' bytes,
+ * chunk N is fetched by slot N % 'nslots'.  Chunks are returned to the
+ * reader in order, each slot is re-used for its next chunk once the
+ * reader has consumed its current chunk, limiting the memory used to
+ * 'nslots' chunks. */
+typedef struct LMURLRanges
+{
+  CURLM *multi;        /* Multi handle driving all slots */
+  LMURLRange *slots;   /* Range request slots */
+  int nslots;          /* Number of slots, the number of concurrent requests */
+  int running;         /* Number of transfers in progress */
+  int64_t start;       /* First byte of the requested range */
+  int64_t end;         /* Last byte of the requested range */
+  int64_t rangesize;   /* Size of each chunk */
+  int64_t nchunks;     /* Number of chunks */
+  int64_t nextchunk;   /* Next chunk to request */
+  int64_t readchunk;   /* Chunk being read */
+  size_t readoffset;   /* Read offset within readchunk */
+} LMURLRanges;
+
+/* Header callback parameters for range support detection */
+struct ranges_header_parameters
+{
+  int accept_ranges;
+};
+
+/*********************************************************************
+ * Callback fired when receiving headers of a HEAD request, detecting
+ * "Accept-Ranges: bytes".
+ *
+ * Returns number of bytes processed for success.
+ *********************************************************************/
+static size_t
+ranges_header_callback (char *buffer, size_t size, size_t num, void *userdata)
+{
+  struct ranges_header_parameters *rhp = (struct ranges_header_parameters *)userdata;
+
+  size *= num;
+
+  if (buffer && rhp && size >= 20 && lmp_strncasecmp (buffer, "Accept-Ranges: bytes", 20) == 0)
+    rhp->accept_ranges = 1;
+
+  return size;
+}
+
+/*********************************************************************
+ * Callback fired when recv'ing data for a range request.  A response
+ * larger than the requested range, e.g. a complete object returned
+ * when the range is not honored, aborts the transfer.
+ *
+ * Returns number of bytes added to the slot buffer.
+ *********************************************************************/
+static size_t
+ranges_recv_callback (char *buffer, size_t size, size_t num, void *userdata)
+{
+  LMURLRange *slot = (LMURLRange *)userdata;
+
+  size *= num;
+
+  if (!buffer || !slot || size > slot->size - slot->length)
+    return 0;
+
+  memcpy (slot->buffer + slot->length, buffer, size);
+  slot->length += size;
+
+  return size;
+}
+
+/*********************************************************************
+ * Start the request of the next chunk using a slot.
+ *
+ * Returns 0 on success and -1 on error.
+ *********************************************************************/
+static int
+ranges_request (LMURLRanges *ranges, LMURLRange *slot)
+{
+  char rangestr[42];
+  int64_t first;
+  int64_t last;
+
+  first = ranges->start + ranges->nextchunk * ranges->rangesize;
+  last = first + ranges->rangesize - 1;
+  if (last > ranges->end)
+    last = ranges->end;
+
+  snprintf (rangestr, sizeof (rangestr), "%" PRId64 "-%" PRId64, first, last);
+
+  slot->chunk = ranges->nextchunk++;
+  slot->size = (size_t)(last - first + 1);
+  slot->length = 0;
+  slot->done = 0;
+
+  /* A completed handle must be removed from the multi handle before re-adding */
+  curl_multi_remove_handle (ranges->multi, slot->easy);
+
+  if (curl_easy_setopt (slot->easy, CURLOPT_RANGE, rangestr) != CURLE_OK)
+  {
+    ms_log (2, "Cannot set CURLOPT_RANGE to '%s'\n", rangestr);
+    return -1;
+  }
+
+  if (curl_multi_add_handle (ranges->multi, slot->easy) != CURLM_OK)
+  {
+    ms_log (2, "Cannot add CURL handle to multi handle\n");
+    return -1;
+  }
+
+  ranges->running++;
+
+  return 0;
+}
+
+/*********************************************************************
+ * Perform transfers, first waiting for activity if 'wait' is set, and
+ * mark completed chunks as done.
+ *
+ * Returns 0 on success and -1 if a transfer failed.
+ *********************************************************************/
+static int
+ranges_perform (LMURLRanges *ranges, int wait)
+{
+  LMURLRange *slot;
+  CURLMsg *msg;
+  long response_code;
+  int msgs_left;
+  int still_running;
+  int idx;
+
+  if ((wait && curl_multi_wait (ranges->multi, NULL, 0, 1000, NULL) != CURLM_OK) ||
+      curl_multi_perform (ranges->multi, &still_running) != CURLM_OK)
+  {
+    ms_log (2, "Error performing range transfers\n");
+    return -1;
+  }
+
+  while ((msg = curl_multi_info_read (ranges->multi, &msgs_left)))
+  {
+    if (msg->msg != CURLMSG_DONE)
+      continue;
+
+    for (slot = NULL, idx = 0; idx < ranges->nslots; idx++)
+    {
+      if (ranges->slots[idx].easy == msg->easy_handle)
+        slot = &ranges->slots[idx];
+    }
+
+    if (!slot)
+      continue;
+
+    ranges->running--;
+
+    if (msg->data.result != CURLE_OK)
+    {
+      ms_log (2, "Error transferring data: %s\n", curl_easy_strerror (msg->data.result));
+      return -1;
+    }
+
+    curl_easy_getinfo (slot->easy, CURLINFO_RESPONSE_CODE, &response_code);
+
+    if (response_code != 206 || slot->length != slot->size)
+    {
+      ms_log (2, "Range request not fulfilled, response code %ld, %zu of %zu bytes\n",
+              response_code, slot->length, slot->size);
+      return -1;
+    }
+
+    slot->done = 1;
+  }
+
+  return 0;
+}
+
+/*********************************************************************
+ * Release a concurrent range reader.
+ *********************************************************************/
+static void
+ranges_free (LMURLRanges *ranges)
+{
+  int idx;
+
+  if (!ranges)
+    return;
+
+  for (idx = 0; ranges->slots && idx < ranges->nslots; idx++)
+  {
+    if (ranges->slots[idx].easy)
+    {
+      if (ranges->multi)
+        curl_multi_remove_handle (ranges->multi, ranges->slots[idx].easy);
+      curl_easy_cleanup (ranges->slots[idx].easy);
+    }
+
+    if (ranges->slots[idx].buffer)
+      lm_memory ()->free (ranges->slots[idx].buffer);
+  }
+
+  if (ranges->multi)
+    curl_multi_cleanup (ranges->multi);
+
+  if (ranges->slots)
+    lm_memory ()->free (ranges->slots);
+
+  lm_memory ()->free (ranges);
+}
+
+/*********************************************************************
+ * Open a URL for reading with concurrent range requests.
+ *
+ * A HEAD request determines the content length and if the server
+ * accepts byte ranges.  The requested byte range, by default the
+ * whole object, is then fetched in chunks of the configured range
+ * size with up to the configured number of concurrent requests.
+ *
+ * Returns 0 on success, -1 on error and 1 if range requests are not
+ * applicable, e.g. the server does not accept ranges, the length is
+ * unknown or the range is a single chunk, and the URL should be read
+ * with a single request.
+ *********************************************************************/
+static int
+url_open_ranges (LMIO *io, LMURLSettings *url, const char *path, int64_t *startoffset,
+                 int64_t *endoffset)
+{
+  struct ranges_header_parameters rhp = {0};
+  LMURLRanges *ranges = NULL;
+  CURL *head = NULL;
+  char *effective = NULL;
+  curl_off_t length = -1;
+  long response_code = 0;
+  int64_t start;
+  int64_t end;
+  int idx;
+
+  /* Determine content length and range support with a HEAD request */
+  if ((head = url_easy_init (url, path)) == NULL)
+    return -1;
+
+  if (curl_easy_setopt (head, CURLOPT_NOBODY, 1L) != CURLE_OK ||
+      curl_easy_setopt (head, CURLOPT_HEADERFUNCTION, ranges_header_callback) != CURLE_OK ||
+      curl_easy_setopt (head, CURLOPT_HEADERDATA, (void *)&rhp) != CURLE_OK)
+  {
+    ms_log (2, "Cannot configure HEAD request\n");
+    curl_easy_cleanup (head);
+    return -1;
+  }
+
+  /* Any failure of the HEAD request is left to a single request to report */
+  if (curl_easy_perform (head) != CURLE_OK ||
+      curl_easy_getinfo (head, CURLINFO_RESPONSE_CODE, &response_code) != CURLE_OK ||
+      response_code != 200 ||
+      curl_easy_getinfo (head, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length) != CURLE_OK ||
+      length <= 0 || !rhp.accept_ranges)
+  {
+    curl_easy_cleanup (head);
+    return 1;
+  }
+
+  start = (startoffset && *startoffset > 0) ? *startoffset : 0;
+  end = (endoffset && *endoffset > 0 && *endoffset < (int64_t)length) ? *endoffset
+                                                                      : (int64_t)length - 1;
+
+  if (end - start + 1 <= url->rangesize)
+  {
+    curl_easy_cleanup (head);
+    return 1;
+  }
+
+  if ((ranges = (LMURLRanges *)lm_memory ()->malloc (sizeof (LMURLRanges))) == NULL)
+  {
+    ms_log (2, "Cannot allocate memory\n");
+    curl_easy_cleanup (head);
+    return -1;
+  }
+
+  memset (ranges, 0, sizeof (LMURLRanges));
+  ranges->start = start;
+  ranges->end = end;
+  ranges->rangesize = url->rangesize;
+  ranges->nchunks = (end - start) / url->rangesize + 1;
+  ranges->nslots = (url->parallel < ranges->nchunks) ? url->parallel : (int)ranges->nchunks;
+
+  if ((ranges->multi = curl_multi_init ()) == NULL ||
+      (ranges->slots = (LMURLRange *)lm_memory ()->malloc (sizeof (LMURLRange) *
+                                                             ranges->nslots)) == NULL)
+  {
+    ms_log (2, "Cannot initialize concurrent range requests\n");
+    goto failed;
+  }
+
+  memset (ranges->slots, 0, sizeof (LMURLRange) * ranges->nslots);
+
+  /* Request ranges from the URL after any redirection */
+  curl_easy_getinfo (head, CURLINFO_EFFECTIVE_URL, &effective);
+
+  for (idx = 0; idx < ranges->nslots; idx++)
+  {
+    LMURLRange *slot = &ranges->slots[idx];
+
+    if ((slot->easy = url_easy_init (url, (effective) ? effective : path)) == NULL)
+      goto failed;
+
+    if ((slot->buffer = (char *)lm_memory ()->malloc ((size_t)ranges->rangesize)) == NULL)
+    {
+      ms_log (2, "Cannot allocate memory\n");
+      goto failed;
+    }
+
+    if (curl_easy_setopt (slot->easy, CURLOPT_WRITEFUNCTION, ranges_recv_callback) != CURLE_OK ||
+        curl_easy_setopt (slot->easy, CURLOPT_WRITEDATA, (void *)slot) != CURLE_OK)
+    {
+      ms_log (2, "Cannot set CURLOPT_WRITEFUNCTION\n");
+      goto failed;
+    }
+
+    if (ranges_request (ranges, slot))
+      goto failed;
+  }
+
+  curl_easy_cleanup (head);
+
+  if (startoffset)
+    *startoffset = start;
+  if (endoffset && *endoffset > 0)
+    *endoffset = end;
+
+  io->type = LMIO_URLRANGES;
+  io->handle = ranges;
+  io->handle2 = NULL;
+  io->still_running = 1;
+  io->urlfail = 0;
+
+  return 0;
+
+failed:
+  ranges_free (ranges);
+  curl_easy_cleanup (head);
+
+  return -1;
+}
+
+/*********************************************************************
+ * Read data from a URL opened with concurrent range requests, in order
+ * of the byte range.  Available data are returned without waiting for
+ * the complete request size.
+ *
+ * Returns the number of bytes read on success and -1 on error.
+ *********************************************************************/
+static int64_t
+url_read_ranges (LMIO *io, void *buffer, size_t size)
+{
+  LMURLRanges *ranges = (LMURLRanges *)io->handle;
+  LMURLRange *slot;
+  size_t read = 0;
+  size_t count;
+
+  if (io->urlfail)
+    return -1;
+
+  /* Progress all transfers, not only the one being read */
+  if (ranges->running > 0 && ranges_perform (ranges, 0))
+  {
+    io->urlfail = 1;
+    return -1;
+  }
+
+  while (read < size && ranges->readchunk < ranges->nchunks)
+  {
+    slot = &ranges->slots[ranges->readchunk % ranges->nslots];
+
+    if (slot->length > ranges->readoffset)
+    {
+      count = slot->length - ranges->readoffset;
+      if (count > size - read)
+        count = size - read;
+
+      memcpy ((char *)buffer + read, slot->buffer + ranges->readoffset, count);
+      ranges->readoffset += count;
+      read += count;
+    }
+    /* Chunk consumed, start the next chunk for this slot */
+    else if (slot->done)
+    {
+      ranges->readchunk++;
+      ranges->readoffset = 0;
+
+      if (ranges->nextchunk < ranges->nchunks && ranges_request (ranges, slot))
+      {
+        io->urlfail = 1;
+        break;
+      }
+    }
+    /* Return the data available, otherwise wait for more */
+    else if (read > 0)
+    {
+      break;
+    }
+    else if (ranges_perform (ranges, 1))
+    {
+      io->urlfail = 1;
+      break;
+    }
+  }
+
+  if (ranges->readchunk >= ranges->nchunks)
+    io->still_running = 0;
+
+  if (io->urlfail && read == 0)
+    return -1;
+
+  return (int64_t)read;
+}
+
+/* Variable whose address identifies the calling thread */
+static lm_thread_local char thread_marker;
+
+/* A URL transfer driven by the persistent multi handle of URL settings,
+ * started when opened or ahead of being opened by msio_url_prefetch().
+ * Received data are buffered until read, the transfer is paused while
+ * the buffer is full. */
+typedef struct LMURLTransfer
+{
+  char *path;                 /* URL */
+  CURL *easy;                 /* Handle of the transfer */
+  CURLM *multi;               /* Persistent multi handle of the URL settings */
+  char *buffer;               /* Received data, allocated on first data */
+  size_t length;              /* Bytes of data in buffer */
+  size_t offset;              /* Read offset in buffer */
+  int paused;                 /* Set when paused with a full buffer */
+  int done;                   /* Set when the transfer has completed */
+  CURLcode result;            /* Result of the completed transfer */
+  struct LMURLTransfer *next; /* Next prefetched transfer not yet opened */
+} LMURLTransfer;
+
+/*********************************************************************
+ * Return the persistent multi handle of URL settings if it may be used
+ * by the calling thread, creating it if needed.
+ *
+ * Connections are kept open in the multi handle after transfers
+ * complete, so later requests to the same host avoid connection and
+ * TLS setup.  A multi handle must not be used by concurrent threads,
+ * it is used only by the thread that created it, other threads use a
+ * connection per request.
+ *
+ * Returns the multi handle or NULL if not available to the thread.
+ *********************************************************************/
+static CURLM *
+transfer_multi (LMURLSettings *url)
+{
+  CURLM *multi = NULL;
+
+  lmp_staticmutex_lock (&settings_lock);
+
+  if (url->multi == NULL && (url->multi = curl_multi_init ()) != NULL)
+    url->multiowner = &thread_marker;
+
+  if (url->multiowner == &thread_marker)
+    multi = (CURLM *)url->multi;
+
+  lmp_staticmutex_unlock (&settings_lock);
+
+  return multi;
+}
+
+/*********************************************************************
+ * Callback fired when recv'ing data for a transfer, appending data to
+ * the transfer buffer and pausing the transfer when it is full.
+ *
+ * Returns number of bytes added to the buffer.
+ *********************************************************************/
+static size_t
+transfer_recv_callback (char *buffer, size_t size, size_t num, void *userdata)
+{
+  LMURLTransfer *transfer = (LMURLTransfer *)userdata;
+
+  size *= num;
+
+  if (!buffer || !transfer)
+    return 0;
+
+  if (transfer->buffer == NULL &&
+      (transfer->buffer = (char *)lm_memory ()->malloc (LIBMSEED_URL_PREFETCH_BUFSIZE)) == NULL)
+  {
+    ms_log (2, "Cannot allocate memory\n");
+    return 0;
+  }
+
+  /* Move unread data to the start of the buffer */
+  if (transfer->offset > 0 && transfer->length + size > LIBMSEED_URL_PREFETCH_BUFSIZE)
+  {
+    memmove (transfer->buffer, transfer->buffer + transfer->offset,
+             transfer->length - transfer->offset);
+    transfer->length -= transfer->offset;
+    transfer->offset = 0;
+  }
+
+  if (transfer->length + size > LIBMSEED_URL_PREFETCH_BUFSIZE)
+  {
+    transfer->paused = 1;
+    return CURL_WRITEFUNC_PAUSE;
+  }
+
+  memcpy (transfer->buffer + transfer->length, buffer, size);
+  transfer->length += size;
+
+  return size;
+}
+
+/*********************************************************************
+ * Perform transfers of a multi handle, first waiting for activity if
+ * 'wait' is set, and mark completed transfers as done.
+ *
+ * Returns 0 on success and -1 on error.
+ *********************************************************************/
+static int
+transfer_perform (CURLM *multi, int wait)
+{
+  LMURLTransfer *transfer;
+  CURLMsg *msg;
+  int msgs_left;
+  int still_running;
+
+  if ((wait && curl_multi_wait (multi, NULL, 0, 1000, NULL) != CURLM_OK) ||
+      curl_multi_perform (multi, &still_running) != CURLM_OK)
+  {
+    ms_log (2, "Error performing transfers\n");
+    return -1;
+  }
+
+  while ((msg = curl_multi_info_read (multi, &msgs_left)))
+  {
+    if (msg->msg != CURLMSG_DONE ||
+        curl_easy_getinfo (msg->easy_handle, CURLINFO_PRIVATE, (char **)&transfer) != CURLE_OK ||
+        !transfer)
+      continue;
+
+    transfer->done = 1;
+    transfer->result = msg->data.result;
+  }
+
+  return 0;
+}
+
+/*********************************************************************
+ * Release a transfer, the connection of a completed transfer remains
+ * open in the multi handle for reuse.
+ *********************************************************************/
+static void
+transfer_free (LMURLTransfer *transfer)
+{
+  if (!transfer)
+    return;
+
+  if (transfer->easy)
+  {
+    curl_multi_remove_handle (transfer->multi, transfer->easy);
+    curl_easy_cleanup (transfer->easy);
+  }
+
+  if (transfer->buffer)
+    lm_memory ()->free (transfer->buffer);
+
+  if (transfer->path)
+    lm_memory ()->free (transfer->path);
+
+  lm_memory ()->free (transfer);
+}
+
+/*********************************************************************
+ * Start a transfer of a URL using a persistent multi handle.
+ *
+ * Returns the transfer on success and NULL on error.
+ *********************************************************************/
+static LMURLTransfer *
+transfer_start (LMURLSettings *url, CURLM *multi, const char *path)
+{
+  LMURLTransfer *transfer;
+  int still_running;
+
+  if ((transfer = (LMURLTransfer *)lm_memory ()->malloc (sizeof (LMURLTransfer))) == NULL)
+  {
+    ms_log (2, "Cannot allocate memory\n");
+    return NULL;
+  }
+
+  memset (transfer, 0, sizeof (LMURLTransfer));
+
+  if ((transfer->path = (char *)lm_memory ()->malloc (strlen (path) + 1)) == NULL)
+  {
+    ms_log (2, "Cannot allocate memory\n");
+    transfer_free (transfer);
+    return NULL;
+  }
+
+  strcpy (transfer->path, path);
+  transfer->multi = multi;
+
+  if ((transfer->easy = url_easy_init (url, path)) == NULL)
+  {
+    transfer_free (transfer);
+    return NULL;
+  }
+
+  if (curl_easy_setopt (transfer->easy, CURLOPT_WRITEFUNCTION, transfer_recv_callback) !=
+          CURLE_OK ||
+      curl_easy_setopt (transfer->easy, CURLOPT_WRITEDATA, (void *)transfer) != CURLE_OK ||
+      curl_easy_setopt (transfer->easy, CURLOPT_PRIVATE, (void *)transfer) != CURLE_OK)
+  {
+    ms_log (2, "Cannot set CURLOPT_WRITEFUNCTION\n");
+    transfer_free (transfer);
+    return NULL;
+  }
+
+  if (curl_multi_add_handle (multi, transfer->easy) != CURLM_OK)
+  {
+    ms_log (2, "Cannot add CURL handle to multi handle\n");
+    transfer_free (transfer);
+    return NULL;
+  }
+
+  /* Start connecting without waiting */
+  curl_multi_perform (multi, &still_running);
+
+  return transfer;
+}
+
+/*********************************************************************
+ * Cancel all prefetched transfers not yet opened.
+ *********************************************************************/
+static void
+prefetch_cancel (LMURLSettings *url)
+{
+  LMURLTransfer *transfer;
+
+  while ((transfer = (LMURLTransfer *)url->prefetch) != NULL)
+  {
+    url->prefetch = transfer->next;
+    transfer_free (transfer);
+  }
+
+  url->prefetchcount = 0;
+}
+
+/*********************************************************************
+ * Remove and return the prefetched transfer of a URL.
+ *
+ * Returns the transfer or NULL if the URL was not prefetched.
+ *********************************************************************/
+static LMURLTransfer *
+prefetch_take (LMURLSettings *url, const char *path)
+{
+  LMURLTransfer **link = (LMURLTransfer **)&url->prefetch;
+  LMURLTransfer *transfer;
+
+  for (; *link; link = &(*link)->next)
+  {
+    if (strcmp ((*link)->path, path) == 0)
+    {
+      transfer = *link;
+      *link = transfer->next;
+      transfer->next = NULL;
+      url->prefetchcount--;
+
+      return transfer;
+    }
+  }
+
+  return NULL;
+}
+
+/*********************************************************************
+ * Open a URL with a transfer, waiting for the response status.
+ *
+ * Returns 0 on success and -1 on error.
+ *********************************************************************/
+static int
+url_open_transfer (LMIO *io, LMURLTransfer *transfer, const char *path)
+{
+  long response_code = 0;
+
+  io->type = LMIO_URLTRANSFER;
+  io->handle = transfer;
+  io->handle2 = NULL;
+  io->still_running = 1;
+  io->urlfail = 0;
+
+  while (!transfer->done && response_code == 0)
+  {
+    if (transfer_perform (transfer->multi, 1))
+      return -1;
+
+    curl_easy_getinfo (transfer->easy, CURLINFO_RESPONSE_CODE, &response_code);
+  }
+
+  curl_easy_getinfo (transfer->easy, CURLINFO_RESPONSE_CODE, &response_code);
+
+  if (response_code == 404)
+  {
+    ms_log (2, "Cannot open %s: Not Found (404)\n", path);
+    return -1;
+  }
+  else if (response_code >= 400 && response_code < 600)
+  {
+    ms_log (2, "Cannot open %s: response code %ld\n", path, response_code);
+    return -1;
+  }
+  else if (transfer->done && transfer->result != CURLE_OK)
+  {
+    ms_log (2, "Error transferring data: %s\n", curl_easy_strerror (transfer->result));
+    ms_log (2, "Cannot open %s: transfer failed\n", path);
+    return -1;
+  }
+
+  return 0;
+}
+
+/*********************************************************************
+ * Read data from a URL opened with a transfer.  Available data are
+ * returned without waiting for the complete request size.  All
+ * transfers of the multi handle, including prefetched transfers, make
+ * progress while reading.
+ *
+ * Returns the number of bytes read on success and -1 on error.
+ *********************************************************************/
+static int64_t
+url_read_transfer (LMIO *io, void *buffer, size_t size)
+{
+  LMURLTransfer *transfer = (LMURLTransfer *)io->handle;
+  size_t read = 0;
+  size_t count;
+
+  if (io->urlfail)
+    return -1;
+
+  if (transfer_perform (transfer->multi, 0))
+  {
+    io->urlfail = 1;
+    return -1;
+  }
+
+  while (read < size)
+  {
+    if (transfer->length > transfer->offset)
+    {
+      count = transfer->length - transfer->offset;
+      if (count > size - read)
+        count = size - read;
 
-      if (endval > INT64_MAX)
+      memcpy ((char *)buffer + read, transfer->buffer + transfer->offset, count);
+      transfer->offset += count;
+      read += count;
+    }
+    else if (transfer->done)
+    {
+      if (transfer->result != CURLE_OK)
       {
-        startdigits = 0;
-        enddigits = 0;
+        ms_log (2, "Error transferring data: %s\n", curl_easy_strerror (transfer->result));
+        io->urlfail = 1;
       }
-    }
 
-    /* The range is only honored if an offset was actually applied */
-    if (hcp->startoffset && startdigits)
+      break;
+    }
+    /* Return the data available, otherwise wait for more */
+    else if (read > 0)
     {
-      *hcp->startoffset = (int64_t)startval;
-      hcp->range_honored = 1;
+      break;
+    }
+    else if (transfer_perform (transfer->multi, 1))
+    {
+      io->urlfail = 1;
+      break;
     }
 
-    if (hcp->endoffset && enddigits)
+    /* Resume a paused transfer once data have been read from the buffer */
+    if (transfer->paused && transfer->offset > 0)
     {
-      *hcp->endoffset = (int64_t)endval;
-      hcp->range_honored = 1;
+      transfer->paused = 0;
+      curl_easy_pause (transfer->easy, CURLPAUSE_CONT);
     }
   }
 
-  return size;
+  if (transfer->done && transfer->offset >= transfer->length)
+    io->still_running = 0;
+
+  if (io->urlfail && read == 0)
+    return -1;
+
+  return (int64_t)read;
 }
 
 #endif /* defined(LIBMSEED_URL) */
 
+/*********************************************************************
+ * Identify the compression format of a file from its first bytes,
+ * leaving the file positioned at its start.  Only seekable files are
+ * inspected.
+ *
+ * Returns one of the LM_DECOMPRESS_* formats.
+ *********************************************************************/
+static int
+file_compression (FILE *file)
+{
+  uint8_t header[6];
+  size_t length;
+
+  if (lmp_fseek64 (file, 0, SEEK_SET))
+    return LM_DECOMPRESS_NONE;
+
+  length = fread (header, 1, sizeof (header), file);
+
+  if (lmp_fseek64 (file, 0, SEEK_SET))
+    return LM_DECOMPRESS_NONE;
+
+  return lm_decompress_format (header, length);
+}
+
 /***************************************************************************
  * msio_fopen:
  *
@@ -216,6 +1371,10 @@ header_callback (char *buffer, size_t size, size_t num, void *userdata)
  * actual range if reported via HTTP, which may be different than
  * requested.
  *
+ * Local files compressed in a supported format are read through a
+ * decompressor, see decompress.c, and offsets refer to the
+ * decompressed data.
+ *
  * Return 0 on success and -1 on error.
  *
  * @ref MessageOnError - this function logs a message on error
@@ -246,125 +1405,50 @@ msio_fopen (LMIO *io, const char *path, const char *mode, int64_t *startoffset,
     ms_log (2, "URL support not included in library for %s\n", path);
     return -1;
 #else
+    LMURLSettings *url = lm_urlsettings ();
     long response_code;
     struct header_callback_parameters hcp;
     int range_requested = 0;
 
-    io->type = LMIO_URL;
-    io->handle2 = NULL;
-
-    /* Check for URL debugging environment variable */
-    if (libmseed_url_debug < 0)
-    {
-      if (getenv ("LIBMSEED_URL_DEBUG"))
-        libmseed_url_debug = 1;
-      else
-        libmseed_url_debug = 0;
-    }
-
-    /* Check for SSL peer/host verify environment variable */
-    if (libmseed_ssl_noverify < 0)
-    {
-      if (getenv ("LIBMSEED_SSL_NOVERIFY"))
-        libmseed_ssl_noverify = 1;
-      else
-        libmseed_ssl_noverify = 0;
-    }
-
-    /* Check for stall (low-speed) timeout environment variable */
-    if (libmseed_url_stalltimeout < 0)
-    {
-      char *timeoutstr = getenv ("LIBMSEED_URL_TIMEOUT");
-      long timeoutval;
-
-      if (timeoutstr && (timeoutval = strtol (timeoutstr, NULL, 10)) > 0)
-        libmseed_url_stalltimeout = timeoutval;
-      else
-        libmseed_url_stalltimeout = LIBMSEED_URL_STALLTIMEOUT_DEFAULT;
-    }
-
-    if (libmseed_url_connecttimeout < 0)
-      libmseed_url_connecttimeout = LIBMSEED_URL_CONNECTTIMEOUT_DEFAULT;
-
-    /* Configure the libcurl easy handle, duplicate global options if present */
-    io->handle = (gCURLeasy) ? curl_easy_duphandle (gCURLeasy) : curl_easy_init ();
+    LMURLTransfer *transfer = NULL;
+    CURLM *multi;
 
-    if (io->handle == NULL)
-    {
-      ms_log (2, "Cannot initialize CURL handle\n");
-      return -1;
-    }
+    io->handle2 = NULL;
 
-    /* URL debug */
-    if (libmseed_url_debug && curl_easy_setopt (io->handle, CURLOPT_VERBOSE, 1L) != CURLE_OK)
-    {
-      ms_log (2, "Cannot set CURLOPT_VERBOSE\n");
-      goto onerror;
-    }
+    url_resolve_settings (url);
 
-    /* SSL peer and host verification */
-    if (libmseed_ssl_noverify &&
-        (curl_easy_setopt (io->handle, CURLOPT_SSL_VERIFYPEER, 0L) != CURLE_OK ||
-         curl_easy_setopt (io->handle, CURLOPT_SSL_VERIFYHOST, 0L) != CURLE_OK))
+    /* Read complete objects through the persistent multi handle if available
+     * to this thread, using a prefetched transfer if present */
+    if (!(startoffset && *startoffset > 0) && !(endoffset && *endoffset > 0) &&
+        (multi = transfer_multi (url)) != NULL)
     {
-      ms_log (2, "Cannot set CURLOPT_SSL_VERIFYPEER and/or CURLOPT_SSL_VERIFYHOST\n");
-      goto onerror;
-    }
+      transfer = prefetch_take (url, path);
 
-    /* Set URL */
-    if (curl_easy_setopt (io->handle, CURLOPT_URL, path) != CURLE_OK)
-    {
-      ms_log (2, "Cannot set CURLOPT_URL\n");
-      goto onerror;
-    }
+      if (!transfer && url->parallel <= 1 && (transfer = transfer_start (url, multi, path)) == NULL)
+        return -1;
 
-    /* Set default User-Agent header, can be overridden via custom header */
-    if (curl_easy_setopt (io->handle, CURLOPT_USERAGENT,
-                          "libmseed/" LIBMSEED_VERSION " libcurl/" LIBCURL_VERSION) != CURLE_OK)
-    {
-      ms_log (2, "Cannot set default CURLOPT_USERAGENT\n");
-      goto onerror;
-    }
+      if (transfer)
+      {
+        if (url_open_transfer (io, transfer, path))
+          goto onerror;
 
-    /* Disable signals */
-    if (curl_easy_setopt (io->handle, CURLOPT_NOSIGNAL, 1L) != CURLE_OK)
-    {
-      ms_log (2, "Cannot set CURLOPT_NOSIGNAL\n");
-      goto onerror;
+        return 0;
+      }
     }
 
-    /* Connection timeout, 0 disables */
-    if (libmseed_url_connecttimeout > 0 &&
-        curl_easy_setopt (io->handle, CURLOPT_CONNECTTIMEOUT, libmseed_url_connecttimeout) !=
-            CURLE_OK)
+    /* Read with concurrent range requests if enabled and supported by the server */
+    if (url->parallel > 1)
     {
-      ms_log (2, "Cannot set CURLOPT_CONNECTTIMEOUT\n");
-      goto onerror;
-    }
+      int rv = url_open_ranges (io, url, path, startoffset, endoffset);
 
-    /* Abort the transfer if it stalls below 1 byte/second, 0 disables */
-    if (libmseed_url_stalltimeout > 0 &&
-        (curl_easy_setopt (io->handle, CURLOPT_LOW_SPEED_LIMIT, 1L) != CURLE_OK ||
-         curl_easy_setopt (io->handle, CURLOPT_LOW_SPEED_TIME, libmseed_url_stalltimeout) !=
-             CURLE_OK))
-    {
-      ms_log (2, "Cannot set CURLOPT_LOW_SPEED_LIMIT and/or CURLOPT_LOW_SPEED_TIME\n");
-      goto onerror;
+      if (rv <= 0)
+        return rv;
     }
 
-    /* Return failure codes on errors */
-    if (curl_easy_setopt (io->handle, CURLOPT_FAILONERROR, 1L) != CURLE_OK)
-    {
-      ms_log (2, "Cannot set CURLOPT_FAILONERROR\n");
-      goto onerror;
-    }
+    io->type = LMIO_URL;
 
-    /* Follow HTTP redirects */
-    if (curl_easy_setopt (io->handle, CURLOPT_FOLLOWLOCATION, 1L) != CURLE_OK)
-    {
-      ms_log (2, "Cannot set CURLOPT_FOLLOWLOCATION\n");
+    if ((io->handle = url_easy_init (url, path)) == NULL)
       goto onerror;
-    }
 
     /* Configure write callback for recv'ed data */
     if (curl_easy_setopt (io->handle, CURLOPT_WRITEFUNCTION, recv_callback) != CURLE_OK)
@@ -435,13 +1519,6 @@ msio_fopen (LMIO *io, const char *path, const char *mode, int64_t *startoffset,
       }
     }
 
-    /* Set custom headers */
-    if (gCURLheaders && curl_easy_setopt (io->handle, CURLOPT_HTTPHEADER, gCURLheaders) != CURLE_OK)
-    {
-      ms_log (2, "Cannot set CURLOPT_HTTPHEADER\n");
-      goto onerror;
-    }
-
     /* Set connection as still running */
     io->still_running = 1;
 
@@ -490,6 +1567,38 @@ msio_fopen (LMIO *io, const char *path, const char *mode, int64_t *startoffset,
   }
   else
   {
+    LMIOBuffer *iobuffer;
+    char *buffer;
+    int64_t length;
+    int format;
+
+    /* Read the contents of a prefetched file from memory if available */
+    if (!(startoffset && *startoffset > 0) && !(endoffset && *endoffset > 0) &&
+        lm_fileprefetch_take (path, &buffer, &length) == 0)
+    {
+      if ((iobuffer = (LMIOBuffer *)lm_memory ()->malloc (sizeof (LMIOBuffer))) == NULL)
+      {
+        ms_log (2, "Cannot allocate memory for prefetched file\n");
+        lm_memory ()->free (buffer);
+        return -1;
+      }
+
+      iobuffer->buffer = buffer;
+      iobuffer->length = length;
+      iobuffer->offset = 0;
+
+      io->type = LMIO_BUFFER;
+      io->handle = iobuffer;
+
+      /* Decompress a compressed file, contents are otherwise read in place */
+      format = lm_decompress_format ((uint8_t *)buffer, (size_t)length);
+
+      if (format != LM_DECOMPRESS_NONE && lm_decompress_open (io, format, path, 0))
+        goto onerror;
+
+      return 0;
+    }
+
     io->type = LMIO_FILE;
 
     if ((io->handle = fopen (path, mode)) == NULL)
@@ -498,8 +1607,15 @@ msio_fopen (LMIO *io, const char *path, const char *mode, int64_t *startoffset,
       goto onerror;
     }
 
+    /* Read a compressed file through a decompressor, offsets are in the
+     * decompressed data */
+    if ((format = file_compression (io->handle)) != LM_DECOMPRESS_NONE)
+    {
+      if (lm_decompress_open (io, format, path, (startoffset) ? *startoffset : 0))
+        goto onerror;
+    }
     /* Seek to position if start offset is provided */
-    if (startoffset && *startoffset > 0)
+    else if (startoffset && *startoffset > 0)
     {
       if (lmp_fseek64 (io->handle, *startoffset, SEEK_SET))
       {
@@ -530,7 +1646,7 @@ onerror:
 int
 msio_fclose (LMIO *io)
 {
-  int rv;
+  int rv = 0;
 
   if (!io)
   {
@@ -562,13 +1678,34 @@ msio_fclose (LMIO *io)
     curl_multi_cleanup (io->handle2);
 #endif
   }
+  else if (io->type == LMIO_URLRANGES)
+  {
+#if defined(LIBMSEED_URL)
+    ranges_free ((LMURLRanges *)io->handle);
+#endif
+  }
+  else if (io->type == LMIO_URLTRANSFER)
+  {
+#if defined(LIBMSEED_URL)
+    transfer_free ((LMURLTransfer *)io->handle);
+#endif
+  }
+  else if (io->type == LMIO_BUFFER)
+  {
+    lm_memory ()->free (((LMIOBuffer *)io->handle)->buffer);
+    lm_memory ()->free (io->handle);
+  }
+  else if (io->type == LMIO_DECOMPRESS)
+  {
+    rv = lm_decompress_close (io);
+  }
 
   io->type = LMIO_NULL;
   io->handle = NULL;
   io->handle2 = NULL;
   io->urlfail = 0;
 
-  return 0;
+  return rv;
 } /* End of msio_fclose() */
 
 /*********************************************************************
@@ -734,6 +1871,39 @@ msio_fread (LMIO *io, void *buffer, size_t size)
 
 #endif /* defined(LIBMSEED_URL) */
   }
+  /* Read from URL with concurrent range requests */
+  else if (io->type == LMIO_URLRANGES)
+  {
+#if defined(LIBMSEED_URL)
+    return url_read_ranges (io, buffer, size);
+#endif
+  }
+  /* Read from URL with a buffered transfer */
+  else if (io->type == LMIO_URLTRANSFER)
+  {
+#if defined(LIBMSEED_URL)
+    return url_read_transfer (io, buffer, size);
+#endif
+  }
+  /* Read the contents of a prefetched file */
+  else if (io->type == LMIO_BUFFER)
+  {
+    LMIOBuffer *iobuffer = (LMIOBuffer *)io->handle;
+
+    if ((int64_t)size > iobuffer->length - iobuffer->offset)
+      size = (size_t)(iobuffer->length - iobuffer->offset);
+
+    if (size > 0)
+      memcpy (buffer, iobuffer->buffer + iobuffer->offset, size);
+
+    iobuffer->offset += size;
+    read = size;
+  }
+  /* Read decompressed data */
+  else if (io->type == LMIO_DECOMPRESS)
+  {
+    return lm_decompress_read (io, buffer, size);
+  }
 
   return (int64_t)read;
 } /* End of msio_fread() */
@@ -759,7 +1929,17 @@ msio_feof (LMIO *io)
     if (feof ((FILE *)io->handle))
       return 1;
   }
-  else if (io->type == LMIO_URL)
+  else if (io->type == LMIO_BUFFER)
+  {
+    if (((LMIOBuffer *)io->handle)->offset >= ((LMIOBuffer *)io->handle)->length)
+      return 1;
+  }
+  else if (io->type == LMIO_DECOMPRESS)
+  {
+    if (lm_decompress_eof (io))
+      return 1;
+  }
+  else if (io->type == LMIO_URL || io->type == LMIO_URLRANGES || io->type == LMIO_URLTRANSFER)
   {
 #if !defined(LIBMSEED_URL)
     ms_log (2, "URL support not included in library\n");
@@ -780,6 +1960,141 @@ msio_feof (LMIO *io)
   return 0;
 } /* End of msio_feof() */
 
+/*********************************************************************
+ * msio_fseek:
+ *
+ * Set the read position of a local file or prefetched file, relative
+ * to whence as with fseek().  Other types of IO handles cannot be
+ * positioned.
+ *
+ * Returns the new read position on success and -1 on error.
+ *********************************************************************/
+int64_t
+msio_fseek (LMIO *io, int64_t offset, int whence)
+{
+  LMIOBuffer *iobuffer;
+
+  if (!io || io->handle == NULL)
+    return -1;
+
+  if (io->type == LMIO_FILE)
+  {
+    if (lmp_fseek64 ((FILE *)io->handle, offset, whence))
+      return -1;
+
+    return lmp_ftell64 ((FILE *)io->handle);
+  }
+  else if (io->type == LMIO_BUFFER)
+  {
+    iobuffer = (LMIOBuffer *)io->handle;
+
+    if (whence == SEEK_CUR)
+      offset += iobuffer->offset;
+    else if (whence == SEEK_END)
+      offset += iobuffer->length;
+
+    if (offset < 0 || offset > iobuffer->length)
+      return -1;
+
+    iobuffer->offset = offset;
+
+    return offset;
+  }
+
+  return -1;
+} /* End of msio_fseek() */
+
+/*********************************************************************
+ * msio_dropcache:
+ *
+ * Advise the system that file data read from an IO handle will not be
+ * read again and can be dropped from the page cache, to be called
+ * after each read with the number of bytes read.  Data before the read
+ * position is dropped in portions of LMIO_DROPCACHE_SIZE, and the
+ * remainder of the file once the end of the file is reached.
+ *
+ * Only files read with a FILE handle are supported, other handles,
+ * non-seekable input and systems without posix_fadvise() are ignored.
+ *********************************************************************/
+void
+msio_dropcache (LMIO *io, int64_t readcount)
+{
+#if defined(POSIX_FADV_DONTNEED)
+  int64_t position;
+  int64_t start;
+  int64_t end;
+  int fd;
+
+  if (!io || io->handle == NULL || (io->type != LMIO_FILE && io->type != LMIO_FD))
+    return;
+
+  if ((position = lmp_ftell64 ((FILE *)io->handle)) < 0)
+    return;
+
+  fd = fileno ((FILE *)io->handle);
+
+  /* Start of the portion containing the data of this read */
+  start = ((position - readcount) / LMIO_DROPCACHE_SIZE) * LMIO_DROPCACHE_SIZE;
+
+  if (start < 0)
+    start = 0;
+
+  /* Drop through the end of the file, or all complete portions read */
+  if (feof ((FILE *)io->handle))
+  {
+    posix_fadvise (fd, (off_t)start, 0, POSIX_FADV_DONTNEED);
+  }
+  else
+  {
+    end = (position / LMIO_DROPCACHE_SIZE) * LMIO_DROPCACHE_SIZE;
+
+    if (end > start)
+      posix_fadvise (fd, (off_t)start, (off_t)(end - start), POSIX_FADV_DONTNEED);
+  }
+#else
+  (void)io;
+  (void)readcount;
+#endif
+} /* End of msio_dropcache() */
+
+/*********************************************************************
+ * msio_buffer_take:
+ *
+ * Take the unread contents of a prefetched file opened as an
+ * LMIO_BUFFER handle, leaving the handle at the end of the stream.  The
+ * contents are owned by the caller and allocated with the memory
+ * functions of the calling thread's context.
+ *
+ * Returns the contents, or NULL if the handle is not a prefetched file.
+ *********************************************************************/
+char *
+msio_buffer_take (LMIO *io, int64_t *length)
+{
+  LMIOBuffer *iobuffer;
+  char *contents;
+
+  if (!io || io->type != LMIO_BUFFER || !io->handle || !length)
+    return NULL;
+
+  iobuffer = (LMIOBuffer *)io->handle;
+
+  if (!iobuffer->buffer)
+    return NULL;
+
+  /* Move unread contents to the start of the buffer */
+  if (iobuffer->offset > 0)
+    memmove (iobuffer->buffer, iobuffer->buffer + iobuffer->offset,
+             (size_t)(iobuffer->length - iobuffer->offset));
+
+  contents = iobuffer->buffer;
+  *length = iobuffer->length - iobuffer->offset;
+
+  iobuffer->buffer = NULL;
+  iobuffer->offset = iobuffer->length;
+
+  return contents;
+} /* End of msio_buffer_take() */
+
 /*********************************************************************
  * msio_url_useragent:
  *
@@ -839,16 +2154,129 @@ msio_url_timeout (long connecttimeout, long stalltimeout)
   ms_log (2, "URL support not included in library\n");
   return -1;
 #else
+  LMURLSettings *url = lm_urlsettings ();
+
   if (connecttimeout >= 0)
-    libmseed_url_connecttimeout = connecttimeout;
+    url->connecttimeout = connecttimeout;
 
   if (stalltimeout >= 0)
-    libmseed_url_stalltimeout = stalltimeout;
+    url->stalltimeout = stalltimeout;
 #endif
 
   return 0;
 } /* End of msio_url_timeout() */
 
+/*********************************************************************
+ * msio_url_parallel:
+ *
+ * Set the number of concurrent range requests and the size of each
+ * range for URL-based IO.  A connections value of 0 or 1 disables
+ * concurrent range requests, a negative value leaves it unchanged.  A
+ * rangesize of 0 or less leaves the size unchanged.
+ *
+ * Returns 0 on success non-zero otherwise.
+ *
+ * @ref MessageOnError - this function logs a message on error
+ *********************************************************************/
+int
+msio_url_parallel (int connections, int64_t rangesize)
+{
+#if !defined(LIBMSEED_URL)
+  (void)connections; /* Unused */
+  (void)rangesize;   /* Unused */
+  ms_log (2, "URL support not included in library\n");
+  return -1;
+#else
+  LMURLSettings *url = lm_urlsettings ();
+
+  if (connections > LIBMSEED_URL_PARALLEL_MAX)
+  {
+    ms_log (2, "%s(): Too many connections, maximum is %d: %d\n", __func__,
+            LIBMSEED_URL_PARALLEL_MAX, connections);
+    return -1;
+  }
+
+  if (connections >= 0)
+    url->parallel = connections;
+
+  if (rangesize > 0)
+    url->rangesize = rangesize;
+#endif
+
+  return 0;
+} /* End of msio_url_parallel() */
+
+/*********************************************************************
+ * msio_url_prefetch:
+ *
+ * Start the transfer of a URL before it is opened, the transfer is
+ * used when the URL is opened by the same thread without a byte range.
+ * Up to LIBMSEED_URL_PREFETCH_MAX transfers are kept, starting another
+ * cancels the oldest.  Paths that are not URLs, and URLs already
+ * prefetched, are ignored.  A NULL path cancels all prefetched
+ * transfers that have not been opened.
+ *
+ * Returns 0 on success non-zero otherwise.
+ *
+ * @ref MessageOnError - this function logs a message on error
+ *********************************************************************/
+int
+msio_url_prefetch (const char *path)
+{
+  /* Paths that are not URLs are read from the file system */
+  if (path && (lmp_strncasecmp (path, "file://", 7) == 0 || !strstr (path, "://")))
+    return 0;
+
+#if !defined(LIBMSEED_URL)
+  ms_log (2, "URL support not included in library\n");
+  return -1;
+#else
+  LMURLSettings *url = lm_urlsettings ();
+  LMURLTransfer *transfer;
+  LMURLTransfer **link;
+  CURLM *multi;
+
+  /* Prefetched transfers are only used by the thread owning the multi handle */
+  if ((multi = transfer_multi (url)) == NULL)
+    return 0;
+
+  if (!path)
+  {
+    prefetch_cancel (url);
+    return 0;
+  }
+
+  for (link = (LMURLTransfer **)&url->prefetch; *link; link = &(*link)->next)
+  {
+    if (strcmp ((*link)->path, path) == 0)
+      return 0;
+  }
+
+  url_resolve_settings (url);
+
+  if ((transfer = transfer_start (url, multi, path)) == NULL)
+    return -1;
+
+  /* Cancel the oldest transfer if the maximum are pending */
+  if (url->prefetchcount >= LIBMSEED_URL_PREFETCH_MAX)
+  {
+    LMURLTransfer *oldest = (LMURLTransfer *)url->prefetch;
+
+    if (link == &oldest->next)
+      link = (LMURLTransfer **)&url->prefetch;
+
+    url->prefetch = oldest->next;
+    url->prefetchcount--;
+    transfer_free (oldest);
+  }
+
+  *link = transfer;
+  url->prefetchcount++;
+#endif
+
+  return 0;
+} /* End of msio_url_prefetch() */
+
 /*********************************************************************
  * msio_url_userpassword:
  *
@@ -871,17 +2299,19 @@ msio_url_userpassword (const char *userpassword)
   ms_log (2, "URL support not included in library\n");
   return -1;
 #else
-  if (gCURLeasy == NULL && (gCURLeasy = curl_easy_init ()) == NULL)
+  LMURLSettings *url = lm_urlsettings ();
+
+  if (url->easy == NULL && (url->easy = curl_easy_init ()) == NULL)
     return -1;
 
   /* Allow any authentication, libcurl will pick the most secure */
-  if (curl_easy_setopt (gCURLeasy, CURLOPT_HTTPAUTH, CURLAUTH_ANY) != CURLE_OK)
+  if (curl_easy_setopt ((CURL *)url->easy, CURLOPT_HTTPAUTH, CURLAUTH_ANY) != CURLE_OK)
   {
     ms_log (2, "Cannot set CURLOPT_HTTPAUTH\n");
     return -1;
   }
 
-  if (curl_easy_setopt (gCURLeasy, CURLOPT_USERPWD, userpassword) != CURLE_OK)
+  if (curl_easy_setopt ((CURL *)url->easy, CURLOPT_USERPWD, userpassword) != CURLE_OK)
   {
     ms_log (2, "Cannot set CURLOPT_USERPWD\n");
     return -1;
@@ -913,9 +2343,10 @@ msio_url_addheader (const char *header)
   ms_log (2, "URL support not included in library\n");
   return -1;
 #else
+  LMURLSettings *url = lm_urlsettings ();
   struct curl_slist *slist = NULL;
 
-  slist = curl_slist_append (gCURLheaders, header);
+  slist = curl_slist_append ((struct curl_slist *)url->headers, header);
 
   if (slist == NULL)
   {
@@ -923,7 +2354,7 @@ msio_url_addheader (const char *header)
     return -1;
   }
 
-  gCURLheaders = slist;
+  url->headers = slist;
 #endif
 
   return 0;
@@ -941,10 +2372,12 @@ msio_url_freeheaders (void)
   ms_log (2, "URL support not included in library\n");
   return;
 #else
-  if (gCURLheaders != NULL)
+  LMURLSettings *url = lm_urlsettings ();
+
+  if (url->headers != NULL)
   {
-    curl_slist_free_all (gCURLheaders);
-    gCURLheaders = NULL;
+    curl_slist_free_all ((struct curl_slist *)url->headers);
+    url->headers = NULL;
   }
 #endif
 } /* End of msio_url_freeheaders() */
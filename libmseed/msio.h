@@ -32,8 +32,13 @@ extern int msio_fopen (LMIO *io, const char *path, const char *mode,
 extern int msio_fclose (LMIO *io);
 extern int64_t msio_fread (LMIO *io, void *buffer, size_t size);
 extern int msio_feof (LMIO *io);
+extern int64_t msio_fseek (LMIO *io, int64_t offset, int whence);
+extern void msio_dropcache (LMIO *io, int64_t readcount);
+extern char *msio_buffer_take (LMIO *io, int64_t *length);
 extern int msio_url_useragent (const char *program, const char *version);
 extern int msio_url_timeout (long connecttimeout, long stalltimeout);
+extern int msio_url_parallel (int connections, int64_t rangesize);
+extern int msio_url_prefetch (const char *path);
 extern int msio_url_userpassword (const char *userpassword);
 extern int msio_url_addheader (const char *header);
 extern void msio_url_freeheaders (void);
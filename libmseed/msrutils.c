@@ -23,6 +23,7 @@
 #include <string.h>
 #include <time.h>
 
+#include "internalstate.h"
 #include "libmseed.h"
 
 /** ************************************************************************
@@ -49,7 +50,7 @@ msr3_init (MS3Record *msr)
 
   if (!msr)
   {
-    msr = (MS3Record *)libmseed_memory.malloc (sizeof (MS3Record));
+    msr = (MS3Record *)lm_memory ()->malloc (sizeof (MS3Record));
   }
   else
   {
@@ -57,7 +58,7 @@ msr3_init (MS3Record *msr)
     datasize = msr->datasize;
 
     if (msr->extra)
-      libmseed_memory.free (msr->extra);
+      lm_memory ()->free (msr->extra);
   }
 
   if (msr == NULL)
@@ -68,6 +69,9 @@ msr3_init (MS3Record *msr)
 
   memcpy (msr, &msr_initialized, sizeof (MS3Record));
 
+  /* Clear deferred extra headers of a reused record */
+  lm_extrapending_set (msr, 0);
+
   msr->datasamples = datasamples;
   msr->datasize = datasize;
 
@@ -88,12 +92,14 @@ msr3_free (MS3Record **ppmsr)
   if (ppmsr != NULL && *ppmsr != 0)
   {
     if ((*ppmsr)->extra)
-      libmseed_memory.free ((*ppmsr)->extra);
+      lm_memory ()->free ((*ppmsr)->extra);
 
     if ((*ppmsr)->datasamples)
-      libmseed_memory.free ((*ppmsr)->datasamples);
+      lm_memory ()->free ((*ppmsr)->datasamples);
+
+    lm_extrapending_set (*ppmsr, 0);
 
-    libmseed_memory.free (*ppmsr);
+    lm_memory ()->free (*ppmsr);
 
     *ppmsr = NULL;
   }
@@ -127,6 +133,10 @@ msr3_duplicate_extra (const MS3Record *msr, int8_t datadup, int8_t extradup)
     return NULL;
   }
 
+  /* Map deferred miniSEED 2 extra headers before copying them */
+  if (extradup && lm_extrapending (msr) && msr3_unpack_extra ((MS3Record *)msr, 0) < 0)
+    return NULL;
+
   /* Allocate target MS3Record structure */
   if ((dupmsr = msr3_init (NULL)) == NULL)
     return NULL;
@@ -145,7 +155,7 @@ msr3_duplicate_extra (const MS3Record *msr, int8_t datadup, int8_t extradup)
   if (extradup && msr->extralength > 0 && msr->extra)
   {
     /* Allocate memory for new extra headers */
-    if ((dupmsr->extra = (char *)libmseed_memory.malloc (msr->extralength + 1)) == NULL)
+    if ((dupmsr->extra = (char *)lm_memory ()->malloc (msr->extralength + 1)) == NULL)
     {
       ms_log (2, "Error allocating memory\n");
       msr3_free (&dupmsr);
@@ -163,7 +173,7 @@ msr3_duplicate_extra (const MS3Record *msr, int8_t datadup, int8_t extradup)
   if (datadup && msr->numsamples > 0 && msr->datasize > 0 && msr->datasamples)
   {
     /* Allocate memory for new data array */
-    if ((dupmsr->datasamples = libmseed_memory.malloc ((size_t)(msr->datasize))) == NULL)
+    if ((dupmsr->datasamples = lm_memory ()->malloc ((size_t)(msr->datasize))) == NULL)
     {
       ms_log (2, "Error allocating memory\n");
       msr3_free (&dupmsr);
@@ -259,6 +269,10 @@ msr3_print (const MS3Record *msr, int8_t details)
   /* Report information in the fixed header */
   if (details > 0)
   {
+    /* Map deferred miniSEED 2 extra headers for reporting */
+    if (lm_extrapending (msr))
+      msr3_unpack_extra ((MS3Record *)msr, 0);
+
     ms_log (0, "%s, version %d, %d bytes (format: %d)\n", msr->sid, msr->pubversion, msr->reclen,
             msr->formatversion);
     ms_log (0, "             start time: %s\n", time);
@@ -340,7 +354,7 @@ msr3_resize_buffer (MS3Record *msr)
 
     if (msr->datasize > datasize)
     {
-      void *resized = libmseed_memory.realloc (msr->datasamples, datasize);
+      void *resized = lm_memory ()->realloc (msr->datasamples, datasize);
 
       if (resized == NULL)
       {
@@ -187,6 +187,10 @@ msr3_pack_init (const MS3Record *msr, uint32_t flags, int8_t verbose)
     return NULL;
   }
 
+  /* Map deferred miniSEED 2 extra headers */
+  if (lm_extrapending (msr) && msr3_unpack_extra ((MS3Record *)msr, verbose) < 0)
+    return NULL;
+
   if ((msr->reclen != -1) && (msr->reclen < MINRECLEN || msr->reclen > MAXRECLEN))
   {
     ms_log (2, "%s: Record length is out of range: %d\n", msr->sid, msr->reclen);
@@ -200,7 +204,7 @@ msr3_pack_init (const MS3Record *msr, uint32_t flags, int8_t verbose)
   }
 
   /* Allocate pack state context */
-  packer = (MS3RecordPacker *)libmseed_memory.malloc (sizeof (MS3RecordPacker));
+  packer = (MS3RecordPacker *)lm_memory ()->malloc (sizeof (MS3RecordPacker));
   if (!packer)
   {
     ms_log (2, "Cannot allocate memory for packer context\n");
@@ -242,17 +246,17 @@ msr3_pack_init (const MS3Record *msr, uint32_t flags, int8_t verbose)
               "%s: Record length (%u) is not large enough for header (%u), SID (%" PRIsize_t
               "), and extra (%d)\n",
               msr->sid, packer->maxreclen, MS3FSDH_LENGTH, strlen (msr->sid), msr->extralength);
-      libmseed_memory.free (packer);
+      lm_memory ()->free (packer);
       return NULL;
     }
   }
 
   /* Allocate space for generated record */
-  packer->rawrec = (char *)libmseed_memory.malloc (packer->maxreclen);
+  packer->rawrec = (char *)lm_memory ()->malloc (packer->maxreclen);
   if (!packer->rawrec)
   {
     ms_log (2, "%s: Cannot allocate memory for record buffer\n", msr->sid);
-    libmseed_memory.free (packer);
+    lm_memory ()->free (packer);
     return NULL;
   }
 
@@ -265,8 +269,8 @@ msr3_pack_init (const MS3Record *msr, uint32_t flags, int8_t verbose)
     if (!packer->samplesize)
     {
       ms_log (2, "%s: Unknown sample type '%c'\n", msr->sid, msr->sampletype);
-      libmseed_memory.free (packer->rawrec);
-      libmseed_memory.free (packer);
+      lm_memory ()->free (packer->rawrec);
+      lm_memory ()->free (packer);
       return NULL;
     }
   }
@@ -296,8 +300,8 @@ msr3_pack_init (const MS3Record *msr, uint32_t flags, int8_t verbose)
       {
         ms_log (2, "%s: Data offset (%d) does not fit within record length (%u)\n", msr->sid,
                 packer->dataoffset, packer->maxreclen);
-        libmseed_memory.free (packer->rawrec);
-        libmseed_memory.free (packer);
+        lm_memory ()->free (packer->rawrec);
+        lm_memory ()->free (packer);
         return NULL;
       }
 
@@ -309,8 +313,8 @@ msr3_pack_init (const MS3Record *msr, uint32_t flags, int8_t verbose)
   if (packer->dataoffset < 0)
   {
     ms_log (2, "%s: Cannot pack miniSEED header\n", msr->sid);
-    libmseed_memory.free (packer->rawrec);
-    libmseed_memory.free (packer);
+    lm_memory ()->free (packer->rawrec);
+    lm_memory ()->free (packer);
     return NULL;
   }
 
@@ -342,12 +346,12 @@ msr3_pack_init (const MS3Record *msr, uint32_t flags, int8_t verbose)
     }
 
     /* Allocate space for encoded data separately for alignment */
-    packer->encoded = (char *)libmseed_memory.malloc (packer->maxdatabytes);
+    packer->encoded = (char *)lm_memory ()->malloc (packer->maxdatabytes);
     if (!packer->encoded)
     {
       ms_log (2, "%s: Cannot allocate memory for encoded data buffer\n", msr->sid);
-      libmseed_memory.free (packer->rawrec);
-      libmseed_memory.free (packer);
+      lm_memory ()->free (packer->rawrec);
+      lm_memory ()->free (packer);
       return NULL;
     }
   }
@@ -598,6 +602,38 @@ msr3_pack_next (MS3RecordPacker *packer, char **record, int32_t *reclen)
   return 1;
 } /* End of msr3_pack_next() */
 
+/***************************************************************************
+ * Position a packer to generate the next record starting at the
+ * specified sample offset.
+ *
+ * Packing is a pure function of the starting sample: the record start
+ * time is projected from the template start time and the Steim
+ * integration constant is always reset, so records generated after a
+ * seek are identical to those generated by a packer that reached the
+ * offset sequentially.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+int
+lm_pack_seek (MS3RecordPacker *packer, int64_t sampleoffset)
+{
+  if (!packer || sampleoffset < 0 || sampleoffset > packer->msr->numsamples)
+  {
+    ms_log (2, "%s(): Invalid packer or sample offset\n", __func__);
+    return -1;
+  }
+
+  packer->packed_samples = sampleoffset;
+  packer->finished = (packer->msr->numsamples > 0 && sampleoffset == packer->msr->numsamples);
+  packer->nextstarttime = ms_sampletime (packer->msr->starttime, sampleoffset, packer->msr->samprate);
+
+  /* Records after the first carry a start time updated from nextstarttime */
+  if (sampleoffset > 0 && packer->recordcount == 0)
+    packer->recordcount = 1;
+
+  return 0;
+} /* End of lm_pack_seek() */
+
 /** ************************************************************************
  * @brief Free packer and resources
  *
@@ -620,15 +656,146 @@ msr3_pack_free (MS3RecordPacker **packer, int64_t *packedsamples)
     *packedsamples = (*packer)->packed_samples;
 
   if ((*packer)->rawrec)
-    libmseed_memory.free ((*packer)->rawrec);
+    lm_memory ()->free ((*packer)->rawrec);
 
   if ((*packer)->encoded)
-    libmseed_memory.free ((*packer)->encoded);
+    lm_memory ()->free ((*packer)->encoded);
 
-  libmseed_memory.free (*packer);
+  lm_memory ()->free (*packer);
   *packer = NULL;
 } /* End of msr3_pack_free() */
 
+/***************************************************************************
+ * Swap the byte order of a Steim frame.  The control word determines the
+ * layout of the other words: 8-bit differences are not swapped, the
+ * 16-bit differences of Steim1 are swapped individually and all other
+ * words are swapped as 32-bit quantities.  The frame is in host byte
+ * order when hostorder is true.
+ ***************************************************************************/
+static void
+repack_swap_steimframe (char *frame, int first, int8_t encoding, int8_t hostorder)
+{
+  uint32_t control;
+  int nibble;
+  int widx;
+
+  memcpy (&control, frame, sizeof (uint32_t));
+  if (!hostorder)
+    ms_gswap4 (&control);
+
+  ms_gswap4 (frame);
+
+  /* Forward and reverse integration constants of the first frame */
+  if (first)
+  {
+    ms_gswap4 (frame + 4);
+    ms_gswap4 (frame + 8);
+  }
+
+  for (widx = (first) ? 3 : 1; widx < 16; widx++)
+  {
+    nibble = (control >> (30 - (2 * widx))) & 0x3;
+
+    if (nibble == 2 && encoding == DE_STEIM1)
+    {
+      ms_gswap2 (frame + (4 * widx));
+      ms_gswap2 (frame + (4 * widx) + 2);
+    }
+    else if (nibble == 2 || nibble == 3)
+    {
+      ms_gswap4 (frame + (4 * widx));
+    }
+  }
+} /* End of repack_swap_steimframe() */
+
+/***************************************************************************
+ * Return the size of the words of encoded data that are byte swapped
+ * when repacking, 1 for text that has no byte order and -1 for unknown
+ * or unsupported encodings, which cannot be repacked.  Steim frames are
+ * swapped as 4-byte words with the differences of each frame.
+ ***************************************************************************/
+static int
+repack_wordsize (int8_t encoding)
+{
+  switch (encoding)
+  {
+  case DE_TEXT:
+    return 1;
+  case DE_INT16:
+  case DE_CDSN:
+  case DE_SRO:
+  case DE_DWWSSN:
+  case DE_GEOSCOPE163:
+  case DE_GEOSCOPE164:
+    return 2;
+  case DE_GEOSCOPE24:
+    return 3;
+  case DE_INT32:
+  case DE_FLOAT32:
+  case DE_STEIM1:
+  case DE_STEIM2:
+    return 4;
+  case DE_FLOAT64:
+    return 8;
+  default:
+    return -1;
+  }
+} /* End of repack_wordsize() */
+
+/***************************************************************************
+ * Swap the byte order of encoded data copied from a parsed record when
+ * it differs from the byte order required by the destination format.
+ * The byte order of the original data is known from the payload swap
+ * flag of the record.  The encoding must be supported by
+ * repack_wordsize(), text is not swapped.
+ ***************************************************************************/
+static void
+repack_swap_data (const MS3Record *msr, char *data, uint32_t datasize, int8_t bigendian)
+{
+  int8_t hostorder = (msr->swapflag & MSSWAP_PAYLOAD) ? 0 : 1;
+  int8_t sourcebigendian;
+  uint32_t offset;
+  char byte;
+  int size;
+
+  /* Original data is in host order unless the payload needed swapping */
+  sourcebigendian = (ms_bigendianhost ()) ? hostorder : !hostorder;
+
+  if (sourcebigendian == bigendian)
+    return;
+
+  if (msr->encoding == DE_STEIM1 || msr->encoding == DE_STEIM2)
+  {
+    for (offset = 0; offset + 64 <= datasize; offset += 64)
+      repack_swap_steimframe (data + offset, (offset == 0), msr->encoding, hostorder);
+    return;
+  }
+
+  size = repack_wordsize (msr->encoding);
+
+  for (offset = 0; size > 1 && offset + size <= datasize; offset += size)
+  {
+    if (size == 2)
+    {
+      ms_gswap2 (data + offset);
+    }
+    else if (size == 3)
+    {
+      byte = data[offset];
+      data[offset] = data[offset + 2];
+      data[offset + 2] = byte;
+    }
+    else if (size == 4)
+    {
+      ms_gswap4 (data + offset);
+    }
+    else
+    {
+      ms_gswap8 (data + offset);
+    }
+  }
+} /* End of repack_swap_data() */
+
 /** ************************************************************************
  * @brief Repack a parsed miniSEED record into a version 3 record.
  *
@@ -636,6 +803,12 @@ msr3_pack_free (MS3RecordPacker **packer, int64_t *packedsamples)
  * encoded data from the original record.  The original record must be
  * available at the ::MS3Record.record pointer.
  *
+ * The byte order of the encoded data is swapped if needed, miniSEED 3
+ * data is little endian except for Steim encodings, which are big endian.
+ *
+ * Records with samples in an unknown or unsupported encoding, such as
+ * miniSEED 2 records without Blockette 1000, cannot be repacked.
+ *
  * This can be used to efficiently convert format versions or modify
  * header values without unpacking the data samples.
  *
@@ -664,6 +837,18 @@ msr3_repack_mseed3 (const MS3Record *msr, char *record, uint32_t recbuflen, int8
     return -1;
   }
 
+  /* Encoded data can only be copied if the encoding is known */
+  if (msr->samplecnt > 0 && repack_wordsize (msr->encoding) < 0)
+  {
+    ms_log (2, "%s: Cannot repack data, unknown or unsupported encoding %d (%s)\n", msr->sid,
+            msr->encoding, (char *)ms_encodingstr (msr->encoding));
+    return -1;
+  }
+
+  /* Map deferred miniSEED 2 extra headers */
+  if (lm_extrapending (msr) && msr3_unpack_extra ((MS3Record *)msr, verbose) < 0)
+    return -1;
+
   if (recbuflen < (MS3FSDH_LENGTH + strlen (msr->sid) + msr->extralength))
   {
     ms_log (2,
@@ -705,8 +890,11 @@ msr3_repack_mseed3 (const MS3Record *msr, char *record, uint32_t recbuflen, int8
 
   reclen = dataoffset + origdatasize;
 
-  /* Copy encoded data into record */
+  /* Copy encoded data into record, Steim encodings are big endian and all
+   * others little endian in miniSEED 3 */
   memcpy (record + dataoffset, msr->record + origdataoffset, origdatasize);
+  repack_swap_data (msr, record + dataoffset, origdatasize,
+                    (msr->encoding == DE_STEIM1 || msr->encoding == DE_STEIM2));
 
   /* Check to see if byte swapping is needed, miniSEED 3 is little endian */
   swapflag = (ms_bigendianhost ()) ? 1 : 0;
@@ -765,6 +953,10 @@ msr3_pack_header3 (const MS3Record *msr, char *record, uint32_t recbuflen, int8_
     return -1;
   }
 
+  /* Map deferred miniSEED 2 extra headers */
+  if (lm_extrapending (msr) && msr3_unpack_extra ((MS3Record *)msr, verbose) < 0)
+    return -1;
+
   /* Use default record length and encoding if needed */
   maxreclen = (msr->reclen < 0) ? MS_PACK_DEFAULT_RECLEN : msr->reclen;
   encoding = (msr->encoding < 0) ? MS_PACK_DEFAULT_ENCODING : msr->encoding;
@@ -848,6 +1040,12 @@ msr3_pack_header3 (const MS3Record *msr, char *record, uint32_t recbuflen, int8_
  * encoded data from the original record.  The original record must be
  * available at the ::MS3Record.record pointer.
  *
+ * The byte order of the encoded data is swapped if needed, the record
+ * is written big endian.
+ *
+ * Records with samples in an unknown or unsupported encoding, such as
+ * miniSEED 2 records without Blockette 1000, cannot be repacked.
+ *
  * The new record will be the same length as the original record and an
  * error will be returned if the repacked record would not fit.
  * If the new record is shorter than the original record, the extra space
@@ -902,6 +1100,14 @@ msr3_repack_mseed2 (const MS3Record *msr, char *record, uint32_t recbuflen, int8
     return -1;
   }
 
+  /* Encoded data can only be copied if the encoding is known */
+  if (msr->samplecnt > 0 && repack_wordsize (msr->encoding) < 0)
+  {
+    ms_log (2, "%s: Cannot repack data, unknown or unsupported encoding %d (%s)\n", msr->sid,
+            msr->encoding, (char *)ms_encodingstr (msr->encoding));
+    return -1;
+  }
+
   /* Pack fixed header and blockettes */
   headerlen = msr3_pack_header2 (msr, record, recbuflen, verbose);
 
@@ -945,8 +1151,9 @@ msr3_repack_mseed2 (const MS3Record *msr, char *record, uint32_t recbuflen, int8
   if (dataoffset > (uint32_t)headerlen)
     memset (record + headerlen, 0, dataoffset - headerlen);
 
-  /* Copy encoded data into record */
+  /* Copy encoded data into record, miniSEED 2 data is written big endian */
   memcpy (record + dataoffset, msr->record + origdataoffset, origdatasize);
+  repack_swap_data (msr, record + dataoffset, origdatasize, 1);
 
   /* Check if byte swapping is needed, miniSEED 2 is written big endian */
   swapflag = (ms_bigendianhost ()) ? 0 : 1;
@@ -1019,10 +1226,15 @@ msr3_pack_header2_offsets (const MS3Record *msr, char *record, uint32_t recbufle
   uint32_t reclen;
   uint8_t encoding;
 
-  char network[64];
-  char station[64];
-  char location[64];
-  char channel[64];
+  const char *network;
+  const char *station;
+  const char *location;
+  const char *channel;
+  uint32_t sidhandle;
+  char netbuf[64];
+  char stabuf[64];
+  char locbuf[64];
+  char chanbuf[64];
 
   uint16_t year;
   uint16_t day;
@@ -1060,6 +1272,10 @@ msr3_pack_header2_offsets (const MS3Record *msr, char *record, uint32_t recbufle
     return -1;
   }
 
+  /* Map deferred miniSEED 2 extra headers */
+  if (lm_extrapending (msr) && msr3_unpack_extra ((MS3Record *)msr, verbose) < 0)
+    return -1;
+
   /* Initialize blockette offsets to 0 */
   if (blockette_1000_offset)
     *blockette_1000_offset = 0;
@@ -1102,13 +1318,32 @@ msr3_pack_header2_offsets (const MS3Record *msr, char *record, uint32_t recbufle
       break;
   }
 
-  /* Parse identifier codes from full identifier */
-  if (ms_sid2nslc_n (msr->sid, network, sizeof (network), station, sizeof (station), location,
-                     sizeof (location), channel, sizeof (channel)))
+  /* Parse identifier codes from full identifier, cached for each interned identifier,
+   * or parsed directly if the identifier cannot be interned */
+  if ((sidhandle = lm_sid_intern (msr->sid)))
+  {
+    if (ms_sid2nslc_interned (sidhandle, &network, &station, &location, &channel))
+    {
+      ms_log (2, "%s: Cannot parse SEED identifier codes from full identifier\n", msr->sid);
+      return -1;
+    }
+  }
+  else if (ms_sid2nslc_n (msr->sid, netbuf, sizeof (netbuf), stabuf, sizeof (stabuf), locbuf,
+                          sizeof (locbuf), chanbuf, sizeof (chanbuf)))
   {
     ms_log (2, "%s: Cannot parse SEED identifier codes from full identifier\n", msr->sid);
     return -1;
   }
+  else
+  {
+    if (verbose > 1)
+      ms_log (0, "%s: Cannot intern identifier, parsed codes directly\n", msr->sid);
+
+    network = netbuf;
+    station = stabuf;
+    location = locbuf;
+    channel = chanbuf;
+  }
 
   /* Verify that identifier codes will fit into and are appropriate for miniSEED 2 */
   if (strlen (network) > 2 || strlen (station) > 5 || strlen (location) > 2 ||
@@ -0,0 +1,376 @@
+/***************************************************************************
+ * Read-ahead of input streams by a helper thread.
+ *
+ * When reading with MSF_READAHEAD a helper thread fills a ring of large
+ * buffers from the input while the caller parses records.  Each buffer
+ * is handed to the parser in place: the read buffer of the stream points
+ * at the buffer data, and the remainder of a record that straddles the
+ * end of the previous buffer is copied into space reserved in front of
+ * the data.  Only records larger than that space are assembled in the
+ * regular read buffer of the stream.
+ *
+ * This file is part of the miniSEED Library.
+ *
+ * Copyright (c) 2026 Chad Trabant, EarthScope Data Services
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include <string.h>
+
+#include "internalstate.h"
+#include "msio.h"
+
+/* Number of buffers in the ring and size of the data in each buffer */
+#define LM_READAHEAD_BUFFERS 4
+#define LM_READAHEAD_BUFSIZE 4194304
+
+/* Space in front of the data of each buffer for the carried over
+ * remainder of a record, enough for any miniSEED 2 record */
+#define LM_READAHEAD_HEADROOM MAXRECLENv2
+
+/* Buffer of the read-ahead ring */
+typedef struct LMReadAheadBuffer
+{
+  char *start; /* Allocation, headroom followed by data */
+  int length;  /* Length of data */
+  int offset;  /* Offset of data not yet consumed */
+  int eof;     /* End of input follows the data */
+  int error;   /* Reading the data failed */
+} LMReadAheadBuffer;
+
+#define LM_READAHEAD_DATA(BUFFER) ((BUFFER)->start + LM_READAHEAD_HEADROOM)
+
+struct LMReadAhead
+{
+  LMIO *input;   /* Input read by the helper thread */
+  int64_t limit; /* Bytes remaining to read, -1 when unlimited */
+  int nocache;   /* Drop input from the page cache once read */
+  LMReadAheadBuffer ring[LM_READAHEAD_BUFFERS];
+  int widx;  /* Next buffer filled by the helper thread */
+  int ridx;  /* Next buffer taken by the parser */
+  int ready; /* Buffers filled and not yet taken */
+  int held;  /* Buffers filled and not yet released */
+  int stop;  /* Request for the helper thread to stop */
+  lmp_thread_t thread;
+  lmp_mutex_t lock;
+  lmp_cond_t cond;
+
+  /* State of the parsing thread */
+  LMReadAheadBuffer *source; /* Buffer being consumed */
+  char *ownbuffer;           /* Read buffer of the stream */
+  int eof;                   /* All input has been consumed */
+};
+
+/* Helper thread, fill buffers of the ring in order until the end of the
+ * input, an error, or a request to stop */
+static void *
+readahead_thread (void *arg)
+{
+  LMReadAhead *ra = (LMReadAhead *)arg;
+  LMReadAheadBuffer *buffer;
+  int64_t readcount;
+  size_t readsize;
+  int done = 0;
+
+  while (!done)
+  {
+    lmp_mutex_lock (&ra->lock);
+    while (ra->held == LM_READAHEAD_BUFFERS && !ra->stop)
+      lmp_cond_wait (&ra->cond, &ra->lock);
+
+    if (ra->stop)
+    {
+      lmp_mutex_unlock (&ra->lock);
+      break;
+    }
+
+    buffer = &ra->ring[ra->widx];
+    lmp_mutex_unlock (&ra->lock);
+
+    buffer->length = 0;
+    buffer->offset = 0;
+    buffer->eof = 0;
+    buffer->error = 0;
+
+    while (buffer->length < LM_READAHEAD_BUFSIZE)
+    {
+      readsize = LM_READAHEAD_BUFSIZE - buffer->length;
+
+      if (ra->limit >= 0 && (int64_t)readsize > ra->limit)
+        readsize = (size_t)ra->limit;
+
+      if (readsize == 0)
+      {
+        buffer->eof = 1;
+        break;
+      }
+
+      readcount = msio_fread (ra->input, LM_READAHEAD_DATA (buffer) + buffer->length, readsize);
+
+      if (ra->nocache)
+        msio_dropcache (ra->input, (readcount > 0) ? readcount : 0);
+
+      if (readcount <= 0)
+      {
+        if (msio_feof (ra->input))
+          buffer->eof = 1;
+        else
+          buffer->error = 1;
+        break;
+      }
+
+      buffer->length += (int)readcount;
+
+      if (ra->limit >= 0)
+        ra->limit -= readcount;
+    }
+
+    done = (buffer->eof || buffer->error);
+
+    lmp_mutex_lock (&ra->lock);
+    ra->widx = (ra->widx + 1) % LM_READAHEAD_BUFFERS;
+    ra->ready++;
+    ra->held++;
+    lmp_cond_broadcast (&ra->cond);
+    lmp_mutex_unlock (&ra->lock);
+  }
+
+  return NULL;
+} /* End of readahead_thread() */
+
+/***************************************************************************
+ * Start reading the input of a stream ahead of parsing.  The input must
+ * be open and the read buffer of the stream allocated, reading starts at
+ * the current position of the input and continues to the end offset of
+ * the stream, if known.  With MSF_NOCACHE in flags the input is dropped
+ * from the page cache as it is read.
+ *
+ * Returns 0 on success and -1 when read-ahead is not possible, leaving
+ * the stream to be read without it.
+ ***************************************************************************/
+int
+lm_readahead_start (MS3FileParam *msfp, uint32_t flags)
+{
+  LMReader *reader;
+  LMReadAhead *ra;
+  int idx;
+
+  if (!msfp || !msfp->input.handle || !msfp->readbuffer || LM_READAHEAD (msfp))
+    return -1;
+
+  /* A prefetched URL transfer is driven by the thread that started it,
+   * and a prefetched file is already in memory */
+  if (msfp->input.type == LMIO_URLTRANSFER || msfp->input.type == LMIO_BUFFER)
+    return -1;
+
+  if (!(reader = lm_reader (msfp)))
+    return -1;
+
+  if (!(ra = (LMReadAhead *)lm_memory ()->malloc (sizeof (LMReadAhead))))
+    return -1;
+
+  memset (ra, 0, sizeof (LMReadAhead));
+  ra->input = &msfp->input;
+  ra->ownbuffer = msfp->readbuffer;
+  ra->limit = -1;
+  ra->nocache = (flags & MSF_NOCACHE) ? 1 : 0;
+
+  /* Do not read beyond a known end offset, as for reading without read-ahead */
+  if (msfp->endoffset && msfp->input.type != LMIO_URL)
+  {
+    ra->limit = msfp->endoffset - msfp->streampos + 1;
+
+    if (ra->limit < 0)
+      ra->limit = 0;
+  }
+
+  for (idx = 0; idx < LM_READAHEAD_BUFFERS; idx++)
+  {
+    ra->ring[idx].start =
+        (char *)lm_memory ()->malloc (LM_READAHEAD_HEADROOM + LM_READAHEAD_BUFSIZE);
+
+    if (!ra->ring[idx].start)
+      break;
+  }
+
+  if (idx < LM_READAHEAD_BUFFERS || lmp_mutex_init (&ra->lock))
+  {
+    while (idx-- > 0)
+      lm_memory ()->free (ra->ring[idx].start);
+    lm_memory ()->free (ra);
+    return -1;
+  }
+
+  if (lmp_cond_init (&ra->cond))
+  {
+    lmp_mutex_destroy (&ra->lock);
+    for (idx = 0; idx < LM_READAHEAD_BUFFERS; idx++)
+      lm_memory ()->free (ra->ring[idx].start);
+    lm_memory ()->free (ra);
+    return -1;
+  }
+
+  if (lmp_thread_create (&ra->thread, readahead_thread, ra))
+  {
+    lmp_cond_destroy (&ra->cond);
+    lmp_mutex_destroy (&ra->lock);
+    for (idx = 0; idx < LM_READAHEAD_BUFFERS; idx++)
+      lm_memory ()->free (ra->ring[idx].start);
+    lm_memory ()->free (ra);
+    return -1;
+  }
+
+  reader->readahead = ra;
+
+  return 0;
+} /* End of lm_readahead_start() */
+
+/***************************************************************************
+ * Add data from the read-ahead ring to the read buffer of a stream,
+ * keeping the unprocessed data in the buffer.
+ *
+ * When the next buffer of the ring is taken, the unprocessed data is
+ * copied into the space in front of its data and the read buffer of the
+ * stream is pointed at it.  Unprocessed data that does not fit, a large
+ * record straddling buffers, is assembled in the stream's own buffer.
+ *
+ * Returns the number of bytes added, 0 at the end of input and -1 on a
+ * read error.
+ ***************************************************************************/
+int
+lm_readahead_fill (MS3FileParam *msfp)
+{
+  LMReadAhead *ra = LM_READAHEAD (msfp);
+  LMReadAheadBuffer *previous = NULL;
+  LMReadAheadBuffer *source;
+  char *remainder = msfp->readbuffer + msfp->readoffset;
+  int remaining = msfp->readlength - msfp->readoffset;
+  int available;
+  int count;
+
+  if (ra->eof)
+    return 0;
+
+  if (ra->source && ra->source->error)
+    return -1;
+
+  /* Take the next buffer from the ring when the current one is consumed */
+  if (!ra->source || ra->source->offset >= ra->source->length)
+  {
+    lmp_mutex_lock (&ra->lock);
+    while (ra->ready == 0)
+      lmp_cond_wait (&ra->cond, &ra->lock);
+
+    previous = ra->source;
+    ra->source = &ra->ring[ra->ridx];
+    ra->ridx = (ra->ridx + 1) % LM_READAHEAD_BUFFERS;
+    ra->ready--;
+    lmp_mutex_unlock (&ra->lock);
+  }
+
+  source = ra->source;
+  available = source->length - source->offset;
+
+  /* Carry the unprocessed data over to the front of the new data */
+  if (remaining <= LM_READAHEAD_HEADROOM + source->offset)
+  {
+    char *data = LM_READAHEAD_DATA (source) + source->offset;
+
+    if (remaining > 0)
+      memmove (data - remaining, remainder, remaining);
+
+    msfp->readbuffer = data - remaining;
+    msfp->readlength = remaining + available;
+    msfp->readoffset = 0;
+
+    count = available;
+  }
+  /* Otherwise assemble the data in the stream's own buffer */
+  else
+  {
+    if (remainder != ra->ownbuffer)
+      memmove (ra->ownbuffer, remainder, remaining);
+
+    count = MAXRECLEN - remaining;
+    if (count > available)
+      count = available;
+
+    memcpy (ra->ownbuffer + remaining, LM_READAHEAD_DATA (source) + source->offset, count);
+
+    msfp->readbuffer = ra->ownbuffer;
+    msfp->readlength = remaining + count;
+    msfp->readoffset = 0;
+  }
+
+  source->offset += count;
+
+  if (source->eof && source->offset >= source->length)
+    ra->eof = 1;
+
+  /* Release the previous buffer, its data is no longer referenced */
+  if (previous)
+  {
+    lmp_mutex_lock (&ra->lock);
+    ra->held--;
+    lmp_cond_broadcast (&ra->cond);
+    lmp_mutex_unlock (&ra->lock);
+  }
+
+  return count;
+} /* End of lm_readahead_fill() */
+
+/***************************************************************************
+ * Return non-zero when all input of a stream read ahead has been added
+ * to the read buffer, the equivalent of msio_feof() for the input.
+ ***************************************************************************/
+int
+lm_readahead_eof (MS3FileParam *msfp)
+{
+  return LM_READAHEAD (msfp)->eof;
+} /* End of lm_readahead_eof() */
+
+/***************************************************************************
+ * Stop reading ahead, wait for the helper thread and release the ring.
+ * The read buffer of the stream is restored to its own buffer, the
+ * unprocessed data is not preserved.
+ ***************************************************************************/
+void
+lm_readahead_stop (MS3FileParam *msfp)
+{
+  LMReadAhead *ra;
+  int idx;
+
+  if (!msfp || !(ra = LM_READAHEAD (msfp)))
+    return;
+
+  lmp_mutex_lock (&ra->lock);
+  ra->stop = 1;
+  lmp_cond_broadcast (&ra->cond);
+  lmp_mutex_unlock (&ra->lock);
+
+  lmp_thread_join (ra->thread);
+
+  lmp_cond_destroy (&ra->cond);
+  lmp_mutex_destroy (&ra->lock);
+
+  for (idx = 0; idx < LM_READAHEAD_BUFFERS; idx++)
+    lm_memory ()->free (ra->ring[idx].start);
+
+  msfp->readbuffer = ra->ownbuffer;
+  msfp->readlength = 0;
+  msfp->readoffset = 0;
+  ((LMReader *)msfp->reader)->readahead = NULL;
+
+  lm_memory ()->free (ra);
+} /* End of lm_readahead_stop() */
@@ -24,6 +24,7 @@
 #include <string.h>
 #include <time.h>
 
+#include "internalstate.h"
 #include "libmseed.h"
 
 static int ms_isinteger (const char *string);
@@ -204,7 +205,7 @@ ms3_addselect (MS3Selections **ppselections, const char *sidpattern, nstime_t st
   }
 
   /* Allocate new SelectTime and populate */
-  if (!(newst = (MS3SelectTime *)libmseed_memory.malloc (sizeof (MS3SelectTime))))
+  if (!(newst = (MS3SelectTime *)lm_memory ()->malloc (sizeof (MS3SelectTime))))
   {
     ms_log (2, "Cannot allocate memory\n");
     return -1;
@@ -218,10 +219,10 @@ ms3_addselect (MS3Selections **ppselections, const char *sidpattern, nstime_t st
   if (!*ppselections)
   {
     /* Allocate new Selections and populate */
-    if (!(newsl = (MS3Selections *)libmseed_memory.malloc (sizeof (MS3Selections))))
+    if (!(newsl = (MS3Selections *)lm_memory ()->malloc (sizeof (MS3Selections))))
     {
       ms_log (2, "Cannot allocate memory\n");
-      libmseed_memory.free (newst);
+      lm_memory ()->free (newst);
       return -1;
     }
     memset (newsl, 0, sizeof (MS3Selections));
@@ -260,10 +261,10 @@ ms3_addselect (MS3Selections **ppselections, const char *sidpattern, nstime_t st
     else
     {
       /* Allocate new MS3Selections and populate */
-      if (!(newsl = (MS3Selections *)libmseed_memory.malloc (sizeof (MS3Selections))))
+      if (!(newsl = (MS3Selections *)lm_memory ()->malloc (sizeof (MS3Selections))))
       {
         ms_log (2, "Cannot allocate memory\n");
-        libmseed_memory.free (newst);
+        lm_memory ()->free (newst);
         return -1;
       }
       memset (newsl, 0, sizeof (MS3Selections));
@@ -739,12 +740,12 @@ ms3_freeselections (MS3Selections *selections)
       {
         selecttimenext = selecttime->next;
 
-        libmseed_memory.free (selecttime);
+        lm_memory ()->free (selecttime);
 
         selecttime = selecttimenext;
       }
 
-      libmseed_memory.free (select);
+      lm_memory ()->free (select);
 
       select = selectnext;
     }
@@ -0,0 +1,435 @@
+/***************************************************************************
+ * Source identifier interning.
+ *
+ * Each distinct source identifier (SID) is assigned a small integer
+ * handle, starting at 1, the first time it is interned.  Handles are
+ * stable for the life of the process and shared by all threads and
+ * library contexts, allowing SIDs to be compared and used as array
+ * indexes as integers.  Data derived from a SID, such as the split
+ * network, station, location and channel codes, is computed once and
+ * cached with the entry.
+ *
+ * Lookups of interned SIDs do not lock, only adding a SID is serialized.
+ * Entries and hash tables are published with atomic stores and never
+ * change or move once visible to other threads.
+ *
+ * Entries are never removed, as their handles are valid in all threads
+ * for the life of the process.  For the same reason the table is
+ * allocated with the memory management functions of the default
+ * context, not those of a library context, so that it is unaffected by
+ * a context being freed or its arena reset.  Data structures that only
+ * need to find SIDs, such as the index of a trace list, keep their own
+ * table that is freed with them.
+ *
+ * This file is part of the miniSEED Library.
+ *
+ * Copyright (c) 2026 Chad Trabant, EarthScope Data Services
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "internalstate.h"
+#include "threadutils.h"
+
+/* Handles are mapped to entries through chunks of entry pointers that
+ * are never moved.  Each chunk is twice the size of the previous one,
+ * the first of LM_SIDCHUNKSIZE entries, so that LM_SIDCHUNKS chunks
+ * cover all handles. */
+#define LM_SIDCHUNKSIZE 1024
+#define LM_SIDCHUNKS 22
+
+/* Initial size of the hash table, a power of two */
+#define LM_SIDHASHSIZE 256
+
+/* States of the cached network, station, location and channel codes */
+#define LM_NSLC_UNKNOWN 0
+#define LM_NSLC_VALID 1
+#define LM_NSLC_INVALID 2
+
+typedef struct LMSIDEntry
+{
+  uint32_t handle;
+  uint32_t hash;
+  uint32_t nslcstate; /* Set once with the codes, while holding the lock */
+  char sid[LM_SIDLEN];
+  char net[LM_SIDLEN];
+  char sta[LM_SIDLEN];
+  char loc[LM_SIDLEN];
+  char chan[LM_SIDLEN];
+} LMSIDEntry;
+
+/* Open addressing hash table of entries.  A table replaced by a larger
+ * one is retained, as it may still be searched by other threads, and
+ * linked from its replacement. */
+typedef struct LMSIDHash
+{
+  uint32_t size; /* Number of slots, a power of two */
+  struct LMSIDHash *previous;
+  LMSIDEntry *slot[];
+} LMSIDHash;
+
+static lmp_staticmutex_t sidlock = LMP_STATICMUTEX_INITIALIZER;
+
+static LMSIDHash *sidhash = NULL; /* Current hash table, read without the lock */
+static uint32_t sidcount = 0;     /* Number of interned SIDs, also the last handle */
+
+static LMSIDEntry **sidchunks[LM_SIDCHUNKS];
+
+/* Last entry interned, and last entry with valid codes returned, by each
+ * thread, runs of the same SID are common. */
+static lm_thread_local LMSIDEntry *lastentry = NULL;
+static lm_thread_local LMSIDEntry *lastnslcentry = NULL;
+
+/* Search a hash table for a SID, may be called without the lock.
+ * Returns the entry or NULL if not found. */
+static LMSIDEntry *
+lm_sid_search (LMSIDHash *table, const char *sid, uint32_t hash)
+{
+  LMSIDEntry *entry;
+  uint32_t slot;
+
+  if (!table)
+    return NULL;
+
+  slot = hash & (table->size - 1);
+  while ((entry = (LMSIDEntry *)lmp_atomic_loadptr ((void *const *)&table->slot[slot])))
+  {
+    if (entry->hash == hash && !strcmp (entry->sid, sid))
+      return entry;
+
+    slot = (slot + 1) & (table->size - 1);
+  }
+
+  return NULL;
+}
+
+/* Insert an entry into a hash table, called with the lock held */
+static void
+lm_sid_insert (LMSIDHash *table, LMSIDEntry *entry)
+{
+  uint32_t slot = entry->hash & (table->size - 1);
+
+  while (table->slot[slot])
+    slot = (slot + 1) & (table->size - 1);
+
+  lmp_atomic_storeptr ((void **)&table->slot[slot], entry);
+}
+
+/* Replace the hash table with one of double the size, called with the
+ * lock held.  Returns 0 on success and -1 on error. */
+static int
+lm_sid_growhash (void)
+{
+  LMSIDHash *newhash;
+  uint32_t newsize = (sidhash) ? sidhash->size * 2 : LM_SIDHASHSIZE;
+  uint32_t idx;
+
+  if (sidhash && newsize <= sidhash->size)
+    return -1;
+
+  if (!(newhash = (LMSIDHash *)libmseed_memory.malloc (sizeof (LMSIDHash) +
+                                                       sizeof (LMSIDEntry *) * newsize)))
+    return -1;
+
+  memset (newhash, 0, sizeof (LMSIDHash) + sizeof (LMSIDEntry *) * newsize);
+  newhash->size = newsize;
+  newhash->previous = sidhash;
+
+  for (idx = 0; sidhash && idx < sidhash->size; idx++)
+  {
+    if (sidhash->slot[idx])
+      lm_sid_insert (newhash, sidhash->slot[idx]);
+  }
+
+  lmp_atomic_storeptr ((void **)&sidhash, newhash);
+
+  return 0;
+}
+
+/* Locate the chunk and offset within it of a zero-based entry index */
+static void
+lm_sid_chunk (uint32_t index, uint32_t *chunk, uint32_t *offset)
+{
+  uint32_t size = LM_SIDCHUNKSIZE;
+
+  *chunk = 0;
+  while (index >= size)
+  {
+    index -= size;
+    size *= 2;
+    *chunk += 1;
+  }
+
+  *offset = index;
+}
+
+/* Return the entry for a handle or NULL if not a valid handle, may be
+ * called without the lock */
+static LMSIDEntry *
+lm_sid_entry (uint32_t handle)
+{
+  uint32_t chunk;
+  uint32_t offset;
+
+  if (handle == 0 || handle > lmp_atomic_load32 (&sidcount))
+    return NULL;
+
+  lm_sid_chunk (handle - 1, &chunk, &offset);
+
+  return sidchunks[chunk][offset];
+}
+
+/***************************************************************************
+ * Intern a source identifier, errors are logged if @p logerrors is
+ * non-zero.
+ *
+ * Returns the handle for the SID, or 0 on error.
+ ***************************************************************************/
+static uint32_t
+sid_intern (const char *sid, int logerrors)
+{
+  LMSIDEntry *entry = lastentry;
+  uint32_t hash;
+  uint32_t index;
+  uint32_t chunk;
+  uint32_t offset;
+
+  if (!sid)
+  {
+    if (logerrors)
+      ms_log (2, "ms_sid_intern(): Required input not defined: 'sid'\n");
+    return 0;
+  }
+
+  if (entry && !strcmp (entry->sid, sid))
+    return entry->handle;
+
+  if (strlen (sid) >= LM_SIDLEN)
+  {
+    if (logerrors)
+      ms_log (2, "ms_sid_intern(): Source identifier is too long: %s\n", sid);
+    return 0;
+  }
+
+  hash = lm_sid_hash (sid);
+
+  /* Search for existing entry without the lock */
+  if ((entry = lm_sid_search ((LMSIDHash *)lmp_atomic_loadptr ((void *const *)&sidhash), sid,
+                              hash)))
+  {
+    lastentry = entry;
+    return entry->handle;
+  }
+
+  lmp_staticmutex_lock (&sidlock);
+
+  /* Search again, the entry may have been added by another thread */
+  if ((entry = lm_sid_search (sidhash, sid, hash)))
+  {
+    lmp_staticmutex_unlock (&sidlock);
+    lastentry = entry;
+    return entry->handle;
+  }
+
+  /* Add new entry, keeping the hash table at most half full */
+  index = sidcount;
+  lm_sid_chunk (index, &chunk, &offset);
+
+  if (chunk >= LM_SIDCHUNKS)
+  {
+    lmp_staticmutex_unlock (&sidlock);
+    if (logerrors)
+      ms_log (2, "ms_sid_intern(): Maximum number of interned source identifiers reached\n");
+    return 0;
+  }
+
+  if ((!sidhash || (sidcount + 1) * 2 > sidhash->size) && lm_sid_growhash ())
+  {
+    lmp_staticmutex_unlock (&sidlock);
+    if (logerrors)
+      ms_log (2, "ms_sid_intern(): Cannot allocate memory\n");
+    return 0;
+  }
+
+  if (!sidchunks[chunk])
+  {
+    if (!(sidchunks[chunk] = (LMSIDEntry **)libmseed_memory.malloc (
+              sizeof (LMSIDEntry *) * ((size_t)LM_SIDCHUNKSIZE << chunk))))
+    {
+      lmp_staticmutex_unlock (&sidlock);
+      if (logerrors)
+        ms_log (2, "ms_sid_intern(): Cannot allocate memory\n");
+      return 0;
+    }
+  }
+
+  if (!(entry = (LMSIDEntry *)libmseed_memory.malloc (sizeof (LMSIDEntry))))
+  {
+    lmp_staticmutex_unlock (&sidlock);
+    if (logerrors)
+      ms_log (2, "ms_sid_intern(): Cannot allocate memory\n");
+    return 0;
+  }
+
+  memset (entry, 0, sizeof (LMSIDEntry));
+  entry->handle = index + 1;
+  entry->hash = hash;
+  entry->nslcstate = LM_NSLC_UNKNOWN;
+  strcpy (entry->sid, sid);
+
+  /* Publish the entry by handle, then by SID */
+  sidchunks[chunk][offset] = entry;
+  lmp_atomic_store32 (&sidcount, sidcount + 1);
+
+  lm_sid_insert (sidhash, entry);
+
+  lmp_staticmutex_unlock (&sidlock);
+
+  lastentry = entry;
+
+  return entry->handle;
+} /* End of sid_intern() */
+
+/** ************************************************************************
+ * @brief Intern a source identifier, returning its handle
+ *
+ * Each distinct source identifier (SID) is assigned a small integer
+ * handle the first time it is interned, subsequent calls for the same
+ * SID return the same handle.  Handles start at 1, are assigned
+ * consecutively, and are valid for the life of the process in all
+ * threads.  Two SIDs are equal if and only if their handles are equal.
+ *
+ * The SID string can be retrieved with ms_sid_interned() and the split
+ * codes with ms_sid2nslc_interned().
+ *
+ * This function is thread-safe.  Only the first call for each SID
+ * acquires a lock.
+ *
+ * @param[in] sid Source identifier to intern
+ *
+ * @returns the handle for the SID, or 0 on error.
+ *
+ * @ref MessageOnError - this function logs a message on error
+ ***************************************************************************/
+uint32_t
+ms_sid_intern (const char *sid)
+{
+  return sid_intern (sid, 1);
+} /* End of ms_sid_intern() */
+
+/***************************************************************************
+ * Intern a source identifier without logging errors, for callers that
+ * handle identifiers that cannot be interned.
+ *
+ * Returns the handle for the SID, or 0 on error.
+ ***************************************************************************/
+uint32_t
+lm_sid_intern (const char *sid)
+{
+  return sid_intern (sid, 0);
+} /* End of lm_sid_intern() */
+
+/** ************************************************************************
+ * @brief Return the source identifier for an interned SID handle
+ *
+ * @param[in] handle SID handle returned by ms_sid_intern()
+ *
+ * @returns the source identifier, valid for the life of the process, or
+ * NULL if the handle is not valid.
+ ***************************************************************************/
+const char *
+ms_sid_interned (uint32_t handle)
+{
+  LMSIDEntry *entry = lm_sid_entry (handle);
+
+  return (entry) ? entry->sid : NULL;
+} /* End of ms_sid_interned() */
+
+/** ************************************************************************
+ * @brief Return the network, station, location and channel codes of an
+ * interned SID handle
+ *
+ * The codes are parsed with ms_sid2nslc_n() once per SID and cached.
+ * Each of @p net, @p sta, @p loc and @p chan may be NULL if the code is
+ * not needed, otherwise it is set to a string valid for the life of the
+ * process.
+ *
+ * This function is thread-safe.
+ *
+ * @param[in] handle SID handle returned by ms_sid_intern()
+ * @param[out] net Network code
+ * @param[out] sta Station code
+ * @param[out] loc Location code
+ * @param[out] chan Channel code
+ *
+ * @retval 0 on success
+ * @retval -1 on error, invalid handle or SID that cannot be parsed
+ *
+ * @ref MessageOnError - this function logs a message on error
+ *
+ * @see ms_sid2nslc_n()
+ ***************************************************************************/
+int
+ms_sid2nslc_interned (uint32_t handle, const char **net, const char **sta, const char **loc,
+                      const char **chan)
+{
+  LMSIDEntry *entry = lastnslcentry;
+  uint32_t nslcstate;
+
+  if (!entry || entry->handle != handle)
+  {
+    if (!(entry = lm_sid_entry (handle)))
+    {
+      ms_log (2, "%s(): Invalid SID handle: %u\n", __func__, handle);
+      return -1;
+    }
+
+    /* Parse the codes once, published with the state */
+    if ((nslcstate = lmp_atomic_load32 (&entry->nslcstate)) == LM_NSLC_UNKNOWN)
+    {
+      lmp_staticmutex_lock (&sidlock);
+
+      if ((nslcstate = entry->nslcstate) == LM_NSLC_UNKNOWN)
+      {
+        nslcstate = (ms_sid2nslc_n (entry->sid, entry->net, sizeof (entry->net), entry->sta,
+                                    sizeof (entry->sta), entry->loc, sizeof (entry->loc),
+                                    entry->chan, sizeof (entry->chan)))
+                        ? LM_NSLC_INVALID
+                        : LM_NSLC_VALID;
+
+        lmp_atomic_store32 (&entry->nslcstate, nslcstate);
+      }
+
+      lmp_staticmutex_unlock (&sidlock);
+    }
+
+    if (nslcstate != LM_NSLC_VALID)
+      return -1;
+
+    lastnslcentry = entry;
+  }
+
+  if (net)
+    *net = entry->net;
+  if (sta)
+    *sta = entry->sta;
+  if (loc)
+    *loc = entry->loc;
+  if (chan)
+    *chan = entry->chan;
+
+  return 0;
+} /* End of ms_sid2nslc_interned() */
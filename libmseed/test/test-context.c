@@ -0,0 +1,414 @@
+#include <tau/tau.h>
+#include <libmseed.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TESTFILE_CONTEXT_LEAPSECONDS "testdata-context-leapseconds"
+
+/* Allocation counters for the memory management functions of a context,
+ * only checked when used by a single thread, and a flag set by the
+ * global functions */
+static int context_mallocs = 0;
+static int context_frees = 0;
+static int global_used = 0;
+
+static void *
+context_malloc (size_t size)
+{
+  context_mallocs++;
+  return malloc (size);
+}
+
+static void *
+context_realloc (void *ptr, size_t size)
+{
+  if (!ptr)
+    context_mallocs++;
+  return realloc (ptr, size);
+}
+
+static void
+context_free (void *ptr)
+{
+  if (ptr)
+    context_frees++;
+  free (ptr);
+}
+
+static void *
+global_malloc (size_t size)
+{
+  global_used = 1;
+  return malloc (size);
+}
+
+static void *
+global_realloc (void *ptr, size_t size)
+{
+  global_used = 1;
+  return realloc (ptr, size);
+}
+
+static void
+global_free (void *ptr)
+{
+  global_used = 1;
+  free (ptr);
+}
+
+static void *
+failing_malloc (size_t size)
+{
+  (void)size;
+  return NULL;
+}
+
+static void
+record_handler (char *record, int reclen, void *handlerdata)
+{
+  (void)record;
+  (void)reclen;
+  (*(int *)handlerdata) += 1;
+}
+
+TEST (context, bind)
+{
+  LMContext *ctx = ms_context_create ();
+  REQUIRE (ctx != NULL, "ms_context_create() returned unexpected NULL");
+
+  CHECK (ms_context_current () == NULL, "Default context is not NULL");
+  CHECK (ms_context_bind (ctx) == NULL, "ms_context_bind() did not return previous context");
+  CHECK (ms_context_current () == ctx, "ms_context_current() did not return bound context");
+
+  /* Freeing a bound context reverts the thread to the default */
+  ms_context_free (&ctx);
+  CHECK (ctx == NULL, "ms_context_free() did not reset pointer");
+  CHECK (ms_context_current () == NULL, "Thread did not revert to default context");
+
+  CHECK (ms_context_setmemory (NULL, NULL, 0) == -1,
+         "ms_context_setmemory() accepted NULL context");
+}
+
+TEST (context, logging)
+{
+  LMContext *ctx1 = ms_context_create ();
+  LMContext *ctx2 = ms_context_create ();
+  char message[200];
+
+  REQUIRE (ctx1 != NULL && ctx2 != NULL, "ms_context_create() returned unexpected NULL");
+
+  /* Accumulate a message in the registry of the first context */
+  ms_context_bind (ctx1);
+  ms_rloginit (NULL, NULL, NULL, NULL, 10);
+  ms_log (2, "Context message");
+
+  /* Registries of the default and other context are independent */
+  ms_context_bind (NULL);
+  CHECK (ms_rlog_pop (NULL, message, sizeof (message), 0) == 0, "Default registry not empty");
+
+  ms_context_bind (ctx2);
+  CHECK (ms_rlog_pop (NULL, message, sizeof (message), 0) == 0, "Second registry not empty");
+
+  ms_context_bind (ctx1);
+  CHECK (ms_rlog_pop (NULL, message, sizeof (message), 0) > 0, "Context registry is empty");
+  CHECK_STREQ (message, "Error: Context message");
+
+  ms_log (2, "Freed with context");
+  ms_context_free (&ctx1);
+  ms_context_free (&ctx2);
+}
+
+TEST (context, leapseconds)
+{
+  LMContext *ctx1 = ms_context_create ();
+  LMContext *ctx2 = ms_context_create ();
+  nstime_t start = ms_timestr2nstime ("2029-12-31T23:59:59Z");
+  FILE *fp;
+
+  REQUIRE (ctx1 != NULL && ctx2 != NULL, "ms_context_create() returned unexpected NULL");
+
+  /* Leap second file with a single, fictional leap second at 2030-01-01 */
+  fp = fopen (TESTFILE_CONTEXT_LEAPSECONDS, "w");
+  REQUIRE (fp != NULL, "Failed to open leap second file");
+  fprintf (fp, "# Test leap seconds\n4102444800\t38\n");
+  fclose (fp);
+
+  ms_context_bind (ctx1);
+  CHECK (ms_readleapsecondfile (TESTFILE_CONTEXT_LEAPSECONDS) == 1,
+         "ms_readleapsecondfile() returned unexpected value");
+  CHECK (ms_sampletime (start, 2, 1.0) == start + NSTMODULUS, "Leap second not applied");
+
+  ms_context_bind (ctx2);
+  CHECK (ms_sampletime (start, 2, 1.0) == start + 2 * NSTMODULUS,
+         "Leap second applied to other context");
+
+  ms_context_bind (NULL);
+  CHECK (ms_sampletime (start, 2, 1.0) == start + 2 * NSTMODULUS,
+         "Leap second applied to default context");
+
+  ms_context_free (&ctx1);
+  ms_context_free (&ctx2);
+}
+
+TEST (context, memory)
+{
+  LIBMSEED_MEMORY counting = {context_malloc, context_realloc, context_free};
+  LIBMSEED_MEMORY global = {global_malloc, global_realloc, global_free};
+  LIBMSEED_MEMORY saved = libmseed_memory;
+  LMContext *ctx = ms_context_create ();
+  MS3Record *msr = NULL;
+
+  REQUIRE (ctx != NULL, "ms_context_create() returned unexpected NULL");
+  REQUIRE (ms_context_setmemory (ctx, &counting, 0) == 0, "ms_context_setmemory() failed");
+
+  context_mallocs = 0;
+  context_frees = 0;
+  global_used = 0;
+  libmseed_memory = global;
+
+  ms_context_bind (ctx);
+  msr = msr3_init (NULL);
+  REQUIRE (msr != NULL, "msr3_init() returned unexpected NULL");
+  msr3_free (&msr);
+  ms_context_bind (NULL);
+
+  libmseed_memory = saved;
+
+  CHECK (context_mallocs > 0, "Context allocator not used");
+  CHECK (context_mallocs == context_frees, "Context allocations not balanced");
+  CHECK (global_used == 0, "Global allocator used with bound context");
+
+  ms_context_free (&ctx);
+}
+
+/* Library worker threads inherit the context of the calling thread */
+TEST (context, worker_threads)
+{
+  LIBMSEED_MEMORY counting = {context_malloc, context_realloc, context_free};
+  LIBMSEED_MEMORY global = {global_malloc, global_realloc, global_free};
+  LIBMSEED_MEMORY saved = libmseed_memory;
+  MS3Record msr = MS3Record_INITIALIZER;
+  LMContext *ctx = ms_context_create ();
+  MS3TraceList *mstl = NULL;
+  int32_t data[2000];
+  char sid[LM_SIDLEN];
+  int64_t packedsamples = 0;
+  int64_t rv;
+  int records = 0;
+
+  REQUIRE (ctx != NULL, "ms_context_create() returned unexpected NULL");
+  REQUIRE (ms_context_setmemory (ctx, &counting, 0) == 0, "ms_context_setmemory() failed");
+
+  for (int idx = 0; idx < 2000; idx++)
+    data[idx] = (idx * 37) % 1000 - 500;
+
+  ms_context_bind (ctx);
+
+  mstl = mstl3_init (NULL);
+  REQUIRE (mstl != NULL, "mstl3_init() returned unexpected NULL");
+
+  msr.pubversion = 1;
+  msr.datasamples = data;
+  msr.sampletype = 'i';
+  msr.samprate = 100.0;
+  msr.starttime = ms_timestr2nstime ("2012-05-12T00:00:00Z");
+  msr.numsamples = 2000;
+  msr.samplecnt = msr.numsamples;
+
+  for (int trace = 0; trace < 8; trace++)
+  {
+    snprintf (sid, sizeof (sid), "FDSN:XX_TEST_%02d_H_H_Z", trace);
+    strcpy (msr.sid, sid);
+    REQUIRE (mstl3_addmsr (mstl, &msr, 0, 1, 0, NULL) != NULL, "mstl3_addmsr() failed");
+  }
+
+  global_used = 0;
+  libmseed_memory = global;
+
+  rv = mstl3_pack_parallel (mstl, record_handler, &records, 512, DE_STEIM2, &packedsamples,
+                            MSF_FLUSHDATA, 0, NULL, 4);
+
+  libmseed_memory = saved;
+
+  CHECK (rv > 0 && rv == records, "mstl3_pack_parallel() returned unexpected value");
+  CHECK (packedsamples == 8 * 2000, "Packed samples mismatch");
+  CHECK (global_used == 0, "Global allocator used by worker threads");
+
+  mstl3_free (&mstl, 0);
+  ms_context_bind (NULL);
+  ms_context_free (&ctx);
+}
+
+/* Sum of sample counts and segment count of a trace list */
+static int64_t
+tracelist_samples (MS3TraceList *mstl, int *segments)
+{
+  MS3TraceID *id;
+  MS3TraceSeg *seg;
+  int64_t samples = 0;
+
+  *segments = 0;
+  for (id = mstl->traces.next[0]; id; id = id->next[0])
+    for (seg = id->first; seg; seg = seg->next)
+    {
+      samples += seg->numsamples;
+      *segments += 1;
+    }
+
+  return samples;
+}
+
+TEST (context, arena)
+{
+  LMContext *ctx = ms_context_create ();
+  MS3TraceList *mstl = NULL;
+  MS3Record *msr = NULL;
+  void *first;
+  char *path = "data/testdata-3channel-signal.mseed3";
+  int64_t samples;
+  int64_t arenasamples;
+  int segments;
+  int arenasegments;
+
+  REQUIRE (ctx != NULL, "ms_context_create() returned unexpected NULL");
+  CHECK (ms_context_setarena (NULL, 0) == -1, "ms_context_setarena() accepted NULL context");
+  REQUIRE (ms_context_setarena (ctx, 65536) == 0, "ms_context_setarena() failed");
+  CHECK (ms_context_setarena (ctx, 0) == -1, "ms_context_setarena() accepted second arena");
+
+  /* Reference trace list with the default memory management functions */
+  REQUIRE (ms3_readtracelist (&mstl, path, NULL, 0, MSF_UNPACKDATA, 0) == MS_NOERROR,
+           "ms3_readtracelist() failed");
+  samples = tracelist_samples (mstl, &segments);
+  mstl3_free (&mstl, 1);
+
+  ms_context_bind (ctx);
+
+  /* Freed small allocations are recycled */
+  first = msr = msr3_init (NULL);
+  REQUIRE (msr != NULL, "msr3_init() returned unexpected NULL");
+  msr3_free (&msr);
+  msr = msr3_init (NULL);
+  CHECK (msr == first, "Freed record not reused");
+  msr3_free (&msr);
+
+  /* Read twice, releasing the first trace list with the arena */
+  for (int pass = 0; pass < 2; pass++)
+  {
+    mstl = NULL;
+    REQUIRE (ms3_readtracelist (&mstl, path, NULL, 0, MSF_UNPACKDATA, 0) == MS_NOERROR,
+             "ms3_readtracelist() failed with arena");
+    arenasamples = tracelist_samples (mstl, &arenasegments);
+
+    CHECK (arenasamples == samples, "Sample count mismatch with arena");
+    CHECK (arenasegments == segments, "Segment count mismatch with arena");
+
+    ms_context_resetarena (ctx);
+  }
+
+  ms_context_bind (NULL);
+  ms_context_free (&ctx);
+}
+
+/* The pre-allocation block size of a bound context replaces the global one */
+TEST (context, prealloc)
+{
+  LIBMSEED_MEMORY counting = {context_malloc, context_realloc, context_free};
+  LIBMSEED_MEMORY global = {global_malloc, global_realloc, global_free};
+  LIBMSEED_MEMORY saved = libmseed_memory;
+  size_t savedblocksize = libmseed_prealloc_block_size;
+  LMContext *ctx = ms_context_create ();
+  MS3TraceList *mstl = NULL;
+  char *path = "data/testdata-3channel-signal.mseed3";
+  int64_t samples;
+  int64_t contextsamples;
+  int segments;
+  int contextsegments;
+  int rv;
+
+  REQUIRE (ctx != NULL, "ms_context_create() returned unexpected NULL");
+  REQUIRE (ms_context_setmemory (ctx, &counting, 0) == 0, "ms_context_setmemory() failed");
+
+  /* Reference trace list with the default memory management functions */
+  REQUIRE (ms3_readtracelist (&mstl, path, NULL, 0, MSF_UNPACKDATA | MSF_RECORDLIST, 0) ==
+               MS_NOERROR,
+           "ms3_readtracelist() failed");
+  samples = tracelist_samples (mstl, &segments);
+  mstl3_free (&mstl, 1);
+
+  context_mallocs = 0;
+  context_frees = 0;
+  global_used = 0;
+  libmseed_memory = global;
+  libmseed_prealloc_block_size = 65536;
+
+  ms_context_bind (ctx);
+  rv = ms3_readtracelist (&mstl, path, NULL, 0, MSF_UNPACKDATA | MSF_RECORDLIST, 0);
+  if (rv == MS_NOERROR)
+  {
+    contextsamples = tracelist_samples (mstl, &contextsegments);
+    mstl3_free (&mstl, 1);
+  }
+  ms_context_bind (NULL);
+
+  libmseed_memory = saved;
+  libmseed_prealloc_block_size = savedblocksize;
+
+  REQUIRE (rv == MS_NOERROR, "ms3_readtracelist() failed with context pre-allocation disabled");
+  CHECK (contextsamples == samples, "Sample count mismatch with context");
+  CHECK (contextsegments == segments, "Segment count mismatch with context");
+  CHECK (context_mallocs == context_frees, "Context allocations not balanced");
+  CHECK (global_used == 0, "Global allocator used with bound context");
+
+  ms_context_free (&ctx);
+}
+
+/* miniSEED 2 packing parses the identifier directly if it cannot be interned */
+TEST (context, pack_nointern)
+{
+  LIBMSEED_MEMORY saved = libmseed_memory;
+  LMContext *ctx = ms_context_create ();
+  MS3Record *msr = NULL;
+  int32_t data[100];
+  int64_t packedsamples = 0;
+  char message[200];
+  int records = 0;
+  int messages;
+  int rv;
+
+  REQUIRE (ctx != NULL, "ms_context_create() returned unexpected NULL");
+
+  msr = msr3_init (NULL);
+  REQUIRE (msr != NULL, "msr3_init() returned unexpected NULL");
+
+  for (int idx = 0; idx < 100; idx++)
+    data[idx] = idx;
+
+  strcpy (msr->sid, "FDSN:XX_NOINT_00_B_H_Z");
+  msr->starttime = ms_timestr2nstime ("2026-01-01T00:00:00Z");
+  msr->reclen = 512;
+  msr->encoding = DE_INT32;
+  msr->samprate = 1.0;
+  msr->datasamples = data;
+  msr->sampletype = 'i';
+  msr->numsamples = 100;
+  msr->samplecnt = 100;
+
+  /* Interning allocates with the global functions, packing with the context */
+  libmseed_memory.malloc = failing_malloc;
+  ms_context_bind (ctx);
+  ms_rloginit (NULL, NULL, NULL, NULL, 10);
+  rv = msr3_pack (msr, record_handler, &records, &packedsamples, MSF_FLUSHDATA | MSF_PACKVER2, 0);
+  messages = ms_rlog_pop (NULL, message, sizeof (message), 0);
+  ms_context_bind (NULL);
+  libmseed_memory = saved;
+
+  CHECK (messages == 0, "Error logged for an identifier packed without interning");
+  CHECK (rv == 1 && records == 1, "msr3_pack() did not pack 1 record");
+  CHECK (packedsamples == 100, "msr3_pack() did not pack all samples");
+  CHECK (ms_sid_intern ("FDSN:XX_NOINT_00_B_H_Z") > 0, "ms_sid_intern() failed");
+
+  msr->datasamples = NULL;
+  msr3_free (&msr);
+  ms_context_free (&ctx);
+}
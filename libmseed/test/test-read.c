@@ -11,6 +11,8 @@
    #include <fcntl.h>
    #define SET_BINARY_MODE(fd) _setmode(fd, _O_BINARY)
 #else
+   #include <pthread.h>
+   #include <unistd.h>
    #define SET_BINARY_MODE(fd) ((void)0)
 #endif
 
@@ -630,6 +632,76 @@ TEST (read, oddball)
   ms3_readmsr (&msr, NULL, flags, 0);
 }
 
+/* Compare extra headers mapped from miniSEED 2 blockettes when parsing
+ * against those deferred with MSF_DEFEREXTRA and mapped on demand */
+TEST (read, deferextra)
+{
+  MS3FileParam *msfp = NULL;
+  MS3FileParam *dmsfp = NULL;
+  MS3Record *msr = NULL;
+  MS3Record *dmsr = NULL;
+  char timestr[50] = {0};
+  int records;
+  int pending;
+  int rv;
+  int idx;
+
+  const char *files[] = {"data/testdata-detection.record.mseed2",
+                         "data/testdata-unapplied-timecorrection.mseed2",
+                         "data/testdata-3channel-signal.mseed2",
+                         "data/testdata-oneseries-mixedlengths-mixedorder.mseed2"};
+
+  for (idx = 0; idx < (int)(sizeof (files) / sizeof (files[0])); idx++)
+  {
+    records = 0;
+    pending = 0;
+
+    while ((rv = ms3_readmsr_r (&msfp, &msr, files[idx], 0, 0)) == MS_NOERROR)
+    {
+      rv = ms3_readmsr_r (&dmsfp, &dmsr, files[idx], MSF_DEFEREXTRA, 0);
+      REQUIRE (rv == MS_NOERROR, "ms3_readmsr_r() with MSF_DEFEREXTRA did not return MS_NOERROR");
+
+      records++;
+
+      CHECK ((dmsr->swapflag & ~(MSSWAP_HEADER | MSSWAP_PAYLOAD)) == 0,
+             "Swap flag has undocumented bits set");
+
+      if (msr->extralength > 0)
+      {
+        pending++;
+        CHECK (dmsr->extra == NULL && dmsr->extralength == 0, "Deferred extra headers are populated");
+      }
+
+      rv = msr3_unpack_extra (dmsr, 0);
+      CHECK (rv == msr->extralength, "msr3_unpack_extra() returned unexpected length");
+      CHECK (dmsr->extralength == msr->extralength, "Extra headers not mapped by msr3_unpack_extra()");
+      CHECK (msr3_unpack_extra (dmsr, 0) == rv, "Extra headers mapped again by msr3_unpack_extra()");
+
+      if (msr->extralength > 0 && dmsr->extra)
+        CHECK_STREQ (dmsr->extra, msr->extra);
+    }
+    CHECK (rv == MS_ENDOFFILE, "ms3_readmsr_r() did not return expected MS_ENDOFFILE");
+    CHECK (records > 0, "No records read");
+
+    if (idx < 2)
+      CHECK (pending == records, "Expected extra headers to be pending for all records");
+
+    ms3_readmsr_r (&msfp, &msr, NULL, 0, 0);
+    ms3_readmsr_r (&dmsfp, &dmsr, NULL, 0, 0);
+  }
+
+  /* Extra header routines map deferred headers on demand */
+  rv = ms3_readmsr (&dmsr, "data/testdata-detection.record.mseed2", MSF_DEFEREXTRA, 0);
+  REQUIRE (rv == MS_NOERROR, "ms3_readmsr() did not return expected MS_NOERROR");
+  REQUIRE (dmsr->extra == NULL, "Extra headers are not pending");
+
+  CHECK (mseh_exists (dmsr, "/FDSN/Event/Detection/0"), "Expected /FDSN/Event/Detection does not exist");
+  mseh_get_string (dmsr, "/FDSN/Event/Detection/0/OnsetTime", timestr, sizeof (timestr));
+  CHECK_STREQ (timestr, "2004-07-28T20:28:06.185000Z");
+  CHECK (dmsr->extra != NULL, "Extra headers still pending after access");
+  ms3_readmsr (&dmsr, NULL, 0, 0);
+}
+
 TEST (read, error)
 {
   MS3Record *msr = NULL;
@@ -754,3 +826,668 @@ TEST (read, v2_b100_invalid_samplerate)
   msr3_free (&msr);
   msr3_free (&parsed);
 }
+
+/* Read a file with ms3_readmsr_r() and ms3_readmsr_batch() in lockstep and
+ * return the number of records, or -1 if any record differs */
+static int64_t
+compare_batch_read (const char *path, int maxrecords, uint32_t flags)
+{
+  MS3FileParam *msfp = NULL;
+  MS3FileParam *batchmsfp = NULL;
+  MS3Record *msr = NULL;
+  MS3Record *records[64];
+  int64_t recordcount = 0;
+  int batchcount;
+  int idx;
+  int rv = MS_NOERROR;
+
+  while ((batchcount =
+              ms3_readmsr_batch (&batchmsfp, records, maxrecords, path, flags, NULL, 0)) > 0)
+  {
+    for (idx = 0; idx < batchcount; idx++)
+    {
+      if ((rv = ms3_readmsr_r (&msfp, &msr, path, flags, 0)) != MS_NOERROR)
+        break;
+
+      if (strcmp (records[idx]->sid, msr->sid) || records[idx]->starttime != msr->starttime ||
+          records[idx]->reclen != msr->reclen || records[idx]->numsamples != msr->numsamples ||
+          memcmp (records[idx]->record, msr->record, msr->reclen) ||
+          (msr->numsamples > 0 &&
+           memcmp (records[idx]->datasamples, msr->datasamples,
+                   msr->numsamples * ms_samplesize (msr->sampletype))))
+      {
+        rv = MS_GENERROR;
+        break;
+      }
+
+      recordcount++;
+    }
+
+    if (rv != MS_NOERROR)
+      break;
+  }
+
+  /* Both readers must be at the end of the stream */
+  if (rv == MS_NOERROR &&
+      (batchcount != 0 || ms3_readmsr_r (&msfp, &msr, path, flags, 0) != MS_ENDOFFILE))
+    rv = MS_GENERROR;
+
+  ms3_readmsr_r (&msfp, &msr, NULL, flags, 0);
+  ms3_readmsr_batch (&batchmsfp, NULL, 0, NULL, flags, NULL, 0);
+
+  return (rv == MS_NOERROR) ? recordcount : -1;
+}
+
+TEST (read, batch)
+{
+  MS3FileParam *msfp = NULL;
+  MS3Record *records[8];
+  MS3Selections *selections = NULL;
+  const char *path = "data/testdata-oneseries-mixedlengths-mixedorder.mseed2";
+  const char *largepath = "testdata-batch-large.mseed2";
+  char buffer[16384];
+  size_t length;
+  FILE *ifp;
+  FILE *ofp;
+  int64_t count;
+  int rv;
+
+  /* Batches of different sizes match individually read records */
+  CHECK (compare_batch_read (path, 1, MSF_UNPACKDATA) == 7, "Batch size 1 mismatch");
+  CHECK (compare_batch_read (path, 5, MSF_UNPACKDATA) == 7, "Batch size 5 mismatch");
+  CHECK (compare_batch_read ("data/testdata-3channel-signal.mseed3", 64, 0) > 0,
+         "Batch size 64 mismatch");
+
+  /* Batches end at read buffer refills for a file larger than the buffer */
+  ifp = fopen (path, "rb");
+  REQUIRE (ifp != NULL, "Cannot open test data");
+  length = fread (buffer, 1, sizeof (buffer), ifp);
+  fclose (ifp);
+
+  ofp = fopen (largepath, "wb");
+  REQUIRE (ofp != NULL, "Cannot open output file");
+  for (count = 0; count < (MAXRECLEN / (int64_t)length) + 2; count++)
+    fwrite (buffer, 1, length, ofp);
+  fclose (ofp);
+
+  count = compare_batch_read (largepath, 64, 0);
+  CHECK (count == 7 * ((MAXRECLEN / (int64_t)length) + 2), "Large file batch read mismatch");
+  remove (largepath);
+
+  /* Selections are applied to batches */
+  rv = ms3_addselect (&selections, "FDSN:IU_COLA_*_L_H_Z", NSTUNSET, NSTUNSET, 0);
+  REQUIRE (rv == 0, "ms3_addselect() returned an unexpected error");
+
+  rv = ms3_readmsr_batch (&msfp, records, 8, "data/testdata-3channel-signal.mseed3", 0, selections,
+                          0);
+  CHECK (rv > 0, "ms3_readmsr_batch() with selections returned no records");
+  for (int idx = 0; idx < rv; idx++)
+    CHECK_STREQ (records[idx]->sid, "FDSN:IU_COLA_00_L_H_Z");
+  ms3_readmsr_batch (&msfp, NULL, 0, NULL, 0, NULL, 0);
+  CHECK (msfp == NULL, "ms3_readmsr_batch() cleanup did not free parameters");
+  ms3_freeselections (selections);
+
+  /* Errors */
+  CHECK (ms3_readmsr_batch (&msfp, records, 0, path, 0, NULL, 0) == MS_GENERROR,
+         "ms3_readmsr_batch() accepted zero records");
+  CHECK (ms3_readmsr_batch (&msfp, records, 8, "data/no-such-file", 0, NULL, 0) == MS_GENERROR,
+         "ms3_readmsr_batch() did not fail for missing file");
+  ms3_readmsr_batch (&msfp, NULL, 0, NULL, 0, NULL, 0);
+}
+
+/* Write packed records to the FILE * given as handler data */
+static void
+record_handler_file (char *record, int reclen, void *handlerdata)
+{
+  fwrite (record, 1, reclen, (FILE *)handlerdata);
+}
+
+/* Read a stream with and without read-ahead, comparing the records.
+ * Returns the number of records or -1 on a mismatch. */
+static int64_t
+compare_readahead (const char *path, uint32_t flags)
+{
+  MS3FileParam *msfp = NULL;
+  MS3FileParam *ramsfp = NULL;
+  MS3Record *msr = NULL;
+  MS3Record *ramsr = NULL;
+  int64_t recordcount = 0;
+  int rv;
+  int rarv;
+
+  for (;;)
+  {
+    rv = ms3_readmsr_r (&msfp, &msr, path, flags, 0);
+    rarv = ms3_readmsr_r (&ramsfp, &ramsr, path, flags | MSF_READAHEAD, 0);
+
+    if (rv != rarv)
+    {
+      recordcount = -1;
+      break;
+    }
+
+    if (rv != MS_NOERROR)
+      break;
+
+    if (strcmp (ramsr->sid, msr->sid) || ramsr->starttime != msr->starttime ||
+        ramsr->reclen != msr->reclen || ramsfp->streampos != msfp->streampos ||
+        memcmp (ramsr->record, msr->record, msr->reclen))
+    {
+      recordcount = -1;
+      break;
+    }
+
+    recordcount++;
+  }
+
+  if (rv != MS_ENDOFFILE)
+    recordcount = -1;
+
+  ms3_readmsr_r (&msfp, &msr, NULL, 0, 0);
+  ms3_readmsr_r (&ramsfp, &ramsr, NULL, 0, 0);
+
+  return recordcount;
+}
+
+TEST (read, readahead)
+{
+  MS3Record *msr = NULL;
+  const char *path = "data/testdata-oneseries-mixedlengths-mixedorder.mseed2";
+  const char *largepath = "testdata-readahead-large.mseed";
+  char rangepath[256];
+  char buffer[16384];
+  int64_t packedsamples;
+  int32_t *samples;
+  size_t length;
+  FILE *ifp;
+  FILE *ofp;
+  int64_t count;
+  int copies = 4000;
+  int idx;
+  int rv;
+
+  /* Small files read in a single buffer */
+  CHECK (compare_readahead (path, MSF_UNPACKDATA) == 7, "Small file read-ahead mismatch");
+  CHECK (compare_readahead ("data/testdata-3channel-signal.mseed3", 0) > 0,
+         "Small file read-ahead mismatch");
+
+  /* A file of many buffers, with records of mixed lengths straddling the
+   * buffers, followed by records larger than the carry-over space */
+  ifp = fopen (path, "rb");
+  REQUIRE (ifp != NULL, "Cannot open test data");
+  length = fread (buffer, 1, sizeof (buffer), ifp);
+  fclose (ifp);
+
+  ofp = fopen (largepath, "wb");
+  REQUIRE (ofp != NULL, "Cannot open output file");
+  for (idx = 0; idx < copies; idx++)
+    fwrite (buffer, 1, length, ofp);
+
+  samples = (int32_t *)malloc (250000 * sizeof (int32_t));
+  REQUIRE (samples != NULL, "Cannot allocate samples");
+  for (idx = 0; idx < 250000; idx++)
+    samples[idx] = idx;
+
+  msr = msr3_init (msr);
+  REQUIRE (msr != NULL, "msr3_init() returned unexpected NULL");
+  strcpy (msr->sid, "FDSN:XX_TEST__L_H_Z");
+  msr->reclen = 1100000;
+  msr->formatversion = 3;
+  msr->encoding = DE_INT32;
+  msr->samprate = 1.0;
+  msr->datasamples = samples;
+  msr->numsamples = 250000;
+  msr->sampletype = 'i';
+
+  for (idx = 0; idx < 12; idx++)
+  {
+    msr->starttime =
+        ms_timestr2nstime ("2020-01-01T00:00:00Z") + (nstime_t)idx * 250000 * NSTMODULUS;
+    rv = msr3_pack (msr, record_handler_file, ofp, &packedsamples, MSF_FLUSHDATA, 0);
+    CHECK (rv == 1, "msr3_pack() returned unexpected value");
+  }
+  fclose (ofp);
+
+  msr->datasamples = NULL;
+  msr3_free (&msr);
+  free (samples);
+
+  count = compare_readahead (largepath, 0);
+  CHECK (count == 7 * copies + 12, "Large file read-ahead mismatch");
+  CHECK (compare_readahead (largepath, MSF_UNPACKDATA | MSF_VALIDATECRC) == 7 * copies + 12,
+         "Large file read-ahead with unpacking mismatch");
+
+  /* Byte ranges are limited as without read-ahead */
+  snprintf (rangepath, sizeof (rangepath), "%s@%zu-%zu", largepath, length,
+            (length * (copies - 1)) - 1);
+  CHECK (compare_readahead (rangepath, MSF_PNAMERANGE) == 7 * (copies - 2),
+         "Byte range read-ahead mismatch");
+
+  /* Batches with read-ahead match individually read records */
+  CHECK (compare_batch_read (largepath, 64, MSF_READAHEAD) == 7 * copies + 12,
+         "Batch read-ahead mismatch");
+
+  remove (largepath);
+}
+
+/* Read all records of a stream, returning a checksum of the records and
+ * their offsets, or 0 on error */
+static uint32_t
+read_checksum (const char *path, uint32_t flags, int64_t *recordcount)
+{
+  MS3FileParam *msfp = NULL;
+  MS3Record *msr = NULL;
+  uint32_t crc = 0;
+  int rv;
+
+  *recordcount = 0;
+
+  while ((rv = ms3_readmsr_r (&msfp, &msr, path, flags, 0)) == MS_NOERROR)
+  {
+    crc = ms_crc32c ((const uint8_t *)msr->record, msr->reclen, crc);
+    crc = ms_crc32c ((const uint8_t *)&msfp->streampos, sizeof (int64_t), crc);
+    (*recordcount)++;
+  }
+
+  ms3_readmsr_r (&msfp, &msr, NULL, 0, 0);
+
+  return (rv == MS_ENDOFFILE) ? crc : 0;
+}
+
+TEST (read, prefetch)
+{
+  MS3TraceList *mstl = NULL;
+  MS3FileParam *msfp = NULL;
+  MS3Record *msr = NULL;
+  const char *paths[] = {"data/testdata-3channel-signal.mseed2",
+                         "data/testdata-3channel-signal.mseed3",
+                         "data/testdata-oneseries-mixedlengths-mixedorder.mseed2",
+                         "data/testdata-oneseries-mixedlengths-mixedorder.mseed3",
+                         "data/testdata-no-blockette1000-steim1.mseed2",
+                         "data/reference-testdata-int32.mseed3"};
+  int npaths = sizeof (paths) / sizeof (paths[0]);
+  uint32_t checksums[sizeof (paths) / sizeof (paths[0])];
+  int64_t counts[sizeof (paths) / sizeof (paths[0])];
+  int64_t count;
+  int idx;
+  int rv;
+
+  for (idx = 0; idx < npaths; idx++)
+  {
+    checksums[idx] = read_checksum (paths[idx], 0, &counts[idx]);
+    REQUIRE (checksums[idx] != 0, "Cannot read test data");
+  }
+
+  /* Prefetched files read the same as files read directly */
+  for (idx = 0; idx < npaths; idx++)
+    CHECK (ms3_file_prefetch (paths[idx], MSF_PNAMERANGE) == 0, "ms3_file_prefetch() failed");
+  CHECK (ms3_file_prefetch (paths[0], 0) == 0, "ms3_file_prefetch() failed for duplicate");
+
+  for (idx = 0; idx < npaths; idx++)
+  {
+    CHECK (read_checksum (paths[idx], 0, &count) == checksums[idx], "Prefetched file mismatch");
+    CHECK (count == counts[idx], "Prefetched file record count mismatch");
+  }
+
+  /* Records of prefetched files are parsed in place */
+  CHECK (ms3_file_prefetch (paths[1], 0) == 0, "ms3_file_prefetch() failed");
+  rv = ms3_readmsr_r (&msfp, &msr, paths[1], MSF_UNPACKDATA, 0);
+  CHECK (rv == MS_NOERROR, "ms3_readmsr_r() of prefetched file failed");
+  CHECK (msfp->input.type == LMIO_BUFFER, "Prefetched file not read from memory");
+  CHECK (msr->record == msfp->readbuffer, "Prefetched record not parsed in place");
+  ms3_readmsr_r (&msfp, &msr, NULL, 0, 0);
+
+  /* Trace lists are read from prefetched files */
+  CHECK (ms3_file_prefetch (paths[2], 0) == 0, "ms3_file_prefetch() failed");
+  rv = ms3_readtracelist (&mstl, paths[2], NULL, 0, MSF_UNPACKDATA, 0);
+  CHECK (rv == MS_NOERROR, "ms3_readtracelist() of prefetched file failed");
+  REQUIRE (mstl != NULL, "ms3_readtracelist() did not return a trace list");
+  CHECK (mstl->numtraceids == 1, "Unexpected trace count for prefetched file");
+  mstl3_free (&mstl, 0);
+
+  /* A missing prefetched file fails when read */
+  ms_rloginit (NULL, NULL, NULL, NULL, 10);
+  CHECK (ms3_file_prefetch ("data/no-such-file", 0) == 0, "ms3_file_prefetch() failed");
+  rv = ms3_readmsr_r (&msfp, &msr, "data/no-such-file", 0, 0);
+  CHECK (rv == MS_GENERROR, "ms3_readmsr_r() of missing prefetched file did not fail");
+  ms3_readmsr_r (&msfp, &msr, NULL, 0, 0);
+
+  /* URLs, stdin and byte ranges are not prefetched */
+  CHECK (ms3_file_prefetch ("http://localhost/file", 0) == 0, "ms3_file_prefetch() URL failed");
+  CHECK (ms3_file_prefetch ("-", 0) == 0, "ms3_file_prefetch() stdin failed");
+  CHECK (ms3_file_prefetch ("data/testdata-3channel-signal.mseed3@0-4095", MSF_PNAMERANGE) == 0,
+         "ms3_file_prefetch() byte range failed");
+
+  /* Unread prefetches are cancelled */
+  CHECK (ms3_file_prefetch (paths[3], 0) == 0, "ms3_file_prefetch() failed");
+  CHECK (ms3_file_prefetch (NULL, 0) == 0, "ms3_file_prefetch() cancel failed");
+  CHECK (read_checksum (paths[3], 0, &count) == checksums[3], "Cancelled prefetch mismatch");
+}
+
+#if !defined(LMP_WIN)
+typedef struct PipeWriter
+{
+  const char *path;
+  int fd;
+} PipeWriter;
+
+/* Copy a file to a pipe and close the pipe */
+static void *
+pipe_writer_thread (void *arg)
+{
+  PipeWriter *pw = (PipeWriter *)arg;
+  char buffer[4096];
+  size_t length;
+  FILE *ifp;
+
+  if ((ifp = fopen (pw->path, "rb")))
+  {
+    while ((length = fread (buffer, 1, sizeof (buffer), ifp)) > 0)
+      if (write (pw->fd, buffer, length) != (ssize_t)length)
+        break;
+
+    fclose (ifp);
+  }
+
+  close (pw->fd);
+
+  return NULL;
+}
+
+/* Pipes named for prefetching are read directly */
+TEST (read, prefetch_pipe)
+{
+  PipeWriter pw;
+  pthread_t tid;
+  char pipepath[64];
+  uint32_t checksum;
+  int64_t count;
+  int64_t pipecount;
+  int fds[2];
+
+  pw.path = "data/testdata-3channel-signal.mseed3";
+  checksum = read_checksum (pw.path, 0, &count);
+  REQUIRE (checksum != 0, "Cannot read test data");
+
+  REQUIRE (pipe (fds) == 0, "pipe() failed");
+  snprintf (pipepath, sizeof (pipepath), "/dev/fd/%d", fds[0]);
+
+  pw.fd = fds[1];
+  REQUIRE (pthread_create (&tid, NULL, pipe_writer_thread, &pw) == 0, "pthread_create() failed");
+
+  CHECK (ms3_file_prefetch (pipepath, 0) == 0, "ms3_file_prefetch() failed for pipe");
+  CHECK (read_checksum (pipepath, 0, &pipecount) == checksum, "Pipe read mismatch");
+  CHECK (pipecount == count, "Pipe record count mismatch");
+
+  pthread_join (tid, NULL);
+  close (fds[0]);
+}
+#endif /* !defined(LMP_WIN) */
+
+TEST (read, nocache)
+{
+  const char *path = "data/testdata-oneseries-mixedlengths-mixedorder.mseed2";
+  const char *largepath = "testdata-nocache-large.mseed";
+  char rangepath[256];
+  char buffer[16384];
+  uint32_t checksum;
+  size_t length;
+  FILE *ifp;
+  FILE *ofp;
+  int64_t count;
+  int64_t expected;
+  int copies = 1500;
+  int idx;
+
+  /* A file spanning several portions dropped from the page cache */
+  ifp = fopen (path, "rb");
+  REQUIRE (ifp != NULL, "Cannot open test data");
+  length = fread (buffer, 1, sizeof (buffer), ifp);
+  fclose (ifp);
+
+  ofp = fopen (largepath, "wb");
+  REQUIRE (ofp != NULL, "Cannot open output file");
+  for (idx = 0; idx < copies; idx++)
+    fwrite (buffer, 1, length, ofp);
+  fclose (ofp);
+
+  checksum = read_checksum (largepath, 0, &expected);
+  REQUIRE (checksum != 0, "Cannot read test data");
+  CHECK (expected == 7 * copies, "Unexpected record count");
+
+  /* Reading is not affected by dropping input from the page cache */
+  CHECK (read_checksum (largepath, MSF_NOCACHE, &count) == checksum, "No cache read mismatch");
+  CHECK (count == expected, "No cache record count mismatch");
+  CHECK (read_checksum (largepath, MSF_NOCACHE | MSF_READAHEAD, &count) == checksum,
+         "No cache read-ahead mismatch");
+  CHECK (count == expected, "No cache read-ahead record count mismatch");
+
+  /* Byte ranges */
+  snprintf (rangepath, sizeof (rangepath), "%s@%zu-%zu", largepath, length,
+            (length * (copies - 1)) - 1);
+  read_checksum (rangepath, MSF_PNAMERANGE | MSF_NOCACHE, &count);
+  CHECK (count == 7 * (copies - 2), "No cache byte range record count mismatch");
+
+  /* Prefetched files */
+  CHECK (ms3_file_prefetch (path, MSF_NOCACHE) == 0, "ms3_file_prefetch() failed");
+  CHECK (read_checksum (path, MSF_NOCACHE, &count) == read_checksum (path, 0, &expected),
+         "No cache prefetched file mismatch");
+  CHECK (count == expected, "No cache prefetched file record count mismatch");
+
+  remove (largepath);
+}
+
+TEST (read, decompress)
+{
+  MS3FileParam *msfp = NULL;
+  MS3Record *msr = NULL;
+  const char *path = "data/testdata-oneseries-mixedlengths-mixedorder.mseed2";
+  const char *formats[] = {"gzip", "xz", "zstd"};
+  const char *suffixes[] = {"gz", "xz", "zst"};
+  const char *concatpath = "testdata-decompress-concatenated";
+  const char *truncpath = "testdata-decompress-truncated";
+  char compressed[256];
+  char rangepath[256];
+  char buffer[16384];
+  uint32_t checksum;
+  uint32_t rangechecksum;
+  int64_t expected;
+  int64_t count;
+  int64_t datalength;
+  int64_t offset;
+  int64_t zoffset;
+  int64_t skip;
+  size_t length;
+  FILE *ifp;
+  FILE *ofp;
+  int rangestart;
+  int idx;
+  int rv;
+
+  ms_rloginit (NULL, NULL, NULL, NULL, 10);
+
+  checksum = read_checksum (path, 0, &expected);
+  REQUIRE (checksum != 0, "Cannot read test data");
+
+  /* A byte range starting at the second record */
+  rv = ms3_readmsr_r (&msfp, &msr, path, 0, 0);
+  REQUIRE (rv == MS_NOERROR, "Cannot read test data");
+  rangestart = msr->reclen;
+
+  /* Offsets of files that are not compressed are not mapped */
+  CHECK (ms3_compressed_offset (msfp, 0, &zoffset, &skip) == 1, "Uncompressed file mapped");
+  CHECK (zoffset == 0 && skip == 0, "Uncompressed file offset mismatch");
+  ms3_readmsr_r (&msfp, &msr, NULL, 0, 0);
+
+  ifp = fopen (path, "rb");
+  REQUIRE (ifp != NULL, "Cannot open test data");
+  datalength = (int64_t)fread (buffer, 1, sizeof (buffer), ifp);
+  fclose (ifp);
+  snprintf (rangepath, sizeof (rangepath), "%s@%d-", path, rangestart);
+  rangechecksum = read_checksum (rangepath, MSF_PNAMERANGE, &count);
+  REQUIRE (rangechecksum != 0 && count == expected - 1, "Cannot read test data range");
+
+  for (idx = 0; idx < 3; idx++)
+  {
+    snprintf (compressed, sizeof (compressed), "%s.%s", path, suffixes[idx]);
+
+    /* Compressed input is an error when the format is not supported */
+    if (!libmseed_decompress_support (formats[idx]))
+    {
+      CHECK (read_checksum (compressed, 0, &count) == 0, "Unsupported format not rejected");
+      continue;
+    }
+
+    /* Records and offsets match those of the decompressed data */
+    CHECK (read_checksum (compressed, 0, &count) == checksum, "Decompressed read mismatch");
+    CHECK (count == expected, "Decompressed record count mismatch");
+    CHECK (read_checksum (compressed, MSF_READAHEAD, &count) == checksum,
+           "Decompressed read-ahead mismatch");
+
+    /* Prefetched compressed files */
+    CHECK (ms3_file_prefetch (compressed, 0) == 0, "ms3_file_prefetch() failed");
+    CHECK (read_checksum (compressed, 0, &count) == checksum, "Decompressed prefetch mismatch");
+
+    /* Byte ranges refer to the decompressed data */
+    snprintf (rangepath, sizeof (rangepath), "%s@%d-", compressed, rangestart);
+    CHECK (read_checksum (rangepath, MSF_PNAMERANGE, &count) == rangechecksum,
+           "Decompressed byte range mismatch");
+  }
+
+  /* Concatenated gzip members are read in sequence */
+  if (libmseed_decompress_support ("gzip"))
+  {
+    snprintf (compressed, sizeof (compressed), "%s.gz", path);
+    ifp = fopen (compressed, "rb");
+    REQUIRE (ifp != NULL, "Cannot open test data");
+    length = fread (buffer, 1, sizeof (buffer), ifp);
+    fclose (ifp);
+
+    ofp = fopen (concatpath, "wb");
+    REQUIRE (ofp != NULL, "Cannot open output file");
+    fwrite (buffer, 1, length, ofp);
+    fwrite (buffer, 1, length, ofp);
+    fclose (ofp);
+
+    read_checksum (concatpath, 0, &count);
+    CHECK (count == 2 * expected, "Concatenated gzip record count mismatch");
+
+    /* Offsets map to the gzip member containing them */
+    count = 0;
+    while ((rv = ms3_readmsr_r (&msfp, &msr, concatpath, 0, 0)) == MS_NOERROR)
+    {
+      offset = msfp->streampos - msr->reclen;
+      rv = ms3_compressed_offset (msfp, offset, &zoffset, &skip);
+
+      if (offset < datalength)
+        count += (rv == 0 && zoffset == 0 && skip == offset);
+      else
+        count += (rv == 0 && zoffset == (int64_t)length && skip == offset - datalength);
+    }
+    CHECK (rv == MS_ENDOFFILE, "Cannot read concatenated gzip");
+    CHECK (count == 2 * expected, "Concatenated gzip compressed offset mismatch");
+    ms3_readmsr_r (&msfp, &msr, NULL, 0, 0);
+
+    /* Truncated compressed data is an error */
+    ofp = fopen (truncpath, "wb");
+    REQUIRE (ofp != NULL, "Cannot open output file");
+    fwrite (buffer, 1, length / 2, ofp);
+    fclose (ofp);
+
+    CHECK (read_checksum (truncpath, 0, &count) == 0, "Truncated gzip not detected");
+
+    remove (concatpath);
+    remove (truncpath);
+  }
+}
+
+TEST (read, decompress_seekable)
+{
+  MS3FileParam *msfp = NULL;
+  MS3Record *msr = NULL;
+  const char *path = "data/testdata-oneseries-mixedlengths-mixedorder.mseed2";
+  const char *seekpath = "data/testdata-oneseries-mixedlengths-mixedorder.mseed2.seekable.zst";
+  const char *corruptpath = "testdata-decompress-corrupt.zst";
+  /* Frames of 4096 bytes of decompressed data in the seekable test data */
+  const int64_t frames[] = {0, 3225, 6721, 9970};
+  char rangepath[256];
+  char zrangepath[256];
+  char buffer[16384];
+  uint32_t checksum;
+  int64_t expected;
+  int64_t count;
+  int64_t offset;
+  int64_t zoffset;
+  int64_t skip;
+  size_t length;
+  FILE *ifp;
+  FILE *ofp;
+  int rangestart = 0;
+  int rv;
+
+  ms_rloginit (NULL, NULL, NULL, NULL, 10);
+
+  checksum = read_checksum (path, 0, &expected);
+  REQUIRE (checksum != 0, "Cannot read test data");
+
+  if (!libmseed_decompress_support ("zstd"))
+  {
+    CHECK (read_checksum (seekpath, 0, &count) == 0, "Unsupported format not rejected");
+    return;
+  }
+
+  /* Seekable frames are decompressed as a whole */
+  CHECK (read_checksum (seekpath, 0, &count) == checksum, "Seekable read mismatch");
+  CHECK (count == expected, "Seekable record count mismatch");
+  CHECK (read_checksum (seekpath, MSF_READAHEAD, &count) == checksum,
+         "Seekable read-ahead mismatch");
+
+  CHECK (ms3_file_prefetch (seekpath, 0) == 0, "ms3_file_prefetch() failed");
+  CHECK (read_checksum (seekpath, 0, &count) == checksum, "Seekable prefetch mismatch");
+
+  /* Offsets map to the frames of the seek table, including data not yet read */
+  rv = ms3_readmsr_r (&msfp, &msr, seekpath, 0, 0);
+  REQUIRE (rv == MS_NOERROR, "Cannot read seekable test data");
+  CHECK (ms3_compressed_offset (msfp, 16000, &zoffset, &skip) == 0, "Offset not mapped");
+  CHECK (zoffset == frames[3] && skip == 16000 - 3 * 4096, "Offset mapping mismatch");
+  CHECK (ms3_compressed_offset (msfp, 16256, &zoffset, &skip) == -1, "Offset beyond end mapped");
+
+  do
+  {
+    offset = msfp->streampos - msr->reclen;
+    rv = ms3_compressed_offset (msfp, offset, &zoffset, &skip);
+    CHECK (rv == 0 && zoffset == frames[offset / 4096] && skip == offset % 4096,
+           "Record offset mapping mismatch");
+
+    /* A range starting at a record beyond the second frame */
+    if (!rangestart && offset > 2 * 4096)
+      rangestart = (int)offset;
+  } while (ms3_readmsr_r (&msfp, &msr, seekpath, 0, 0) == MS_NOERROR);
+  ms3_readmsr_r (&msfp, &msr, NULL, 0, 0);
+
+  /* Byte ranges start at the frame containing the start */
+  REQUIRE (rangestart > 0, "No record beyond the second frame");
+  snprintf (rangepath, sizeof (rangepath), "%s@%d-", path, rangestart);
+  snprintf (zrangepath, sizeof (zrangepath), "%s@%d-", seekpath, rangestart);
+  CHECK (read_checksum (zrangepath, MSF_PNAMERANGE, &count) ==
+             read_checksum (rangepath, MSF_PNAMERANGE, &expected),
+         "Seekable byte range mismatch");
+  CHECK (count == expected, "Seekable byte range record count mismatch");
+
+  /* A corrupt frame is an error */
+  ifp = fopen (seekpath, "rb");
+  REQUIRE (ifp != NULL, "Cannot open test data");
+  length = fread (buffer, 1, sizeof (buffer), ifp);
+  fclose (ifp);
+
+  buffer[frames[2]] ^= 0x5A;
+
+  ofp = fopen (corruptpath, "wb");
+  REQUIRE (ofp != NULL, "Cannot open output file");
+  fwrite (buffer, 1, length, ofp);
+  fclose (ofp);
+
+  CHECK (read_checksum (corruptpath, 0, &count) == 0, "Corrupt seekable frame not detected");
+
+  remove (corruptpath);
+}
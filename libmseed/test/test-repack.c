@@ -167,3 +167,187 @@ TEST (repack, v2_negative_time_correction)
   msr3_free (&msr);
   msr3_free (&parsed);
 }
+
+/* Test that encoded data is byte swapped as needed when repacking between
+ * versions, by comparing the decoded samples of the original and repacked
+ * records.
+ */
+TEST (repack, byteorder)
+{
+  const char *inputs[] = {"data/reference-testdata-int32.mseed2",
+                          "data/reference-testdata-float64.mseed2",
+                          "data/reference-testdata-steim1-LE.mseed2",
+                          "data/reference-testdata-steim2-LE.mseed2",
+                          "data/reference-testdata-int16.mseed3",
+                          "data/reference-testdata-float32.mseed3",
+                          NULL};
+  MS3Record *msr = NULL;
+  MS3Record *parsed = NULL;
+  char buffer[8192];
+  uint8_t samplesize;
+  int packedlength;
+  int idx;
+  int rv;
+
+  for (idx = 0; inputs[idx]; idx++)
+  {
+    rv = ms3_readmsr (&msr, inputs[idx], MSF_UNPACKDATA, 0);
+    REQUIRE (rv == MS_NOERROR, "ms3_readmsr() did not return expected MS_NOERROR");
+
+    if (msr->formatversion == 2)
+    {
+      packedlength = msr3_repack_mseed3 (msr, buffer, sizeof (buffer), 0);
+    }
+    else
+    {
+      msr->reclen = 1024;
+      packedlength = msr3_repack_mseed2 (msr, buffer, sizeof (buffer), 0);
+    }
+
+    CHECK (packedlength > 0, "Repacking returned an error");
+
+    rv = msr3_parse (buffer, (uint64_t)packedlength, &parsed, MSF_UNPACKDATA | MSF_VALIDATECRC, 0);
+    REQUIRE (rv == MS_NOERROR, "msr3_parse() did not return expected MS_NOERROR");
+
+    samplesize = ms_samplesize (msr->sampletype);
+
+    CHECK (parsed->formatversion != msr->formatversion, "Repacked record version not changed");
+    CHECK (parsed->numsamples == msr->numsamples, "Repacked record sample count mismatch");
+    CHECK (parsed->sampletype == msr->sampletype, "Repacked record sample type mismatch");
+    CHECK (!memcmp (parsed->datasamples, msr->datasamples, (size_t)(samplesize * msr->numsamples)),
+           "Repacked record samples mismatch");
+
+    ms3_readmsr (&msr, NULL, 0, 0);
+  }
+
+  msr3_free (&parsed);
+}
+
+/* Compare the decoded samples of two records */
+static int
+cmpsamples (const MS3Record *msrA, const MS3Record *msrB)
+{
+  uint8_t samplesize = ms_samplesize (msrA->sampletype);
+
+  if (msrA->numsamples != msrB->numsamples || msrA->sampletype != msrB->sampletype ||
+      samplesize == 0)
+    return -1;
+
+  return memcmp (msrA->datasamples, msrB->datasamples, (size_t)(samplesize * msrA->numsamples));
+}
+
+/* Test that records in every supported encoding, including the legacy
+ * encodings, repack to the other version and back with the same decoded
+ * samples, and that records in an unknown encoding are refused.
+ */
+TEST (repack, encodings)
+{
+  const char *inputs[] = {"data/reference-testdata-text.mseed2",
+                          "data/reference-testdata-int16.mseed2",
+                          "data/reference-testdata-int32.mseed2",
+                          "data/reference-testdata-float32.mseed2",
+                          "data/reference-testdata-float64.mseed2",
+                          "data/reference-testdata-steim1.mseed2",
+                          "data/reference-testdata-steim2.mseed2",
+                          "data/reference-testdata-steim1-LE.mseed2",
+                          "data/reference-testdata-steim2-LE.mseed2",
+                          "data/testdata-encoding-CDSN.mseed2",
+                          "data/testdata-encoding-SRO.mseed2",
+                          "data/testdata-encoding-DWWSSN.mseed2",
+                          "data/testdata-encoding-GEOSCOPE-16bit-3exp-encoded.mseed2",
+                          "data/reference-testdata-text.mseed3",
+                          "data/reference-testdata-int16.mseed3",
+                          "data/reference-testdata-int32.mseed3",
+                          "data/reference-testdata-float32.mseed3",
+                          "data/reference-testdata-float64.mseed3",
+                          "data/reference-testdata-steim1.mseed3",
+                          "data/reference-testdata-steim2.mseed3",
+                          NULL};
+  MS3Record *msr = NULL;
+  MS3Record *converted = NULL;
+  MS3Record *restored = NULL;
+  char buffer[16384];
+  char rbuffer[16384];
+  int packedlength;
+  int idx;
+  int rv;
+
+  for (idx = 0; inputs[idx]; idx++)
+  {
+    rv = ms3_readmsr (&msr, inputs[idx], MSF_UNPACKDATA, 0);
+    REQUIRE (rv == MS_NOERROR, "ms3_readmsr() did not return expected MS_NOERROR");
+    REQUIRE (msr != NULL, "ms3_readmsr() did not populate 'msr'");
+
+    /* Repack to the other version */
+    if (msr->formatversion == 2)
+    {
+      packedlength = msr3_repack_mseed3 (msr, buffer, sizeof (buffer), 0);
+    }
+    else
+    {
+      msr->reclen = 4096;
+      packedlength = msr3_repack_mseed2 (msr, buffer, sizeof (buffer), 0);
+    }
+
+    CHECK (packedlength > 0, "Repacking returned an error");
+
+    rv = (packedlength > 0) ? msr3_parse (buffer, (uint64_t)packedlength, &converted,
+                                          MSF_UNPACKDATA | MSF_VALIDATECRC, 0)
+                            : -1;
+    CHECK (rv == MS_NOERROR, "msr3_parse() of converted record did not return MS_NOERROR");
+
+    /* Close the file before the next input when a step fails */
+    if (rv != MS_NOERROR)
+    {
+      ms3_readmsr (&msr, NULL, 0, 0);
+      continue;
+    }
+
+    CHECK (converted->formatversion != msr->formatversion, "Repacked record version not changed");
+    CHECK (converted->encoding == msr->encoding, "Repacked record encoding mismatch");
+    CHECK (cmpsamples (msr, converted) == 0, "Converted record samples mismatch");
+
+    /* Repack back to the original version */
+    if (converted->formatversion == 2)
+    {
+      packedlength = msr3_repack_mseed3 (converted, rbuffer, sizeof (rbuffer), 0);
+    }
+    else
+    {
+      converted->reclen = (msr->formatversion == 2) ? msr->reclen : 4096;
+      packedlength = msr3_repack_mseed2 (converted, rbuffer, sizeof (rbuffer), 0);
+    }
+
+    CHECK (packedlength > 0, "Repacking back returned an error");
+
+    rv = (packedlength > 0) ? msr3_parse (rbuffer, (uint64_t)packedlength, &restored,
+                                          MSF_UNPACKDATA | MSF_VALIDATECRC, 0)
+                            : -1;
+    CHECK (rv == MS_NOERROR, "msr3_parse() of restored record did not return MS_NOERROR");
+
+    if (rv == MS_NOERROR)
+    {
+      CHECK (restored->formatversion == msr->formatversion, "Restored record version mismatch");
+      CHECK (restored->encoding == msr->encoding, "Restored record encoding mismatch");
+      CHECK (cmpsamples (msr, restored) == 0, "Restored record samples mismatch");
+    }
+
+    ms3_readmsr (&msr, NULL, 0, 0);
+  }
+
+  /* Records without Blockette 1000 have an unknown encoding */
+  rv = ms3_readmsr (&msr, "data/testdata-no-blockette1000-steim1.mseed2", 0, 0);
+  REQUIRE (rv == MS_NOERROR, "ms3_readmsr() did not return expected MS_NOERROR");
+  CHECK (msr->encoding == -1, "Record without Blockette 1000 has unexpected encoding");
+
+  packedlength = msr3_repack_mseed3 (msr, buffer, sizeof (buffer), 0);
+  CHECK (packedlength == -1, "msr3_repack_mseed3() did not refuse unknown encoding");
+
+  msr->reclen = 4096;
+  packedlength = msr3_repack_mseed2 (msr, buffer, sizeof (buffer), 0);
+  CHECK (packedlength == -1, "msr3_repack_mseed2() did not refuse unknown encoding");
+
+  ms3_readmsr (&msr, NULL, 0, 0);
+  msr3_free (&converted);
+  msr3_free (&restored);
+}
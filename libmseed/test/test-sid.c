@@ -121,4 +121,81 @@ TEST (SID, ms_xchan2seedchan) {
   /* Error tests, cannot map to SEED codes */
   rv = ms_xchan2seedchan (seedchan, "BB_SS_SS");
   CHECK (rv == -1, "ms_seedchan2xchan did not return expected -1");
-}
\ No newline at end of file
+}
+
+TEST (SID, ms_sid_intern) {
+  const char *net = NULL;
+  const char *sta = NULL;
+  const char *loc = NULL;
+  const char *chan = NULL;
+  uint32_t handle;
+  uint32_t other;
+  int rv;
+
+  handle = ms_sid_intern ("FDSN:XX_TEST_00_B_H_Z");
+  CHECK (handle > 0, "ms_sid_intern did not return a handle");
+
+  other = ms_sid_intern ("FDSN:XX_TEST_00_B_H_Z");
+  CHECK (other == handle, "ms_sid_intern did not return the same handle for the same SID");
+
+  other = ms_sid_intern ("FDSN:XX_TEST_00_B_H_N");
+  CHECK (other > 0 && other != handle,
+         "ms_sid_intern did not return a different handle for a different SID");
+
+  CHECK_STREQ (ms_sid_interned (handle), "FDSN:XX_TEST_00_B_H_Z");
+  CHECK_STREQ (ms_sid_interned (other), "FDSN:XX_TEST_00_B_H_N");
+
+  rv = ms_sid2nslc_interned (handle, &net, &sta, &loc, &chan);
+  CHECK (rv == 0, "ms_sid2nslc_interned did not return expected 0 for success");
+  CHECK_STREQ (net, "XX");
+  CHECK_STREQ (sta, "TEST");
+  CHECK_STREQ (loc, "00");
+  CHECK_STREQ (chan, "BHZ");
+
+  rv = ms_sid2nslc_interned (other, NULL, NULL, NULL, &chan);
+  CHECK (rv == 0, "ms_sid2nslc_interned did not return expected 0 for success");
+  CHECK_STREQ (chan, "BHN");
+
+  /* Error tests */
+  other = ms_sid_intern ("INVALID");
+  CHECK (other > 0, "ms_sid_intern did not return a handle for an unparsable SID");
+
+  rv = ms_sid2nslc_interned (other, &net, &sta, &loc, &chan);
+  CHECK (rv == -1, "ms_sid2nslc_interned did not return expected -1 for an unparsable SID");
+
+  CHECK (ms_sid_interned (0) == NULL, "ms_sid_interned did not return NULL for handle 0");
+  CHECK (ms_sid_interned (UINT32_MAX) == NULL,
+         "ms_sid_interned did not return NULL for an invalid handle");
+
+  rv = ms_sid2nslc_interned (UINT32_MAX, &net, &sta, &loc, &chan);
+  CHECK (rv == -1, "ms_sid2nslc_interned did not return expected -1 for an invalid handle");
+
+  handle = ms_sid_intern (NULL);
+  CHECK (handle == 0, "ms_sid_intern did not return 0 for NULL SID");
+}
+
+TEST (SID, ms_sid_intern_many)
+{
+  char sid[LM_SIDLEN];
+  uint32_t handle[3000];
+  int matching = 1;
+
+  /* Enough SIDs to grow the hash table and fill more than one handle chunk */
+  for (int idx = 0; idx < 3000; idx++)
+  {
+    snprintf (sid, sizeof (sid), "FDSN:XX_M%04d__B_H_Z", idx);
+    handle[idx] = ms_sid_intern (sid);
+    if (handle[idx] == 0)
+      matching = 0;
+  }
+  CHECK (matching, "ms_sid_intern did not return a handle");
+
+  for (int idx = 0; idx < 3000; idx++)
+  {
+    snprintf (sid, sizeof (sid), "FDSN:XX_M%04d__B_H_Z", idx);
+    if (ms_sid_intern (sid) != handle[idx] || !ms_sid_interned (handle[idx]) ||
+        strcmp (ms_sid_interned (handle[idx]), sid))
+      matching = 0;
+  }
+  CHECK (matching, "ms_sid_intern did not return the same handle for the same SID");
+}
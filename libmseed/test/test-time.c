@@ -96,6 +96,68 @@ TEST (time, nstime2timestr)
   CHECK_STREQ (timestr, "ERROR");
 }
 
+TEST (time, nstime2timestr_sequence)
+{
+  char timestr[50];
+  uint16_t year, yday;
+  uint8_t hour, min, sec;
+  uint32_t nsec;
+  nstime_t nstime;
+
+  /* Suppress error and warning messages by accumulating them */
+  ms_rloginit (NULL, NULL, NULL, NULL, 10);
+
+  /* Consecutive times crossing day, leap day and year boundaries */
+  nstime = ms_timestr2nstime ("2000-02-28T23:59:59.5Z");
+  ms_nstime2timestr_n (nstime, timestr, sizeof(timestr), ISOMONTHDAY_DOY_Z, MICRO_NONE);
+  CHECK_STREQ (timestr, "2000-02-28T23:59:59.500000Z (059)");
+
+  nstime += NSTMODULUS / 2;
+  ms_nstime2timestr_n (nstime, timestr, sizeof(timestr), ISOMONTHDAY_DOY_Z, MICRO_NONE);
+  CHECK_STREQ (timestr, "2000-02-29T00:00:00Z (060)");
+
+  nstime += (nstime_t)86400 * NSTMODULUS;
+  ms_nstime2timestr_n (nstime, timestr, sizeof(timestr), SEEDORDINAL, MICRO_NONE);
+  CHECK_STREQ (timestr, "2000,061,00:00:00");
+
+  nstime = ms_timestr2nstime ("2000-12-31T23:59:59.999999999Z");
+  ms_nstime2timestr_n (nstime, timestr, sizeof(timestr), ISOMONTHDAY_SPACE, NANO);
+  CHECK_STREQ (timestr, "2000-12-31 23:59:59.999999999");
+
+  nstime += 1;
+  ms_nstime2timestr_n (nstime, timestr, sizeof(timestr), ISOMONTHDAY_SPACE_Z, NANO);
+  CHECK_STREQ (timestr, "2001-01-01 00:00:00.000000000Z");
+
+  /* Alternate between days to exercise reuse of prior conversions */
+  ms_nstime2timestr_n (0, timestr, sizeof(timestr), ISOMONTHDAY, NONE);
+  CHECK_STREQ (timestr, "1970-01-01T00:00:00");
+
+  ms_nstime2timestr_n (-1, timestr, sizeof(timestr), ISOMONTHDAY, NANO);
+  CHECK_STREQ (timestr, "1969-12-31T23:59:59.999999999");
+
+  ms_nstime2timestr_n (1, timestr, sizeof(timestr), SEEDORDINAL, NANO);
+  CHECK_STREQ (timestr, "1970,001,00:00:00.000000001");
+
+  /* Extremes of the nstime_t range */
+  ms_nstime2timestr_n (INT64_MAX, timestr, sizeof(timestr), ISOMONTHDAY_DOY_Z, NANO);
+  CHECK_STREQ (timestr, "2262-04-11T23:47:16.854775807Z (101)");
+
+  ms_nstime2timestr_n (INT64_MIN + 2, timestr, sizeof(timestr), SEEDORDINAL, NANO);
+  CHECK_STREQ (timestr, "1677,264,00:12:43.145224194");
+
+  /* Truncation to the destination size is an error */
+  CHECK (ms_nstime2timestr_n (0, timestr, 11, ISOMONTHDAY, NONE) == NULL,
+         "Expected failure for small time string buffer");
+  CHECK_STREQ (timestr, "1970-01-01");
+
+  /* Individual components */
+  nstime = ms_timestr2nstime ("2024-12-31T12:34:56.000000789Z");
+  CHECK (ms_nstime2time (nstime, &year, &yday, &hour, &min, &sec, &nsec) == 0,
+         "ms_nstime2time() returned error");
+  CHECK (year == 2024 && yday == 366 && hour == 12 && min == 34 && sec == 56 && nsec == 789,
+         "ms_nstime2time() returned unexpected components");
+}
+
 TEST (time, timestr2nstime)
 {
   nstime_t nstime;
@@ -173,6 +235,57 @@ TEST (time, timestr2nstime)
   CHECK (nstime == NSTERROR, "Failed to produce error for time string: '20040512T000000'");
 }
 
+/* Verify the direct parsing of common fixed-width ISO and SEED time string
+ * shapes, and that invalid values in those shapes are rejected. */
+TEST (time, timestr2nstime_common)
+{
+  nstime_t nstime;
+
+  /* Suppress error and warning messages by accumulating them */
+  ms_rloginit (NULL, NULL, NULL, NULL, 10);
+
+  /* Fixed-width ISO and SEED shapes, parsed directly */
+  nstime = ms_timestr2nstime ("2004-05-12T07:08:09.123456788Z");
+  CHECK (nstime == 1084345689123456788, "Failed to convert time string: '2004-05-12T07:08:09.123456788Z'");
+
+  nstime = ms_timestr2nstime ("2004-05-12 07:08:09.123456");
+  CHECK (nstime == 1084345689123456000, "Failed to convert time string: '2004-05-12 07:08:09.123456'");
+
+  nstime = ms_timestr2nstime ("2004-05-12");
+  CHECK (nstime == 1084320000000000000, "Failed to convert time string: '2004-05-12'");
+
+  nstime = ms_timestr2nstime ("2004-133T07:08:09Z");
+  CHECK (nstime == 1084345689000000000, "Failed to convert time string: '2004-133T07:08:09Z'");
+
+  nstime = ms_timestr2nstime ("2004,133,07:08:09.123456788");
+  CHECK (nstime == 1084345689123456788, "Failed to convert time string: '2004,133,07:08:09.123456788'");
+
+  nstime = ms_timestr2nstime ("2004,133");
+  CHECK (nstime == 1084320000000000000, "Failed to convert time string: '2004,133'");
+
+  nstime = ms_timestr2nstime ("2000-02-29T23:59:59.9999999999Z");
+  CHECK (nstime == 951868800000000000, "Failed to convert time string: '2000-02-29T23:59:59.9999999999Z'");
+
+  nstime = ms_timestr2nstime ("1969-12-31T23:59:59.5");
+  CHECK (nstime == -500000000, "Failed to convert time string: '1969-12-31T23:59:59.5'");
+
+  /* Fixed-width shapes that are not valid times */
+  nstime = ms_timestr2nstime ("2005-02-29T00:00:00");
+  CHECK (nstime == NSTERROR, "Failed to produce error for time string: '2005-02-29T00:00:00'");
+
+  nstime = ms_timestr2nstime ("2005,366,00:00:00");
+  CHECK (nstime == NSTERROR, "Failed to produce error for time string: '2005,366,00:00:00'");
+
+  nstime = ms_timestr2nstime ("2004-05-12T24:00:00");
+  CHECK (nstime == NSTERROR, "Failed to produce error for time string: '2004-05-12T24:00:00'");
+
+  nstime = ms_timestr2nstime ("2004-05-12T07:08:09.123456789012Z");
+  CHECK (nstime == NSTERROR, "Failed to produce error for time string: '2004-05-12T07:08:09.123456789012Z'");
+
+  nstime = ms_timestr2nstime ("2004-133,07:08:09");
+  CHECK (nstime == NSTERROR, "Failed to produce error for time string: '2004-133,07:08:09'");
+}
+
 /* Verify ms_sampletime() adjusts by one second per leap second contained in
  * the span, not just the first, using the embedded leap second list (which
  * includes leaps at 2015-07-01 and 2017-01-01). */
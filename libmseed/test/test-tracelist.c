@@ -1,7 +1,12 @@
 #include <tau/tau.h>
 #include <libmseed.h>
+#include <string.h>
 #include <time.h>
 
+#if !defined(LMP_WIN)
+#include <pthread.h>
+#endif
+
 /* This test reads a miniSEED file directly into a MS3TraceList and verifies the
  * contents of the trace list against expected values.
  *
@@ -54,6 +59,58 @@ TEST (tracelist, ms3_readtracelist_mixedlengths_mixedorder)
   mstl3_free (&mstl, 1);
 }
 
+/* This test verifies that data samples decoded directly into trace segments,
+ * as done by ms3_readtracelist(), match samples unpacked into each record and
+ * copied into the trace list.  Mixed time order exercises both appending and
+ * prepending to a segment.
+ */
+TEST (tracelist, mstl3_addmsr_directdecode)
+{
+  MS3TraceList *copied = NULL;
+  MS3TraceList *decoded = NULL;
+  MS3FileParam *msfp = NULL;
+  MS3Record *msr = NULL;
+  MS3TraceSeg *cseg;
+  MS3TraceSeg *dseg;
+  int rv;
+
+  char *path = "data/testdata-oneseries-mixedlengths-mixedorder.mseed2";
+
+  copied = mstl3_init (NULL);
+  REQUIRE (copied != NULL, "mstl3_init() returned unexpected NULL");
+
+  /* Unpack each record and copy samples into the trace list */
+  while ((rv = ms3_readmsr_r (&msfp, &msr, path, MSF_UNPACKDATA, 0)) == MS_NOERROR)
+  {
+    REQUIRE (mstl3_addmsr (copied, msr, 0, 1, 0, NULL) != NULL, "mstl3_addmsr() returned NULL");
+  }
+  ms3_readmsr_r (&msfp, &msr, NULL, 0, 0);
+  CHECK (rv == MS_ENDOFFILE, "ms3_readmsr_r() did not return expected MS_ENDOFFILE");
+
+  /* Decode samples directly into the trace list */
+  rv = ms3_readtracelist (&decoded, path, NULL, 0, MSF_UNPACKDATA, 0);
+  CHECK (rv == MS_NOERROR, "ms3_readtracelist() did not return expected MS_NOERROR");
+  REQUIRE (decoded != NULL, "ms3_readtracelist() did not populate 'mstl'");
+
+  REQUIRE (copied->numtraceids == 1 && decoded->numtraceids == 1, "Unexpected trace ID count");
+
+  cseg = copied->traces.next[0]->first;
+  dseg = decoded->traces.next[0]->first;
+  REQUIRE (cseg != NULL && dseg != NULL, "Segments are not populated");
+
+  CHECK (dseg->starttime == cseg->starttime, "Segment start time mismatch");
+  CHECK (dseg->endtime == cseg->endtime, "Segment end time mismatch");
+  CHECK (dseg->samplecnt == cseg->samplecnt, "Segment sample count mismatch");
+  CHECK (dseg->numsamples == 3952, "Decoded segment numsamples is not expected 3952");
+  CHECK (dseg->sampletype == cseg->sampletype, "Segment sample type mismatch");
+  CHECK (dseg->numsamples == cseg->numsamples, "Segment numsamples mismatch");
+  CHECK (!memcmp (dseg->datasamples, cseg->datasamples, cseg->numsamples * sizeof (int32_t)),
+         "Decoded samples do not match copied samples");
+
+  mstl3_free (&copied, 0);
+  mstl3_free (&decoded, 0);
+}
+
 /* This test reads a miniSEED file directly into a MS3TraceList while using the
  * MSF_RECORDLIST flag to build a record list for each trace segment.  The
  * expected contents of the record list are verified.
@@ -656,3 +713,430 @@ TEST (tracelist, mstl3_convertsamples_double)
   CHECK (((int32_t *)seg->datasamples)[1] == -2, "Double sample did not convert as expected");
   mstl3_free (&mstl, 0);
 }
+
+/* Compare the IDs, segments and samples of two trace lists */
+static int
+compare_tracelists (MS3TraceList *mstl1, MS3TraceList *mstl2)
+{
+  MS3TraceID *id1 = mstl1->traces.next[0];
+  MS3TraceID *id2 = mstl2->traces.next[0];
+  MS3TraceSeg *seg1;
+  MS3TraceSeg *seg2;
+
+  if (mstl1->numtraceids != mstl2->numtraceids)
+    return -1;
+
+  for (; id1 && id2; id1 = id1->next[0], id2 = id2->next[0])
+  {
+    if (strcmp (id1->sid, id2->sid) || id1->pubversion != id2->pubversion ||
+        id1->earliest != id2->earliest || id1->latest != id2->latest ||
+        id1->numsegments != id2->numsegments)
+      return -1;
+
+    for (seg1 = id1->first, seg2 = id2->first; seg1 && seg2; seg1 = seg1->next, seg2 = seg2->next)
+    {
+      if (seg1->starttime != seg2->starttime || seg1->endtime != seg2->endtime ||
+          seg1->samplecnt != seg2->samplecnt || seg1->numsamples != seg2->numsamples ||
+          seg1->sampletype != seg2->sampletype ||
+          memcmp (seg1->datasamples, seg2->datasamples,
+                  seg1->numsamples * ms_samplesize (seg1->sampletype)))
+        return -1;
+    }
+
+    if (seg1 || seg2)
+      return -1;
+  }
+
+  return (id1 || id2) ? -1 : 0;
+}
+
+/* This test verifies that adding records with mstl3_addmsr_batch() results in
+ * the same trace list as adding them one at a time with mstl3_addmsr().  The
+ * records of two files are interleaved, and the mixed time order of one file
+ * exercises segment creation and merging within a batch.
+ */
+TEST (tracelist, mstl3_addmsr_batch)
+{
+  MS3TraceList *sequential = NULL;
+  MS3TraceList *batch = NULL;
+  MS3FileParam *msfp = NULL;
+  MS3Record *msr = NULL;
+  MS3Record *records[200];
+  MS3Record *file1[100];
+  MS3Record *file2[100];
+  int count1 = 0;
+  int count2 = 0;
+  int count = 0;
+  int8_t splitversion;
+  int idx;
+
+  char *path1 = "data/testdata-oneseries-mixedlengths-mixedorder.mseed2";
+  char *path2 = "data/testdata-3channel-signal.mseed3";
+
+  while (count1 < 100 && ms3_readmsr_r (&msfp, &msr, path1, MSF_UNPACKDATA, 0) == MS_NOERROR)
+    file1[count1++] = msr3_duplicate (msr, 1);
+  ms3_readmsr_r (&msfp, &msr, NULL, 0, 0);
+
+  while (count2 < 100 && ms3_readmsr_r (&msfp, &msr, path2, MSF_UNPACKDATA, 0) == MS_NOERROR)
+    file2[count2++] = msr3_duplicate (msr, 1);
+  ms3_readmsr_r (&msfp, &msr, NULL, 0, 0);
+
+  REQUIRE (count1 > 0 && count2 > 0, "Test records were not read");
+
+  /* Interleave records of both files, with a different version for some */
+  for (idx = 0; idx < count1 || idx < count2; idx++)
+  {
+    if (idx < count2)
+      records[count++] = file2[idx];
+    if (idx < count1)
+    {
+      file1[idx]->pubversion = (idx % 3) ? 1 : 2;
+      records[count++] = file1[idx];
+    }
+  }
+
+  for (splitversion = 0; splitversion <= 1; splitversion++)
+  {
+    sequential = mstl3_init (NULL);
+    batch = mstl3_init (NULL);
+    REQUIRE (sequential != NULL && batch != NULL, "mstl3_init() returned unexpected NULL");
+
+    for (idx = 0; idx < count; idx++)
+      REQUIRE (mstl3_addmsr (sequential, records[idx], splitversion, 1, 0, NULL) != NULL,
+               "mstl3_addmsr() returned NULL");
+
+    /* Add in two batches to also merge into existing trace IDs */
+    CHECK (mstl3_addmsr_batch (batch, records, count / 2, splitversion, 1, 0, NULL) == count / 2,
+           "mstl3_addmsr_batch() did not return expected count");
+    CHECK (mstl3_addmsr_batch (batch, records + count / 2, count - count / 2, splitversion, 1, 0,
+                               NULL) == count - count / 2,
+           "mstl3_addmsr_batch() did not return expected count");
+
+    CHECK (batch->numtraceids == ((splitversion) ? 5 : 4), "Unexpected number of trace IDs");
+    CHECK (compare_tracelists (sequential, batch) == 0,
+           "Batch trace list does not match sequential insertion");
+
+    mstl3_free (&sequential, 0);
+    mstl3_free (&batch, 0);
+  }
+
+  CHECK (mstl3_addmsr_batch (NULL, records, count, 0, 1, 0, NULL) == -1,
+         "mstl3_addmsr_batch() accepted NULL trace list");
+
+  for (idx = 0; idx < count; idx++)
+    msr3_free (&records[idx]);
+}
+
+/* Add a 1 Hz record of 'count' samples, valued by sample time, to a trace list */
+static MS3TraceSeg *
+add_sequence (MS3TraceList *mstl, const char *sid, int64_t startsecond, int count)
+{
+  MS3Record msr = MS3Record_INITIALIZER;
+  int32_t data[100];
+
+  for (int idx = 0; idx < count && idx < 100; idx++)
+    data[idx] = (int32_t)(startsecond + idx);
+
+  strcpy (msr.sid, sid);
+  msr.pubversion = 1;
+  msr.starttime = startsecond * NSTMODULUS;
+  msr.samprate = 1.0;
+  msr.datasamples = data;
+  msr.sampletype = 'i';
+  msr.numsamples = count;
+  msr.samplecnt = count;
+
+  return mstl3_addmsr (mstl, &msr, 0, 1, 0, NULL);
+}
+
+/* This test verifies that merging trace lists with mstl3_merge() results in
+ * the same trace list as adding all records to a single list, that segments
+ * not joining existing coverage are moved without copying, and that
+ * segments bridging a gap are healed.
+ */
+TEST (tracelist, mstl3_merge)
+{
+  MS3TraceList *single = NULL;
+  MS3TraceList *merged = NULL;
+  MS3TraceList *part[2] = {NULL, NULL};
+  MS3TraceSeg *moved;
+  MS3FileParam *msfp = NULL;
+  MS3Record *msr = NULL;
+  MS3TraceID *id;
+  void *samples;
+  int count = 0;
+  int rv;
+
+  char *paths[] = {"data/testdata-oneseries-mixedlengths-mixedorder.mseed2",
+                   "data/testdata-3channel-signal.mseed3"};
+
+  single = mstl3_init (NULL);
+  part[0] = mstl3_init (NULL);
+  part[1] = mstl3_init (NULL);
+  REQUIRE (single != NULL && part[0] != NULL && part[1] != NULL,
+           "mstl3_init() returned unexpected NULL");
+
+  /* Alternate records of both files between two trace lists */
+  for (int file = 0; file < 2; file++)
+  {
+    while ((rv = ms3_readmsr_r (&msfp, &msr, paths[file], MSF_UNPACKDATA, 0)) == MS_NOERROR)
+    {
+      REQUIRE (mstl3_addmsr (single, msr, 0, 1, 0, NULL) != NULL, "mstl3_addmsr() returned NULL");
+      REQUIRE (mstl3_addmsr (part[count++ % 2], msr, 0, 1, 0, NULL) != NULL,
+               "mstl3_addmsr() returned NULL");
+    }
+    ms3_readmsr_r (&msfp, &msr, NULL, 0, 0);
+    CHECK (rv == MS_ENDOFFILE, "ms3_readmsr_r() did not return expected MS_ENDOFFILE");
+  }
+
+  merged = mstl3_init (NULL);
+  REQUIRE (merged != NULL, "mstl3_init() returned unexpected NULL");
+
+  CHECK (mstl3_merge (merged, &part[0], 0, 1, 0, NULL) == 0, "mstl3_merge() failed");
+  CHECK (mstl3_merge (merged, &part[1], 0, 1, 0, NULL) == 0, "mstl3_merge() failed");
+  CHECK (part[0] == NULL && part[1] == NULL, "Source trace lists were not freed");
+  CHECK (compare_tracelists (single, merged) == 0, "Merged trace list does not match");
+
+  mstl3_free (&single, 0);
+  mstl3_free (&merged, 0);
+
+  /* Coverage of 0-9 and 20-29 seconds, and a separate 100-109 */
+  merged = mstl3_init (NULL);
+  part[0] = mstl3_init (NULL);
+  REQUIRE (merged != NULL && part[0] != NULL, "mstl3_init() returned unexpected NULL");
+
+  REQUIRE (add_sequence (merged, "FDSN:XX_TEST__B_H_Z", 0, 10), "add_sequence() failed");
+  REQUIRE (add_sequence (merged, "FDSN:XX_TEST__B_H_Z", 20, 10), "add_sequence() failed");
+  REQUIRE ((moved = add_sequence (part[0], "FDSN:XX_TEST__B_H_Z", 100, 10)),
+           "add_sequence() failed");
+  samples = moved->datasamples;
+
+  CHECK (mstl3_merge (merged, &part[0], 0, 1, 0, NULL) == 0, "mstl3_merge() failed");
+
+  id = merged->traces.next[0];
+  REQUIRE (id != NULL, "Merged trace ID not found");
+  CHECK (id->numsegments == 3, "Unexpected number of segments");
+  CHECK (id->last == moved && id->last->datasamples == samples,
+         "Non-overlapping segment was not moved");
+
+  /* Filling the gap heals the first two segments */
+  part[0] = mstl3_init (NULL);
+  REQUIRE (part[0] != NULL, "mstl3_init() returned unexpected NULL");
+  REQUIRE (add_sequence (part[0], "FDSN:XX_TEST__B_H_Z", 10, 10), "add_sequence() failed");
+  REQUIRE (add_sequence (part[0], "FDSN:XX_TEST__B_H_Z", 90, 10), "add_sequence() failed");
+
+  CHECK (mstl3_merge (merged, &part[0], 0, 1, 0, NULL) == 0, "mstl3_merge() failed");
+
+  CHECK (id->numsegments == 2, "Unexpected number of segments after healing");
+  CHECK (id->first->starttime == 0 && id->first->endtime == (nstime_t)29 * NSTMODULUS,
+         "Unexpected coverage of healed segment");
+  CHECK (id->last->starttime == (nstime_t)90 * NSTMODULUS &&
+             id->last->endtime == (nstime_t)109 * NSTMODULUS,
+         "Unexpected coverage of prepended segment");
+  CHECK (id->earliest == 0 && id->latest == (nstime_t)109 * NSTMODULUS,
+         "Unexpected trace ID extent");
+
+  for (int idx = 0; idx < 30; idx++)
+    CHECK (((int32_t *)id->first->datasamples)[idx] == idx, "Unexpected healed sample value");
+  for (int idx = 0; idx < 20; idx++)
+    CHECK (((int32_t *)id->last->datasamples)[idx] == 90 + idx,
+           "Unexpected prepended sample value");
+
+  CHECK (mstl3_merge (merged, &merged, 0, 1, 0, NULL) == -1, "mstl3_merge() accepted same list");
+
+  mstl3_free (&merged, 0);
+}
+
+#if !defined(LMP_WIN)
+#define SHARDS_CHANNELS 16
+#define SHARDS_RECORDS 40
+#define SHARDS_SAMPLES 50
+#define SHARDS_THREADS 4
+
+typedef struct ShardsThread
+{
+  MS3TraceListShards *shards;
+  int thread;
+  int errors;
+} ShardsThread;
+
+/* Add every SHARDS_THREADS'th record of each channel, starting at the thread number */
+static void *
+shards_add_thread (void *arg)
+{
+  ShardsThread *st = (ShardsThread *)arg;
+  MS3Record msr = MS3Record_INITIALIZER;
+  int32_t data[SHARDS_SAMPLES];
+
+  msr.pubversion = 1;
+  msr.samprate = 1.0;
+  msr.datasamples = data;
+  msr.sampletype = 'i';
+  msr.numsamples = SHARDS_SAMPLES;
+  msr.samplecnt = SHARDS_SAMPLES;
+
+  for (int record = st->thread; record < SHARDS_RECORDS; record += SHARDS_THREADS)
+  {
+    for (int channel = 0; channel < SHARDS_CHANNELS; channel++)
+    {
+      snprintf (msr.sid, sizeof (msr.sid), "FDSN:XX_S%02d__B_H_Z", channel);
+      msr.starttime = (nstime_t)record * SHARDS_SAMPLES * NSTMODULUS;
+
+      for (int idx = 0; idx < SHARDS_SAMPLES; idx++)
+        data[idx] = channel * 10000 + record * SHARDS_SAMPLES + idx;
+
+      if (mstl3_shards_addmsr (st->shards, &msr, 0, 1, 0, NULL))
+        st->errors++;
+    }
+  }
+
+  return NULL;
+}
+
+/* This test adds records to a sharded trace list from multiple threads in
+ * no particular order and verifies that the acquired trace list contains a
+ * single, healed segment for each channel.
+ */
+TEST (tracelist, mstl3_shards)
+{
+  MS3TraceListShards *shards = NULL;
+  MS3TraceList *mstl = NULL;
+  MS3TraceID *id;
+  ShardsThread st[SHARDS_THREADS];
+  pthread_t tid[SHARDS_THREADS];
+  int channel = 0;
+  int errors = 0;
+
+  shards = mstl3_shards_init (5);
+  REQUIRE (shards != NULL, "mstl3_shards_init() returned unexpected NULL");
+  CHECK (mstl3_shards_release (shards) == -1, "mstl3_shards_release() accepted unacquired shards");
+
+  for (int thread = 0; thread < SHARDS_THREADS; thread++)
+  {
+    st[thread].shards = shards;
+    st[thread].thread = thread;
+    st[thread].errors = 0;
+    REQUIRE (pthread_create (&tid[thread], NULL, shards_add_thread, &st[thread]) == 0,
+             "pthread_create() failed");
+  }
+
+  for (int thread = 0; thread < SHARDS_THREADS; thread++)
+  {
+    pthread_join (tid[thread], NULL);
+    errors += st[thread].errors;
+  }
+
+  CHECK (errors == 0, "mstl3_shards_addmsr() returned errors");
+
+  mstl = mstl3_shards_acquire (shards);
+  REQUIRE (mstl != NULL, "mstl3_shards_acquire() returned unexpected NULL");
+  CHECK (mstl->numtraceids == SHARDS_CHANNELS, "Unexpected number of trace IDs");
+
+  /* Trace IDs are in source ID order */
+  for (id = mstl->traces.next[0]; id; id = id->next[0], channel++)
+  {
+    char sid[LM_SIDLEN];
+    int32_t *samples = (int32_t *)id->first->datasamples;
+    int matching = 1;
+
+    snprintf (sid, sizeof (sid), "FDSN:XX_S%02d__B_H_Z", channel);
+    CHECK_STREQ (id->sid, sid);
+    CHECK (id->numsegments == 1, "Unexpected number of segments");
+    CHECK (id->first->numsamples == SHARDS_RECORDS * SHARDS_SAMPLES,
+           "Unexpected number of samples");
+
+    for (int idx = 0; idx < id->first->numsamples; idx++)
+      if (samples[idx] != channel * 10000 + idx)
+        matching = 0;
+
+    CHECK (matching, "Unexpected sample values");
+  }
+
+  /* Add a trace ID while acquired, returned to a shard on release */
+  REQUIRE (add_sequence (mstl, "FDSN:XX_NEW__B_H_Z", 0, 10), "add_sequence() failed");
+  CHECK (mstl3_shards_release (shards) == 0, "mstl3_shards_release() failed");
+
+  mstl = mstl3_shards_acquire (shards);
+  REQUIRE (mstl != NULL, "mstl3_shards_acquire() returned unexpected NULL");
+  CHECK (mstl->numtraceids == SHARDS_CHANNELS + 1, "Unexpected number of trace IDs");
+  CHECK (mstl3_shards_release (shards) == 0, "mstl3_shards_release() failed");
+
+  mstl3_shards_free (&shards, 0);
+  CHECK (shards == NULL, "mstl3_shards_free() did not reset pointer");
+}
+#endif /* !defined(LMP_WIN) */
+
+#define VERSIONS_COUNT 6
+
+/* Verify a trace list of VERSIONS_COUNT versions of a source ID, each with
+ * two segments, followed by a single version of a second source ID */
+static int
+check_versions (MS3TraceList *mstl)
+{
+  MS3TraceID *id = mstl->traces.next[0];
+
+  if (mstl->numtraceids != VERSIONS_COUNT + 1)
+    return 0;
+
+  for (int version = 1; version <= VERSIONS_COUNT; version++, id = id->next[0])
+  {
+    if (!id || strcmp (id->sid, "FDSN:XX_VER__B_H_Z") || id->pubversion != version ||
+        id->numsegments != 2 || id->first->numsamples != 10 || id->last->numsamples != 10)
+      return 0;
+  }
+
+  return (id && !strcmp (id->sid, "FDSN:XX_WXYZ__B_H_Z") && !id->next[0]);
+}
+
+/* This test adds several publication versions of a source ID to a sharded
+ * trace list and verifies that all trace IDs and segments are retained when
+ * acquired and released repeatedly.
+ */
+TEST (tracelist, mstl3_shards_versions)
+{
+  MS3TraceListShards *shards = NULL;
+  MS3TraceList *mstl = NULL;
+  MS3Record msr = MS3Record_INITIALIZER;
+  int32_t data[10] = {0};
+  int errors = 0;
+
+  shards = mstl3_shards_init (3);
+  REQUIRE (shards != NULL, "mstl3_shards_init() returned unexpected NULL");
+
+  msr.samprate = 1.0;
+  msr.datasamples = data;
+  msr.sampletype = 'i';
+  msr.numsamples = 10;
+  msr.samplecnt = 10;
+
+  /* Versions added in descending order, each with two separate segments */
+  strcpy (msr.sid, "FDSN:XX_VER__B_H_Z");
+  for (int version = VERSIONS_COUNT; version >= 1; version--)
+  {
+    msr.pubversion = version;
+    msr.starttime = 0;
+    if (mstl3_shards_addmsr (shards, &msr, 1, 1, 0, NULL))
+      errors++;
+    msr.starttime = (nstime_t)100 * NSTMODULUS;
+    if (mstl3_shards_addmsr (shards, &msr, 1, 1, 0, NULL))
+      errors++;
+  }
+
+  strcpy (msr.sid, "FDSN:XX_WXYZ__B_H_Z");
+  msr.pubversion = 1;
+  msr.starttime = 0;
+  if (mstl3_shards_addmsr (shards, &msr, 1, 1, 0, NULL))
+    errors++;
+
+  CHECK (errors == 0, "mstl3_shards_addmsr() returned errors");
+
+  for (int pass = 0; pass < 3; pass++)
+  {
+    mstl = mstl3_shards_acquire (shards);
+    REQUIRE (mstl != NULL, "mstl3_shards_acquire() returned unexpected NULL");
+    CHECK (check_versions (mstl), "Unexpected trace IDs in acquired trace list");
+    REQUIRE (mstl3_shards_release (shards) == 0, "mstl3_shards_release() failed");
+  }
+
+  mstl3_shards_free (&shards, 0);
+}
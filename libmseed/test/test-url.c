@@ -0,0 +1,413 @@
+#include <tau/tau.h>
+#include <libmseed.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(LIBMSEED_URL) && !defined(LMP_WIN)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define MAXCLIENTS 64
+
+/* A minimal HTTP server on the loopback interface serving a file from
+ * memory for any path except "/missing", with optional support for byte
+ * ranges and persistent connections. */
+typedef struct TestServer
+{
+  int listenfd;
+  int port;
+  char *data;
+  size_t length;
+  int ranges;         /* Set to accept byte range requests */
+  int keepalive;      /* Set to keep connections open between requests */
+  int rangerequests;  /* Number of range requests served */
+  int requests;       /* Number of requests served */
+  int connections;    /* Number of connections accepted */
+  volatile int stop;
+  pthread_t thread;
+} TestServer;
+
+static void
+send_all (int fd, const char *buffer, size_t length)
+{
+  ssize_t rv;
+
+  while (length > 0 && (rv = send (fd, buffer, length, MSG_NOSIGNAL)) > 0)
+  {
+    buffer += rv;
+    length -= (size_t)rv;
+  }
+}
+
+/* Serve a request from a connection, returning 0 if the connection
+ * remains open for further requests */
+static int
+serve_request (TestServer *server, int fd)
+{
+  char request[4096];
+  char header[512];
+  size_t length = 0;
+  ssize_t rv;
+  char *range;
+  long long first = 0;
+  long long last = (long long)server->length - 1;
+  int head;
+  int partial = 0;
+
+  while (length < sizeof (request) - 1 &&
+         (rv = recv (fd, request + length, sizeof (request) - 1 - length, 0)) > 0)
+  {
+    length += (size_t)rv;
+    request[length] = '\0';
+
+    if (strstr (request, "\r\n\r\n"))
+      break;
+  }
+
+  if (length == 0)
+    return -1;
+
+  request[length] = '\0';
+  head = (strncmp (request, "HEAD ", 5) == 0);
+  server->requests++;
+
+  if (strstr (request, " /missing "))
+  {
+    snprintf (header, sizeof (header),
+              "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: %s\r\n\r\n",
+              (server->keepalive) ? "keep-alive" : "close");
+    send_all (fd, header, strlen (header));
+
+    return (server->keepalive) ? 0 : -1;
+  }
+
+  if (server->ranges && (range = strstr (request, "Range: bytes=")) &&
+      sscanf (range + 13, "%lld-%lld", &first, &last) == 2 && first <= last &&
+      last < (long long)server->length)
+  {
+    partial = 1;
+    server->rangerequests++;
+  }
+  else
+  {
+    first = 0;
+    last = (long long)server->length - 1;
+  }
+
+  if (partial)
+    snprintf (header, sizeof (header),
+              "HTTP/1.1 206 Partial Content\r\nContent-Range: bytes %lld-%lld/%zu\r\n"
+              "Content-Length: %lld\r\nConnection: %s\r\n\r\n",
+              first, last, server->length, last - first + 1,
+              (server->keepalive) ? "keep-alive" : "close");
+  else
+    snprintf (header, sizeof (header),
+              "HTTP/1.1 200 OK\r\n%sContent-Length: %zu\r\nConnection: %s\r\n\r\n",
+              (server->ranges) ? "Accept-Ranges: bytes\r\n" : "", server->length,
+              (server->keepalive) ? "keep-alive" : "close");
+
+  send_all (fd, header, strlen (header));
+
+  if (!head)
+    send_all (fd, server->data + first, (size_t)(last - first + 1));
+
+  return (server->keepalive) ? 0 : -1;
+}
+
+static void *
+server_thread (void *arg)
+{
+  TestServer *server = (TestServer *)arg;
+  struct pollfd fds[MAXCLIENTS + 1];
+  int nfds = 1;
+  int idx;
+  int fd;
+
+  fds[0].fd = server->listenfd;
+  fds[0].events = POLLIN;
+
+  while (poll (fds, nfds, -1) >= 0)
+  {
+    if (fds[0].revents & POLLIN)
+    {
+      if ((fd = accept (server->listenfd, NULL, NULL)) < 0 || server->stop)
+      {
+        if (fd >= 0)
+          close (fd);
+        break;
+      }
+
+      server->connections++;
+
+      if (nfds <= MAXCLIENTS)
+      {
+        fds[nfds].fd = fd;
+        fds[nfds].events = POLLIN;
+        fds[nfds].revents = 0;
+        nfds++;
+      }
+      else
+      {
+        close (fd);
+      }
+    }
+
+    for (idx = 1; idx < nfds; idx++)
+    {
+      if (fds[idx].revents == 0)
+        continue;
+
+      if ((fds[idx].revents & POLLIN) && serve_request (server, fds[idx].fd) == 0)
+        continue;
+
+      /* Connection closed, replace with the last entry */
+      close (fds[idx].fd);
+      fds[idx] = fds[--nfds];
+      idx--;
+    }
+  }
+
+  for (idx = 1; idx < nfds; idx++)
+    close (fds[idx].fd);
+
+  return NULL;
+}
+
+static int
+server_start (TestServer *server, const char *path, int ranges, int keepalive)
+{
+  struct sockaddr_in addr;
+  socklen_t addrlen = sizeof (addr);
+  FILE *fp;
+
+  memset (server, 0, sizeof (TestServer));
+  server->ranges = ranges;
+  server->keepalive = keepalive;
+
+  if ((fp = fopen (path, "rb")) == NULL)
+    return -1;
+
+  fseek (fp, 0, SEEK_END);
+  server->length = (size_t)ftell (fp);
+  fseek (fp, 0, SEEK_SET);
+
+  if ((server->data = (char *)malloc (server->length)) == NULL ||
+      fread (server->data, 1, server->length, fp) != server->length)
+  {
+    fclose (fp);
+    return -1;
+  }
+  fclose (fp);
+
+  memset (&addr, 0, sizeof (addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  addr.sin_port = 0;
+
+  if ((server->listenfd = socket (AF_INET, SOCK_STREAM, 0)) < 0 ||
+      bind (server->listenfd, (struct sockaddr *)&addr, sizeof (addr)) ||
+      listen (server->listenfd, 64) ||
+      getsockname (server->listenfd, (struct sockaddr *)&addr, &addrlen))
+    return -1;
+
+  server->port = ntohs (addr.sin_port);
+
+  return pthread_create (&server->thread, NULL, server_thread, server);
+}
+
+static void
+server_stop (TestServer *server)
+{
+  struct sockaddr_in addr;
+  int fd;
+
+  /* Wake the server with a connection after setting the stop flag */
+  server->stop = 1;
+
+  memset (&addr, 0, sizeof (addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  addr.sin_port = htons (server->port);
+
+  if ((fd = socket (AF_INET, SOCK_STREAM, 0)) >= 0)
+  {
+    connect (fd, (struct sockaddr *)&addr, sizeof (addr));
+    close (fd);
+  }
+
+  pthread_join (server->thread, NULL);
+  close (server->listenfd);
+  free (server->data);
+}
+
+/* Read all records of a URL and a local file in lockstep, returning the
+ * number of records or -1 if any record differs */
+static int
+compare_records (const char *url, const char *path)
+{
+  MS3FileParam *urlmsfp = NULL;
+  MS3FileParam *filemsfp = NULL;
+  MS3Record *urlmsr = NULL;
+  MS3Record *filemsr = NULL;
+  int urlrv;
+  int filerv;
+  int count = 0;
+
+  for (;;)
+  {
+    urlrv = ms3_readmsr_r (&urlmsfp, &urlmsr, url, MSF_PNAMERANGE, 0);
+    filerv = ms3_readmsr_r (&filemsfp, &filemsr, path, MSF_PNAMERANGE, 0);
+
+    if (urlrv != filerv)
+    {
+      count = -1;
+      break;
+    }
+
+    if (urlrv != MS_NOERROR)
+      break;
+
+    if (urlmsr->reclen != filemsr->reclen ||
+        memcmp (urlmsr->record, filemsr->record, urlmsr->reclen))
+    {
+      count = -1;
+      break;
+    }
+
+    count++;
+  }
+
+  ms3_readmsr_r (&urlmsfp, &urlmsr, NULL, 0, 0);
+  ms3_readmsr_r (&filemsfp, &filemsr, NULL, 0, 0);
+
+  return count;
+}
+
+/* This test reads records from a local HTTP server with concurrent range
+ * requests and verifies that the records are identical to those read from
+ * the file, for the whole file and a byte range, and that a server without
+ * range support is read with a single request.
+ */
+TEST (url, parallel_ranges)
+{
+  TestServer server;
+  char url[256];
+  char urlrange[256];
+  char *path = "data/testdata-3channel-signal.mseed3";
+  char *pathrange = "data/testdata-3channel-signal.mseed3@13964-40039";
+  int records;
+
+  /* The library may be built without URL support */
+  if (!libmseed_url_support ())
+    return;
+
+  REQUIRE (server_start (&server, path, 1, 0) == 0, "Cannot start test HTTP server");
+
+  snprintf (url, sizeof (url), "http://127.0.0.1:%d/data.mseed3", server.port);
+  snprintf (urlrange, sizeof (urlrange), "http://127.0.0.1:%d/data.mseed3@13964-40039",
+            server.port);
+
+  /* Whole file in chunks not aligned to records, with 3 concurrent requests */
+  CHECK (ms3_url_parallel (3, 5000) == 0, "ms3_url_parallel() did not return 0");
+
+  records = compare_records (url, path);
+  CHECK (records > 0, "Records read with range requests differ from file");
+  CHECK (server.rangerequests == 12, "Unexpected number of range requests");
+
+  /* A byte range of the file */
+  server.rangerequests = 0;
+  records = compare_records (urlrange, pathrange);
+  CHECK (records > 0, "Records read from a byte range with range requests differ from file");
+  CHECK (server.rangerequests == 6, "Unexpected number of range requests for a byte range");
+
+  /* A single chunk is read with a single request */
+  CHECK (ms3_url_parallel (3, 100000) == 0, "ms3_url_parallel() did not return 0");
+  server.rangerequests = 0;
+  records = compare_records (url, path);
+  CHECK (records > 0, "Records read with a single request differ from file");
+  CHECK (server.rangerequests == 0, "Range requests used for a single chunk");
+
+  server_stop (&server);
+
+  /* Server without range support is read with a single request */
+  REQUIRE (server_start (&server, path, 0, 0) == 0, "Cannot start test HTTP server");
+  snprintf (url, sizeof (url), "http://127.0.0.1:%d/data.mseed3", server.port);
+
+  CHECK (ms3_url_parallel (3, 5000) == 0, "ms3_url_parallel() did not return 0");
+  records = compare_records (url, path);
+  CHECK (records > 0, "Records read from server without range support differ from file");
+  CHECK (server.requests == 2, "Unexpected number of requests without range support");
+
+  server_stop (&server);
+
+  CHECK (ms3_url_parallel (0, 0) == 0, "ms3_url_parallel() did not return 0");
+  CHECK (ms3_url_parallel (65, 0) != 0, "ms3_url_parallel() accepted too many connections");
+}
+
+/* This test reads several URLs from a server keeping connections open,
+ * verifying that a connection is reused by sequential reads, that
+ * prefetched transfers are used when the URLs are read, and that a
+ * prefetched URL that does not exist fails when read.
+ */
+TEST (url, reuse_prefetch)
+{
+  TestServer server;
+  MS3FileParam *msfp = NULL;
+  MS3Record *msr = NULL;
+  char url[3][256];
+  char missing[256];
+  char *path = "data/testdata-3channel-signal.mseed3";
+  int idx;
+  int rv;
+
+  /* The library may be built without URL support */
+  if (!libmseed_url_support ())
+    return;
+
+  REQUIRE (server_start (&server, path, 0, 1) == 0, "Cannot start test HTTP server");
+  REQUIRE (ms3_url_parallel (0, 0) == 0, "ms3_url_parallel() did not return 0");
+
+  for (idx = 0; idx < 3; idx++)
+    snprintf (url[idx], sizeof (url[idx]), "http://127.0.0.1:%d/data%d.mseed3", server.port, idx);
+
+  /* Sequential reads reuse a single connection */
+  for (idx = 0; idx < 3; idx++)
+    CHECK (compare_records (url[idx], path) > 0, "Records read from URL differ from file");
+
+  CHECK (server.requests == 3, "Unexpected number of requests for sequential reads");
+  CHECK (server.connections == 1, "Connection not reused for sequential reads");
+
+  /* Prefetched URLs are requested once, a repeated prefetch is ignored */
+  server.requests = 0;
+  for (idx = 0; idx < 3; idx++)
+    CHECK (ms3_url_prefetch (url[idx], 0) == 0, "ms3_url_prefetch() did not return 0");
+  CHECK (ms3_url_prefetch (url[0], 0) == 0, "ms3_url_prefetch() did not return 0");
+
+  for (idx = 0; idx < 3; idx++)
+    CHECK (compare_records (url[idx], path) > 0, "Records read from prefetched URL differ from file");
+
+  CHECK (server.requests == 3, "Prefetched transfers not used when URLs are read");
+
+  /* Suppress error messages by accumulating them */
+  ms_rloginit (NULL, NULL, NULL, NULL, 10);
+
+  /* A prefetched URL that does not exist fails when read */
+  snprintf (missing, sizeof (missing), "http://127.0.0.1:%d/missing", server.port);
+  CHECK (ms3_url_prefetch (missing, 0) == 0, "ms3_url_prefetch() did not return 0");
+
+  rv = ms3_readmsr_r (&msfp, &msr, missing, 0, 0);
+  CHECK (rv == MS_GENERROR, "Reading a missing prefetched URL did not fail");
+  ms3_readmsr_r (&msfp, &msr, NULL, 0, 0);
+
+  /* Paths that are not URLs, or include a byte range, are not prefetched */
+  CHECK (ms3_url_prefetch (path, 0) == 0, "ms3_url_prefetch() did not return 0 for a file");
+  CHECK (ms3_url_prefetch (NULL, 0) == 0, "ms3_url_prefetch() did not cancel prefetches");
+
+  server_stop (&server);
+}
+#endif /* defined(LIBMSEED_URL) && !defined(LMP_WIN) */
@@ -93,6 +93,11 @@ extern int cmpfiles (char *fileA, char *fileB);
 #define TESTFILE_B500FIELDS_V2 "testdata-b500fields.mseed2"
 #define TESTFILE_SAMPLECOUNT_V2 "testdata-samplecount.mseed2"
 #define TESTFILE_MSTLPACK_EXTRA_V2 "testdata-mstlpack-extra.mseed2"
+#define TESTFILE_MSTLPACK_PARALLEL_V3 "testdata-mstlpack-parallel.mseed3"
+#define TESTFILE_MSTLPACK_SERIAL_PARTIAL "testdata-mstlpack-serial-partial.mseed3"
+#define TESTFILE_MSTLPACK_PARALLEL_PARTIAL "testdata-mstlpack-parallel-partial.mseed3"
+#define TESTFILE_MSTLPACK_SERIAL_LONG "testdata-mstlpack-serial-long.mseed"
+#define TESTFILE_MSTLPACK_PARALLEL_LONG "testdata-mstlpack-parallel-long.mseed"
 
 /* Test writing miniSEED records to a file for each supported encoding and
  * verifies the output against reference files.
@@ -951,6 +956,119 @@ TEST (write, mstl3_writemseed)
   msr3_free (&msr);
 }
 
+/* Test writing miniSEED records with a buffered writer, verify output
+ * against a reference file, appending, and that preallocated space for
+ * a fixed width encoding is not left in the file.
+ */
+TEST (write, ms3_writer)
+{
+  MS3Record *msr = NULL;
+  MS3Record *rmsr = NULL;
+  MS3TraceList *mstl = NULL;
+  MS3Writer *writer = NULL;
+  MS3Writer *other = NULL;
+  FILE *fp;
+  int32_t isinedata[SINE_DATA_SAMPLES];
+  int64_t reclensum = 0;
+  int64_t filesize;
+  int reccount = 0;
+  int idx;
+  int64_t rv;
+
+  for (idx = 0; idx < SINE_DATA_SAMPLES; idx++)
+  {
+    isinedata[idx] = (int32_t)(dsinedata[idx]);
+  }
+
+  msr = msr3_init (msr);
+  REQUIRE (msr != NULL, "msr3_init() returned unexpected NULL");
+
+  mstl = mstl3_init (mstl);
+  REQUIRE (mstl != NULL, "mstl3_init() returned unexpected NULL");
+
+  msr->reclen = 512;
+  msr->pubversion = 1;
+  msr->starttime = ms_timestr2nstime ("2012-05-12T00:00:00");
+
+  strcpy (msr->sid, "FDSN:XX_TEST__B_H_Z");
+  msr->samprate    = 40.0;
+  msr->numsamples  = SINE_DATA_SAMPLES - 1;
+  msr->datasamples = isinedata;
+  msr->sampletype  = 'i';
+
+  REQUIRE (mstl3_addmsr (mstl, msr, 0, 1, 0, NULL) != NULL, "mstl3_addmsr() returned unexpected NULL");
+
+  /* Same output as mstl3_writemseed() */
+  writer = ms3_writer_open (TESTFILE_STEIM2_V3 ".writer", 1);
+  REQUIRE (writer != NULL, "ms3_writer_open() returned unexpected NULL");
+
+  rv = mstl3_writemseed_w (writer, mstl, 512, DE_STEIM2, 0, 0);
+  CHECK (rv == 4, "mstl3_writemseed_w() return unexpected value");
+
+  CHECK (ms3_writer_close (&writer) == 0, "ms3_writer_close() returned an error");
+  CHECK (writer == NULL, "ms3_writer_close() did not reset writer");
+  CHECK (!cmpfiles (TESTFILE_STEIM2_V3 ".writer", "data/reference-" TESTFILE_STEIM2_V3),
+         "Steim2 encoding writer mismatch");
+
+  /* Append records of a fixed width encoding, preallocating space */
+  writer = ms3_writer_open (TESTFILE_STEIM2_V3 ".writer", 0);
+  REQUIRE (writer != NULL, "ms3_writer_open() returned unexpected NULL");
+
+  rv = mstl3_writemseed_w (writer, mstl, 512, DE_INT32, 0, 0);
+  CHECK (rv > 0, "mstl3_writemseed_w() return unexpected value");
+
+  rv = msr3_writemseed_w (writer, msr, MSF_FLUSHDATA, 0);
+  CHECK (rv == 4, "msr3_writemseed_w() return unexpected value");
+
+  CHECK (ms3_writer_close (&writer) == 0, "ms3_writer_close() returned an error");
+
+  while (ms3_readmsr (&rmsr, TESTFILE_STEIM2_V3 ".writer", 0, 0) == MS_NOERROR)
+  {
+    reclensum += rmsr->reclen;
+    reccount++;
+  }
+  ms3_readmsr (&rmsr, NULL, 0, 0);
+
+  fp = fopen (TESTFILE_STEIM2_V3 ".writer", "rb");
+  REQUIRE (fp != NULL, "Cannot open written file");
+  fseek (fp, 0, SEEK_END);
+  filesize = ftell (fp);
+  fclose (fp);
+
+  CHECK (reccount > 8, "Appended records not read");
+  CHECK (filesize == reclensum, "Written file size does not match records");
+
+  /* Closing a writer does not remove records appended by another writer */
+  writer = ms3_writer_open (TESTFILE_STEIM2_V3 ".writer", 1);
+  REQUIRE (writer != NULL, "ms3_writer_open() returned unexpected NULL");
+  CHECK (ms3_writer_close (&writer) == 0, "ms3_writer_close() returned an error");
+
+  writer = ms3_writer_open (TESTFILE_STEIM2_V3 ".writer", 0);
+  REQUIRE (writer != NULL, "ms3_writer_open() returned unexpected NULL");
+  rv = mstl3_writemseed_w (writer, mstl, 512, DE_INT32, 0, 0);
+  CHECK (rv > 0, "mstl3_writemseed_w() return unexpected value");
+  CHECK (ms3_writer_flush (writer) == 0, "ms3_writer_flush() returned an error");
+
+  other = ms3_writer_open (TESTFILE_STEIM2_V3 ".writer", 0);
+  REQUIRE (other != NULL, "ms3_writer_open() returned unexpected NULL");
+  rv += msr3_writemseed_w (other, msr, MSF_FLUSHDATA, 0);
+  CHECK (ms3_writer_close (&other) == 0, "ms3_writer_close() returned an error");
+
+  CHECK (ms3_writer_close (&writer) == 0, "ms3_writer_close() returned an error");
+
+  reccount = 0;
+  while (ms3_readmsr (&rmsr, TESTFILE_STEIM2_V3 ".writer", 0, 0) == MS_NOERROR)
+    reccount++;
+  ms3_readmsr (&rmsr, NULL, 0, 0);
+
+  CHECK (reccount == rv, "Records appended by another writer were removed");
+
+  mstl3_free (&mstl, 0);
+
+  msr->datasamples = NULL;
+  msr3_free (&msr);
+}
+
 /***************************************************************************
  *
  * Internal record handler.  The handler data should be a pointer to
@@ -1569,6 +1687,286 @@ TEST (pack, mstl3_pack_maintainmstl)
   mstl3_free (&mstl, 0);
 }
 
+/* Test packing miniSEED records from a MS3TraceList with multiple threads.
+ *
+ * This test should reproduce the results of the mstl3_pack_v3 test and verify
+ * output against the same reference data.
+ */
+TEST (pack, mstl3_pack_parallel_v3)
+{
+  MS3Record msr = MS3Record_INITIALIZER;
+  MS3TraceList *mstl = NULL;
+  MS3TraceSeg *seg = NULL;
+  FILE *ofp = NULL;
+  int32_t isinedata[SINE_DATA_SAMPLES];
+  int64_t rv;
+
+  /* Create integer sine data set */
+  for (int idx = 0; idx < SINE_DATA_SAMPLES; idx++)
+  {
+    isinedata[idx] = (int32_t)(dsinedata[idx]);
+  }
+
+  mstl = mstl3_init (mstl);
+  REQUIRE (mstl != NULL, "mstl3_init() returned unexpected NULL");
+
+  /* Common record parameters */
+  msr.reclen = 512;
+  msr.pubversion = 1;
+  msr.datasamples = isinedata;
+  msr.sampletype = 'i';
+
+  /* Add a H_H_Z trace */
+  strcpy (msr.sid, "FDSN:XX_TEST__H_H_Z");
+  msr.samprate = 100.0;
+  msr.starttime = ms_timestr2nstime ("2012-05-12T00:00:00.123456789Z");
+  msr.numsamples = SINE_DATA_SAMPLES;
+  msr.samplecnt = msr.numsamples;
+
+  seg = mstl3_addmsr (mstl, &msr, 0, 1, 0, NULL);
+  REQUIRE (seg != NULL, "mstl3_addmsr() returned unexpected NULL");
+
+  /* Add a B_H_Z trace */
+  strcpy (msr.sid, "FDSN:XX_TEST__B_H_Z");
+  msr.samprate = 40.0;
+  msr.starttime = ms_timestr2nstime ("2012-05-12T00:00:00.123456789Z");
+  msr.numsamples = SINE_DATA_SAMPLES;
+  msr.samplecnt = msr.numsamples;
+
+  seg = mstl3_addmsr (mstl, &msr, 0, 1, 0, NULL);
+  REQUIRE (seg != NULL, "mstl3_addmsr() returned unexpected NULL");
+
+  /* Open file for generated miniSEED records */
+  ofp = fopen (TESTFILE_MSTLPACK_PARALLEL_V3, "wb");
+  REQUIRE (ofp != NULL, "Failed to open output file");
+
+  int64_t packedsamples = 0;
+  rv = mstl3_pack_parallel (mstl, record_handler_int, ofp, 512, DE_STEIM1, &packedsamples,
+                            MSF_FLUSHDATA, 0, NULL, 4);
+  REQUIRE (rv == 8, "mstl3_pack_parallel() return unexpected value");
+  CHECK (packedsamples == SINE_DATA_SAMPLES + SINE_DATA_SAMPLES, "Packed samples mismatch");
+
+  fclose (ofp);
+
+  CHECK (!cmpfiles (TESTFILE_MSTLPACK_PARALLEL_V3, "data/reference-" TESTFILE_MSTLPACK_V3),
+         "Parallel trace list packing v3 mismatch");
+
+  /* Check that contents of the MS3TraceList have been removed */
+  CHECK (mstl->numtraceids == 0, "MS3TraceList ID count is not 0");
+  CHECK (mstl->traces.next[0] == NULL, "MS3TraceList ID list is not empty");
+
+  mstl3_free (&mstl, 0);
+}
+
+/* Build a trace list of many segments for parallel packing comparisons */
+static MS3TraceList *
+build_parallel_mstl (int32_t *data)
+{
+  MS3Record msr = MS3Record_INITIALIZER;
+  MS3TraceList *mstl = mstl3_init (NULL);
+  char sid[LM_SIDLEN];
+
+  if (!mstl)
+    return NULL;
+
+  msr.pubversion = 1;
+  msr.datasamples = data;
+  msr.sampletype = 'i';
+  msr.samprate = 100.0;
+
+  for (int trace = 0; trace < 12; trace++)
+  {
+    snprintf (sid, sizeof (sid), "FDSN:XX_TEST_%02d_H_H_Z", trace);
+    strcpy (msr.sid, sid);
+
+    /* Two segments per trace separated by a gap */
+    for (int gap = 0; gap < 2; gap++)
+    {
+      msr.starttime = ms_timestr2nstime ("2012-05-12T00:00:00Z") + (nstime_t)gap * 3600 * NSTMODULUS;
+      msr.numsamples = SINE_DATA_SAMPLES - trace * 10;
+      msr.samplecnt = msr.numsamples;
+
+      if (!mstl3_addmsr (mstl, &msr, 0, 1, 0, NULL))
+      {
+        mstl3_free (&mstl, 0);
+        return NULL;
+      }
+    }
+  }
+
+  return mstl;
+}
+
+/* Test packing without flushing from a MS3TraceList with multiple threads and
+ * verify the records and remaining trace list match serial packing.
+ */
+TEST (pack, mstl3_pack_parallel_partial)
+{
+  MS3TraceList *serial = NULL;
+  MS3TraceList *parallel = NULL;
+  MS3TraceID *sid;
+  MS3TraceID *pid;
+  MS3TraceSeg *sseg;
+  MS3TraceSeg *pseg;
+  FILE *ofp = NULL;
+  int32_t isinedata[SINE_DATA_SAMPLES];
+  int64_t serialsamples = 0;
+  int64_t parallelsamples = 0;
+  int64_t serialrv;
+  int64_t parallelrv;
+
+  for (int idx = 0; idx < SINE_DATA_SAMPLES; idx++)
+  {
+    isinedata[idx] = (int32_t)(dsinedata[idx]);
+  }
+
+  serial = build_parallel_mstl (isinedata);
+  parallel = build_parallel_mstl (isinedata);
+  REQUIRE (serial != NULL && parallel != NULL, "build_parallel_mstl() returned unexpected NULL");
+
+  ofp = fopen (TESTFILE_MSTLPACK_SERIAL_PARTIAL, "wb");
+  REQUIRE (ofp != NULL, "Failed to open output file");
+  serialrv = mstl3_pack (serial, record_handler_int, ofp, 256, DE_STEIM2, &serialsamples, 0, 0, NULL);
+  fclose (ofp);
+
+  ofp = fopen (TESTFILE_MSTLPACK_PARALLEL_PARTIAL, "wb");
+  REQUIRE (ofp != NULL, "Failed to open output file");
+  parallelrv = mstl3_pack_parallel (parallel, record_handler_int, ofp, 256, DE_STEIM2,
+                                    &parallelsamples, 0, 0, NULL, 3);
+  fclose (ofp);
+
+  REQUIRE (serialrv > 0, "mstl3_pack() return unexpected value");
+  CHECK (parallelrv == serialrv, "Parallel record count mismatch");
+  CHECK (parallelsamples == serialsamples, "Parallel packed samples mismatch");
+  CHECK (!cmpfiles (TESTFILE_MSTLPACK_PARALLEL_PARTIAL, TESTFILE_MSTLPACK_SERIAL_PARTIAL),
+         "Parallel partial packing mismatch");
+
+  /* Remaining data must be identical */
+  CHECK (parallel->numtraceids == serial->numtraceids, "Trace ID count mismatch");
+  for (sid = serial->traces.next[0], pid = parallel->traces.next[0]; sid && pid;
+       sid = sid->next[0], pid = pid->next[0])
+  {
+    CHECK_STREQ (pid->sid, sid->sid);
+    CHECK (pid->numsegments == sid->numsegments, "Segment count mismatch");
+
+    for (sseg = sid->first, pseg = pid->first; sseg && pseg; sseg = sseg->next, pseg = pseg->next)
+    {
+      CHECK (pseg->starttime == sseg->starttime, "Segment start time mismatch");
+      CHECK (pseg->numsamples == sseg->numsamples, "Segment sample count mismatch");
+      CHECK (!memcmp (pseg->datasamples, sseg->datasamples, sseg->numsamples * sizeof (int32_t)),
+             "Segment samples mismatch");
+    }
+  }
+
+  mstl3_free (&serial, 0);
+  mstl3_free (&parallel, 0);
+}
+
+/* Pack a single long segment serially and in parallel with the specified
+ * parameters, returning non-zero if the records, counts or remaining trace
+ * list differ. */
+static int
+pack_long_segment_compare (const int32_t *data, int64_t numsamples, int reclen, int8_t encoding,
+                           uint32_t flags)
+{
+  MS3Record msr = MS3Record_INITIALIZER;
+  MS3TraceList *serial = mstl3_init (NULL);
+  MS3TraceList *parallel = mstl3_init (NULL);
+  FILE *ofp = NULL;
+  int64_t serialsamples = 0;
+  int64_t parallelsamples = 0;
+  int64_t serialrv = -1;
+  int64_t parallelrv = -2;
+  int mismatch = 1;
+
+  strcpy (msr.sid, "FDSN:XX_TEST__L_H_Z");
+  msr.pubversion = 1;
+  msr.datasamples = (void *)data;
+  msr.sampletype = 'i';
+  msr.samprate = 100.0;
+  msr.starttime = ms_timestr2nstime ("2012-05-12T00:00:00.123456789Z");
+  msr.numsamples = numsamples;
+  msr.samplecnt = numsamples;
+
+  if (!serial || !parallel || !mstl3_addmsr (serial, &msr, 0, 1, 0, NULL) ||
+      !mstl3_addmsr (parallel, &msr, 0, 1, 0, NULL))
+    goto cleanup;
+
+  if ((ofp = fopen (TESTFILE_MSTLPACK_SERIAL_LONG, "wb")))
+  {
+    serialrv = mstl3_pack (serial, record_handler_int, ofp, reclen, encoding, &serialsamples, flags,
+                           0, NULL);
+    fclose (ofp);
+  }
+
+  if ((ofp = fopen (TESTFILE_MSTLPACK_PARALLEL_LONG, "wb")))
+  {
+    parallelrv = mstl3_pack_parallel (parallel, record_handler_int, ofp, reclen, encoding,
+                                      &parallelsamples, flags, 0, NULL, 4);
+    fclose (ofp);
+  }
+
+  if (serialrv <= 0 || parallelrv != serialrv || parallelsamples != serialsamples)
+    goto cleanup;
+
+  if (cmpfiles (TESTFILE_MSTLPACK_PARALLEL_LONG, TESTFILE_MSTLPACK_SERIAL_LONG))
+    goto cleanup;
+
+  if (serial->numtraceids != parallel->numtraceids)
+    goto cleanup;
+
+  if (serial->numtraceids > 0 &&
+      (serial->traces.next[0]->first->numsamples != parallel->traces.next[0]->first->numsamples ||
+       serial->traces.next[0]->first->starttime != parallel->traces.next[0]->first->starttime))
+    goto cleanup;
+
+  mismatch = 0;
+
+cleanup:
+  mstl3_free (&serial, 0);
+  mstl3_free (&parallel, 0);
+
+  return mismatch;
+}
+
+/* Test packing a single long segment with multiple threads, which is split
+ * into blocks packed in parallel, exactly for fixed-width encodings and
+ * speculatively for Steim encodings.  Verify output matches serial packing.
+ */
+TEST (pack, mstl3_pack_parallel_longsegment)
+{
+  const int64_t numsamples = 1000003;
+  int32_t *data = NULL;
+  uint64_t state = 12345;
+
+  data = (int32_t *)malloc (numsamples * sizeof (int32_t));
+  REQUIRE (data != NULL, "Cannot allocate test data");
+
+  /* Random walk with varying step size for variable Steim compression */
+  int32_t value = 0;
+  for (int64_t idx = 0; idx < numsamples; idx++)
+  {
+    int32_t range = ((idx / 104729) % 3) ? 16 : 40000;
+
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    value += (int32_t)((state >> 33) % range) - range / 2;
+    data[idx] = value;
+  }
+
+  CHECK (!pack_long_segment_compare (data, numsamples, 512, DE_STEIM1, MSF_FLUSHDATA),
+         "Steim1 v3 long segment mismatch");
+  CHECK (!pack_long_segment_compare (data, numsamples, 4096, DE_STEIM2, MSF_FLUSHDATA),
+         "Steim2 v3 long segment mismatch");
+  CHECK (!pack_long_segment_compare (data, numsamples, 512, DE_STEIM2, MSF_PACKVER2),
+         "Steim2 v2 long segment without flush mismatch");
+  CHECK (!pack_long_segment_compare (data, numsamples, 512, DE_INT32, MSF_FLUSHDATA),
+         "Int32 v3 long segment mismatch");
+  CHECK (!pack_long_segment_compare (data, numsamples, 4096, DE_INT32, MSF_PACKVER2),
+         "Int32 v2 long segment without flush mismatch");
+
+  free (data);
+}
+
 /* Test packing miniSEED records from a MS3TraceList with the generator
  * interface and set the MSF_MAINTAINMSTL flag to maintain the trace list after
  * packing.
@@ -0,0 +1,299 @@
+/***************************************************************************
+ * Internal portability routines for threads, locks and condition
+ * variables used by the parallel library interfaces.
+ *
+ * This file is part of the miniSEED Library.
+ *
+ * Copyright (c) 2026 Chad Trabant, EarthScope Data Services
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include "internalstate.h"
+#include "threadutils.h"
+
+#if !defined(LMP_WIN) && !defined(LIBMSEED_NO_THREADING)
+#include <unistd.h>
+#endif
+
+/* Upper limit on worker threads, regardless of processor count */
+#define LM_MAXTHREADS 256
+
+#if !defined(LIBMSEED_NO_THREADING)
+/* Thread start parameters, the new thread inherits the library context
+ * bound to the creating thread */
+typedef struct
+{
+  void *(*start_routine) (void *);
+  void *arg;
+  LMContext *context;
+} lmp_threadstart;
+
+static void *
+lmp_threadstart_run (void *param)
+{
+  lmp_threadstart start = *(lmp_threadstart *)param;
+
+  lm_currentcontext = start.context;
+  lm_memory ()->free (param);
+
+  return start.start_routine (start.arg);
+}
+
+#if defined(LMP_WIN)
+/* Adapter for the Win32 thread entry point signature */
+static DWORD WINAPI
+lmp_win_threadentry (LPVOID param)
+{
+  lmp_threadstart_run (param);
+
+  return 0;
+}
+#endif
+#endif
+
+/***************************************************************************
+ * Create a new thread running start_routine(arg).
+ *
+ * Returns 0 on success and -1 on error or when built without threading.
+ ***************************************************************************/
+int
+lmp_thread_create (lmp_thread_t *thread, void *(*start_routine) (void *), void *arg)
+{
+#if defined(LIBMSEED_NO_THREADING)
+  (void)thread;
+  (void)start_routine;
+  (void)arg;
+  return -1;
+#else
+  lmp_threadstart *start;
+
+  if (!(start = (lmp_threadstart *)lm_memory ()->malloc (sizeof (lmp_threadstart))))
+    return -1;
+
+  start->start_routine = start_routine;
+  start->arg = arg;
+  start->context = lm_currentcontext;
+
+#if defined(LMP_WIN)
+  *thread = CreateThread (NULL, 0, lmp_win_threadentry, start, 0, NULL);
+
+  if (*thread == NULL)
+#else
+  if (pthread_create (thread, NULL, lmp_threadstart_run, start) != 0)
+#endif
+  {
+    lm_memory ()->free (start);
+    return -1;
+  }
+
+  return 0;
+#endif
+} /* End of lmp_thread_create() */
+
+/***************************************************************************
+ * Wait for a thread created with lmp_thread_create() to finish.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+int
+lmp_thread_join (lmp_thread_t thread)
+{
+#if defined(LIBMSEED_NO_THREADING)
+  (void)thread;
+  return -1;
+#elif defined(LMP_WIN)
+  if (WaitForSingleObject (thread, INFINITE) != WAIT_OBJECT_0)
+    return -1;
+
+  CloseHandle (thread);
+  return 0;
+#else
+  return (pthread_join (thread, NULL) == 0) ? 0 : -1;
+#endif
+} /* End of lmp_thread_join() */
+
+int
+lmp_mutex_init (lmp_mutex_t *mutex)
+{
+#if defined(LIBMSEED_NO_THREADING)
+  *mutex = 0;
+  return 0;
+#elif defined(LMP_WIN)
+  InitializeCriticalSection (mutex);
+  return 0;
+#else
+  return (pthread_mutex_init (mutex, NULL) == 0) ? 0 : -1;
+#endif
+}
+
+void
+lmp_mutex_lock (lmp_mutex_t *mutex)
+{
+#if defined(LIBMSEED_NO_THREADING)
+  (void)mutex;
+#elif defined(LMP_WIN)
+  EnterCriticalSection (mutex);
+#else
+  pthread_mutex_lock (mutex);
+#endif
+}
+
+void
+lmp_mutex_unlock (lmp_mutex_t *mutex)
+{
+#if defined(LIBMSEED_NO_THREADING)
+  (void)mutex;
+#elif defined(LMP_WIN)
+  LeaveCriticalSection (mutex);
+#else
+  pthread_mutex_unlock (mutex);
+#endif
+}
+
+void
+lmp_mutex_destroy (lmp_mutex_t *mutex)
+{
+#if defined(LIBMSEED_NO_THREADING)
+  (void)mutex;
+#elif defined(LMP_WIN)
+  DeleteCriticalSection (mutex);
+#else
+  pthread_mutex_destroy (mutex);
+#endif
+}
+
+void
+lmp_staticmutex_lock (lmp_staticmutex_t *mutex)
+{
+#if defined(LIBMSEED_NO_THREADING)
+  (void)mutex;
+#elif defined(LMP_WIN)
+  AcquireSRWLockExclusive (mutex);
+#else
+  pthread_mutex_lock (mutex);
+#endif
+}
+
+void
+lmp_staticmutex_unlock (lmp_staticmutex_t *mutex)
+{
+#if defined(LIBMSEED_NO_THREADING)
+  (void)mutex;
+#elif defined(LMP_WIN)
+  ReleaseSRWLockExclusive (mutex);
+#else
+  pthread_mutex_unlock (mutex);
+#endif
+}
+
+int
+lmp_cond_init (lmp_cond_t *cond)
+{
+#if defined(LIBMSEED_NO_THREADING)
+  *cond = 0;
+  return 0;
+#elif defined(LMP_WIN)
+  InitializeConditionVariable (cond);
+  return 0;
+#else
+  return (pthread_cond_init (cond, NULL) == 0) ? 0 : -1;
+#endif
+}
+
+void
+lmp_cond_wait (lmp_cond_t *cond, lmp_mutex_t *mutex)
+{
+#if defined(LIBMSEED_NO_THREADING)
+  (void)cond;
+  (void)mutex;
+#elif defined(LMP_WIN)
+  SleepConditionVariableCS (cond, mutex, INFINITE);
+#else
+  pthread_cond_wait (cond, mutex);
+#endif
+}
+
+void
+lmp_cond_signal (lmp_cond_t *cond)
+{
+#if defined(LIBMSEED_NO_THREADING)
+  (void)cond;
+#elif defined(LMP_WIN)
+  WakeConditionVariable (cond);
+#else
+  pthread_cond_signal (cond);
+#endif
+}
+
+void
+lmp_cond_broadcast (lmp_cond_t *cond)
+{
+#if defined(LIBMSEED_NO_THREADING)
+  (void)cond;
+#elif defined(LMP_WIN)
+  WakeAllConditionVariable (cond);
+#else
+  pthread_cond_broadcast (cond);
+#endif
+}
+
+void
+lmp_cond_destroy (lmp_cond_t *cond)
+{
+#if defined(LIBMSEED_NO_THREADING) || defined(LMP_WIN)
+  (void)cond;
+#else
+  pthread_cond_destroy (cond);
+#endif
+}
+
+/***************************************************************************
+ * Return the number of online processors, or 1 if not determinable.
+ ***************************************************************************/
+int
+lmp_cpucount (void)
+{
+#if defined(LMP_WIN)
+  SYSTEM_INFO sysinfo;
+
+  GetSystemInfo (&sysinfo);
+
+  return (sysinfo.dwNumberOfProcessors > 0) ? (int)sysinfo.dwNumberOfProcessors : 1;
+#elif defined(_SC_NPROCESSORS_ONLN)
+  long count = sysconf (_SC_NPROCESSORS_ONLN);
+
+  return (count > 0) ? (int)count : 1;
+#else
+  return 1;
+#endif
+} /* End of lmp_cpucount() */
+
+/***************************************************************************
+ * Resolve a caller-requested number of threads.  Values less than 1
+ * select the number of online processors.  The result is bounded to
+ * LM_MAXTHREADS and is always 1 when built without threading.
+ ***************************************************************************/
+int
+lm_resolve_threads (int nthreads)
+{
+#if defined(LIBMSEED_NO_THREADING)
+  (void)nthreads;
+  return 1;
+#else
+  if (nthreads < 1)
+    nthreads = lmp_cpucount ();
+
+  return (nthreads > LM_MAXTHREADS) ? LM_MAXTHREADS : nthreads;
+#endif
+} /* End of lm_resolve_threads() */
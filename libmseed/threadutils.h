@@ -0,0 +1,160 @@
+/***************************************************************************
+ * Interface declarations for the internal threading routines in
+ * threadutils.c
+ *
+ * This file is part of the miniSEED Library.
+ *
+ * Copyright (c) 2026 Chad Trabant, EarthScope Data Services
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#ifndef THREADUTILS_H
+#define THREADUTILS_H 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "libmseed.h"
+
+/* Thin portability layer over the platform thread primitives.
+ *
+ * When the library is built with LIBMSEED_NO_THREADING no threads are
+ * created; lmp_thread_create() returns an error and lm_resolve_threads()
+ * always returns 1, so callers must keep a serial path.  The lock
+ * primitives are no-ops in that mode. */
+#if defined(LIBMSEED_NO_THREADING)
+typedef int lmp_thread_t;
+typedef int lmp_mutex_t;
+typedef int lmp_cond_t;
+#elif defined(LMP_WIN)
+typedef HANDLE lmp_thread_t;
+typedef CRITICAL_SECTION lmp_mutex_t;
+typedef CONDITION_VARIABLE lmp_cond_t;
+#else
+#include <pthread.h>
+typedef pthread_t lmp_thread_t;
+typedef pthread_mutex_t lmp_mutex_t;
+typedef pthread_cond_t lmp_cond_t;
+#endif
+
+/* Mutex for static storage, initialized with LMP_STATICMUTEX_INITIALIZER
+ * and never destroyed */
+#if defined(LIBMSEED_NO_THREADING)
+typedef int lmp_staticmutex_t;
+#define LMP_STATICMUTEX_INITIALIZER 0
+#elif defined(LMP_WIN)
+typedef SRWLOCK lmp_staticmutex_t;
+#define LMP_STATICMUTEX_INITIALIZER SRWLOCK_INIT
+#else
+typedef pthread_mutex_t lmp_staticmutex_t;
+#define LMP_STATICMUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+#endif
+
+extern int lmp_thread_create (lmp_thread_t *thread, void *(*start_routine) (void *), void *arg);
+extern int lmp_thread_join (lmp_thread_t thread);
+
+extern int lmp_mutex_init (lmp_mutex_t *mutex);
+extern void lmp_mutex_lock (lmp_mutex_t *mutex);
+extern void lmp_mutex_unlock (lmp_mutex_t *mutex);
+extern void lmp_mutex_destroy (lmp_mutex_t *mutex);
+
+extern void lmp_staticmutex_lock (lmp_staticmutex_t *mutex);
+extern void lmp_staticmutex_unlock (lmp_staticmutex_t *mutex);
+
+extern int lmp_cond_init (lmp_cond_t *cond);
+extern void lmp_cond_wait (lmp_cond_t *cond, lmp_mutex_t *mutex);
+extern void lmp_cond_signal (lmp_cond_t *cond);
+extern void lmp_cond_broadcast (lmp_cond_t *cond);
+extern void lmp_cond_destroy (lmp_cond_t *cond);
+
+extern int lmp_cpucount (void);
+
+/* Atomic loads with acquire and stores with release ordering, used to
+ * publish data to threads that read it without holding a lock.  Plain
+ * accesses when built without threading. */
+#if defined(LIBMSEED_NO_THREADING)
+static inline void *
+lmp_atomic_loadptr (void *const *ptr)
+{
+  return *ptr;
+}
+static inline void
+lmp_atomic_storeptr (void **ptr, void *value)
+{
+  *ptr = value;
+}
+static inline uint32_t
+lmp_atomic_load32 (const uint32_t *ptr)
+{
+  return *ptr;
+}
+static inline void
+lmp_atomic_store32 (uint32_t *ptr, uint32_t value)
+{
+  *ptr = value;
+}
+#elif defined(LMP_WIN)
+static inline void *
+lmp_atomic_loadptr (void *const *ptr)
+{
+  return InterlockedCompareExchangePointer ((PVOID volatile *)ptr, NULL, NULL);
+}
+static inline void
+lmp_atomic_storeptr (void **ptr, void *value)
+{
+  InterlockedExchangePointer ((PVOID volatile *)ptr, value);
+}
+static inline uint32_t
+lmp_atomic_load32 (const uint32_t *ptr)
+{
+  return (uint32_t)InterlockedCompareExchange ((LONG volatile *)ptr, 0, 0);
+}
+static inline void
+lmp_atomic_store32 (uint32_t *ptr, uint32_t value)
+{
+  InterlockedExchange ((LONG volatile *)ptr, (LONG)value);
+}
+#else
+static inline void *
+lmp_atomic_loadptr (void *const *ptr)
+{
+  return __atomic_load_n (ptr, __ATOMIC_ACQUIRE);
+}
+static inline void
+lmp_atomic_storeptr (void **ptr, void *value)
+{
+  __atomic_store_n (ptr, value, __ATOMIC_RELEASE);
+}
+static inline uint32_t
+lmp_atomic_load32 (const uint32_t *ptr)
+{
+  return __atomic_load_n (ptr, __ATOMIC_ACQUIRE);
+}
+static inline void
+lmp_atomic_store32 (uint32_t *ptr, uint32_t value)
+{
+  __atomic_store_n (ptr, value, __ATOMIC_RELEASE);
+}
+#endif
+
+/* Resolve a caller-requested thread count: values < 1 select the number
+ * of online processors, always 1 when built without threading */
+extern int lm_resolve_threads (int nthreads);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
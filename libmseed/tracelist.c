@@ -26,14 +26,33 @@
 
 #include "internalstate.h"
 #include "libmseed.h"
+#include "threadutils.h"
+#include "unpack.h"
 
 static MS3TraceID *lm_addID (MS3TraceList *mstl, MS3TraceID *id, MS3TraceID **prev);
-static MS3TraceSeg *lm_msr2seg (const MS3Record *msr, nstime_t endtime);
+static int lm_findID_index (MS3TraceList *mstl, const char *sid, uint8_t pubversion,
+                            MS3TraceID **pid);
+static void lm_idindex_add (MS3TraceList *mstl, MS3TraceID *id);
+static void lm_idindex_remove (MS3TraceList *mstl, MS3TraceID *id);
+static MS3TraceSeg *lm_msr2seg (const MS3Record *msr, nstime_t endtime, int8_t decode);
 static MS3TraceSeg *lm_addmsrtoseg (MS3TraceSeg *seg, const MS3Record *msr, nstime_t endtime,
-                                    int8_t whence);
+                                    int8_t whence, int8_t decode);
 static MS3TraceSeg *lm_addsegtoseg (MS3TraceSeg *seg1, MS3TraceSeg *seg2);
 static MS3RecordPtr *lm_add_recordptr (MS3TraceSeg *seg, const MS3Record *msr, nstime_t endtime,
                                        int8_t whence, uint32_t flags);
+static void lm_tolerances (const MS3Record *msr, const MS3Tolerance *tolerance, nstime_t nsperiod,
+                           nstime_t *nstimetol, double *sampratetol);
+static void lm_sortseg (MS3TraceID *id, MS3TraceSeg *seg);
+static int lm_seg_updatetime (MS3TraceSeg *seg);
+static void lm_detachseg (MS3TraceList *mstl, MS3TraceID *id, MS3TraceSeg *seg);
+static void lm_unlinkfirstID (MS3TraceList *mstl, MS3TraceID *id);
+static int lm_linkID (MS3TraceList *mstl, MS3TraceID *id);
+static int lm_mergeseg (MS3TraceList *mstl, MS3TraceID *id, MS3TraceList *srcmstl,
+                        MS3TraceID *srcid, MS3TraceSeg *seg, int8_t autoheal, uint32_t flags,
+                        const MS3Tolerance *tolerance);
+static MS3TraceSeg *lm_addmsr (MS3TraceList *mstl, const MS3Record *msr, MS3RecordPtr **pprecptr,
+                               int8_t splitversion, int8_t autoheal, uint32_t flags,
+                               const MS3Tolerance *tolerance, MS3TraceID **pid);
 
 static void lm_recentseg_touch (LMTraceIDNode *idnode, MS3TraceSeg *seg);
 static void lm_recentseg_remove (LMTraceIDNode *idnode, MS3TraceSeg *seg);
@@ -52,6 +71,13 @@ static void lm_update_id_extent (MS3TraceID *id);
 static uint32_t lm_lcg_r (uint64_t *state);
 static uint8_t lm_random_height (uint8_t maximum, uint64_t *state);
 static nstime_t lm_packed_starttime (const MS3TraceSeg *seg, int64_t packedsamples);
+static int lm_pack_template (MS3Record *msr, const MS3TraceID *id, const MS3TraceSeg *seg,
+                             int reclen, int8_t encoding, char *extra);
+static int lm_trim_packed (MS3TraceID *id, MS3TraceSeg *seg, int64_t packedsamples);
+static int64_t lm_pack_parallel (MS3TraceList *mstl, void (*record_handler) (char *, int, void *),
+                                 void *handlerdata, int reclen, int8_t encoding,
+                                 int64_t *packedsamples, uint32_t flags, int8_t verbose,
+                                 char *extra, nstime_t flush_idle_nanoseconds, int nthreads);
 
 /* Test if two sample rates are similar using either specified tolerance (if non-negative) or
  * default tolerance */
@@ -84,7 +110,7 @@ mstl3_init (MS3TraceList *mstl)
     mstl3_free (&mstl, 1);
   }
 
-  mstl = (MS3TraceList *)libmseed_memory.malloc (sizeof (LMTraceListNode));
+  mstl = (MS3TraceList *)lm_memory ()->malloc (sizeof (LMTraceListNode));
 
   if (mstl == NULL)
   {
@@ -142,14 +168,17 @@ mstl3_free (MS3TraceList **ppmstl, int8_t freeprvtptr)
 
     /* Free private pointer data if present and requested */
     if (freeprvtptr && id->prvtptr)
-      libmseed_memory.free (id->prvtptr);
+      lm_memory ()->free (id->prvtptr);
 
-    libmseed_memory.free (id);
+    lm_memory ()->free (id);
 
     id = nextid;
   }
 
-  libmseed_memory.free (*ppmstl);
+  if (((LMTraceListNode *)*ppmstl)->idindex)
+    lm_memory ()->free (((LMTraceListNode *)*ppmstl)->idindex);
+
+  lm_memory ()->free (*ppmstl);
 
   *ppmstl = NULL;
 
@@ -185,6 +214,10 @@ mstl3_findID (MS3TraceList *mstl, const char *sid, uint8_t pubversion, MS3TraceI
     return NULL;
   }
 
+  /* Resolve with the SID index, searching the list only for previous pointers if not found */
+  if (lm_findID_index (mstl, sid, pubversion, &id) && (id || !prev))
+    return id;
+
   level = MSTRACEID_SKIPLIST_HEIGHT - 1;
 
   /* Search trace ID skip list, starting from the head/sentinel node */
@@ -272,7 +305,7 @@ lm_addID (MS3TraceList *mstl, MS3TraceID *id, MS3TraceID **prev)
   /* If previous list pointers not supplied, find them */
   if (!prev)
   {
-    mstl3_findID (mstl, id->sid, 0, local_prev);
+    mstl3_findID (mstl, id->sid, id->pubversion, local_prev);
     prev = local_prev;
   }
 
@@ -304,9 +337,204 @@ lm_addID (MS3TraceList *mstl, MS3TraceID *id, MS3TraceID **prev)
 
   mstl->numtraceids++;
 
+  lm_idindex_add (mstl, id);
+
   return id;
 } /* End of lm_addID() */
 
+/***************************************************************************
+ * Return the index slot for a source ID, either the slot holding the
+ * SID or the empty slot where it would be inserted.
+ ***************************************************************************/
+static LMIDIndexSlot *
+lm_idindex_slot (LMTraceListNode *node, const char *sid, uint32_t hash)
+{
+  uint32_t mask = node->idindexsize - 1;
+  uint32_t slot = hash & mask;
+
+  while (node->idindex[slot].id)
+  {
+    if (node->idindex[slot].hash == hash && !strcmp (node->idindex[slot].id->sid, sid))
+      break;
+
+    slot = (slot + 1) & mask;
+  }
+
+  return &node->idindex[slot];
+}
+
+/***************************************************************************
+ * Find a trace ID using the index of trace IDs by source ID.
+ *
+ * The index is a hash table owned by the list that maps each SID to the
+ * first trace ID in the list with that SID.  Trace IDs for different
+ * versions of a SID are adjacent in the list and are found by following
+ * the list from the first.  If the index is not maintained for the list
+ * the skip list must be searched.
+ *
+ * Returns 1 and sets @p *pid to the matching ID, or NULL if there is no
+ * matching ID, if resolved by the index.  Otherwise returns 0.
+ ***************************************************************************/
+static int
+lm_findID_index (MS3TraceList *mstl, const char *sid, uint8_t pubversion, MS3TraceID **pid)
+{
+  LMTraceListNode *node = (LMTraceListNode *)mstl;
+  MS3TraceID *id;
+
+  if (node->foreignid || node->noidindex)
+    return 0;
+
+  *pid = NULL;
+
+  if (!node->idindexcount)
+    return 1;
+
+  id = lm_idindex_slot (node, sid, lm_sid_hash (sid))->id;
+
+  if (pubversion)
+  {
+    while (id && id->pubversion != pubversion)
+    {
+      id = id->next[0];
+
+      if (id && strcmp (id->sid, sid))
+        id = NULL;
+    }
+  }
+
+  *pid = id;
+
+  return 1;
+} /* End of lm_findID_index() */
+
+/***************************************************************************
+ * Add a trace ID, already linked into the list, to the index of trace IDs
+ * by source ID.  If the index cannot be updated it is no longer
+ * maintained for the list.
+ ***************************************************************************/
+static void
+lm_idindex_add (MS3TraceList *mstl, MS3TraceID *id)
+{
+  LMTraceListNode *node = (LMTraceListNode *)mstl;
+  LMIDIndexSlot *newindex;
+  LMIDIndexSlot *slot;
+  uint32_t newsize;
+  uint32_t hash;
+  uint32_t idx;
+  uint32_t pos;
+
+  if (node->foreignid || node->noidindex)
+    return;
+
+  /* Grow the index, keeping it at most half full */
+  if ((node->idindexcount + 1) * 2 > node->idindexsize)
+  {
+    newsize = (node->idindexsize) ? node->idindexsize * 2 : 64;
+
+    if (newsize <= node->idindexsize ||
+        !(newindex = (LMIDIndexSlot *)lm_memory ()->malloc (sizeof (LMIDIndexSlot) * newsize)))
+    {
+      if (node->idindex)
+        lm_memory ()->free (node->idindex);
+      node->idindex = NULL;
+      node->idindexsize = 0;
+      node->idindexcount = 0;
+      node->noidindex = 1;
+      return;
+    }
+
+    memset (newindex, 0, sizeof (LMIDIndexSlot) * newsize);
+
+    for (idx = 0; idx < node->idindexsize; idx++)
+    {
+      if (!node->idindex[idx].id)
+        continue;
+
+      pos = node->idindex[idx].hash & (newsize - 1);
+      while (newindex[pos].id)
+        pos = (pos + 1) & (newsize - 1);
+
+      newindex[pos] = node->idindex[idx];
+    }
+
+    if (node->idindex)
+      lm_memory ()->free (node->idindex);
+
+    node->idindex = newindex;
+    node->idindexsize = newsize;
+  }
+
+  hash = lm_sid_hash (id->sid);
+  slot = lm_idindex_slot (node, id->sid, hash);
+
+  if (!slot->id)
+  {
+    slot->hash = hash;
+    slot->id = id;
+    node->idindexcount++;
+  }
+  /* A new ID linked before the first ID of its SID becomes the first */
+  else if (id->next[0] == slot->id)
+  {
+    slot->id = id;
+  }
+} /* End of lm_idindex_add() */
+
+/***************************************************************************
+ * Remove a trace ID from the index of trace IDs by source ID, called
+ * before the ID is unlinked from the list.
+ ***************************************************************************/
+static void
+lm_idindex_remove (MS3TraceList *mstl, MS3TraceID *id)
+{
+  LMTraceListNode *node = (LMTraceListNode *)mstl;
+  LMIDIndexSlot *slot;
+  uint32_t mask;
+  uint32_t hole;
+  uint32_t pos;
+  uint32_t home;
+
+  if (node->foreignid || node->noidindex || !node->idindexcount)
+    return;
+
+  slot = lm_idindex_slot (node, id->sid, lm_sid_hash (id->sid));
+
+  if (slot->id != id)
+    return;
+
+  /* The next ID becomes the first if it has the same SID */
+  if (id->next[0] && !strcmp (id->next[0]->sid, id->sid))
+  {
+    slot->id = id->next[0];
+    return;
+  }
+
+  /* Remove the entry, shifting following entries of the probe sequence back */
+  mask = node->idindexsize - 1;
+  hole = (uint32_t)(slot - node->idindex);
+  pos = hole;
+
+  while (1)
+  {
+    pos = (pos + 1) & mask;
+
+    if (!node->idindex[pos].id)
+      break;
+
+    home = node->idindex[pos].hash & mask;
+
+    /* Move the entry into the hole if its home is not between the hole and its position */
+    if (((pos - home) & mask) >= ((pos - hole) & mask))
+    {
+      node->idindex[hole] = node->idindex[pos];
+      hole = pos;
+    }
+  }
+
+  node->idindex[hole].id = NULL;
+  node->idindexcount--;
+} /* End of lm_idindex_remove() */
+
 /***************************************************************************
  * Move a segment into the most-recently-used slot of a trace ID's recent
  * set, evicting the least-recently-used entry if the segment was not
@@ -438,14 +666,14 @@ lm_seg_listorder (const MS3TraceSeg *a, const MS3TraceSeg *b, int *order)
 } /* End of lm_seg_listorder() */
 
 /***************************************************************************
- * Reproduce the segment-list search of _mstl3_addmsr_impl() using only
+ * Reproduce the segment-list search of lm_addmsr() using only
  * the recent segments of a trace ID.  Callable only when every segment not
  * in the recent set is provably out of range for segbefore, segafter, and
  * the autoheal exact match, and necessarily sorts before the record (see
  * the guard at the call site); under that condition the outcome of the
  * recent segments alone matches a full scan.
  *
- * This loop body mirrors the general search in _mstl3_addmsr_impl() and
+ * This loop body mirrors the general search in lm_addmsr() and
  * must be kept in lockstep with it.
  *
  * Returns 1 with *psegbefore, *psegafter and *pfollowseg set (any may be
@@ -495,7 +723,7 @@ lm_scan_recent (LMTraceIDNode *idnode, const MS3Record *msr, nstime_t endtime, n
     }
   }
 
-  /* Identical loop body to the general search in _mstl3_addmsr_impl(),
+  /* Identical loop body to the general search in lm_addmsr(),
    * run over the recent segments only, in list order */
   for (i = 0; i < count; i++)
   {
@@ -579,6 +807,133 @@ lm_scan_recent (LMTraceIDNode *idnode, const MS3Record *msr, nstime_t endtime, n
   return 1;
 } /* End of lm_scan_recent() */
 
+/***************************************************************************
+ * Determine the time and sample rate tolerances for a record.  The time
+ * tolerance defaults to 1/2 of @p nsperiod and the sample rate tolerance
+ * to the default sentinel of -1.0 if not provided by @p tolerance or if
+ * negative values are returned.
+ ***************************************************************************/
+static void
+lm_tolerances (const MS3Record *msr, const MS3Tolerance *tolerance, nstime_t nsperiod,
+               nstime_t *nstimetol, double *sampratetol)
+{
+  /* Calculate high-precision time tolerance */
+  if (tolerance && tolerance->time)
+  {
+    double timetol = tolerance->time (msr);
+
+    if (timetol < 0.0)
+    {
+      ms_log (1, "%s: Ignoring negative time tolerance (%g), using default\n", msr->sid, timetol);
+      *nstimetol = (nstime_t)(0.5 * nsperiod);
+    }
+    else
+      *nstimetol = (nstime_t)(NSTMODULUS * timetol);
+  }
+  else
+    *nstimetol = (nstime_t)(0.5 * nsperiod); /* Default time tolerance is 1/2 sample period */
+
+  /* Calculate sample rate tolerance */
+  *sampratetol = -1.0;
+  if (tolerance && tolerance->samprate)
+  {
+    *sampratetol = tolerance->samprate (msr);
+
+    if (*sampratetol < 0.0)
+    {
+      ms_log (1, "%s: Ignoring negative sample rate tolerance (%g), using default\n", msr->sid,
+              *sampratetol);
+      *sampratetol = -1.0; /* Restore default sentinel */
+    }
+  }
+} /* End of lm_tolerances() */
+
+/***************************************************************************
+ * Move a modified segment into its sorted place in the segment list of a
+ * trace ID, ordered by start time ascending and end time descending.
+ ***************************************************************************/
+static void
+lm_sortseg (MS3TraceID *id, MS3TraceSeg *seg)
+{
+  MS3TraceSeg *next;
+  MS3TraceSeg *prev;
+
+  while (seg->next &&
+         (seg->starttime > seg->next->starttime ||
+          (seg->starttime == seg->next->starttime && seg->endtime < seg->next->endtime)))
+  {
+    /* Move segment down list, swap seg and seg->next */
+    next = seg->next;
+
+    if (seg->prev)
+      seg->prev->next = next;
+
+    if (next->next)
+      next->next->prev = seg;
+
+    next->prev = seg->prev;
+    seg->prev = next;
+    seg->next = next->next;
+    next->next = seg;
+
+    /* Reset first and last segment pointers if replaced */
+    if (id->first == seg)
+      id->first = next;
+
+    if (id->last == next)
+      id->last = seg;
+  }
+  while (seg->prev &&
+         (seg->starttime < seg->prev->starttime ||
+          (seg->starttime == seg->prev->starttime && seg->endtime > seg->prev->endtime)))
+  {
+    /* Move segment up list, swap seg and seg->prev */
+    prev = seg->prev;
+
+    if (seg->next)
+      seg->next->prev = prev;
+
+    if (prev->prev)
+      prev->prev->next = seg;
+
+    prev->next = seg->next;
+    seg->next = prev;
+    seg->prev = prev->prev;
+    prev->prev = seg;
+
+    /* Reset first and last segment pointers if replaced */
+    if (id->first == prev)
+      id->first = seg;
+
+    if (id->last == seg)
+      id->last = prev;
+  }
+} /* End of lm_sortseg() */
+
+/***************************************************************************
+ * Store the current time as the update time at seg.prvtptr, allocating
+ * if needed.
+ *
+ * Return 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+lm_seg_updatetime (MS3TraceSeg *seg)
+{
+  if (!seg->prvtptr)
+  {
+    if (!(seg->prvtptr = lm_memory ()->malloc (sizeof (nstime_t))))
+    {
+      ms_log (2, "Error allocating memory\n");
+      return -1;
+    }
+  }
+
+  /* Set to current time */
+  *(nstime_t *)seg->prvtptr = lmp_systemtime ();
+
+  return 0;
+} /* End of lm_seg_updatetime() */
+
 /***************************************************************************
  * Implementation of MS3TraceList addition functions
  *
@@ -589,6 +944,22 @@ MS3TraceSeg *
 _mstl3_addmsr_impl (MS3TraceList *mstl, const MS3Record *msr, MS3RecordPtr **pprecptr,
                     int8_t splitversion, int8_t autoheal, uint32_t flags,
                     const MS3Tolerance *tolerance)
+{
+  return lm_addmsr (mstl, msr, pprecptr, splitversion, autoheal, flags, tolerance, NULL);
+} /* End of _mstl3_addmsr_impl() */
+
+/***************************************************************************
+ * Add a MS3Record to a MS3TraceList, see mstl3_addmsr() for details.
+ *
+ * If @p pid is not NULL and @p *pid is set, it is used as the matching
+ * MS3TraceID instead of searching the list; the caller must ensure it
+ * matches the record.  On success the matching MS3TraceID, possibly
+ * newly created, is stored at @p *pid.
+ ***************************************************************************/
+static MS3TraceSeg *
+lm_addmsr (MS3TraceList *mstl, const MS3Record *msr, MS3RecordPtr **pprecptr,
+           int8_t splitversion, int8_t autoheal, uint32_t flags, const MS3Tolerance *tolerance,
+           MS3TraceID **pid)
 {
   MS3TraceID *id = NULL;
   MS3TraceID *previd[MSTRACEID_SKIPLIST_HEIGHT] = {NULL};
@@ -611,12 +982,18 @@ _mstl3_addmsr_impl (MS3TraceList *mstl, const MS3Record *msr, MS3RecordPtr **ppr
   double sampratehz;
   double sampratetol = -1.0;
 
+  int8_t decode;
+
   if (!mstl || !msr)
   {
     ms_log (2, "%s(): Required input not defined: 'mstl' or 'msr'\n", __func__);
     return NULL;
   }
 
+  /* Decode data samples directly into the segment if requested and not yet unpacked */
+  decode = ((flags & MSF_UNPACKDATA) && msr->samplecnt > 0 && msr->numsamples == 0 &&
+            msr->record) ? 1 : 0;
+
   /* Calculate end time for MS3Record */
   if ((endtime = msr3_endtime (msr)) == NSTERROR)
   {
@@ -628,13 +1005,16 @@ _mstl3_addmsr_impl (MS3TraceList *mstl, const MS3Record *msr, MS3RecordPtr **ppr
    * as the version, otherwise use msr->pubversion */
   uint8_t pubversion = (flags & MSF_SPLITISVERSION) ? splitversion : msr->pubversion;
 
-  /* Search for matching trace ID */
-  id = mstl3_findID (mstl, msr->sid, (splitversion) ? pubversion : 0, previd);
+  /* Search for matching trace ID unless already known */
+  if (pid && *pid)
+    id = *pid;
+  else
+    id = mstl3_findID (mstl, msr->sid, (splitversion) ? pubversion : 0, previd);
 
   /* If no matching ID was found create new MS3TraceID and MS3TraceSeg entries */
   if (!id)
   {
-    if (!(id = (MS3TraceID *)libmseed_memory.malloc (sizeof (LMTraceIDNode))))
+    if (!(id = (MS3TraceID *)lm_memory ()->malloc (sizeof (LMTraceIDNode))))
     {
       ms_log (2, "Error allocating memory\n");
       return NULL;
@@ -651,9 +1031,9 @@ _mstl3_addmsr_impl (MS3TraceList *mstl, const MS3Record *msr, MS3RecordPtr **ppr
     /* End-time bound starts below any possible end time, recent set starts empty */
     ((LMTraceIDNode *)id)->nonrecentendbound = INT64_MIN;
 
-    if (!(seg = lm_msr2seg (msr, endtime)))
+    if (!(seg = lm_msr2seg (msr, endtime, decode)))
     {
-      libmseed_memory.free (id);
+      lm_memory ()->free (id);
       return NULL;
     }
     id->first = id->last = seg;
@@ -662,7 +1042,7 @@ _mstl3_addmsr_impl (MS3TraceList *mstl, const MS3Record *msr, MS3RecordPtr **ppr
     if (pprecptr && !(*pprecptr = lm_add_recordptr (seg, msr, endtime, 1, flags)))
     {
       lm_free_segment_memory (seg, 0);
-      libmseed_memory.free (id);
+      lm_memory ()->free (id);
       return NULL;
     }
 
@@ -671,47 +1051,18 @@ _mstl3_addmsr_impl (MS3TraceList *mstl, const MS3Record *msr, MS3RecordPtr **ppr
     {
       ms_log (2, "Error adding new ID to trace list\n");
       lm_free_segment_memory (seg, 0);
-      libmseed_memory.free (id);
+      lm_memory ()->free (id);
       return NULL;
     }
   }
   /* Add data coverage to the matching MS3TraceID */
   else
   {
-    /* Calculate nanosecond sample period */
+    /* Calculate nanosecond sample period and tolerances */
     nsperiod = msr3_nsperiod (msr);
-
-    /* Calculate high-precision time tolerance */
-    if (tolerance && tolerance->time)
-    {
-      double timetol = tolerance->time (msr);
-
-      if (timetol < 0.0)
-      {
-        ms_log (1, "%s: Ignoring negative time tolerance (%g), using default\n", msr->sid, timetol);
-        nstimetol = (nstime_t)(0.5 * nsperiod);
-      }
-      else
-        nstimetol = (nstime_t)(NSTMODULUS * timetol);
-    }
-    else
-      nstimetol = (nstime_t)(0.5 * nsperiod); /* Default time tolerance is 1/2 sample period */
-
+    lm_tolerances (msr, tolerance, nsperiod, &nstimetol, &sampratetol);
     nnstimetol = (nstimetol) ? -nstimetol : 0;
 
-    /* Calculate sample rate tolerance */
-    if (tolerance && tolerance->samprate)
-    {
-      sampratetol = tolerance->samprate (msr);
-
-      if (sampratetol < 0.0)
-      {
-        ms_log (1, "%s: Ignoring negative sample rate tolerance (%g), using default\n", msr->sid,
-                sampratetol);
-        sampratetol = -1.0; /* Restore default sentinel */
-      }
-    }
-
     sampratehz = msr3_sampratehz (msr);
 
     /* last/firstgap are negative when the record overlaps the trace
@@ -737,7 +1088,7 @@ _mstl3_addmsr_impl (MS3TraceList *mstl, const MS3Record *msr, MS3RecordPtr **ppr
         IS_SAMPRATE_SIMILAR (sampratehz, id->last->samprate, sampratetol) &&
         SEGMENT_HAS_TIME_COVERAGE (id->last))
     {
-      if (!lm_addmsrtoseg (id->last, msr, endtime, 1))
+      if (!lm_addmsrtoseg (id->last, msr, endtime, 1, decode))
         return NULL;
 
       seg = id->last;
@@ -757,7 +1108,7 @@ _mstl3_addmsr_impl (MS3TraceList *mstl, const MS3Record *msr, MS3RecordPtr **ppr
     /* Record coverage is after all other coverage */
     else if ((msr->starttime - nsperiod - nstimetol) > id->latest)
     {
-      if (!(seg = lm_msr2seg (msr, endtime)))
+      if (!(seg = lm_msr2seg (msr, endtime, decode)))
         return NULL;
 
       /* Add to end of list */
@@ -781,7 +1132,7 @@ _mstl3_addmsr_impl (MS3TraceList *mstl, const MS3Record *msr, MS3RecordPtr **ppr
     /* Record coverage is before all other coverage */
     else if ((endtime + nsperiod + nstimetol) < id->earliest)
     {
-      if (!(seg = lm_msr2seg (msr, endtime)))
+      if (!(seg = lm_msr2seg (msr, endtime, decode)))
         return NULL;
 
       /* Add to beginning of list */
@@ -807,7 +1158,7 @@ _mstl3_addmsr_impl (MS3TraceList *mstl, const MS3Record *msr, MS3RecordPtr **ppr
              IS_SAMPRATE_SIMILAR (sampratehz, id->first->samprate, sampratetol) &&
              SEGMENT_HAS_TIME_COVERAGE (id->first))
     {
-      if (!lm_addmsrtoseg (id->first, msr, endtime, 2))
+      if (!lm_addmsrtoseg (id->first, msr, endtime, 2, decode))
         return NULL;
 
       seg = id->first;
@@ -934,7 +1285,7 @@ _mstl3_addmsr_impl (MS3TraceList *mstl, const MS3Record *msr, MS3RecordPtr **ppr
       /* Add MS3Record coverage to end of segment before */
       if (segbefore)
       {
-        if (!lm_addmsrtoseg (segbefore, msr, endtime, 1))
+        if (!lm_addmsrtoseg (segbefore, msr, endtime, 1, decode))
         {
           return NULL;
         }
@@ -984,7 +1335,7 @@ _mstl3_addmsr_impl (MS3TraceList *mstl, const MS3Record *msr, MS3RecordPtr **ppr
       /* Add MS3Record coverage to beginning of segment after */
       else if (segafter)
       {
-        if (!lm_addmsrtoseg (segafter, msr, endtime, 2))
+        if (!lm_addmsrtoseg (segafter, msr, endtime, 2, decode))
         {
           return NULL;
         }
@@ -1001,7 +1352,7 @@ _mstl3_addmsr_impl (MS3TraceList *mstl, const MS3Record *msr, MS3RecordPtr **ppr
       else
       {
         /* Create new segment */
-        if (!(seg = lm_msr2seg (msr, endtime)))
+        if (!(seg = lm_msr2seg (msr, endtime, decode)))
         {
           return NULL;
         }
@@ -1053,56 +1404,7 @@ _mstl3_addmsr_impl (MS3TraceList *mstl, const MS3Record *msr, MS3RecordPtr **ppr
   } /* End of adding coverage to matching ID */
 
   /* Sort modified segment into place, logic above should limit these to few shifts if any */
-  while (seg->next &&
-         (seg->starttime > seg->next->starttime ||
-          (seg->starttime == seg->next->starttime && seg->endtime < seg->next->endtime)))
-  {
-    /* Move segment down list, swap seg and seg->next */
-    segafter = seg->next;
-
-    if (seg->prev)
-      seg->prev->next = segafter;
-
-    if (segafter->next)
-      segafter->next->prev = seg;
-
-    segafter->prev = seg->prev;
-    seg->prev = segafter;
-    seg->next = segafter->next;
-    segafter->next = seg;
-
-    /* Reset first and last segment pointers if replaced */
-    if (id->first == seg)
-      id->first = segafter;
-
-    if (id->last == segafter)
-      id->last = seg;
-  }
-  while (seg->prev &&
-         (seg->starttime < seg->prev->starttime ||
-          (seg->starttime == seg->prev->starttime && seg->endtime > seg->prev->endtime)))
-  {
-    /* Move segment up list, swap seg and seg->prev */
-    segbefore = seg->prev;
-
-    if (seg->next)
-      seg->next->prev = segbefore;
-
-    if (segbefore->prev)
-      segbefore->prev->next = seg;
-
-    segbefore->next = seg->next;
-    seg->next = segbefore;
-    seg->prev = segbefore->prev;
-    segbefore->prev = seg;
-
-    /* Reset first and last segment pointers if replaced */
-    if (id->first == segbefore)
-      id->first = seg;
-
-    if (id->last == seg)
-      id->last = segbefore;
-  }
+  lm_sortseg (id, seg);
 
   /* Track the most-recently-active segments to bound future searches */
   if (seg && !((LMTraceListNode *)mstl)->foreignid)
@@ -1112,23 +1414,14 @@ _mstl3_addmsr_impl (MS3TraceList *mstl, const MS3Record *msr, MS3RecordPtr **ppr
   }
 
   /* Store update time at seg.prvtptr, allocate if needed */
-  if (seg && flags & MSF_PPUPDATETIME)
-  {
-    if (!seg->prvtptr)
-    {
-      if (!(seg->prvtptr = libmseed_memory.malloc (sizeof (nstime_t))))
-      {
-        ms_log (2, "Error allocating memory\n");
-        return NULL;
-      }
-    }
+  if (seg && flags & MSF_PPUPDATETIME && lm_seg_updatetime (seg))
+    return NULL;
 
-    /* Set to current time */
-    *(nstime_t *)seg->prvtptr = lmp_systemtime ();
-  }
+  if (pid)
+    *pid = id;
 
   return seg;
-} /* End of _mstl3_addmsr_impl() */
+} /* End of lm_addmsr() */
 
 /** ************************************************************************
  * @brief Add data coverage from an ::MS3Record to a ::MS3TraceList
@@ -1168,12 +1461,19 @@ _mstl3_addmsr_impl (MS3TraceList *mstl, const MS3Record *msr, MS3RecordPtr **ppr
  * mstl3_pack_ppupdate_flushidle(). If this flag is set, ensure to free the
  * memory using mstl3_free() with the @p freeprvtptr parameter set to 1.
  *
+ * If the ::MSF_UNPACKDATA flag is set in @p flags and the data samples
+ * of @p msr have not been unpacked (::MS3Record.numsamples is 0), the
+ * samples are decoded from ::MS3Record.record directly into the segment
+ * buffer, avoiding an intermediate copy.  The raw record must be
+ * available in this case.
+ *
  * @param[in] mstl Destination ::MS3TraceList to add data to
  * @param[in] msr ::MS3Record containing the data to add to list
  * @param[in] splitversion Flag to control splitting of version/quality
  * @param[in] autoheal Flag to control automatic merging of segments
  * @param[in] flags Flags to control optional functionality
  * @parblock
+ *  - @c ::MSF_UNPACKDATA : Decode data samples from the raw record if not unpacked
  *  - @c ::MSF_PPUPDATETIME : Store update time (as nstime_t) at ::MS3TraceSeg.prvtptr
  *  - @c ::MSF_SPLITISVERSION : Use @p splitversion as the version, otherwise use msr->pubversion
  *  - @c ::MSF_RECORDLIST_NOEXTRAS : Do not copy extra headers into record list entries
@@ -1218,36 +1518,883 @@ mstl3_addmsr_recordptr (MS3TraceList *mstl, const MS3Record *msr, MS3RecordPtr *
   return _mstl3_addmsr_impl (mstl, msr, pprecptr, splitversion, autoheal, flags, tolerance);
 }
 
+/* Entry for ordering records by trace ID in mstl3_addmsr_batch() */
+typedef struct LMBatchEntry
+{
+  const MS3Record *msr;
+  int64_t index;      /* Position in the caller's array */
+  uint8_t pubversion; /* Version used to match a trace ID, 0 if not splitting */
+} LMBatchEntry;
+
+/* Order by source ID, then matching version, then original position */
+static int
+lm_batchentry_cmp (const void *a, const void *b)
+{
+  const LMBatchEntry *ea = (const LMBatchEntry *)a;
+  const LMBatchEntry *eb = (const LMBatchEntry *)b;
+  int cmp;
+
+  if ((cmp = strcmp (ea->msr->sid, eb->msr->sid)))
+    return cmp;
+
+  if (ea->pubversion != eb->pubversion)
+    return (ea->pubversion < eb->pubversion) ? -1 : 1;
+
+  return (ea->index < eb->index) ? -1 : (ea->index > eb->index);
+}
+
 /** ************************************************************************
- * @brief Parse miniSEED from a buffer and populate a ::MS3TraceList
+ * @brief Add data coverage from an array of ::MS3Record to a ::MS3TraceList
  *
- * For a full description of @p tolerance see mstl3_addmsr().
+ * The resulting trace list is the same as adding each record of @p msrs,
+ * in array order, with mstl3_addmsr().  For a batch of records the
+ * records are first ordered by trace ID, keeping the array order of
+ * records for the same ID, so that each trace ID is searched for only
+ * once per batch.
  *
- * If the ::MSF_UNPACKDATA flag is set in @p flags, the data samples
- * will be unpacked.  In most cases the caller probably wants this
- * flag set, without it the trace list will merely be a list of
- * channels.
+ * Records are matched to trace IDs in the same way as mstl3_addmsr(),
+ * by source ID and, if @p splitversion is true, by publication version.
+ * See mstl3_addmsr() for a description of all other parameters.
  *
- * If the ::MSF_RECORDLIST flag is set in @p flags, a ::MS3RecordList
- * will be built for each ::MS3TraceSeg.  The ::MS3RecordPtr entries
- * contain the location of the data record, bit flags, extra headers, etc.
- * Extra headers are omitted if ::MSF_RECORDLIST_NOEXTRAS is also set.
+ * If an error occurs while adding a record, records for other trace IDs
+ * may, or may not, have been added to the list.
  *
- * @param[in] ppmstl Pointer-to-point to destination MS3TraceList
- * @param[in] buffer Source buffer to read miniSEED records from
- * @param[in] bufferlength Maximum length of @p buffer
+ * @param[in] mstl Destination ::MS3TraceList to add data to
+ * @param[in] msrs Array of ::MS3Record containing the data to add to list
+ * @param[in] count Number of records in @p msrs
  * @param[in] splitversion Flag to control splitting of version/quality
- * @param[in] flags Flags to control parsing and optional functionality:
- * @parblock
- *  - @c ::MSF_RECORDLIST : Build a ::MS3RecordList for each ::MS3TraceSeg
- *  - @c ::MSF_RECORDLIST_NOEXTRAS : Do not copy extra headers into record list entries
- *  - Flags supported by msr3_parse()
- *  - Flags supported by mstl3_addmsr()
- * @endparblock
+ * @param[in] autoheal Flag to control automatic merging of segments
+ * @param[in] flags Flags to control optional functionality, see mstl3_addmsr()
  * @param[in] tolerance Tolerance function pointers as ::MS3Tolerance
- * @param[in] verbose Controls verbosity, 0 means no diagnostic output
  *
- * @returns The number of records parsed on success, otherwise a
+ * @returns the number of records added or -1 on error.
+ *
+ * @see mstl3_addmsr()
+ * @see ms3_readmsr_batch()
+ *
+ * @ref MessageOnError - this function logs a message on error
+ ***************************************************************************/
+int64_t
+mstl3_addmsr_batch (MS3TraceList *mstl, MS3Record **msrs, int64_t count, int8_t splitversion,
+                    int8_t autoheal, uint32_t flags, const MS3Tolerance *tolerance)
+{
+  LMBatchEntry *entries = NULL;
+  MS3TraceID *id = NULL;
+  int64_t idx;
+
+  if (!mstl || (!msrs && count > 0))
+  {
+    ms_log (2, "%s(): Required input not defined: 'mstl' or 'msrs'\n", __func__);
+    return -1;
+  }
+
+  if (count <= 0)
+    return 0;
+
+  /* No ordering needed for a single record */
+  if (count == 1)
+    return (lm_addmsr (mstl, msrs[0], NULL, splitversion, autoheal, flags, tolerance, NULL))
+               ? 1
+               : -1;
+
+  if (!(entries = (LMBatchEntry *)lm_memory ()->malloc (sizeof (LMBatchEntry) * count)))
+  {
+    ms_log (2, "Error allocating memory\n");
+    return -1;
+  }
+
+  for (idx = 0; idx < count; idx++)
+  {
+    if (!msrs[idx])
+    {
+      ms_log (2, "%s(): Record %" PRId64 " is not defined\n", __func__, idx);
+      lm_memory ()->free (entries);
+      return -1;
+    }
+
+    entries[idx].msr = msrs[idx];
+    entries[idx].index = idx;
+    entries[idx].pubversion = 0;
+
+    if (splitversion)
+      entries[idx].pubversion =
+          (flags & MSF_SPLITISVERSION) ? (uint8_t)splitversion : msrs[idx]->pubversion;
+  }
+
+  /* Group records by trace ID, ties keep array order */
+  qsort (entries, count, sizeof (LMBatchEntry), lm_batchentry_cmp);
+
+  /* Add each run of records for the same trace ID with a single ID search.
+   * Each trace ID is only modified by records for that ID, so adding runs
+   * of records, in array order within a run, is equivalent to adding all
+   * records in array order. */
+  for (idx = 0; idx < count; idx++)
+  {
+    if (idx == 0 || strcmp (entries[idx - 1].msr->sid, entries[idx].msr->sid) ||
+        entries[idx - 1].pubversion != entries[idx].pubversion)
+      id = NULL;
+
+    if (!lm_addmsr (mstl, entries[idx].msr, NULL, splitversion, autoheal, flags, tolerance, &id))
+    {
+      lm_memory ()->free (entries);
+      return -1;
+    }
+  }
+
+  lm_memory ()->free (entries);
+
+  return count;
+} /* End of mstl3_addmsr_batch() */
+
+/***************************************************************************
+ * Detach a segment from the segment list of a trace ID, dropping it from
+ * the recent set of the ID if tracked.
+ ***************************************************************************/
+static void
+lm_detachseg (MS3TraceList *mstl, MS3TraceID *id, MS3TraceSeg *seg)
+{
+  if (seg->prev)
+    seg->prev->next = seg->next;
+  else
+    id->first = seg->next;
+
+  if (seg->next)
+    seg->next->prev = seg->prev;
+  else
+    id->last = seg->prev;
+
+  seg->prev = NULL;
+  seg->next = NULL;
+  id->numsegments -= 1;
+
+  if (!((LMTraceListNode *)mstl)->foreignid)
+    lm_recentseg_remove ((LMTraceIDNode *)id, seg);
+} /* End of lm_detachseg() */
+
+/***************************************************************************
+ * Unlink the first MS3TraceID from a MS3TraceList.  The first entry is
+ * directly linked from the list head at every level it occupies.
+ ***************************************************************************/
+static void
+lm_unlinkfirstID (MS3TraceList *mstl, MS3TraceID *id)
+{
+  int level;
+
+  lm_idindex_remove (mstl, id);
+
+  for (level = 0; level < id->height; level++)
+  {
+    if (mstl->traces.next[level] == id)
+      mstl->traces.next[level] = id->next[level];
+  }
+
+  memset (id->next, 0, sizeof (id->next));
+  mstl->numtraceids--;
+} /* End of lm_unlinkfirstID() */
+
+/***************************************************************************
+ * Link a MS3TraceID unlinked from another MS3TraceList into a list.  The
+ * list position is found by source ID and publication version so that
+ * multiple versions of a source ID are placed correctly.
+ *
+ * Return 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+lm_linkID (MS3TraceList *mstl, MS3TraceID *id)
+{
+  MS3TraceID *previd[MSTRACEID_SKIPLIST_HEIGHT] = {NULL};
+
+  if (mstl3_findID (mstl, id->sid, id->pubversion, previd))
+  {
+    ms_log (2, "Trace ID for %s, version %u already in trace list\n", id->sid, id->pubversion);
+    return -1;
+  }
+
+  if (lm_addID (mstl, id, previd) == NULL)
+  {
+    ms_log (2, "Error adding ID for %s, version %u to trace list\n", id->sid, id->pubversion);
+    return -1;
+  }
+
+  return 0;
+} /* End of lm_linkID() */
+
+/***************************************************************************
+ * Merge a segment of source trace ID 'srcid' in list 'srcmstl' into the
+ * matching trace ID 'id' of list 'mstl'.
+ *
+ * The segment is added to the segment list of 'id' using the same
+ * matching as lm_addmsr() applies to a record with the same coverage.
+ * If the segment does not join an existing segment it is moved into the
+ * list as is, otherwise its samples and record list are appended to the
+ * joined segment and it is freed.  The segment is detached from 'srcid'
+ * only after it is successfully merged.
+ *
+ * Return 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+lm_mergeseg (MS3TraceList *mstl, MS3TraceID *id, MS3TraceList *srcmstl, MS3TraceID *srcid,
+             MS3TraceSeg *seg, int8_t autoheal, uint32_t flags, const MS3Tolerance *tolerance)
+{
+  MS3Record msr = MS3Record_INITIALIZER;
+  MS3TraceSeg *searchseg = NULL;
+  MS3TraceSeg *segbefore = NULL;
+  MS3TraceSeg *segafter = NULL;
+  MS3TraceSeg *followseg = NULL;
+  MS3TraceSeg *target = NULL;
+  void *prvtptr;
+
+  nstime_t pregap;
+  nstime_t postgap;
+  nstime_t nsperiod = 0;
+  nstime_t nstimetol = 0;
+  nstime_t nnstimetol = 0;
+  double sampratetol = -1.0;
+
+  int8_t foreignid = ((LMTraceListNode *)mstl)->foreignid;
+
+  /* Record equivalent of the segment coverage for the tolerance functions */
+  memcpy (msr.sid, srcid->sid, sizeof (msr.sid));
+  msr.pubversion = srcid->pubversion;
+  msr.starttime = seg->starttime;
+  msr.samprate = seg->samprate;
+  msr.samplecnt = seg->samplecnt;
+  msr.numsamples = seg->numsamples;
+  msr.sampletype = seg->sampletype;
+
+  /* Segments without time coverage cannot be joined, only searched for a place */
+  if (SEGMENT_HAS_TIME_COVERAGE (seg))
+  {
+    nsperiod = msr3_nsperiod (&msr);
+    lm_tolerances (&msr, tolerance, nsperiod, &nstimetol, &sampratetol);
+    nnstimetol = (nstimetol) ? -nstimetol : 0;
+
+    for (searchseg = id->first; searchseg; searchseg = searchseg->next)
+    {
+      /* Done searching when segment starts beyond the segment end plus tolerance */
+      if (searchseg->starttime > seg->endtime + nsperiod + nstimetol)
+        break;
+
+      /* Skip segments with no time coverage, these cannot be extended */
+      if (!SEGMENT_HAS_TIME_COVERAGE (searchseg))
+        continue;
+
+      /* Done searching if autohealing and segment exactly matches a segment */
+      if (autoheal && seg->starttime == searchseg->starttime &&
+          seg->endtime == searchseg->endtime)
+      {
+        followseg = searchseg;
+        break;
+      }
+
+      if (seg->starttime > searchseg->starttime)
+        followseg = searchseg;
+
+      if (!segbefore)
+      {
+        postgap = seg->starttime - searchseg->endtime - nsperiod;
+
+        if (postgap <= nstimetol && postgap >= nnstimetol &&
+            IS_SAMPRATE_SIMILAR (seg->samprate, searchseg->samprate, sampratetol))
+          segbefore = searchseg;
+      }
+
+      if (!segafter)
+      {
+        pregap = searchseg->starttime - seg->endtime - nsperiod;
+
+        if (pregap <= nstimetol && pregap >= nnstimetol &&
+            IS_SAMPRATE_SIMILAR (seg->samprate, searchseg->samprate, sampratetol))
+          segafter = searchseg;
+      }
+
+      /* Done searching if both before and after segments are found */
+      if (segbefore && segafter)
+        break;
+      /* Done searching if not autohealing and one match found */
+      else if (!autoheal && (segbefore || segafter))
+        break;
+    }
+  }
+  else
+  {
+    for (searchseg = id->first; searchseg; searchseg = searchseg->next)
+    {
+      if (searchseg->starttime < seg->starttime)
+        followseg = searchseg;
+      else
+        break;
+    }
+  }
+
+  /* Append segment coverage to the end of segment before */
+  if (segbefore)
+  {
+    if (!lm_addsegtoseg (segbefore, seg))
+      return -1;
+
+    lm_detachseg (srcmstl, srcid, seg);
+    lm_free_segment_memory (seg, 1);
+
+    /* Merge two segments that now fit if autohealing */
+    if (autoheal && segafter && segbefore != segafter)
+    {
+      if (!lm_addsegtoseg (segbefore, segafter))
+      {
+        if (!foreignid)
+          lm_endbound_fold ((LMTraceIDNode *)id, segbefore->endtime);
+        return -1;
+      }
+
+      lm_detachseg (mstl, id, segafter);
+      lm_free_segment_memory (segafter, 1);
+    }
+
+    target = segbefore;
+  }
+  /* Prepend segment coverage to the beginning of segment after */
+  else if (segafter)
+  {
+    /* Append coverage of segment after to the source segment, which then
+     * replaces segment after in the list, keeping its private pointer */
+    if (!lm_addsegtoseg (seg, segafter))
+      return -1;
+
+    lm_detachseg (srcmstl, srcid, seg);
+
+    prvtptr = seg->prvtptr;
+    seg->prvtptr = segafter->prvtptr;
+    segafter->prvtptr = prvtptr;
+
+    seg->prev = segafter->prev;
+    seg->next = segafter->next;
+    if (seg->prev)
+      seg->prev->next = seg;
+    else
+      id->first = seg;
+    if (seg->next)
+      seg->next->prev = seg;
+    else
+      id->last = seg;
+
+    if (!foreignid)
+      lm_recentseg_remove ((LMTraceIDNode *)id, segafter);
+
+    lm_free_segment_memory (segafter, 1);
+
+    target = seg;
+  }
+  /* Move segment into the list as a new segment */
+  else
+  {
+    lm_detachseg (srcmstl, srcid, seg);
+
+    if (!followseg)
+    {
+      seg->next = id->first;
+      if (id->first)
+        id->first->prev = seg;
+      else
+        id->last = seg;
+
+      id->first = seg;
+    }
+    else
+    {
+      seg->next = followseg->next;
+      seg->prev = followseg;
+      if (followseg->next)
+        followseg->next->prev = seg;
+      followseg->next = seg;
+
+      if (followseg == id->last)
+        id->last = seg;
+    }
+
+    id->numsegments++;
+
+    target = seg;
+  }
+
+  /* Track largest publication version, earliest and latest times */
+  if (srcid->pubversion > id->pubversion)
+    id->pubversion = srcid->pubversion;
+
+  if (target->starttime < id->earliest)
+    id->earliest = target->starttime;
+
+  if (target->endtime > id->latest)
+    id->latest = target->endtime;
+
+  lm_sortseg (id, target);
+
+  /* Track the most-recently-active segments to bound future searches */
+  if (!foreignid)
+  {
+    lm_recentseg_touch ((LMTraceIDNode *)id, target);
+    lm_recentseg_touch ((LMTraceIDNode *)id, id->last);
+  }
+
+  if (flags & MSF_PPUPDATETIME && lm_seg_updatetime (target))
+    return -1;
+
+  return 0;
+} /* End of lm_mergeseg() */
+
+/** ************************************************************************
+ * @brief Merge the contents of a ::MS3TraceList into another
+ *
+ * All trace IDs and segments, including sample buffers and record lists,
+ * are moved from the source list at @p ppsrc into @p mstl, after which
+ * the source list is freed and @p *ppsrc is set to NULL.  This allows
+ * trace lists built independently, e.g. by parallel readers, to be
+ * combined.
+ *
+ * Trace IDs are matched by source ID and, if @p splitversion is true,
+ * by publication version.  Trace IDs without a match are moved to @p
+ * mstl as they are.  Segments of matching trace IDs are added with the
+ * same tolerances and @p autoheal semantics that mstl3_addmsr() applies
+ * to a record with the same coverage.  Segments that do not join an
+ * existing segment are moved without copying their samples, segments
+ * that do are appended to, or prepended with, the existing segment.
+ *
+ * The private pointers (prvtptr) of trace IDs and segments that are
+ * moved are retained, those of source entries combined with existing
+ * entries are freed.  If the ::MSF_PPUPDATETIME flag is set in @p flags
+ * the update time of each merged segment is set.
+ *
+ * If an error occurs the source list is left with the entries not yet
+ * merged and is not freed.
+ *
+ * @param[in] mstl Destination ::MS3TraceList to merge into
+ * @param[in,out] ppsrc Pointer-to-pointer to the source ::MS3TraceList
+ * @param[in] splitversion Flag to control splitting of version/quality
+ * @param[in] autoheal Flag to control automatic merging of segments
+ * @param[in] flags Flags to control optional functionality
+ * @parblock
+ *  - @c ::MSF_PPUPDATETIME : Store update time (as nstime_t) at ::MS3TraceSeg.prvtptr
+ * @endparblock
+ * @param[in] tolerance Tolerance function pointers as ::MS3Tolerance
+ *
+ * @returns 0 on success and -1 on error.
+ *
+ * @see mstl3_addmsr()
+ *
+ * @ref MessageOnError - this function logs a message on error
+ ***************************************************************************/
+int
+mstl3_merge (MS3TraceList *mstl, MS3TraceList **ppsrc, int8_t splitversion, int8_t autoheal,
+             uint32_t flags, const MS3Tolerance *tolerance)
+{
+  MS3TraceList *src;
+  MS3TraceID *srcid;
+  MS3TraceID *id;
+  MS3TraceID *previd[MSTRACEID_SKIPLIST_HEIGHT] = {NULL};
+
+  if (!mstl || !ppsrc)
+  {
+    ms_log (2, "%s(): Required input not defined: 'mstl' or 'ppsrc'\n", __func__);
+    return -1;
+  }
+
+  if (!(src = *ppsrc))
+    return 0;
+
+  if (src == mstl)
+  {
+    ms_log (2, "%s(): Cannot merge a trace list into itself\n", __func__);
+    return -1;
+  }
+
+  /* IDs not allocated by this library may be moved from the source list */
+  if (((LMTraceListNode *)src)->foreignid)
+    ((LMTraceListNode *)mstl)->foreignid = 1;
+
+  /* Consume source IDs from the head of the list */
+  while ((srcid = src->traces.next[0]))
+  {
+    id = mstl3_findID (mstl, srcid->sid, (splitversion) ? srcid->pubversion : 0, previd);
+
+    /* Move the entire trace ID if not present in the destination */
+    if (!id)
+    {
+      lm_unlinkfirstID (src, srcid);
+
+      if (lm_addID (mstl, srcid, previd) == NULL)
+      {
+        ms_log (2, "Error adding new ID to trace list\n");
+        lm_linkID (src, srcid);
+        return -1;
+      }
+
+      if (flags & MSF_PPUPDATETIME)
+      {
+        for (MS3TraceSeg *seg = srcid->first; seg; seg = seg->next)
+          if (lm_seg_updatetime (seg))
+            return -1;
+      }
+
+      continue;
+    }
+
+    /* Merge each segment into the matching trace ID */
+    while (srcid->first)
+    {
+      if (lm_mergeseg (mstl, id, src, srcid, srcid->first, autoheal, flags, tolerance))
+        return -1;
+    }
+
+    lm_unlinkfirstID (src, srcid);
+
+    if (srcid->prvtptr)
+      lm_memory ()->free (srcid->prvtptr);
+
+    lm_memory ()->free (srcid);
+  }
+
+  mstl3_free (ppsrc, 0);
+
+  return 0;
+} /* End of mstl3_merge() */
+
+/* Return the shard index for a source ID */
+static int
+lm_shard_index (const MS3TraceListShards *shards, const char *sid)
+{
+  return (int)(lm_sid_hash (sid) % (uint32_t)shards->nshards);
+}
+
+/** ************************************************************************
+ * @brief Initialize a ::MS3TraceListShards for concurrent insertion
+ *
+ * A ::MS3TraceListShards is a trace list divided into @p nshards
+ * independently locked trace lists by a hash of the source ID.  All
+ * trace IDs for a source ID, including all publication versions, are
+ * in the same shard.  Records may be added concurrently from multiple
+ * threads with mstl3_shards_addmsr(), where threads only contend when
+ * adding to the same shard.
+ *
+ * To print, pack or otherwise use the contents as a ::MS3TraceList, use
+ * mstl3_shards_acquire() to obtain a consistent, combined trace list
+ * and mstl3_shards_release() when done.
+ *
+ * @param[in] nshards Number of shards, if less than 1 a default of 64
+ *
+ * @returns a pointer to a ::MS3TraceListShards on success or NULL on error.
+ *
+ * @ref MessageOnError - this function logs a message on error
+ *
+ * @see mstl3_shards_free()
+ ***************************************************************************/
+MS3TraceListShards *
+mstl3_shards_init (int nshards)
+{
+  MS3TraceListShards *shards;
+  int idx;
+
+  if (nshards < 1)
+    nshards = LM_DEFAULT_SHARDS;
+
+  if (!(shards = (MS3TraceListShards *)lm_memory ()->malloc (sizeof (MS3TraceListShards))))
+  {
+    ms_log (2, "Cannot allocate memory\n");
+    return NULL;
+  }
+
+  shards->nshards = 0;
+  shards->view = NULL;
+
+  if (!(shards->shard = (LMTraceShard *)lm_memory ()->malloc (sizeof (LMTraceShard) * nshards)))
+  {
+    ms_log (2, "Cannot allocate memory\n");
+    lm_memory ()->free (shards);
+    return NULL;
+  }
+
+  for (idx = 0; idx < nshards; idx++)
+  {
+    if (!(shards->shard[idx].mstl = mstl3_init (NULL)))
+    {
+      mstl3_shards_free (&shards, 0);
+      return NULL;
+    }
+
+    if (lmp_mutex_init (&shards->shard[idx].lock))
+    {
+      ms_log (2, "Cannot initialize shard lock\n");
+      mstl3_free (&shards->shard[idx].mstl, 0);
+      mstl3_shards_free (&shards, 0);
+      return NULL;
+    }
+
+    shards->nshards++;
+  }
+
+  return shards;
+} /* End of mstl3_shards_init() */
+
+/** ************************************************************************
+ * @brief Free all memory associated with a ::MS3TraceListShards
+ *
+ * The pointer to the target ::MS3TraceListShards will be set to NULL.  It
+ * must not be acquired or in use by other threads.
+ *
+ * @param[in] ppshards Pointer-to-pointer to the target ::MS3TraceListShards
+ * @param[in] freeprvtptr If true, also free any data at the @p prvtptr
+ * members, see mstl3_free()
+ ***************************************************************************/
+void
+mstl3_shards_free (MS3TraceListShards **ppshards, int8_t freeprvtptr)
+{
+  int idx;
+
+  if (!ppshards || !*ppshards)
+    return;
+
+  for (idx = 0; idx < (*ppshards)->nshards; idx++)
+  {
+    mstl3_free (&(*ppshards)->shard[idx].mstl, freeprvtptr);
+    lmp_mutex_destroy (&(*ppshards)->shard[idx].lock);
+  }
+
+  lm_memory ()->free ((*ppshards)->shard);
+  lm_memory ()->free (*ppshards);
+
+  *ppshards = NULL;
+} /* End of mstl3_shards_free() */
+
+/** ************************************************************************
+ * @brief Add data coverage from an ::MS3Record to a ::MS3TraceListShards
+ *
+ * The equivalent of mstl3_addmsr() for a ::MS3TraceListShards, that may
+ * be called concurrently from multiple threads.  The record is added to
+ * the shard for its source ID while holding the lock for the shard.  See
+ * mstl3_addmsr() for a description of the parameters.
+ *
+ * Unlike mstl3_addmsr() the updated segment is not returned as it may be
+ * modified by other threads as soon as this function returns.
+ *
+ * @param[in] shards Destination ::MS3TraceListShards to add data to
+ * @param[in] msr ::MS3Record containing the data to add
+ * @param[in] splitversion Flag to control splitting of version/quality
+ * @param[in] autoheal Flag to control automatic merging of segments
+ * @param[in] flags Flags to control optional functionality, see mstl3_addmsr()
+ * @param[in] tolerance Tolerance function pointers as ::MS3Tolerance
+ *
+ * @returns 0 on success and -1 on error.
+ *
+ * @ref MessageOnError - this function logs a message on error
+ ***************************************************************************/
+int
+mstl3_shards_addmsr (MS3TraceListShards *shards, const MS3Record *msr, int8_t splitversion,
+                     int8_t autoheal, uint32_t flags, const MS3Tolerance *tolerance)
+{
+  LMTraceShard *shard;
+  MS3TraceSeg *seg;
+
+  if (!shards || !msr)
+  {
+    ms_log (2, "%s(): Required input not defined: 'shards' or 'msr'\n", __func__);
+    return -1;
+  }
+
+  shard = &shards->shard[lm_shard_index (shards, msr->sid)];
+
+  lmp_mutex_lock (&shard->lock);
+  seg = lm_addmsr (shard->mstl, msr, NULL, splitversion, autoheal, flags, tolerance, NULL);
+  lmp_mutex_unlock (&shard->lock);
+
+  return (seg) ? 0 : -1;
+} /* End of mstl3_shards_addmsr() */
+
+/***************************************************************************
+ * Return the trace IDs of a combined trace list to their shards.  On
+ * error the trace ID that could not be returned is left in the combined
+ * list with those not yet returned, and those already returned remain in
+ * their shards.
+ *
+ * Return 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+lm_shards_return (MS3TraceListShards *shards, MS3TraceList *view)
+{
+  MS3TraceList *shardmstl;
+  MS3TraceID *id;
+  int8_t foreignid;
+
+  foreignid = ((LMTraceListNode *)view)->foreignid;
+
+  while ((id = view->traces.next[0]))
+  {
+    shardmstl = shards->shard[lm_shard_index (shards, id->sid)].mstl;
+
+    lm_unlinkfirstID (view, id);
+
+    if (lm_linkID (shardmstl, id))
+    {
+      lm_linkID (view, id);
+      return -1;
+    }
+
+    if (foreignid)
+      ((LMTraceListNode *)shardmstl)->foreignid = 1;
+  }
+
+  return 0;
+} /* End of lm_shards_return() */
+
+/** ************************************************************************
+ * @brief Acquire a consistent, combined ::MS3TraceList of a ::MS3TraceListShards
+ *
+ * All shards are locked and their trace IDs are moved, without copying
+ * segments or samples, into a single ::MS3TraceList that is returned.
+ * The returned list may be used with any function accepting a trace
+ * list, e.g. mstl3_printtracelist() or mstl3_pack(), and may be modified.
+ *
+ * Insertion by other threads blocks until mstl3_shards_release() is
+ * called, which returns the trace IDs to their shards.  The calling
+ * thread must not call mstl3_shards_addmsr() or acquire again before
+ * releasing, and must not free the returned list.
+ *
+ * @param[in] shards ::MS3TraceListShards to acquire
+ *
+ * @returns the combined ::MS3TraceList on success or NULL on error.
+ *
+ * @ref MessageOnError - this function logs a message on error
+ *
+ * @see mstl3_shards_release()
+ ***************************************************************************/
+MS3TraceList *
+mstl3_shards_acquire (MS3TraceListShards *shards)
+{
+  MS3TraceList *view;
+  MS3TraceList *shardmstl;
+  MS3TraceID *id;
+  int idx;
+
+  if (!shards)
+  {
+    ms_log (2, "%s(): Required input not defined: 'shards'\n", __func__);
+    return NULL;
+  }
+
+  for (idx = 0; idx < shards->nshards; idx++)
+    lmp_mutex_lock (&shards->shard[idx].lock);
+
+  if (!(view = mstl3_init (NULL)))
+  {
+    for (idx = shards->nshards - 1; idx >= 0; idx--)
+      lmp_mutex_unlock (&shards->shard[idx].lock);
+    return NULL;
+  }
+
+  /* Move all trace IDs into the combined list, source IDs are unique to a shard */
+  for (idx = 0; idx < shards->nshards; idx++)
+  {
+    shardmstl = shards->shard[idx].mstl;
+
+    if (((LMTraceListNode *)shardmstl)->foreignid)
+      ((LMTraceListNode *)view)->foreignid = 1;
+
+    while ((id = shardmstl->traces.next[0]))
+    {
+      lm_unlinkfirstID (shardmstl, id);
+
+      if (lm_linkID (view, id))
+      {
+        ms_log (2, "%s(): Cannot combine trace list shards\n", __func__);
+
+        /* Return the ID and those already moved to their shards */
+        lm_linkID (shardmstl, id);
+        lm_shards_return (shards, view);
+
+        mstl3_free (&view, 0);
+
+        for (idx = shards->nshards - 1; idx >= 0; idx--)
+          lmp_mutex_unlock (&shards->shard[idx].lock);
+
+        return NULL;
+      }
+    }
+  }
+
+  shards->view = view;
+
+  return view;
+} /* End of mstl3_shards_acquire() */
+
+/** ************************************************************************
+ * @brief Release a ::MS3TraceListShards acquired with mstl3_shards_acquire()
+ *
+ * The trace IDs of the combined trace list, including any added while
+ * acquired, are returned to their shards and all shards are unlocked.
+ *
+ * If the trace IDs cannot be returned the ::MS3TraceListShards remains
+ * acquired, with all trace IDs in the combined trace list.
+ *
+ * @param[in] shards ::MS3TraceListShards to release
+ *
+ * @returns 0 on success and -1 on error.
+ *
+ * @ref MessageOnError - this function logs a message on error
+ *
+ * @see mstl3_shards_acquire()
+ ***************************************************************************/
+int
+mstl3_shards_release (MS3TraceListShards *shards)
+{
+  int idx;
+
+  if (!shards || !shards->view)
+  {
+    ms_log (2, "%s(): Trace list shards not defined or not acquired\n", __func__);
+    return -1;
+  }
+
+  if (lm_shards_return (shards, shards->view))
+  {
+    ms_log (2, "%s(): Cannot return trace IDs to trace list shards\n", __func__);
+    return -1;
+  }
+
+  mstl3_free (&shards->view, 0);
+
+  for (idx = shards->nshards - 1; idx >= 0; idx--)
+    lmp_mutex_unlock (&shards->shard[idx].lock);
+
+  return 0;
+} /* End of mstl3_shards_release() */
+
+/** ************************************************************************
+ * @brief Parse miniSEED from a buffer and populate a ::MS3TraceList
+ *
+ * For a full description of @p tolerance see mstl3_addmsr().
+ *
+ * If the ::MSF_UNPACKDATA flag is set in @p flags, the data samples
+ * will be unpacked.  In most cases the caller probably wants this
+ * flag set, without it the trace list will merely be a list of
+ * channels.
+ *
+ * If the ::MSF_RECORDLIST flag is set in @p flags, a ::MS3RecordList
+ * will be built for each ::MS3TraceSeg.  The ::MS3RecordPtr entries
+ * contain the location of the data record, bit flags, extra headers, etc.
+ * Extra headers are omitted if ::MSF_RECORDLIST_NOEXTRAS is also set.
+ *
+ * @param[in] ppmstl Pointer-to-point to destination MS3TraceList
+ * @param[in] buffer Source buffer to read miniSEED records from
+ * @param[in] bufferlength Maximum length of @p buffer
+ * @param[in] splitversion Flag to control splitting of version/quality
+ * @param[in] flags Flags to control parsing and optional functionality:
+ * @parblock
+ *  - @c ::MSF_RECORDLIST : Build a ::MS3RecordList for each ::MS3TraceSeg
+ *  - @c ::MSF_RECORDLIST_NOEXTRAS : Do not copy extra headers into record list entries
+ *  - Flags supported by msr3_parse()
+ *  - Flags supported by mstl3_addmsr()
+ * @endparblock
+ * @param[in] tolerance Tolerance function pointers as ::MS3Tolerance
+ * @param[in] verbose Controls verbosity, 0 means no diagnostic output
+ *
+ * @returns The number of records parsed on success, otherwise a
  * negative library error code.
  *
  * @ref MessageOnError - this function logs a message on error
@@ -1334,9 +2481,10 @@ mstl3_readbuffer_selection (MS3TraceList **ppmstl, const char *buffer, uint64_t
       return MS_GENERROR;
   }
 
-  /* Defer data unpacking if selections are used by unsetting MSF_UNPACKDATA */
-  if ((flags & MSF_UNPACKDATA) && selections)
-    pflags &= ~(MSF_UNPACKDATA);
+  /* Data samples are decoded directly into the trace segments by mstl3_addmsr(),
+   * extra headers are only needed if copied into a record list */
+  pflags &= ~(MSF_UNPACKDATA);
+  pflags |= MSF_DEFEREXTRA;
 
   while ((bufferlength - offset) >= MINRECLEN)
   {
@@ -1369,18 +2517,6 @@ mstl3_readbuffer_selection (MS3TraceList **ppmstl, const char *buffer, uint64_t
         offset += msr->reclen;
         continue;
       }
-
-      /* Unpack data samples if this has been deferred */
-      if ((flags & MSF_UNPACKDATA) && msr->samplecnt > 0)
-      {
-        if (msr3_unpack_data (msr, verbose) != msr->samplecnt)
-        {
-          if (msr)
-            msr3_free (&msr);
-
-          return MS_GENERROR;
-        }
-      }
     }
 
     /* Add record to trace list */
@@ -1414,28 +2550,105 @@ mstl3_readbuffer_selection (MS3TraceList **ppmstl, const char *buffer, uint64_t
       recordptr->prvtptr = NULL;
     }
 
-    reccount += 1;
-    offset += msr->reclen;
+    reccount += 1;
+    offset += msr->reclen;
+  }
+
+  if (msr)
+    msr3_free (&msr);
+
+  return reccount;
+} /* End of mstl3_readbuffer_selection() */
+
+/***************************************************************************
+ * Determine the count and type of data samples to add to a segment from
+ * an MS3Record.
+ *
+ * If @p decode is set the samples are decoded from the raw record
+ * directly into the segment, see mstl3_addmsr(), otherwise they are
+ * copied from MS3Record.datasamples.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+lm_msr_samples (const MS3Record *msr, int8_t decode, int64_t *numsamples, char *sampletype,
+                int *samplesize)
+{
+  uint8_t decodedsize = 0;
+
+  *numsamples = 0;
+  *sampletype = msr->sampletype;
+  *samplesize = 0;
+
+  if (decode)
+  {
+    if (lm_unpack_data_size (msr, &decodedsize, sampletype) < 0)
+      return -1;
+
+    *numsamples = msr->samplecnt;
+    *samplesize = decodedsize;
+  }
+  else if (msr->datasamples && msr->numsamples > 0)
+  {
+    *numsamples = msr->numsamples;
+    *samplesize = ms_samplesize (msr->sampletype);
+  }
+
+  if (*numsamples > 0 && !*samplesize)
+  {
+    ms_log (2, "Unknown sample size for sample type: %c\n", *sampletype);
+    return -1;
+  }
+
+  return 0;
+} /* End of lm_msr_samples() */
+
+/***************************************************************************
+ * Place data samples from an MS3Record at the specified buffer location,
+ * either decoding from the raw record or copying from
+ * MS3Record.datasamples.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+lm_msr_putsamples (const MS3Record *msr, int8_t decode, void *output, int64_t numsamples,
+                   int samplesize)
+{
+  char sampletype;
+
+  if (!decode)
+  {
+    memcpy (output, msr->datasamples, (size_t)(numsamples * samplesize));
+    return 0;
   }
 
-  if (msr)
-    msr3_free (&msr);
+  if (lm_unpack_data_to (msr, output, (uint64_t)(numsamples * samplesize), &sampletype, 0) !=
+      numsamples)
+  {
+    ms_log (2, "%s: Cannot unpack data samples\n", msr->sid);
+    return -1;
+  }
 
-  return reccount;
-} /* End of mstl3_readbuffer_selection() */
+  return 0;
+} /* End of lm_msr_putsamples() */
 
 /***************************************************************************
  * Create an MS3TraceSeg structure from an MS3Record structure.
  *
+ * If @p decode is set, data samples are decoded from the raw record
+ * directly into the segment buffer.
+ *
  * Return a pointer to a MS3TraceSeg otherwise NULL on error.
  *
  * @ref MessageOnError - this function logs a message on error
  ***************************************************************************/
 static MS3TraceSeg *
-lm_msr2seg (const MS3Record *msr, nstime_t endtime)
+lm_msr2seg (const MS3Record *msr, nstime_t endtime, int8_t decode)
 {
   MS3TraceSeg *seg = NULL;
   size_t datasize = 0;
+  int64_t numsamples;
+  char sampletype;
   int samplesize;
 
   if (!msr)
@@ -1444,7 +2657,10 @@ lm_msr2seg (const MS3Record *msr, nstime_t endtime)
     return NULL;
   }
 
-  if (!(seg = (MS3TraceSeg *)libmseed_memory.malloc (sizeof (MS3TraceSeg))))
+  if (lm_msr_samples (msr, decode, &numsamples, &sampletype, &samplesize))
+    return NULL;
+
+  if (!(seg = (MS3TraceSeg *)lm_memory ()->malloc (sizeof (MS3TraceSeg))))
   {
     ms_log (2, "Error allocating memory\n");
     return NULL;
@@ -1456,38 +2672,36 @@ lm_msr2seg (const MS3Record *msr, nstime_t endtime)
   seg->endtime = endtime;
   seg->samprate = msr3_sampratehz (msr);
   seg->samplecnt = msr->samplecnt;
-  seg->sampletype = msr->sampletype;
-  seg->numsamples = msr->numsamples;
+  seg->sampletype = sampletype;
+  seg->numsamples = (decode) ? 0 : msr->numsamples;
 
-  /* Allocate space for and copy datasamples */
-  if (msr->datasamples && msr->numsamples)
+  /* Allocate space for and copy or decode datasamples */
+  if (numsamples > 0)
   {
-    if (!(samplesize = ms_samplesize (msr->sampletype)))
+    if ((uint64_t)numsamples > SIZE_MAX / (size_t)samplesize)
     {
-      ms_log (2, "Unknown sample size for sample type: %c\n", msr->sampletype);
+      ms_log (2, "Data buffer size overflow for %" PRId64 " samples\n", numsamples);
       lm_free_segment_memory (seg, 0);
       return NULL;
     }
 
-    if (msr->numsamples < 0 || (uint64_t)msr->numsamples > SIZE_MAX / (size_t)samplesize)
+    datasize = (size_t)numsamples * (size_t)samplesize;
+
+    if (!(seg->datasamples = lm_memory ()->malloc (datasize)))
     {
-      ms_log (2, "Data buffer size overflow for %" PRId64 " samples\n", msr->numsamples);
+      ms_log (2, "Error allocating memory\n");
       lm_free_segment_memory (seg, 0);
       return NULL;
     }
+    seg->datasize = datasize;
 
-    datasize = (size_t)msr->numsamples * (size_t)samplesize;
-
-    if (!(seg->datasamples = libmseed_memory.malloc (datasize)))
+    if (lm_msr_putsamples (msr, decode, seg->datasamples, numsamples, samplesize))
     {
-      ms_log (2, "Error allocating memory\n");
       lm_free_segment_memory (seg, 0);
       return NULL;
     }
-    seg->datasize = datasize;
 
-    /* Copy data samples from MS3Record to MS3TraceSeg */
-    memcpy (seg->datasamples, msr->datasamples, datasize);
+    seg->numsamples = numsamples;
   }
 
   return seg;
@@ -1501,16 +2715,22 @@ lm_msr2seg (const MS3Record *msr, nstime_t endtime)
  * 1 : add coverage to the end
  * 2 : add coverage to the beginninig
  *
+ * If @p decode is set, data samples are decoded from the raw record
+ * directly into the grown segment buffer.
+ *
  * Return a pointer to a MS3TraceSeg otherwise, NULL on error.
  *
  * @ref MessageOnError - this function logs a message on error
  ***************************************************************************/
 static MS3TraceSeg *
-lm_addmsrtoseg (MS3TraceSeg *seg, const MS3Record *msr, nstime_t endtime, int8_t whence)
+lm_addmsrtoseg (MS3TraceSeg *seg, const MS3Record *msr, nstime_t endtime, int8_t whence,
+                int8_t decode)
 {
   int samplesize = 0;
   void *newdatasamples = NULL;
   size_t newdatasize = 0;
+  int64_t numsamples;
+  char sampletype;
 
   if (!seg || !msr)
   {
@@ -1518,33 +2738,36 @@ lm_addmsrtoseg (MS3TraceSeg *seg, const MS3Record *msr, nstime_t endtime, int8_t
     return NULL;
   }
 
+  if (whence != 1 && whence != 2)
+  {
+    ms_log (2, "unrecognized whence value: %d\n", whence);
+    return NULL;
+  }
+
+  if (lm_msr_samples (msr, decode, &numsamples, &sampletype, &samplesize))
+    return NULL;
+
   /* Allocate more memory for data samples if included */
-  if (msr->datasamples && msr->numsamples > 0)
+  if (numsamples > 0)
   {
-    if (msr->sampletype != seg->sampletype)
+    if (sampletype != seg->sampletype)
     {
       ms_log (2, "MS3Record sample type (%c) does not match segment sample type (%c)\n",
-              msr->sampletype, seg->sampletype);
-      return NULL;
-    }
-
-    if (!(samplesize = ms_samplesize (msr->sampletype)))
-    {
-      ms_log (2, "Unknown sample size for sample type: %c\n", msr->sampletype);
+              sampletype, seg->sampletype);
       return NULL;
     }
 
-    if (seg->numsamples < 0 || msr->numsamples < 0 ||
-        (uint64_t)seg->numsamples + (uint64_t)msr->numsamples > SIZE_MAX / (size_t)samplesize)
+    if (seg->numsamples < 0 ||
+        (uint64_t)seg->numsamples + (uint64_t)numsamples > SIZE_MAX / (size_t)samplesize)
     {
       ms_log (2, "Data buffer size overflow combining %" PRId64 " and %" PRId64 " samples\n",
-              seg->numsamples, msr->numsamples);
+              seg->numsamples, numsamples);
       return NULL;
     }
 
-    newdatasize = ((size_t)seg->numsamples + (size_t)msr->numsamples) * (size_t)samplesize;
+    newdatasize = ((size_t)seg->numsamples + (size_t)numsamples) * (size_t)samplesize;
 
-    if (libmseed_prealloc_block_size)
+    if (lm_prealloc_block_size ())
     {
       size_t current_size = seg->datasize;
       newdatasamples = libmseed_memory_prealloc (seg->datasamples, newdatasize, &current_size);
@@ -1556,7 +2779,7 @@ lm_addmsrtoseg (MS3TraceSeg *seg, const MS3Record *msr, nstime_t endtime, int8_t
     }
     else
     {
-      newdatasamples = libmseed_memory.realloc (seg->datasamples, newdatasize);
+      newdatasamples = lm_memory ()->realloc (seg->datasamples, newdatasize);
 
       if (newdatasamples)
         seg->datasize = newdatasize;
@@ -1574,37 +2797,39 @@ lm_addmsrtoseg (MS3TraceSeg *seg, const MS3Record *msr, nstime_t endtime, int8_t
   /* Add coverage to end of segment */
   if (whence == 1)
   {
-    seg->endtime = endtime;
-    seg->samplecnt += msr->samplecnt;
-
-    if (msr->datasamples && msr->numsamples > 0)
+    if (numsamples > 0)
     {
-      memcpy ((char *)seg->datasamples + (seg->numsamples * samplesize), msr->datasamples,
-              (size_t)(msr->numsamples * samplesize));
+      if (lm_msr_putsamples (msr, decode, (char *)seg->datasamples + (seg->numsamples * samplesize),
+                             numsamples, samplesize))
+        return NULL;
 
-      seg->numsamples += msr->numsamples;
+      seg->numsamples += numsamples;
     }
+
+    seg->endtime = endtime;
+    seg->samplecnt += msr->samplecnt;
   }
   /* Add coverage to beginning of segment */
-  else if (whence == 2)
+  else
   {
-    seg->starttime = msr->starttime;
-    seg->samplecnt += msr->samplecnt;
-
-    if (msr->datasamples && msr->numsamples > 0)
+    if (numsamples > 0)
     {
-      memmove ((char *)seg->datasamples + (msr->numsamples * samplesize), seg->datasamples,
+      memmove ((char *)seg->datasamples + (numsamples * samplesize), seg->datasamples,
                (size_t)(seg->numsamples * samplesize));
 
-      memcpy (seg->datasamples, msr->datasamples, (size_t)(msr->numsamples * samplesize));
+      if (lm_msr_putsamples (msr, decode, seg->datasamples, numsamples, samplesize))
+      {
+        /* Restore existing samples to the front of the buffer */
+        memmove (seg->datasamples, (char *)seg->datasamples + (numsamples * samplesize),
+                 (size_t)(seg->numsamples * samplesize));
+        return NULL;
+      }
 
-      seg->numsamples += msr->numsamples;
+      seg->numsamples += numsamples;
     }
-  }
-  else
-  {
-    ms_log (2, "unrecognized whence value: %d\n", whence);
-    return NULL;
+
+    seg->starttime = msr->starttime;
+    seg->samplecnt += msr->samplecnt;
   }
 
   return seg;
@@ -1656,7 +2881,7 @@ lm_addsegtoseg (MS3TraceSeg *seg1, MS3TraceSeg *seg2)
 
     newdatasize = ((size_t)seg1->numsamples + (size_t)seg2->numsamples) * (size_t)samplesize;
 
-    if (libmseed_prealloc_block_size)
+    if (lm_prealloc_block_size ())
     {
       size_t current_size = seg1->datasize;
       newdatasamples = libmseed_memory_prealloc (seg1->datasamples, newdatasize, &current_size);
@@ -1668,7 +2893,7 @@ lm_addsegtoseg (MS3TraceSeg *seg1, MS3TraceSeg *seg2)
     }
     else
     {
-      newdatasamples = libmseed_memory.realloc (seg1->datasamples, newdatasize);
+      newdatasamples = lm_memory ()->realloc (seg1->datasamples, newdatasize);
 
       if (newdatasamples)
         seg1->datasize = newdatasize;
@@ -1709,7 +2934,7 @@ lm_addsegtoseg (MS3TraceSeg *seg1, MS3TraceSeg *seg2)
       seg1->recordlist->recordcnt += seg2->recordlist->recordcnt;
 
       /* Free record list container */
-      libmseed_memory.free (seg2->recordlist);
+      lm_memory ()->free (seg2->recordlist);
     }
 
     seg2->recordlist = NULL;
@@ -1761,7 +2986,7 @@ lm_add_recordptr (MS3TraceSeg *seg, const MS3Record *msr, nstime_t endtime, int8
     return NULL;
   }
 
-  recordptr = (MS3RecordPtr *)libmseed_memory.malloc (sizeof (MS3RecordPtr));
+  recordptr = (MS3RecordPtr *)lm_memory ()->malloc (sizeof (MS3RecordPtr));
 
   if (recordptr == NULL)
   {
@@ -1776,7 +3001,7 @@ lm_add_recordptr (MS3TraceSeg *seg, const MS3Record *msr, nstime_t endtime, int8
   if (recordptr->msr == NULL)
   {
     ms_log (2, "Cannot duplicate MS3Record\n");
-    libmseed_memory.free (recordptr);
+    lm_memory ()->free (recordptr);
     return NULL;
   }
 
@@ -1786,13 +3011,13 @@ lm_add_recordptr (MS3TraceSeg *seg, const MS3Record *msr, nstime_t endtime, int8
   /* If no record list for the segment is present, allocate and add record pointer */
   if (seg->recordlist == NULL)
   {
-    seg->recordlist = (MS3RecordList *)libmseed_memory.malloc (sizeof (MS3RecordList));
+    seg->recordlist = (MS3RecordList *)lm_memory ()->malloc (sizeof (MS3RecordList));
 
     if (seg->recordlist == NULL)
     {
       ms_log (2, "Cannot allocate memory\n");
       msr3_free (&recordptr->msr);
-      libmseed_memory.free (recordptr);
+      lm_memory ()->free (recordptr);
       return NULL;
     }
 
@@ -1954,9 +3179,9 @@ mstl3_convertsamples (MS3TraceSeg *seg, char type, int8_t truncate)
         idata[idx] = (int32_t)(ddata[idx] + (ddata[idx] >= 0 ? 0.5 : -0.5));
 
       /* Reallocate buffer for reduced size needed, only if not pre-allocating */
-      if (libmseed_prealloc_block_size == 0)
+      if (lm_prealloc_block_size () == 0)
       {
-        void *resized = libmseed_memory.realloc (seg->datasamples,
+        void *resized = lm_memory ()->realloc (seg->datasamples,
                                                  (size_t)(seg->numsamples * sizeof (int32_t)));
         if (resized == NULL)
         {
@@ -1985,10 +3210,10 @@ mstl3_convertsamples (MS3TraceSeg *seg, char type, int8_t truncate)
         fdata[idx] = (float)ddata[idx];
 
       /* Reallocate buffer for reduced size needed, only if not pre-allocating */
-      if (libmseed_prealloc_block_size == 0)
+      if (lm_prealloc_block_size () == 0)
       {
         void *resized =
-            libmseed_memory.realloc (seg->datasamples, (size_t)(seg->numsamples * sizeof (float)));
+            lm_memory ()->realloc (seg->datasamples, (size_t)(seg->numsamples * sizeof (float)));
         if (resized == NULL)
         {
           ms_log (2, "Cannot re-allocate buffer after sample conversion\n");
@@ -2015,7 +3240,7 @@ mstl3_convertsamples (MS3TraceSeg *seg, char type, int8_t truncate)
 
     datasize = (size_t)seg->numsamples * sizeof (double);
 
-    if (!(ddata = (double *)libmseed_memory.malloc (datasize)))
+    if (!(ddata = (double *)lm_memory ()->malloc (datasize)))
     {
       ms_log (2, "Cannot allocate buffer for sample conversion to doubles\n");
       return -1;
@@ -2026,14 +3251,14 @@ mstl3_convertsamples (MS3TraceSeg *seg, char type, int8_t truncate)
       for (idx = 0; idx < seg->numsamples; idx++)
         ddata[idx] = (double)idata[idx];
 
-      libmseed_memory.free (idata);
+      lm_memory ()->free (idata);
     }
     else if (seg->sampletype == 'f') /* Convert floats to doubles */
     {
       for (idx = 0; idx < seg->numsamples; idx++)
         ddata[idx] = (double)fdata[idx];
 
-      libmseed_memory.free (fdata);
+      lm_memory ()->free (fdata);
     }
 
     seg->datasamples = ddata;
@@ -2085,7 +3310,7 @@ mstl3_resize_buffers (MS3TraceList *mstl)
 
         if (seg->datasize > datasize)
         {
-          void *resized = libmseed_memory.realloc (seg->datasamples, datasize);
+          void *resized = lm_memory ()->realloc (seg->datasamples, datasize);
 
           if (resized == NULL)
           {
@@ -2229,7 +3454,7 @@ mstl3_unpack_recordlist (MS3TraceID *id, MS3TraceSeg *seg, void *output, uint64_
   /* Otherwise allocate new buffer */
   else
   {
-    if ((output = libmseed_memory.malloc ((size_t)decodedsize)) == NULL)
+    if ((output = lm_memory ()->malloc ((size_t)decodedsize)) == NULL)
     {
       ms_log (2, "%s: Cannot allocate memory for segment data samples\n", id->sid);
       return -1;
@@ -2295,7 +3520,7 @@ mstl3_unpack_recordlist (MS3TraceID *id, MS3TraceSeg *seg, void *output, uint64_
         /* Add new entry to list and open file if needed */
         if (filelistptr == NULL)
         {
-          if ((filelistptr = libmseed_memory.malloc (sizeof (struct filelist_s))) == NULL)
+          if ((filelistptr = lm_memory ()->malloc (sizeof (struct filelist_s))) == NULL)
           {
             ms_log (2, "%s: Cannot allocate memory for file list entry for %s\n", id->sid,
                     recordptr->filename);
@@ -2309,7 +3534,7 @@ mstl3_unpack_recordlist (MS3TraceID *id, MS3TraceSeg *seg, void *output, uint64_
             ms_log (2, "%s: Cannot open file (%s): %s\n", id->sid, recordptr->filename,
                     strerror (errno));
 
-            libmseed_memory.free (filelistptr);
+            lm_memory ()->free (filelistptr);
             totalunpackedsamples = -1;
             break;
           }
@@ -2326,7 +3551,7 @@ mstl3_unpack_recordlist (MS3TraceID *id, MS3TraceSeg *seg, void *output, uint64_
       /* Allocate memory if needed, over-allocating (x2) to minimize reallocation */
       if (recordptr->msr->reclen > filebuffersize)
       {
-        void *resized = libmseed_memory.realloc (filebuffer, recordptr->msr->reclen * 2);
+        void *resized = lm_memory ()->realloc (filebuffer, recordptr->msr->reclen * 2);
 
         if (resized == NULL)
         {
@@ -2374,7 +3599,7 @@ mstl3_unpack_recordlist (MS3TraceID *id, MS3TraceSeg *seg, void *output, uint64_
     unpackedsamples = ms_decode_data (
         input, recordptr->msr->reclen - recordptr->dataoffset, (uint8_t)recordptr->msr->encoding,
         recordptr->msr->samplecnt, (unsigned char *)output + outputoffset,
-        decodedsize - outputoffset, &sampletype, recordptr->msr->swapflag, id->sid, verbose);
+        decodedsize - outputoffset, &sampletype, (recordptr->msr->swapflag & MSSWAP_PAYLOAD), id->sid, verbose);
 
     if (unpackedsamples < 0)
     {
@@ -2390,14 +3615,14 @@ mstl3_unpack_recordlist (MS3TraceID *id, MS3TraceSeg *seg, void *output, uint64_
 
   /* Free file read buffer if used */
   if (filebuffer)
-    libmseed_memory.free (filebuffer);
+    lm_memory ()->free (filebuffer);
 
   /* Close and free file list if used */
   while (filelist)
   {
     filelistptr = filelist->next;
     fclose (filelist->fileptr);
-    libmseed_memory.free (filelist);
+    lm_memory ()->free (filelist);
     filelist = filelistptr;
   }
 
@@ -2410,7 +3635,7 @@ mstl3_unpack_recordlist (MS3TraceID *id, MS3TraceSeg *seg, void *output, uint64_
     /* Free allocated memory on error */
     if (totalunpackedsamples < 0)
     {
-      libmseed_memory.free (output);
+      lm_memory ()->free (output);
       seg->datasamples = NULL;
       seg->datasize = 0;
     }
@@ -2426,99 +3651,687 @@ mstl3_unpack_recordlist (MS3TraceID *id, MS3TraceSeg *seg, void *output, uint64_
   return totalunpackedsamples;
 } /* End of mstl3_unpack_recordlist() */
 
+/***************************************************************************
+ * Determine the packing flags for a segment.
+ *
+ * If flush_idle_nanoseconds is set and the segment has a prvtptr with an
+ * update time set during parsing with the ::MSF_PPUPDATE flag, check if
+ * the segement has been updated within the specified interval.  If it
+ * has not, force the flushing of the segment by setting the
+ * ::MSF_FLUSHDATA flag.
+ ***************************************************************************/
+static uint32_t
+lm_segment_packflags (const MS3TraceSeg *seg, uint32_t flags, nstime_t flush_idle_nanoseconds)
+{
+  if (flush_idle_nanoseconds > 0 && seg->prvtptr)
+  {
+    nstime_t *update_time = (nstime_t *)seg->prvtptr;
+    nstime_t update_latency = lmp_systemtime () - *update_time;
+
+    if (update_latency > flush_idle_nanoseconds)
+    {
+      flags |= MSF_FLUSHDATA;
+    }
+  }
+
+  return flags;
+} /* End of lm_segment_packflags() */
+
 /***************************************************************************
  * Implementation of MS3TraceList packing for the callback interfaces
  *
+ * If @p nthreads is not 1 segments are packed concurrently, see
+ * mstl3_pack_parallel().
+ *
  * @see mstl3_pack()
  * @see mstl3_pack_ppupdate_flushidle()
+ * @see mstl3_pack_parallel()
  ***************************************************************************/
 int64_t
 _mstl3_pack_callback (MS3TraceList *mstl, void (*record_handler) (char *, int, void *),
                       void *handlerdata, int reclen, int8_t encoding, int64_t *packedsamples,
-                      uint32_t flags, int8_t verbose, char *extra, uint32_t flush_idle_seconds)
+                      uint32_t flags, int8_t verbose, char *extra, uint32_t flush_idle_seconds,
+                      int nthreads)
+{
+  int64_t totalpackedrecords = 0;
+  int64_t totalpackedsamples = 0;
+  int64_t segpackedrecords = 0;
+  int64_t segpackedsamples = 0;
+  uint32_t segment_flags = 0;
+  nstime_t flush_idle_nanoseconds = (nstime_t)flush_idle_seconds * NSTMODULUS;
+
+  if (!mstl)
+  {
+    ms_log (2, "%s(): Required input not defined: 'mstl'\n", __func__);
+    return -1;
+  }
+
+  if (!record_handler)
+  {
+    ms_log (2, "callback record_handler() function pointer not set!\n");
+    return -1;
+  }
+
+  if (packedsamples)
+    *packedsamples = 0;
+
+  /* Pack concurrently if requested and more than one thread is available */
+  if (lm_resolve_threads (nthreads) > 1)
+  {
+    return lm_pack_parallel (mstl, record_handler, handlerdata, reclen, encoding, packedsamples,
+                             flags, verbose, extra, flush_idle_nanoseconds,
+                             lm_resolve_threads (nthreads));
+  }
+
+  /* Loop through trace list */
+  MS3TraceID *id = mstl->traces.next[0];
+  while (id && totalpackedrecords >= 0)
+  {
+    MS3TraceID *nextid = id->next[0]; /* Save next pointer before potential removal */
+
+    /* Loop through segment list */
+    MS3TraceSeg *seg = id->first;
+    while (seg)
+    {
+      MS3TraceSeg *nextseg = seg->next; /* Save next pointer before potential removal */
+      segment_flags = lm_segment_packflags (seg, flags, flush_idle_nanoseconds);
+
+      segpackedrecords =
+          mstl3_pack_segment (mstl, id, seg, record_handler, handlerdata, reclen, encoding,
+                              &segpackedsamples, segment_flags, verbose, extra);
+
+      if (segpackedrecords < 0)
+      {
+        ms_log (2, "%s: Error packing data from segment\n", id->sid);
+        totalpackedrecords = -1;
+        break;
+      }
+
+      totalpackedrecords += segpackedrecords;
+      totalpackedsamples += segpackedsamples;
+
+      /* Remove segment if no samples remain and the MSF_MAINTAINMSTL flag is not set */
+      if ((flags & MSF_MAINTAINMSTL) == 0 && seg->numsamples == 0)
+      {
+        lm_remove_segment (mstl, id, seg, 1);
+      }
+
+      seg = nextseg;
+    }
+
+    id = nextid;
+  }
+
+  if (packedsamples)
+    *packedsamples = totalpackedsamples;
+
+  return totalpackedrecords;
+} /* End of _mstl3_pack_callback() */
+
+/* Samples per block when splitting a long segment for parallel packing */
+#define LM_PACK_BLOCKSAMPLES 262144
+
+/* A segment block packing task for lm_pack_parallel() */
+typedef struct LMPackTask
+{
+  MS3TraceID *id;
+  MS3TraceSeg *seg;
+  MS3Record msr;          /* Packing template, borrows segment samples */
+  uint32_t flags;         /* Packing flags for this segment */
+  int64_t blockstart;     /* Sample offset where block packing starts */
+  int64_t blockend;       /* Sample offset where block packing stops */
+  int8_t lastblock;       /* Non-zero for the last block of a segment */
+  int8_t skip;            /* Non-zero if speculative packing is abandoned */
+  char *records;          /* Buffer of packed records, concatenated */
+  size_t recordsused;     /* Bytes used in records buffer */
+  size_t recordsalloc;    /* Bytes allocated for records buffer */
+  int *reclens;           /* Length of each record in buffer */
+  uint32_t *recsamples;   /* Sample count of each record in buffer */
+  int64_t reccount;       /* Count of records in buffer */
+  int64_t recalloc;       /* Count of record entries allocated */
+  int8_t error;           /* Non-zero on packing or allocation error */
+  int8_t done;            /* Non-zero when packing is complete */
+} LMPackTask;
+
+/* Shared state for lm_pack_parallel() workers */
+typedef struct LMPackQueue
+{
+  LMPackTask *tasks;
+  int64_t taskcount;
+  int64_t taskalloc;
+  int64_t nexttask;   /* Next task to be claimed by a worker */
+  int64_t emitted;    /* Count of tasks emitted by the calling thread */
+  int64_t window;     /* Maximum tasks packed ahead of emission */
+  int8_t abort;       /* Stop claiming tasks */
+  lmp_mutex_t lock;
+  lmp_cond_t cond;
+} LMPackQueue;
+
+/***************************************************************************
+ * Append a packed record to a task buffer.
+ *
+ * Returns 0 on success and -1 on allocation error.
+ ***************************************************************************/
+static int
+lm_pack_collect (LMPackTask *task, const char *record, int reclen, uint32_t samples)
+{
+  size_t newalloc;
+  void *ptr;
+
+  if (task->recordsused + reclen > task->recordsalloc)
+  {
+    newalloc = (task->recordsalloc) ? task->recordsalloc * 2 : (size_t)reclen * 8;
+    while (newalloc < task->recordsused + reclen)
+      newalloc *= 2;
+
+    if ((ptr = lm_memory ()->realloc (task->records, newalloc)) == NULL)
+      return -1;
+
+    task->records = (char *)ptr;
+    task->recordsalloc = newalloc;
+  }
+
+  if (task->reccount >= task->recalloc)
+  {
+    newalloc = (task->recalloc) ? task->recalloc * 2 : 8;
+
+    if ((ptr = lm_memory ()->realloc (task->reclens, newalloc * sizeof (int))) == NULL)
+      return -1;
+    task->reclens = (int *)ptr;
+
+    if ((ptr = lm_memory ()->realloc (task->recsamples, newalloc * sizeof (uint32_t))) == NULL)
+      return -1;
+    task->recsamples = (uint32_t *)ptr;
+
+    task->recalloc = newalloc;
+  }
+
+  memcpy (task->records + task->recordsused, record, reclen);
+  task->recordsused += reclen;
+  task->reclens[task->reccount] = reclen;
+  task->recsamples[task->reccount] = samples;
+  task->reccount++;
+
+  return 0;
+} /* End of lm_pack_collect() */
+
+/***************************************************************************
+ * Pack the records of a block into the task buffer, starting at the
+ * block start and continuing until a record reaches the block end or
+ * the packer is finished.
+ *
+ * For blocks after the first of a segment the start is speculative, the
+ * records are only used if the preceding block ends on one of them.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+lm_pack_block (LMPackTask *task)
+{
+  MS3RecordPacker *packer;
+  char *record = NULL;
+  int32_t reclen = 0;
+  int64_t start;
+  int rv = 1;
+
+  if ((packer = msr3_pack_init (&task->msr, task->flags, 0)) == NULL)
+    return -1;
+
+  if (lm_pack_seek (packer, task->blockstart))
+    rv = -1;
+
+  while (rv == 1 && packer->packed_samples < task->blockend)
+  {
+    start = packer->packed_samples;
+
+    if ((rv = msr3_pack_next (packer, &record, &reclen)) != 1)
+      break;
+
+    if (lm_pack_collect (task, record, reclen, (uint32_t)(packer->packed_samples - start)))
+    {
+      ms_log (2, "%s: Cannot allocate memory for packed records\n", task->msr.sid);
+      rv = -1;
+    }
+  }
+
+  msr3_pack_free (&packer, NULL);
+
+  return (rv < 0) ? -1 : 0;
+} /* End of lm_pack_block() */
+
+/***************************************************************************
+ * Worker thread for parallel packing, claims tasks in order within the
+ * emission window and packs each into its task buffer.
+ ***************************************************************************/
+static void *
+lm_pack_worker (void *arg)
+{
+  LMPackQueue *queue = (LMPackQueue *)arg;
+  LMPackTask *task;
+  int rv;
+
+  for (;;)
+  {
+    lmp_mutex_lock (&queue->lock);
+    while (!queue->abort && queue->nexttask < queue->taskcount &&
+           queue->nexttask >= queue->emitted + queue->window)
+      lmp_cond_wait (&queue->cond, &queue->lock);
+
+    if (queue->abort || queue->nexttask >= queue->taskcount)
+    {
+      lmp_mutex_unlock (&queue->lock);
+      break;
+    }
+
+    task = &queue->tasks[queue->nexttask++];
+    rv = task->skip;
+    lmp_mutex_unlock (&queue->lock);
+
+    if (rv == 0)
+      rv = lm_pack_block (task);
+    else
+      rv = 0;
+
+    lmp_mutex_lock (&queue->lock);
+    if (rv)
+      task->error = 1;
+    task->done = 1;
+    lmp_cond_broadcast (&queue->cond);
+    lmp_mutex_unlock (&queue->lock);
+  }
+
+  return NULL;
+} /* End of lm_pack_worker() */
+
+/***************************************************************************
+ * Add the packing tasks for a segment to the queue.
+ *
+ * Long segments are split into blocks of samples that are packed
+ * independently.  For fixed-width encodings the record capacity is
+ * deterministic and blocks are aligned to whole records, for Steim
+ * encodings the block starts are speculative.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+lm_pack_addtasks (LMPackQueue *queue, MS3TraceID *id, MS3TraceSeg *seg, int reclen,
+                  int8_t encoding, uint32_t flags, char *extra)
+{
+  MS3Record msr = MS3Record_INITIALIZER;
+  MS3RecordPacker *packer;
+  LMPackTask *task;
+  int64_t blocksamples;
+  int64_t blockcount;
+  int64_t blockstart;
+  void *ptr;
+
+  if (lm_pack_template (&msr, id, seg, reclen, encoding, extra))
+    return -1;
+
+  /* Determine block size from the record capacity */
+  blocksamples = seg->numsamples;
+  if (seg->numsamples >= 2 * LM_PACK_BLOCKSAMPLES)
+  {
+    if ((packer = msr3_pack_init (&msr, flags, 0)) == NULL)
+      return -1;
+
+    switch (packer->encoding)
+    {
+    case DE_TEXT:
+    case DE_INT16:
+    case DE_INT32:
+    case DE_FLOAT32:
+    case DE_FLOAT64:
+      blocksamples = (int64_t)packer->maxsamples;
+      if (blocksamples < LM_PACK_BLOCKSAMPLES)
+        blocksamples *= LM_PACK_BLOCKSAMPLES / blocksamples;
+      break;
+    default:
+      blocksamples = LM_PACK_BLOCKSAMPLES;
+    }
+
+    msr3_pack_free (&packer, NULL);
+  }
+
+  blockcount = (seg->numsamples + blocksamples - 1) / blocksamples;
+
+  if (queue->taskcount + blockcount > queue->taskalloc)
+  {
+    int64_t newalloc = (queue->taskalloc) ? queue->taskalloc * 2 : 16;
+
+    while (newalloc < queue->taskcount + blockcount)
+      newalloc *= 2;
+
+    if ((ptr = lm_memory ()->realloc (queue->tasks, newalloc * sizeof (LMPackTask))) == NULL)
+    {
+      ms_log (2, "Cannot allocate memory for packing tasks\n");
+      return -1;
+    }
+
+    queue->tasks = (LMPackTask *)ptr;
+    queue->taskalloc = newalloc;
+  }
+
+  for (blockstart = 0; blockstart < seg->numsamples; blockstart += blocksamples)
+  {
+    task = &queue->tasks[queue->taskcount++];
+    memset (task, 0, sizeof (LMPackTask));
+
+    task->id = id;
+    task->seg = seg;
+    task->msr = msr;
+    task->flags = flags;
+    task->blockstart = blockstart;
+    task->blockend = blockstart + blocksamples;
+
+    if (task->blockend >= seg->numsamples)
+    {
+      task->blockend = seg->numsamples;
+      task->lastblock = 1;
+    }
+  }
+
+  return 0;
+} /* End of lm_pack_addtasks() */
+
+/***************************************************************************
+ * Pack all trace list segments concurrently with ordered emission.
+ *
+ * Packing templates and blocks are set up by the calling thread, worker
+ * threads pack blocks into private record buffers and the calling thread
+ * passes the records to the record_handler() in trace list order,
+ * trimming or removing segments exactly as the serial path does.
+ *
+ * Records are a pure function of their starting sample, so records of a
+ * speculative block are kept from the first one that starts where the
+ * preceding records end.  Records before that point are re-encoded by
+ * the calling thread.  The output is identical to serial packing.
+ *
+ * Falls back to serial packing if there is only a single task or
+ * threads cannot be created.
+ *
+ * Returns the number of records created on success and -1 on error.
+ ***************************************************************************/
+static int64_t
+lm_pack_parallel (MS3TraceList *mstl, void (*record_handler) (char *, int, void *),
+                  void *handlerdata, int reclen, int8_t encoding, int64_t *packedsamples,
+                  uint32_t flags, int8_t verbose, char *extra, nstime_t flush_idle_nanoseconds,
+                  int nthreads)
 {
+  LMPackQueue queue;
+  LMPackTask *task;
+  lmp_thread_t *threads = NULL;
+  MS3RecordPacker *repacker = NULL;
+  MS3TraceID *id;
+  MS3TraceSeg *seg;
+  char *record = NULL;
+  int32_t recordlength = 0;
   int64_t totalpackedrecords = 0;
   int64_t totalpackedsamples = 0;
   int64_t segpackedrecords = 0;
-  int64_t segpackedsamples = 0;
-  uint32_t segment_flags = 0;
-  nstime_t flush_idle_nanoseconds = (nstime_t)flush_idle_seconds * NSTMODULUS;
+  int64_t segreencoded = 0;
+  int64_t segpos = 0;
+  int64_t blockmatched;
+  int64_t recstart;
+  int64_t idx;
+  int64_t ridx;
+  size_t offset;
+  int8_t segfinished = 0;
+  int started = 0;
+  int tidx;
+  int rv;
 
-  if (!mstl)
+  memset (&queue, 0, sizeof (queue));
+
+  /* Set up tasks for segments with data to pack, removing empty segments
+   * as the serial path does unless the MSF_MAINTAINMSTL flag is set */
+  id = mstl->traces.next[0];
+  while (id)
   {
-    ms_log (2, "%s(): Required input not defined: 'mstl'\n", __func__);
-    return -1;
+    MS3TraceID *nextid = id->next[0];
+
+    seg = id->first;
+    while (seg)
+    {
+      MS3TraceSeg *nextseg = seg->next;
+
+      if (seg->numsamples > 0)
+      {
+        if (lm_pack_addtasks (&queue, id, seg, reclen, encoding,
+                              lm_segment_packflags (seg, flags, flush_idle_nanoseconds), extra))
+        {
+          ms_log (2, "%s: Error packing data from segment\n", id->sid);
+          if (queue.tasks)
+            lm_memory ()->free (queue.tasks);
+          return -1;
+        }
+      }
+      else if ((flags & MSF_MAINTAINMSTL) == 0)
+      {
+        lm_remove_segment (mstl, id, seg, 1);
+      }
+
+      seg = nextseg;
+    }
+
+    id = nextid;
   }
 
-  if (!record_handler)
+  if (queue.taskcount > 1 &&
+      (threads = (lmp_thread_t *)lm_memory ()->malloc (nthreads * sizeof (lmp_thread_t))))
   {
-    ms_log (2, "callback record_handler() function pointer not set!\n");
-    return -1;
+    queue.window = (int64_t)nthreads * 4;
+
+    if (lmp_mutex_init (&queue.lock) == 0)
+    {
+      if (lmp_cond_init (&queue.cond) == 0)
+      {
+        for (tidx = 0; tidx < nthreads && tidx < queue.taskcount; tidx++)
+        {
+          if (lmp_thread_create (&threads[tidx], lm_pack_worker, &queue))
+            break;
+          started++;
+        }
+
+        if (started == 0)
+          lmp_cond_destroy (&queue.cond);
+      }
+
+      if (started == 0)
+        lmp_mutex_destroy (&queue.lock);
+    }
   }
 
-  if (packedsamples)
-    *packedsamples = 0;
+  /* Fall back to serial packing */
+  if (started == 0)
+  {
+    if (queue.tasks)
+      lm_memory ()->free (queue.tasks);
+    if (threads)
+      lm_memory ()->free (threads);
+
+    return _mstl3_pack_callback (mstl, record_handler, handlerdata, reclen, encoding,
+                                 packedsamples, flags, verbose, extra,
+                                 (uint32_t)(flush_idle_nanoseconds / NSTMODULUS), 1);
+  }
 
-  /* Loop through trace list */
-  MS3TraceID *id = mstl->traces.next[0];
-  while (id && totalpackedrecords >= 0)
+  /* Emit records for each task in trace list order */
+  for (idx = 0; idx < queue.taskcount; idx++)
   {
-    MS3TraceID *nextid = id->next[0]; /* Save next pointer before potential removal */
+    task = &queue.tasks[idx];
 
-    /* Loop through segment list */
-    MS3TraceSeg *seg = id->first;
-    while (seg)
+    lmp_mutex_lock (&queue.lock);
+    while (!task->done)
+      lmp_cond_wait (&queue.cond, &queue.lock);
+    lmp_mutex_unlock (&queue.lock);
+
+    if (task->error)
     {
-      MS3TraceSeg *nextseg = seg->next; /* Save next pointer before potential removal */
-      segment_flags = flags;
+      ms_log (2, "%s: Error packing data from segment\n", task->id->sid);
+      totalpackedrecords = -1;
+      break;
+    }
 
-      /* If flush_idle_seconds is set and the segment has a prvtptr with an
-       * update time set during parsing with the ::MSF_PPUPDATE flag, check if
-       * the segement has been updated within the specified number of seconds.
-       * If it has not, force the flushing of the segment by setting the
-       * ::MSF_FLUSHDATA flag. */
-      if (flush_idle_nanoseconds > 0 && seg->prvtptr)
+    /* Reset stitching state at the start of each segment */
+    if (task->blockstart == 0)
+    {
+      segpos = 0;
+      segpackedrecords = 0;
+      segreencoded = 0;
+      segfinished = 0;
+    }
+
+    /* Emit records of the block that continue the sequence, re-encoding
+     * from the current position where the block records do not */
+    ridx = 0;
+    offset = 0;
+    blockmatched = 0;
+    recstart = task->blockstart;
+    while (!segfinished && segpos < task->blockend)
+    {
+      while (ridx < task->reccount && recstart < segpos)
       {
-        nstime_t *update_time = (nstime_t *)seg->prvtptr;
-        nstime_t update_latency = lmp_systemtime () - *update_time;
+        recstart += task->recsamples[ridx];
+        offset += task->reclens[ridx];
+        ridx++;
+      }
 
-        if (update_latency > flush_idle_nanoseconds)
-        {
-          segment_flags |= MSF_FLUSHDATA;
-        }
+      if (ridx < task->reccount && recstart == segpos)
+      {
+        record_handler (task->records + offset, task->reclens[ridx], handlerdata);
+        segpos += task->recsamples[ridx];
+        segpackedrecords++;
+        blockmatched++;
+        continue;
       }
 
-      segpackedrecords =
-          mstl3_pack_segment (mstl, id, seg, record_handler, handlerdata, reclen, encoding,
-                              &segpackedsamples, segment_flags, verbose, extra);
+      /* Block packing finished at the current position */
+      if (!task->skip && ridx >= task->reccount && recstart == segpos)
+      {
+        segfinished = 1;
+        break;
+      }
 
-      if (segpackedrecords < 0)
+      if (!repacker && (repacker = msr3_pack_init (&task->msr, task->flags, 0)) == NULL)
       {
-        ms_log (2, "%s: Error packing data from segment\n", id->sid);
         totalpackedrecords = -1;
         break;
       }
 
-      totalpackedrecords += segpackedrecords;
-      totalpackedsamples += segpackedsamples;
+      if (lm_pack_seek (repacker, segpos) ||
+          (rv = msr3_pack_next (repacker, &record, &recordlength)) < 0)
+      {
+        totalpackedrecords = -1;
+        break;
+      }
 
-      /* Remove segment if no samples remain and the MSF_MAINTAINMSTL flag is not set */
-      if ((flags & MSF_MAINTAINMSTL) == 0 && seg->numsamples == 0)
+      if (rv == 0)
       {
-        lm_remove_segment (mstl, id, seg, 1);
+        segfinished = 1;
+        break;
       }
 
-      seg = nextseg;
+      record_handler (record, recordlength, handlerdata);
+      segpos = repacker->packed_samples;
+      segpackedrecords++;
+      segreencoded++;
     }
 
-    id = nextid;
+    if (totalpackedrecords < 0)
+    {
+      ms_log (2, "%s: Error packing data from segment\n", task->id->sid);
+      break;
+    }
+
+    /* Release record buffers and open the emission window */
+    lm_memory ()->free (task->records);
+    lm_memory ()->free (task->reclens);
+    lm_memory ()->free (task->recsamples);
+    task->records = NULL;
+    task->reclens = NULL;
+    task->recsamples = NULL;
+
+    lmp_mutex_lock (&queue.lock);
+    queue.emitted = idx + 1;
+
+    /* If speculation never re-synchronized within this block, abandon it for
+     * the unclaimed blocks of the segment, they are re-encoded here instead */
+    if (task->blockstart > 0 && blockmatched == 0)
+    {
+      int64_t skipidx;
+
+      for (skipidx = queue.nexttask;
+           skipidx < queue.taskcount && queue.tasks[skipidx].seg == task->seg; skipidx++)
+        queue.tasks[skipidx].skip = 1;
+    }
+
+    lmp_cond_broadcast (&queue.cond);
+    lmp_mutex_unlock (&queue.lock);
+
+    if (!task->lastblock)
+      continue;
+
+    if (repacker)
+      msr3_pack_free (&repacker, NULL);
+
+    if (verbose > 1)
+    {
+      ms_log (0, "Packed %" PRId64 " records for %s segment\n", segpackedrecords, task->msr.sid);
+
+      if (segreencoded > 0)
+        ms_log (0, "Re-encoded %" PRId64 " speculative records for %s segment\n", segreencoded,
+                task->msr.sid);
+    }
+
+    totalpackedrecords += segpackedrecords;
+    totalpackedsamples += segpos;
+
+    /* If MSF_MAINTAINMSTL not set, modify or remove segment accordingly */
+    if ((flags & MSF_MAINTAINMSTL) == 0 && segpos > 0)
+    {
+      if (lm_trim_packed (task->id, task->seg, segpos))
+      {
+        totalpackedrecords = -1;
+        break;
+      }
+
+      if (task->seg->numsamples == 0)
+        lm_remove_segment (mstl, task->id, task->seg, 1);
+    }
+  }
+
+  /* Stop workers and release remaining resources */
+  lmp_mutex_lock (&queue.lock);
+  queue.abort = 1;
+  lmp_cond_broadcast (&queue.cond);
+  lmp_mutex_unlock (&queue.lock);
+
+  for (tidx = 0; tidx < started; tidx++)
+    lmp_thread_join (threads[tidx]);
+
+  if (repacker)
+    msr3_pack_free (&repacker, NULL);
+
+  for (idx = 0; idx < queue.taskcount; idx++)
+  {
+    if (queue.tasks[idx].records)
+      lm_memory ()->free (queue.tasks[idx].records);
+    if (queue.tasks[idx].reclens)
+      lm_memory ()->free (queue.tasks[idx].reclens);
+    if (queue.tasks[idx].recsamples)
+      lm_memory ()->free (queue.tasks[idx].recsamples);
   }
 
+  lmp_cond_destroy (&queue.cond);
+  lmp_mutex_destroy (&queue.lock);
+  lm_memory ()->free (queue.tasks);
+  lm_memory ()->free (threads);
+
   if (packedsamples)
     *packedsamples = totalpackedsamples;
 
   return totalpackedrecords;
-} /* End of _mstl3_pack_callback() */
+} /* End of lm_pack_parallel() */
 
 /** ************************************************************************
  * @brief Pack ::MS3TraceList data into miniSEED records
@@ -2590,7 +4403,7 @@ mstl3_pack (MS3TraceList *mstl, void (*record_handler) (char *, int, void *), vo
             char *extra)
 {
   return _mstl3_pack_callback (mstl, record_handler, handlerdata, reclen, encoding, packedsamples,
-                               flags, verbose, extra, 0);
+                               flags, verbose, extra, 0, 1);
 }
 
 /***************************************************************************
@@ -2620,6 +4433,120 @@ lm_packed_starttime (const MS3TraceSeg *seg, int64_t packedsamples)
   return ms_sampletime (seg->starttime, packedsamples, seg->samprate);
 } /* End of lm_packed_starttime() */
 
+/***************************************************************************
+ * Populate an MS3Record packing template from a trace segment.
+ *
+ * The template borrows the segment data samples and the @p extra
+ * buffer, neither is owned by the template.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+lm_pack_template (MS3Record *msr, const MS3TraceID *id, const MS3TraceSeg *seg, int reclen,
+                  int8_t encoding, char *extra)
+{
+  size_t extralength;
+
+  msr->reclen = reclen;
+  memcpy (msr->sid, id->sid, sizeof (msr->sid));
+  msr->pubversion = id->pubversion;
+
+  if (extra)
+  {
+    msr->extra = extra;
+    extralength = strlen (extra);
+
+    if (extralength > UINT16_MAX)
+    {
+      ms_log (2, "Extra headers are too long: %" PRIsize_t "\n", extralength);
+      return -1;
+    }
+
+    msr->extralength = (uint16_t)extralength;
+  }
+
+  msr->starttime = seg->starttime;
+  msr->samprate = seg->samprate;
+  msr->samplecnt = seg->samplecnt;
+  msr->datasamples = seg->datasamples;
+  msr->numsamples = seg->numsamples;
+  msr->sampletype = seg->sampletype;
+
+  /* Set encoding for data types with only one encoding, otherwise requested */
+  switch (seg->sampletype)
+  {
+  case 't':
+    msr->encoding = DE_TEXT;
+    break;
+  case 'f':
+    msr->encoding = DE_FLOAT32;
+    break;
+  case 'd':
+    msr->encoding = DE_FLOAT64;
+    break;
+  default:
+    msr->encoding = encoding;
+  }
+
+  return 0;
+} /* End of lm_pack_template() */
+
+/***************************************************************************
+ * Remove packed samples from the front of a trace segment, adjusting
+ * the start time, sample counts and buffer and the trace ID extent.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+lm_trim_packed (MS3TraceID *id, MS3TraceSeg *seg, int64_t packedsamples)
+{
+  int samplesize;
+
+  /* Determine sample size before modifying the segment to avoid a partial update */
+  if (!(samplesize = ms_samplesize (seg->sampletype)))
+  {
+    ms_log (2, "Unknown sample size for sample type: %c\n", seg->sampletype);
+    return -1;
+  }
+
+  /* Calculate new start time, shortcut when all samples have been packed */
+  if (packedsamples == seg->numsamples)
+    seg->starttime = seg->endtime;
+  else
+    seg->starttime = lm_packed_starttime (seg, packedsamples);
+
+  seg->samplecnt -= packedsamples;
+  seg->numsamples -= packedsamples;
+
+  /* Resize data buffer if samples remain */
+  if (seg->numsamples > 0)
+  {
+    size_t bufsize = seg->numsamples * samplesize;
+
+    memmove (seg->datasamples, (uint8_t *)seg->datasamples + (packedsamples * samplesize),
+             bufsize);
+
+    /* Reallocate buffer for reduced size needed, only if not pre-allocating */
+    if (lm_prealloc_block_size () == 0)
+    {
+      void *resized = lm_memory ()->realloc (seg->datasamples, bufsize);
+
+      if (resized == NULL)
+      {
+        ms_log (2, "Cannot (re)allocate datasamples buffer\n");
+        return -1;
+      }
+
+      seg->datasamples = resized;
+      seg->datasize = (uint64_t)bufsize;
+    }
+  }
+
+  lm_update_id_extent (id);
+
+  return 0;
+} /* End of lm_trim_packed() */
+
 /** ************************************************************************
  * @copydoc mstl3_pack()
  *
@@ -2637,7 +4564,50 @@ mstl3_pack_ppupdate_flushidle (MS3TraceList *mstl, void (*record_handler) (char
                                uint32_t flush_idle_seconds)
 {
   return _mstl3_pack_callback (mstl, record_handler, handlerdata, reclen, encoding, packedsamples,
-                               flags, verbose, extra, flush_idle_seconds);
+                               flags, verbose, extra, flush_idle_seconds, 1);
+}
+
+/** ************************************************************************
+ * @brief Pack ::MS3TraceList data into miniSEED records using multiple threads
+ *
+ * This function is identical to mstl3_pack() except that trace
+ * segments are packed concurrently by up to @p nthreads worker
+ * threads.  Records are passed to @p record_handler() from the calling
+ * thread in the same order, and with the same content, as produced by
+ * mstl3_pack(), and the trace list is updated in the same way.  The
+ * @p record_handler() is never called concurrently.
+ *
+ * Segments are packed independently and long segments are split into
+ * blocks of samples packed in parallel.  For the fixed-width encodings
+ * (text, integer and float) the record capacity is known and blocks
+ * align exactly with record boundaries.  For Steim encodings blocks
+ * are packed speculatively from their first sample, records are kept
+ * from the point where they line up with the preceding records and
+ * the rest are re-encoded by the calling thread.  Packed records are
+ * buffered in memory until they are emitted, the number of blocks
+ * packed ahead of emission is bounded.
+ *
+ * Diagnostic messages from worker threads are logged with the default
+ * logging parameters of those threads, not those of the caller.
+ *
+ * @param[in] nthreads Number of worker threads, a value less than 1
+ *                     selects the number of online processors.  If the
+ *                     library is built with @c LIBMSEED_NO_THREADING or
+ *                     threads cannot be created, packing is serial.
+ *
+ * @see mstl3_pack() for descriptions of the remaining parameters.
+ *
+ * @returns the number of records created on success and -1 on error.
+ *
+ * @ref MessageOnError - this function logs a message on error
+ ***************************************************************************/
+int64_t
+mstl3_pack_parallel (MS3TraceList *mstl, void (*record_handler) (char *, int, void *),
+                     void *handlerdata, int reclen, int8_t encoding, int64_t *packedsamples,
+                     uint32_t flags, int8_t verbose, char *extra, int nthreads)
+{
+  return _mstl3_pack_callback (mstl, record_handler, handlerdata, reclen, encoding, packedsamples,
+                               flags, verbose, extra, 0, nthreads);
 }
 
 /** ************************************************************************
@@ -2702,7 +4672,7 @@ mstl3_pack_init (MS3TraceList *mstl, int reclen, int8_t encoding, uint32_t flags
   }
 
   /* Allocate packing state context */
-  packer = (MS3TraceListPacker *)libmseed_memory.malloc (sizeof (MS3TraceListPacker));
+  packer = (MS3TraceListPacker *)lm_memory ()->malloc (sizeof (MS3TraceListPacker));
   if (!packer)
   {
     ms_log (2, "Cannot allocate memory for trace list packing state context\n");
@@ -2903,9 +4873,9 @@ mstl3_pack_next (MS3TraceListPacker *packer, uint32_t flags, char **record, int3
                    bufsize);
 
           /* Reallocate buffer for reduced size if not pre-allocating */
-          if (libmseed_prealloc_block_size == 0)
+          if (lm_prealloc_block_size () == 0)
           {
-            void *resized = libmseed_memory.realloc (packer->current_seg->datasamples, bufsize);
+            void *resized = lm_memory ()->realloc (packer->current_seg->datasamples, bufsize);
 
             if (resized == NULL)
             {
@@ -3166,7 +5136,7 @@ mstl3_pack_free (MS3TraceListPacker **packer, int64_t *packedsamples)
   if (packedsamples)
     *packedsamples = (*packer)->totalpackedsamples;
 
-  libmseed_memory.free (*packer);
+  lm_memory ()->free (*packer);
   *packer = NULL;
 } /* End of mstl3_pack_free() */
 
@@ -3243,8 +5213,6 @@ mstl3_pack_segment (MS3TraceList *mstl, MS3TraceID *id, MS3TraceSeg *seg,
   int64_t totalpackedsamples = 0;
   int segpackedrecords = 0;
   int64_t segpackedsamples = 0;
-  int samplesize;
-  size_t extralength;
 
   if (!id || !seg)
   {
@@ -3266,48 +5234,8 @@ mstl3_pack_segment (MS3TraceList *mstl, MS3TraceID *id, MS3TraceSeg *seg,
     return 0;
   }
 
-  msr.reclen = reclen;
-  msr.encoding = encoding;
-  memcpy (msr.sid, id->sid, sizeof (msr.sid));
-  msr.pubversion = id->pubversion;
-
-  if (extra)
-  {
-    msr.extra = extra;
-    extralength = strlen (extra);
-
-    if (extralength > UINT16_MAX)
-    {
-      ms_log (2, "Extra headers are too long: %" PRIsize_t "\n", extralength);
-      return -1;
-    }
-
-    msr.extralength = (uint16_t)extralength;
-  }
-
-  /* Pack segment data */
-  msr.starttime = seg->starttime;
-  msr.samprate = seg->samprate;
-  msr.samplecnt = seg->samplecnt;
-  msr.datasamples = seg->datasamples;
-  msr.numsamples = seg->numsamples;
-  msr.sampletype = seg->sampletype;
-
-  /* Set encoding for data types with only one encoding, otherwise requested */
-  switch (seg->sampletype)
-  {
-  case 't':
-    msr.encoding = DE_TEXT;
-    break;
-  case 'f':
-    msr.encoding = DE_FLOAT32;
-    break;
-  case 'd':
-    msr.encoding = DE_FLOAT64;
-    break;
-  default:
-    msr.encoding = encoding;
-  }
+  if (lm_pack_template (&msr, id, seg, reclen, encoding, extra))
+    return -1;
 
   segpackedsamples = 0;
   segpackedrecords =
@@ -3321,47 +5249,8 @@ mstl3_pack_segment (MS3TraceList *mstl, MS3TraceID *id, MS3TraceSeg *seg,
   /* If MSF_MAINTAINMSTL not set, modify or remove segment accordingly */
   if ((flags & MSF_MAINTAINMSTL) == 0 && segpackedsamples > 0)
   {
-    /* Determine sample size before modifying the segment to avoid a partial update */
-    if (!(samplesize = ms_samplesize (seg->sampletype)))
-    {
-      ms_log (2, "Unknown sample size for sample type: %c\n", seg->sampletype);
+    if (lm_trim_packed (id, seg, segpackedsamples))
       return -1;
-    }
-
-    /* Calculate new start time, shortcut when all samples have been packed */
-    if (segpackedsamples == seg->numsamples)
-      seg->starttime = seg->endtime;
-    else
-      seg->starttime = lm_packed_starttime (seg, segpackedsamples);
-
-    seg->samplecnt -= segpackedsamples;
-    seg->numsamples -= segpackedsamples;
-
-    /* Resize data buffer if samples remain */
-    if (seg->numsamples > 0)
-    {
-      size_t bufsize = seg->numsamples * samplesize;
-
-      memmove (seg->datasamples, (uint8_t *)seg->datasamples + (segpackedsamples * samplesize),
-               bufsize);
-
-      /* Reallocate buffer for reduced size needed, only if not pre-allocating */
-      if (libmseed_prealloc_block_size == 0)
-      {
-        void *resized = libmseed_memory.realloc (seg->datasamples, bufsize);
-
-        if (resized == NULL)
-        {
-          ms_log (2, "Cannot (re)allocate datasamples buffer\n");
-          return -1;
-        }
-
-        seg->datasamples = resized;
-        seg->datasize = (uint64_t)bufsize;
-      }
-    }
-
-    lm_update_id_extent (id);
   }
 
   totalpackedrecords += segpackedrecords;
@@ -3748,10 +5637,10 @@ lm_free_segment_memory (MS3TraceSeg *seg, int8_t freeprvtptr)
 
   /* Free private pointer data if requested */
   if (freeprvtptr)
-    libmseed_memory.free (seg->prvtptr);
+    lm_memory ()->free (seg->prvtptr);
 
   /* Free data samples */
-  libmseed_memory.free (seg->datasamples);
+  lm_memory ()->free (seg->datasamples);
 
   /* Free associated record list and related private pointers */
   if (seg->recordlist)
@@ -3765,17 +5654,17 @@ lm_free_segment_memory (MS3TraceSeg *seg, int8_t freeprvtptr)
 
       /* Free private pointer data if requested */
       if (freeprvtptr)
-        libmseed_memory.free (recordptr->prvtptr);
+        lm_memory ()->free (recordptr->prvtptr);
 
-      libmseed_memory.free (recordptr);
+      lm_memory ()->free (recordptr);
 
       recordptr = nextrecordptr;
     }
 
-    libmseed_memory.free (seg->recordlist);
+    lm_memory ()->free (seg->recordlist);
   }
 
-  libmseed_memory.free (seg);
+  lm_memory ()->free (seg);
 } /* End of lm_seg3_free_memory() */
 
 /** ************************************************************************
@@ -3860,6 +5749,8 @@ lm_remove_segment (MS3TraceList *mstl, MS3TraceID *id, MS3TraceSeg *seg, int8_t
       }
     }
 
+    lm_idindex_remove (mstl, id);
+
     /* Remove TraceID from skip list by updating previous node pointers */
     for (level = id->height - 1; level >= 0; level--)
     {
@@ -3871,10 +5762,10 @@ lm_remove_segment (MS3TraceList *mstl, MS3TraceID *id, MS3TraceSeg *seg, int8_t
 
     /* Free private pointer data if requested */
     if (freeprvtptr && id->prvtptr)
-      libmseed_memory.free (id->prvtptr);
+      lm_memory ()->free (id->prvtptr);
 
     /* Free the TraceID */
-    libmseed_memory.free (id);
+    lm_memory ()->free (id);
 
     /* Decrement trace count */
     mstl->numtraceids--;
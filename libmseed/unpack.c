@@ -29,6 +29,7 @@
 #include <string.h>
 #include <time.h>
 
+#include "internalstate.h"
 #include "libmseed.h"
 #include "mseedformat.h"
 #include "unpack.h"
@@ -37,9 +38,6 @@
 /* Function(s) internal to this file */
 static nstime_t ms_btime2nstime (uint8_t *btime, int8_t swapflag);
 
-/* Test POINTER for alignment with BYTE_COUNT sized quantities */
-#define is_aligned(POINTER, BYTE_COUNT) (((uintptr_t)(const void *)(POINTER)) % (BYTE_COUNT) == 0)
-
 /***************************************************************************
  * Unpack a miniSEED 3.x data record and populate a MS3Record struct.
  *
@@ -223,7 +221,7 @@ msr3_unpack_mseed3 (const char *record, int reclen, MS3Record **ppmsr, uint32_t
   msr->extralength = extralength;
   if (msr->extralength)
   {
-    if ((msr->extra = (char *)libmseed_memory.malloc (msr->extralength + 1)) == NULL)
+    if ((msr->extra = (char *)lm_memory ()->malloc (msr->extralength + 1)) == NULL)
     {
       ms_log (2, "%s: Cannot allocate memory for extra headers\n", msr->sid);
       return MS_GENERROR;
@@ -261,7 +259,7 @@ msr3_unpack_mseed3 (const char *record, int reclen, MS3Record **ppmsr, uint32_t
   else
   {
     if (msr->datasamples)
-      libmseed_memory.free (msr->datasamples);
+      lm_memory ()->free (msr->datasamples);
 
     msr->datasamples = NULL;
     msr->datasize = 0;
@@ -271,6 +269,517 @@ msr3_unpack_mseed3 (const char *record, int reclen, MS3Record **ppmsr, uint32_t
   return MS_NOERROR;
 } /* End of msr3_unpack_mseed3() */
 
+/* Blockette types that are mapped to extra headers */
+static int
+ms2_blkt_hasextra (uint16_t blkt_type)
+{
+  switch (blkt_type)
+  {
+  case 200:
+  case 201:
+  case 300:
+  case 310:
+  case 320:
+  case 390:
+  case 395:
+  case 500:
+  case 1001:
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+/***************************************************************************
+ * Return non-zero if the miniSEED 2 fixed header contains flags or a
+ * time correction that are mapped to extra headers.
+ ***************************************************************************/
+static int
+ms2_fsdh_hasextra (const char *record, int8_t swapflag)
+{
+  return ((*pMS2FSDH_ACTFLAGS (record) & 0x7C) || (*pMS2FSDH_IOFLAGS (record) & 0x1F) ||
+          (*pMS2FSDH_DQFLAGS (record) & 0x7F) ||
+          HO4d (*pMS2FSDH_TIMECORRECT (record), swapflag) != 0);
+}
+
+/***************************************************************************
+ * Map miniSEED 2 fixed header flags and time correction to extra headers.
+ ***************************************************************************/
+static void
+ms2_fsdh_extra (MS3Record *msr, const char *record, int8_t swapflag, LM_PARSED_JSON **parsestate)
+{
+  int ione = 1;
+  int64_t ival;
+  double dval;
+
+  /* Map activity bits */
+  if (*pMS2FSDH_ACTFLAGS (record) & 0x04) /* Bit 2 */
+    mseh_set_ptr_r (msr, "/FDSN/Event/Begin", &ione, 'b', parsestate);
+  if (*pMS2FSDH_ACTFLAGS (record) & 0x08) /* Bit 3 */
+    mseh_set_ptr_r (msr, "/FDSN/Event/End", &ione, 'b', parsestate);
+  if (*pMS2FSDH_ACTFLAGS (record) & 0x10) /* Bit 4 */
+  {
+    ival = 1;
+    mseh_set_ptr_r (msr, "/FDSN/Time/LeapSecond", &ival, 'i', parsestate);
+  }
+  if (*pMS2FSDH_ACTFLAGS (record) & 0x20) /* Bit 5 */
+  {
+    ival = -1;
+    mseh_set_ptr_r (msr, "/FDSN/Time/LeapSecond", &ival, 'i', parsestate);
+  }
+  if (*pMS2FSDH_ACTFLAGS (record) & 0x40) /* Bit 6 */
+    mseh_set_ptr_r (msr, "/FDSN/Event/InProgress", &ione, 'b', parsestate);
+
+  /* Map I/O and clock flags */
+  if (*pMS2FSDH_IOFLAGS (record) & 0x01) /* Bit 0 */
+    mseh_set_ptr_r (msr, "/FDSN/Flags/StationVolumeParityError", &ione, 'b', parsestate);
+  if (*pMS2FSDH_IOFLAGS (record) & 0x02) /* Bit 1 */
+    mseh_set_ptr_r (msr, "/FDSN/Flags/LongRecordRead", &ione, 'b', parsestate);
+  if (*pMS2FSDH_IOFLAGS (record) & 0x04) /* Bit 2 */
+    mseh_set_ptr_r (msr, "/FDSN/Flags/ShortRecordRead", &ione, 'b', parsestate);
+  if (*pMS2FSDH_IOFLAGS (record) & 0x08) /* Bit 3 */
+    mseh_set_ptr_r (msr, "/FDSN/Flags/StartOfTimeSeries", &ione, 'b', parsestate);
+  if (*pMS2FSDH_IOFLAGS (record) & 0x10) /* Bit 4 */
+    mseh_set_ptr_r (msr, "/FDSN/Flags/EndOfTimeSeries", &ione, 'b', parsestate);
+
+  /* Map data quality flags */
+  if (*pMS2FSDH_DQFLAGS (record) & 0x01) /* Bit 0 */
+    mseh_set_ptr_r (msr, "/FDSN/Flags/AmplifierSaturation", &ione, 'b', parsestate);
+  if (*pMS2FSDH_DQFLAGS (record) & 0x02) /* Bit 1 */
+    mseh_set_ptr_r (msr, "/FDSN/Flags/DigitizerClipping", &ione, 'b', parsestate);
+  if (*pMS2FSDH_DQFLAGS (record) & 0x04) /* Bit 2 */
+    mseh_set_ptr_r (msr, "/FDSN/Flags/Spikes", &ione, 'b', parsestate);
+  if (*pMS2FSDH_DQFLAGS (record) & 0x08) /* Bit 3 */
+    mseh_set_ptr_r (msr, "/FDSN/Flags/Glitches", &ione, 'b', parsestate);
+  if (*pMS2FSDH_DQFLAGS (record) & 0x10) /* Bit 4 */
+    mseh_set_ptr_r (msr, "/FDSN/Flags/MissingData", &ione, 'b', parsestate);
+  if (*pMS2FSDH_DQFLAGS (record) & 0x20) /* Bit 5 */
+    mseh_set_ptr_r (msr, "/FDSN/Flags/TelemetrySyncError", &ione, 'b', parsestate);
+  if (*pMS2FSDH_DQFLAGS (record) & 0x40) /* Bit 6 */
+    mseh_set_ptr_r (msr, "/FDSN/Flags/FilterCharging", &ione, 'b', parsestate);
+
+  dval = (double)HO4d (*pMS2FSDH_TIMECORRECT (record), swapflag);
+  if (dval != 0.0)
+  {
+    dval = dval / 10000.0;
+    mseh_set_ptr_r (msr, "/FDSN/Time/Correction", &dval, 'n', parsestate);
+  }
+} /* End of ms2_fsdh_extra() */
+
+/***************************************************************************
+ * Map a miniSEED 2 blockette to extra headers, the blockette type must
+ * be one for which ms2_blkt_hasextra() is true.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+ms2_blkt_extra (MS3Record *msr, const char *record, int blkt_offset, uint16_t blkt_type,
+                int8_t swapflag, LM_PARSED_JSON **parsestate)
+{
+  MSEHEventDetection eventdetection;
+  MSEHCalibration calibration;
+  MSEHTimingException exception;
+  int64_t ival;
+  char sval[64];
+  int length;
+
+  /* Blockette 200, generic event detection */
+  if (blkt_type == 200)
+  {
+    memset (&eventdetection, 0, sizeof (eventdetection));
+
+    strncpy (eventdetection.type, "GENERIC", sizeof (eventdetection.type));
+    ms_strncpcleantail (eventdetection.detector, pMS2B200_DETECTOR (record + blkt_offset), 24);
+    eventdetection.signalamplitude = HO4f (*pMS2B200_AMPLITUDE (record + blkt_offset), swapflag);
+    eventdetection.signalperiod = HO4f (*pMS2B200_PERIOD (record + blkt_offset), swapflag);
+    eventdetection.backgroundestimate =
+        HO4f (*pMS2B200_BACKGROUNDEST (record + blkt_offset), swapflag);
+
+    /* If bit 2 is set, set compression wave according to bit 0 */
+    if (*pMS2B200_FLAGS (record + blkt_offset) & 0x04)
+    {
+      if (*pMS2B200_FLAGS (record + blkt_offset) & 0x01)
+        strncpy (eventdetection.wave, "DILATATION", sizeof (eventdetection.wave));
+      else
+        strncpy (eventdetection.wave, "COMPRESSION", sizeof (eventdetection.wave));
+    }
+    else
+      eventdetection.wave[0] = '\0';
+
+    if (*pMS2B200_FLAGS (record + blkt_offset) & 0x02)
+      strncpy (eventdetection.units, "DECONVOLVED", sizeof (eventdetection.units));
+    else
+      strncpy (eventdetection.units, "COUNTS", sizeof (eventdetection.units));
+
+    eventdetection.onsettime =
+        ms_btime2nstime ((uint8_t *)pMS2B200_YEAR (record + blkt_offset), swapflag);
+
+    memset (eventdetection.medsnr, 0, 6);
+    eventdetection.medlookback = -1;
+    eventdetection.medpickalgorithm = -1;
+    eventdetection.next = NULL;
+
+    if (mseh_add_event_detection_r (msr, NULL, &eventdetection, parsestate))
+    {
+      ms_log (2, "%s: Problem mapping Blockette 200 to extra headers\n", msr->sid);
+      return -1;
+    }
+  }
+
+  /* Blockette 201, Murdock event detection */
+  else if (blkt_type == 201)
+  {
+    memset (&eventdetection, 0, sizeof (eventdetection));
+
+    strncpy (eventdetection.type, "MURDOCK", sizeof (eventdetection.type));
+    ms_strncpcleantail (eventdetection.detector, pMS2B201_DETECTOR (record + blkt_offset), 24);
+    eventdetection.signalamplitude = HO4f (*pMS2B201_AMPLITUDE (record + blkt_offset), swapflag);
+    eventdetection.signalperiod = HO4f (*pMS2B201_PERIOD (record + blkt_offset), swapflag);
+    eventdetection.backgroundestimate =
+        HO4f (*pMS2B201_BACKGROUNDEST (record + blkt_offset), swapflag);
+
+    /* If bit 0 is set, dilatation wave otherwise compression */
+    if (*pMS2B201_FLAGS (record + blkt_offset) & 0x01)
+      strncpy (eventdetection.wave, "DILATATION", sizeof (eventdetection.wave));
+    else
+      strncpy (eventdetection.wave, "COMPRESSION", sizeof (eventdetection.wave));
+
+    eventdetection.onsettime =
+        ms_btime2nstime ((uint8_t *)pMS2B201_YEAR (record + blkt_offset), swapflag);
+
+    memcpy (eventdetection.medsnr, pMS2B201_MEDSNR (record + blkt_offset), 6);
+    eventdetection.medlookback = *pMS2B201_LOOPBACK (record + blkt_offset);
+    eventdetection.medpickalgorithm = *pMS2B201_PICKALGORITHM (record + blkt_offset);
+    eventdetection.next = NULL;
+
+    if (mseh_add_event_detection_r (msr, NULL, &eventdetection, parsestate))
+    {
+      ms_log (2, "%s: Problem mapping Blockette 201 to extra headers\n", msr->sid);
+      return -1;
+    }
+  }
+
+  /* Blockette 300, step calibration */
+  else if (blkt_type == 300)
+  {
+    memset (&calibration, 0, sizeof (calibration));
+
+    strncpy (calibration.type, "STEP", sizeof (calibration.type));
+
+    calibration.begintime =
+        ms_btime2nstime ((uint8_t *)pMS2B300_YEAR (record + blkt_offset), swapflag);
+
+    calibration.endtime = NSTUNSET;
+    calibration.steps = *pMS2B300_NUMCALIBRATIONS (record + blkt_offset);
+
+    /* If bit 0 is set, first puluse is positive */
+    calibration.firstpulsepositive = -1;
+    if (*pMS2B300_FLAGS (record + blkt_offset) & 0x01)
+      calibration.firstpulsepositive = 1;
+
+    /* If bit 1 is set, calibration's alternate sign */
+    calibration.alternatesign = -1;
+    if (*pMS2B300_FLAGS (record + blkt_offset) & 0x02)
+      calibration.alternatesign = 1;
+
+    /* If bit 2 is set, calibration is automatic, otherwise manual */
+    if (*pMS2B300_FLAGS (record + blkt_offset) & 0x04)
+      strncpy (calibration.trigger, "AUTOMATIC", sizeof (calibration.trigger));
+    else
+      strncpy (calibration.trigger, "MANUAL", sizeof (calibration.trigger));
+
+    /* If bit 3 is set, continued from previous record */
+    calibration.continued = -1;
+    if (*pMS2B300_FLAGS (record + blkt_offset) & 0x08)
+      calibration.continued = 1;
+
+    calibration.duration =
+        (double)(HO4u (*pMS2B300_STEPDURATION (record + blkt_offset), swapflag) / 10000.0);
+    calibration.stepbetween =
+        (double)(HO4u (*pMS2B300_INTERVALDURATION (record + blkt_offset), swapflag) /
+                 10000.0);
+    calibration.amplitude = HO4f (*pMS2B300_AMPLITUDE (record + blkt_offset), swapflag);
+    ms_strncpcleantail (calibration.inputchannel, pMS2B300_INPUTCHANNEL (record + blkt_offset),
+                        3);
+    calibration.inputunits[0] = '\0';
+    calibration.amplituderange[0] = '\0';
+    calibration.sineperiod = 0.0;
+    calibration.refamplitude =
+        (double)(HO4u (*pMS2B300_REFERENCEAMPLITUDE (record + blkt_offset), swapflag));
+    ms_strncpcleantail (calibration.coupling, pMS2B300_COUPLING (record + blkt_offset), 12);
+    ms_strncpcleantail (calibration.rolloff, pMS2B300_ROLLOFF (record + blkt_offset), 12);
+    calibration.noise[0] = '\0';
+    calibration.next = NULL;
+
+    if (mseh_add_calibration_r (msr, NULL, &calibration, parsestate))
+    {
+      ms_log (2, "%s: Problem mapping Blockette 300 to extra headers\n", msr->sid);
+      return -1;
+    }
+  }
+
+  /* Blockette 310, sine calibration */
+  else if (blkt_type == 310)
+  {
+    memset (&calibration, 0, sizeof (calibration));
+
+    strncpy (calibration.type, "SINE", sizeof (calibration.type));
+
+    calibration.begintime =
+        ms_btime2nstime ((uint8_t *)pMS2B310_YEAR (record + blkt_offset), swapflag);
+
+    calibration.endtime = NSTUNSET;
+    calibration.steps = -1;
+    calibration.firstpulsepositive = -1;
+    calibration.alternatesign = -1;
+
+    /* If bit 2 is set, calibration is automatic, otherwise manual */
+    if (*pMS2B310_FLAGS (record + blkt_offset) & 0x04)
+      strncpy (calibration.trigger, "AUTOMATIC", sizeof (calibration.trigger));
+    else
+      strncpy (calibration.trigger, "MANUAL", sizeof (calibration.trigger));
+
+    /* If bit 3 is set, continued from previous record */
+    calibration.continued = -1;
+    if (*pMS2B310_FLAGS (record + blkt_offset) & 0x08)
+      calibration.continued = 1;
+
+    calibration.amplituderange[0] = '\0';
+    /* If bit 4 is set, peak to peak amplitude */
+    if (*pMS2B310_FLAGS (record + blkt_offset) & 0x10)
+      strncpy (calibration.amplituderange, "PEAKTOPEAK", sizeof (calibration.amplituderange));
+    /* Otherwise, if bit 5 is set, zero to peak amplitude */
+    else if (*pMS2B310_FLAGS (record + blkt_offset) & 0x20)
+      strncpy (calibration.amplituderange, "ZEROTOPEAK", sizeof (calibration.amplituderange));
+    /* Otherwise, if bit 6 is set, RMS amplitude */
+    else if (*pMS2B310_FLAGS (record + blkt_offset) & 0x40)
+      strncpy (calibration.amplituderange, "RMS", sizeof (calibration.amplituderange));
+
+    calibration.duration =
+        (double)(HO4u (*pMS2B310_DURATION (record + blkt_offset), swapflag) / 10000.0);
+    calibration.sineperiod = HO4f (*pMS2B310_PERIOD (record + blkt_offset), swapflag);
+    calibration.amplitude = HO4f (*pMS2B310_AMPLITUDE (record + blkt_offset), swapflag);
+    ms_strncpcleantail (calibration.inputchannel, pMS2B310_INPUTCHANNEL (record + blkt_offset),
+                        3);
+    calibration.refamplitude =
+        (double)(HO4u (*pMS2B310_REFERENCEAMPLITUDE (record + blkt_offset), swapflag));
+    calibration.stepbetween = 0.0;
+    calibration.inputunits[0] = '\0';
+    ms_strncpcleantail (calibration.coupling, pMS2B310_COUPLING (record + blkt_offset), 12);
+    ms_strncpcleantail (calibration.rolloff, pMS2B310_ROLLOFF (record + blkt_offset), 12);
+    calibration.noise[0] = '\0';
+    calibration.next = NULL;
+
+    if (mseh_add_calibration_r (msr, NULL, &calibration, parsestate))
+    {
+      ms_log (2, "%s: Problem mapping Blockette 310 to extra headers\n", msr->sid);
+      return -1;
+    }
+  }
+
+  /* Blockette 320, pseudo-random calibration */
+  else if (blkt_type == 320)
+  {
+    memset (&calibration, 0, sizeof (calibration));
+
+    strncpy (calibration.type, "PSEUDORANDOM", sizeof (calibration.type));
+
+    calibration.begintime =
+        ms_btime2nstime ((uint8_t *)pMS2B320_YEAR (record + blkt_offset), swapflag);
+
+    calibration.endtime = NSTUNSET;
+    calibration.steps = -1;
+    calibration.firstpulsepositive = -1;
+    calibration.alternatesign = -1;
+
+    /* If bit 2 is set, calibration is automatic, otherwise manual */
+    if (*pMS2B320_FLAGS (record + blkt_offset) & 0x04)
+      strncpy (calibration.trigger, "AUTOMATIC", sizeof (calibration.trigger));
+    else
+      strncpy (calibration.trigger, "MANUAL", sizeof (calibration.trigger));
+
+    /* If bit 3 is set, continued from previous record */
+    calibration.continued = -1;
+    if (*pMS2B320_FLAGS (record + blkt_offset) & 0x08)
+      calibration.continued = 1;
+
+    calibration.amplituderange[0] = '\0';
+    /* If bit 4 is set, peak to peak amplitude */
+    if (*pMS2B320_FLAGS (record + blkt_offset) & 0x10)
+      strncpy (calibration.amplituderange, "RANDOM", sizeof (calibration.amplituderange));
+
+    calibration.duration =
+        (double)(HO4u (*pMS2B320_DURATION (record + blkt_offset), swapflag) / 10000.0);
+    calibration.amplitude = HO4f (*pMS2B320_PTPAMPLITUDE (record + blkt_offset), swapflag);
+    ms_strncpcleantail (calibration.inputchannel, pMS2B320_INPUTCHANNEL (record + blkt_offset),
+                        3);
+    calibration.refamplitude =
+        (double)(HO4u (*pMS2B320_REFERENCEAMPLITUDE (record + blkt_offset), swapflag));
+    calibration.sineperiod = 0.0;
+    calibration.stepbetween = 0.0;
+    calibration.inputunits[0] = '\0';
+    ms_strncpcleantail (calibration.coupling, pMS2B320_COUPLING (record + blkt_offset), 12);
+    ms_strncpcleantail (calibration.rolloff, pMS2B320_ROLLOFF (record + blkt_offset), 12);
+    ms_strncpcleantail (calibration.noise, pMS2B320_NOISETYPE (record + blkt_offset), 8);
+    calibration.next = NULL;
+
+    if (mseh_add_calibration_r (msr, NULL, &calibration, parsestate))
+    {
+      ms_log (2, "%s: Problem mapping Blockette 320 to extra headers\n", msr->sid);
+      return -1;
+    }
+  }
+
+  /* Blockette 390, generic calibration */
+  else if (blkt_type == 390)
+  {
+    memset (&calibration, 0, sizeof (calibration));
+
+    strncpy (calibration.type, "GENERIC", sizeof (calibration.type));
+
+    calibration.begintime =
+        ms_btime2nstime ((uint8_t *)pMS2B390_YEAR (record + blkt_offset), swapflag);
+
+    calibration.endtime = NSTUNSET;
+    calibration.steps = -1;
+    calibration.firstpulsepositive = -1;
+    calibration.alternatesign = -1;
+
+    /* If bit 2 is set, calibration is automatic, otherwise manual */
+    if (*pMS2B390_FLAGS (record + blkt_offset) & 0x04)
+      strncpy (calibration.trigger, "AUTOMATIC", sizeof (calibration.trigger));
+    else
+      strncpy (calibration.trigger, "MANUAL", sizeof (calibration.trigger));
+
+    /* If bit 3 is set, continued from previous record */
+    calibration.continued = -1;
+    if (*pMS2B390_FLAGS (record + blkt_offset) & 0x08)
+      calibration.continued = 1;
+
+    calibration.amplituderange[0] = '\0';
+    calibration.duration =
+        (double)(HO4u (*pMS2B390_DURATION (record + blkt_offset), swapflag) / 10000.0);
+    calibration.amplitude = HO4f (*pMS2B390_AMPLITUDE (record + blkt_offset), swapflag);
+    ms_strncpcleantail (calibration.inputchannel, pMS2B390_INPUTCHANNEL (record + blkt_offset),
+                        3);
+    calibration.refamplitude = 0.0;
+    calibration.sineperiod = 0.0;
+    calibration.stepbetween = 0.0;
+    calibration.inputunits[0] = '\0';
+    calibration.coupling[0] = '\0';
+    calibration.rolloff[0] = '\0';
+    calibration.noise[0] = '\0';
+    calibration.next = NULL;
+
+    if (mseh_add_calibration_r (msr, NULL, &calibration, parsestate))
+    {
+      ms_log (2, "%s: Problem mapping Blockette 390 to extra headers\n", msr->sid);
+      return -1;
+    }
+  }
+
+  /* Blockette 395, calibration abort */
+  else if (blkt_type == 395)
+  {
+    memset (&calibration, 0, sizeof (calibration));
+
+    strncpy (calibration.type, "ABORT", sizeof (calibration.type));
+
+    calibration.begintime = NSTUNSET;
+
+    calibration.endtime =
+        ms_btime2nstime ((uint8_t *)pMS2B395_YEAR (record + blkt_offset), swapflag);
+
+    calibration.steps = -1;
+    calibration.firstpulsepositive = -1;
+    calibration.alternatesign = -1;
+    calibration.trigger[0] = '\0';
+    calibration.continued = -1;
+    calibration.amplituderange[0] = '\0';
+    calibration.duration = 0.0;
+    calibration.amplitude = 0.0;
+    calibration.inputchannel[0] = '\0';
+    calibration.refamplitude = 0.0;
+    calibration.sineperiod = 0.0;
+    calibration.stepbetween = 0.0;
+    calibration.inputunits[0] = '\0';
+    calibration.coupling[0] = '\0';
+    calibration.rolloff[0] = '\0';
+    calibration.noise[0] = '\0';
+    calibration.next = NULL;
+
+    if (mseh_add_calibration_r (msr, NULL, &calibration, parsestate))
+    {
+      ms_log (2, "%s: Problem mapping Blockette 395 to extra headers\n", msr->sid);
+      return -1;
+    }
+  }
+
+  /* Blockette 500, timing blockette */
+  else if (blkt_type == 500)
+  {
+    memset (&exception, 0, sizeof (exception));
+
+    exception.vcocorrection = HO4f (*pMS2B500_VCOCORRECTION (record + blkt_offset), swapflag);
+
+    exception.time = ms_btime2nstime ((uint8_t *)pMS2B500_YEAR (record + blkt_offset), swapflag);
+
+    /* Apply microsecond precision if non-zero, only to a valid decoded time */
+    if (*pMS2B500_MICROSECOND (record + blkt_offset) != 0 && exception.time != NSTUNSET &&
+        exception.time != NSTERROR)
+    {
+      exception.time +=
+          (nstime_t)*pMS2B500_MICROSECOND (record + blkt_offset) * (NSTMODULUS / 1000000);
+    }
+
+    exception.receptionquality = *pMS2B500_RECEPTIONQUALITY (record + blkt_offset);
+    exception.count = HO4u (*pMS2B500_EXCEPTIONCOUNT (record + blkt_offset), swapflag);
+    ms_strncpopen (exception.type, pMS2B500_EXCEPTIONTYPE (record + blkt_offset),
+                   (int)sizeof (exception.type));
+    ms_strncpopen (exception.clockstatus, pMS2B500_CLOCKSTATUS (record + blkt_offset),
+                   (int)sizeof (exception.clockstatus));
+
+    if (mseh_add_timing_exception_r (msr, NULL, &exception, parsestate))
+    {
+      ms_log (2, "%s: Problem mapping Blockette 500 to extra headers\n", msr->sid);
+      return -1;
+    }
+
+    /* Clock model maps to a single value at /FDSN/Clock/Model */
+    ms_strncpcleantail (sval, pMS2B500_CLOCKMODEL (record + blkt_offset), 32);
+    mseh_set_ptr_r (msr, "/FDSN/Clock/Model", sval, 's', parsestate);
+  }
+
+  /* Blockette 1001, data extension */
+  else if (blkt_type == 1001)
+  {
+    /* Optimization: if no other extra headers yet, directly print this common value */
+    if (*parsestate == NULL && msr->extra == NULL)
+    {
+      length = snprintf (sval, sizeof (sval), "{\"FDSN\":{\"Time\":{\"Quality\":%d}}}",
+                         *pMS2B1001_TIMINGQUALITY (record + blkt_offset));
+
+      if (!(msr->extra = (char *)lm_memory ()->malloc (length + 1)))
+      {
+        ms_log (2, "%s: Cannot allocate memory for extra headers\n", msr->sid);
+        return -1;
+      }
+      memcpy (msr->extra, sval, length + 1);
+
+      msr->extralength = length;
+    }
+    /* Otherwise add it to existing headers */
+    else
+    {
+      ival = *pMS2B1001_TIMINGQUALITY (record + blkt_offset);
+      mseh_set_ptr_r (msr, "/FDSN/Time/Quality", &ival, 'i', parsestate);
+    }
+  }
+
+
+  return 0;
+} /* End of ms2_blkt_extra() */
+
 /***************************************************************************
  * Unpack a miniSEED 2.x data record and populate a MS3Record struct.
  *
@@ -308,12 +817,6 @@ msr3_unpack_mseed2 (const char *record, int reclen, MS3Record **ppmsr, uint32_t
   MS3Record *msr = NULL;
   char errorsid[64];
 
-  int length;
-  int ione = 1;
-  int64_t ival;
-  double dval;
-  char sval[64];
-
   /* For blockette parsing */
   int blkt_offset;
   int blkt_count = 0;
@@ -321,11 +824,9 @@ msr3_unpack_mseed2 (const char *record, int reclen, MS3Record **ppmsr, uint32_t
   int blkt_end = 0;
   uint16_t blkt_type;
   uint16_t next_blkt;
+  int extrapending = 0;
 
   LM_PARSED_JSON *parsestate = NULL;
-  MSEHEventDetection eventdetection;
-  MSEHCalibration calibration;
-  MSEHTimingException exception;
 
   if (!record || !ppmsr)
   {
@@ -392,64 +893,19 @@ msr3_unpack_mseed2 (const char *record, int reclen, MS3Record **ppmsr, uint32_t
   else
     msr->pubversion = 0;
 
-  /* Map activity bits */
+  /* Map record-level flags */
   if (*pMS2FSDH_ACTFLAGS (record) & 0x01) /* Bit 0 */
     msr->flags |= 0x01;
-  if (*pMS2FSDH_ACTFLAGS (record) & 0x04) /* Bit 2 */
-    mseh_set_ptr_r (msr, "/FDSN/Event/Begin", &ione, 'b', &parsestate);
-  if (*pMS2FSDH_ACTFLAGS (record) & 0x08) /* Bit 3 */
-    mseh_set_ptr_r (msr, "/FDSN/Event/End", &ione, 'b', &parsestate);
-  if (*pMS2FSDH_ACTFLAGS (record) & 0x10) /* Bit 4 */
-  {
-    ival = 1;
-    mseh_set_ptr_r (msr, "/FDSN/Time/LeapSecond", &ival, 'i', &parsestate);
-  }
-  if (*pMS2FSDH_ACTFLAGS (record) & 0x20) /* Bit 5 */
-  {
-    ival = -1;
-    mseh_set_ptr_r (msr, "/FDSN/Time/LeapSecond", &ival, 'i', &parsestate);
-  }
-  if (*pMS2FSDH_ACTFLAGS (record) & 0x40) /* Bit 6 */
-    mseh_set_ptr_r (msr, "/FDSN/Event/InProgress", &ione, 'b', &parsestate);
-
-  /* Map I/O and clock flags */
-  if (*pMS2FSDH_IOFLAGS (record) & 0x01) /* Bit 0 */
-    mseh_set_ptr_r (msr, "/FDSN/Flags/StationVolumeParityError", &ione, 'b', &parsestate);
-  if (*pMS2FSDH_IOFLAGS (record) & 0x02) /* Bit 1 */
-    mseh_set_ptr_r (msr, "/FDSN/Flags/LongRecordRead", &ione, 'b', &parsestate);
-  if (*pMS2FSDH_IOFLAGS (record) & 0x04) /* Bit 2 */
-    mseh_set_ptr_r (msr, "/FDSN/Flags/ShortRecordRead", &ione, 'b', &parsestate);
-  if (*pMS2FSDH_IOFLAGS (record) & 0x08) /* Bit 3 */
-    mseh_set_ptr_r (msr, "/FDSN/Flags/StartOfTimeSeries", &ione, 'b', &parsestate);
-  if (*pMS2FSDH_IOFLAGS (record) & 0x10) /* Bit 4 */
-    mseh_set_ptr_r (msr, "/FDSN/Flags/EndOfTimeSeries", &ione, 'b', &parsestate);
   if (*pMS2FSDH_IOFLAGS (record) & 0x20) /* Bit 5 */
     msr->flags |= 0x04;
-
-  /* Map data quality flags */
-  if (*pMS2FSDH_DQFLAGS (record) & 0x01) /* Bit 0 */
-    mseh_set_ptr_r (msr, "/FDSN/Flags/AmplifierSaturation", &ione, 'b', &parsestate);
-  if (*pMS2FSDH_DQFLAGS (record) & 0x02) /* Bit 1 */
-    mseh_set_ptr_r (msr, "/FDSN/Flags/DigitizerClipping", &ione, 'b', &parsestate);
-  if (*pMS2FSDH_DQFLAGS (record) & 0x04) /* Bit 2 */
-    mseh_set_ptr_r (msr, "/FDSN/Flags/Spikes", &ione, 'b', &parsestate);
-  if (*pMS2FSDH_DQFLAGS (record) & 0x08) /* Bit 3 */
-    mseh_set_ptr_r (msr, "/FDSN/Flags/Glitches", &ione, 'b', &parsestate);
-  if (*pMS2FSDH_DQFLAGS (record) & 0x10) /* Bit 4 */
-    mseh_set_ptr_r (msr, "/FDSN/Flags/MissingData", &ione, 'b', &parsestate);
-  if (*pMS2FSDH_DQFLAGS (record) & 0x20) /* Bit 5 */
-    mseh_set_ptr_r (msr, "/FDSN/Flags/TelemetrySyncError", &ione, 'b', &parsestate);
-  if (*pMS2FSDH_DQFLAGS (record) & 0x40) /* Bit 6 */
-    mseh_set_ptr_r (msr, "/FDSN/Flags/FilterCharging", &ione, 'b', &parsestate);
   if (*pMS2FSDH_DQFLAGS (record) & 0x80) /* Bit 7 */
     msr->flags |= 0x02;
 
-  dval = (double)HO4d (*pMS2FSDH_TIMECORRECT (record), msr->swapflag);
-  if (dval != 0.0)
-  {
-    dval = dval / 10000.0;
-    mseh_set_ptr_r (msr, "/FDSN/Time/Correction", &dval, 'n', &parsestate);
-  }
+  /* Map remaining header flags and time correction to extra headers */
+  if (flags & MSF_DEFEREXTRA)
+    extrapending = ms2_fsdh_hasextra (record, msr->swapflag);
+  else
+    ms2_fsdh_extra (msr, record, msr->swapflag, &parsestate);
 
   /* Traverse the blockettes */
   blkt_offset = HO2u (*pMS2FSDH_BLOCKETTEOFFSET (record), msr->swapflag);
@@ -524,392 +980,33 @@ msr3_unpack_mseed2 (const char *record, int reclen, MS3Record **ppmsr, uint32_t
         msr->samprate = b100rate;
     }
 
-    /* Blockette 200, generic event detection */
-    else if (blkt_type == 200)
+    /* Blockettes mapped to extra headers, optionally deferred */
+    else if (ms2_blkt_hasextra (blkt_type))
     {
-      memset (&eventdetection, 0, sizeof (eventdetection));
-
-      strncpy (eventdetection.type, "GENERIC", sizeof (eventdetection.type));
-      ms_strncpcleantail (eventdetection.detector, pMS2B200_DETECTOR (record + blkt_offset), 24);
-      eventdetection.signalamplitude =
-          HO4f (*pMS2B200_AMPLITUDE (record + blkt_offset), msr->swapflag);
-      eventdetection.signalperiod = HO4f (*pMS2B200_PERIOD (record + blkt_offset), msr->swapflag);
-      eventdetection.backgroundestimate =
-          HO4f (*pMS2B200_BACKGROUNDEST (record + blkt_offset), msr->swapflag);
-
-      /* If bit 2 is set, set compression wave according to bit 0 */
-      if (*pMS2B200_FLAGS (record + blkt_offset) & 0x04)
-      {
-        if (*pMS2B200_FLAGS (record + blkt_offset) & 0x01)
-          strncpy (eventdetection.wave, "DILATATION", sizeof (eventdetection.wave));
-        else
-          strncpy (eventdetection.wave, "COMPRESSION", sizeof (eventdetection.wave));
-      }
-      else
-        eventdetection.wave[0] = '\0';
-
-      if (*pMS2B200_FLAGS (record + blkt_offset) & 0x02)
-        strncpy (eventdetection.units, "DECONVOLVED", sizeof (eventdetection.units));
-      else
-        strncpy (eventdetection.units, "COUNTS", sizeof (eventdetection.units));
-
-      eventdetection.onsettime =
-          ms_btime2nstime ((uint8_t *)pMS2B200_YEAR (record + blkt_offset), msr->swapflag);
+      if (blkt_type == 1001)
+        B1001offset = blkt_offset;
 
-      memset (eventdetection.medsnr, 0, 6);
-      eventdetection.medlookback = -1;
-      eventdetection.medpickalgorithm = -1;
-      eventdetection.next = NULL;
-
-      if (mseh_add_event_detection_r (msr, NULL, &eventdetection, &parsestate))
-      {
-        ms_log (2, "%s: Problem mapping Blockette 200 to extra headers\n", msr->sid);
+      if (flags & MSF_DEFEREXTRA)
+        extrapending = 1;
+      else if (ms2_blkt_extra (msr, record, blkt_offset, blkt_type, msr->swapflag, &parsestate))
         goto error_return;
-      }
     }
 
-    /* Blockette 201, Murdock event detection */
-    else if (blkt_type == 201)
+    /* Blockette 400, beam blockette */
+    else if (blkt_type == 400)
     {
-      memset (&eventdetection, 0, sizeof (eventdetection));
-
-      strncpy (eventdetection.type, "MURDOCK", sizeof (eventdetection.type));
-      ms_strncpcleantail (eventdetection.detector, pMS2B201_DETECTOR (record + blkt_offset), 24);
-      eventdetection.signalamplitude =
-          HO4f (*pMS2B201_AMPLITUDE (record + blkt_offset), msr->swapflag);
-      eventdetection.signalperiod = HO4f (*pMS2B201_PERIOD (record + blkt_offset), msr->swapflag);
-      eventdetection.backgroundestimate =
-          HO4f (*pMS2B201_BACKGROUNDEST (record + blkt_offset), msr->swapflag);
-
-      /* If bit 0 is set, dilatation wave otherwise compression */
-      if (*pMS2B201_FLAGS (record + blkt_offset) & 0x01)
-        strncpy (eventdetection.wave, "DILATATION", sizeof (eventdetection.wave));
-      else
-        strncpy (eventdetection.wave, "COMPRESSION", sizeof (eventdetection.wave));
-
-      eventdetection.onsettime =
-          ms_btime2nstime ((uint8_t *)pMS2B201_YEAR (record + blkt_offset), msr->swapflag);
-
-      memcpy (eventdetection.medsnr, pMS2B201_MEDSNR (record + blkt_offset), 6);
-      eventdetection.medlookback = *pMS2B201_LOOPBACK (record + blkt_offset);
-      eventdetection.medpickalgorithm = *pMS2B201_PICKALGORITHM (record + blkt_offset);
-      eventdetection.next = NULL;
-
-      if (mseh_add_event_detection_r (msr, NULL, &eventdetection, &parsestate))
-      {
-        ms_log (2, "%s: Problem mapping Blockette 201 to extra headers\n", msr->sid);
-        goto error_return;
-      }
+      ms_log (1, "%s: WARNING Blockette 400 is present but discarded\n", msr->sid);
     }
 
-    /* Blockette 300, step calibration */
-    else if (blkt_type == 300)
+    /* Blockette 400, beam delay blockette */
+    else if (blkt_type == 405)
     {
-      memset (&calibration, 0, sizeof (calibration));
-
-      strncpy (calibration.type, "STEP", sizeof (calibration.type));
-
-      calibration.begintime =
-          ms_btime2nstime ((uint8_t *)pMS2B300_YEAR (record + blkt_offset), msr->swapflag);
-
-      calibration.endtime = NSTUNSET;
-      calibration.steps = *pMS2B300_NUMCALIBRATIONS (record + blkt_offset);
-
-      /* If bit 0 is set, first puluse is positive */
-      calibration.firstpulsepositive = -1;
-      if (*pMS2B300_FLAGS (record + blkt_offset) & 0x01)
-        calibration.firstpulsepositive = 1;
-
-      /* If bit 1 is set, calibration's alternate sign */
-      calibration.alternatesign = -1;
-      if (*pMS2B300_FLAGS (record + blkt_offset) & 0x02)
-        calibration.alternatesign = 1;
-
-      /* If bit 2 is set, calibration is automatic, otherwise manual */
-      if (*pMS2B300_FLAGS (record + blkt_offset) & 0x04)
-        strncpy (calibration.trigger, "AUTOMATIC", sizeof (calibration.trigger));
-      else
-        strncpy (calibration.trigger, "MANUAL", sizeof (calibration.trigger));
-
-      /* If bit 3 is set, continued from previous record */
-      calibration.continued = -1;
-      if (*pMS2B300_FLAGS (record + blkt_offset) & 0x08)
-        calibration.continued = 1;
-
-      calibration.duration =
-          (double)(HO4u (*pMS2B300_STEPDURATION (record + blkt_offset), msr->swapflag) / 10000.0);
-      calibration.stepbetween =
-          (double)(HO4u (*pMS2B300_INTERVALDURATION (record + blkt_offset), msr->swapflag) /
-                   10000.0);
-      calibration.amplitude = HO4f (*pMS2B300_AMPLITUDE (record + blkt_offset), msr->swapflag);
-      ms_strncpcleantail (calibration.inputchannel, pMS2B300_INPUTCHANNEL (record + blkt_offset),
-                          3);
-      calibration.inputunits[0] = '\0';
-      calibration.amplituderange[0] = '\0';
-      calibration.sineperiod = 0.0;
-      calibration.refamplitude =
-          (double)(HO4u (*pMS2B300_REFERENCEAMPLITUDE (record + blkt_offset), msr->swapflag));
-      ms_strncpcleantail (calibration.coupling, pMS2B300_COUPLING (record + blkt_offset), 12);
-      ms_strncpcleantail (calibration.rolloff, pMS2B300_ROLLOFF (record + blkt_offset), 12);
-      calibration.noise[0] = '\0';
-      calibration.next = NULL;
-
-      if (mseh_add_calibration_r (msr, NULL, &calibration, &parsestate))
-      {
-        ms_log (2, "%s: Problem mapping Blockette 300 to extra headers\n", msr->sid);
-        goto error_return;
-      }
+      ms_log (1, "%s: WARNING Blockette 405 is present but discarded\n", msr->sid);
     }
 
-    /* Blockette 310, sine calibration */
-    else if (blkt_type == 310)
+    else if (blkt_type == 1000)
     {
-      memset (&calibration, 0, sizeof (calibration));
-
-      strncpy (calibration.type, "SINE", sizeof (calibration.type));
-
-      calibration.begintime =
-          ms_btime2nstime ((uint8_t *)pMS2B310_YEAR (record + blkt_offset), msr->swapflag);
-
-      calibration.endtime = NSTUNSET;
-      calibration.steps = -1;
-      calibration.firstpulsepositive = -1;
-      calibration.alternatesign = -1;
-
-      /* If bit 2 is set, calibration is automatic, otherwise manual */
-      if (*pMS2B310_FLAGS (record + blkt_offset) & 0x04)
-        strncpy (calibration.trigger, "AUTOMATIC", sizeof (calibration.trigger));
-      else
-        strncpy (calibration.trigger, "MANUAL", sizeof (calibration.trigger));
-
-      /* If bit 3 is set, continued from previous record */
-      calibration.continued = -1;
-      if (*pMS2B310_FLAGS (record + blkt_offset) & 0x08)
-        calibration.continued = 1;
-
-      calibration.amplituderange[0] = '\0';
-      /* If bit 4 is set, peak to peak amplitude */
-      if (*pMS2B310_FLAGS (record + blkt_offset) & 0x10)
-        strncpy (calibration.amplituderange, "PEAKTOPEAK", sizeof (calibration.amplituderange));
-      /* Otherwise, if bit 5 is set, zero to peak amplitude */
-      else if (*pMS2B310_FLAGS (record + blkt_offset) & 0x20)
-        strncpy (calibration.amplituderange, "ZEROTOPEAK", sizeof (calibration.amplituderange));
-      /* Otherwise, if bit 6 is set, RMS amplitude */
-      else if (*pMS2B310_FLAGS (record + blkt_offset) & 0x40)
-        strncpy (calibration.amplituderange, "RMS", sizeof (calibration.amplituderange));
-
-      calibration.duration =
-          (double)(HO4u (*pMS2B310_DURATION (record + blkt_offset), msr->swapflag) / 10000.0);
-      calibration.sineperiod = HO4f (*pMS2B310_PERIOD (record + blkt_offset), msr->swapflag);
-      calibration.amplitude = HO4f (*pMS2B310_AMPLITUDE (record + blkt_offset), msr->swapflag);
-      ms_strncpcleantail (calibration.inputchannel, pMS2B310_INPUTCHANNEL (record + blkt_offset),
-                          3);
-      calibration.refamplitude =
-          (double)(HO4u (*pMS2B310_REFERENCEAMPLITUDE (record + blkt_offset), msr->swapflag));
-      calibration.stepbetween = 0.0;
-      calibration.inputunits[0] = '\0';
-      ms_strncpcleantail (calibration.coupling, pMS2B310_COUPLING (record + blkt_offset), 12);
-      ms_strncpcleantail (calibration.rolloff, pMS2B310_ROLLOFF (record + blkt_offset), 12);
-      calibration.noise[0] = '\0';
-      calibration.next = NULL;
-
-      if (mseh_add_calibration_r (msr, NULL, &calibration, &parsestate))
-      {
-        ms_log (2, "%s: Problem mapping Blockette 310 to extra headers\n", msr->sid);
-        goto error_return;
-      }
-    }
-
-    /* Blockette 320, pseudo-random calibration */
-    else if (blkt_type == 320)
-    {
-      memset (&calibration, 0, sizeof (calibration));
-
-      strncpy (calibration.type, "PSEUDORANDOM", sizeof (calibration.type));
-
-      calibration.begintime =
-          ms_btime2nstime ((uint8_t *)pMS2B320_YEAR (record + blkt_offset), msr->swapflag);
-
-      calibration.endtime = NSTUNSET;
-      calibration.steps = -1;
-      calibration.firstpulsepositive = -1;
-      calibration.alternatesign = -1;
-
-      /* If bit 2 is set, calibration is automatic, otherwise manual */
-      if (*pMS2B320_FLAGS (record + blkt_offset) & 0x04)
-        strncpy (calibration.trigger, "AUTOMATIC", sizeof (calibration.trigger));
-      else
-        strncpy (calibration.trigger, "MANUAL", sizeof (calibration.trigger));
-
-      /* If bit 3 is set, continued from previous record */
-      calibration.continued = -1;
-      if (*pMS2B320_FLAGS (record + blkt_offset) & 0x08)
-        calibration.continued = 1;
-
-      calibration.amplituderange[0] = '\0';
-      /* If bit 4 is set, peak to peak amplitude */
-      if (*pMS2B320_FLAGS (record + blkt_offset) & 0x10)
-        strncpy (calibration.amplituderange, "RANDOM", sizeof (calibration.amplituderange));
-
-      calibration.duration =
-          (double)(HO4u (*pMS2B320_DURATION (record + blkt_offset), msr->swapflag) / 10000.0);
-      calibration.amplitude = HO4f (*pMS2B320_PTPAMPLITUDE (record + blkt_offset), msr->swapflag);
-      ms_strncpcleantail (calibration.inputchannel, pMS2B320_INPUTCHANNEL (record + blkt_offset),
-                          3);
-      calibration.refamplitude =
-          (double)(HO4u (*pMS2B320_REFERENCEAMPLITUDE (record + blkt_offset), msr->swapflag));
-      calibration.sineperiod = 0.0;
-      calibration.stepbetween = 0.0;
-      calibration.inputunits[0] = '\0';
-      ms_strncpcleantail (calibration.coupling, pMS2B320_COUPLING (record + blkt_offset), 12);
-      ms_strncpcleantail (calibration.rolloff, pMS2B320_ROLLOFF (record + blkt_offset), 12);
-      ms_strncpcleantail (calibration.noise, pMS2B320_NOISETYPE (record + blkt_offset), 8);
-      calibration.next = NULL;
-
-      if (mseh_add_calibration_r (msr, NULL, &calibration, &parsestate))
-      {
-        ms_log (2, "%s: Problem mapping Blockette 320 to extra headers\n", msr->sid);
-        goto error_return;
-      }
-    }
-
-    /* Blockette 390, generic calibration */
-    else if (blkt_type == 390)
-    {
-      memset (&calibration, 0, sizeof (calibration));
-
-      strncpy (calibration.type, "GENERIC", sizeof (calibration.type));
-
-      calibration.begintime =
-          ms_btime2nstime ((uint8_t *)pMS2B390_YEAR (record + blkt_offset), msr->swapflag);
-
-      calibration.endtime = NSTUNSET;
-      calibration.steps = -1;
-      calibration.firstpulsepositive = -1;
-      calibration.alternatesign = -1;
-
-      /* If bit 2 is set, calibration is automatic, otherwise manual */
-      if (*pMS2B390_FLAGS (record + blkt_offset) & 0x04)
-        strncpy (calibration.trigger, "AUTOMATIC", sizeof (calibration.trigger));
-      else
-        strncpy (calibration.trigger, "MANUAL", sizeof (calibration.trigger));
-
-      /* If bit 3 is set, continued from previous record */
-      calibration.continued = -1;
-      if (*pMS2B390_FLAGS (record + blkt_offset) & 0x08)
-        calibration.continued = 1;
-
-      calibration.amplituderange[0] = '\0';
-      calibration.duration =
-          (double)(HO4u (*pMS2B390_DURATION (record + blkt_offset), msr->swapflag) / 10000.0);
-      calibration.amplitude = HO4f (*pMS2B390_AMPLITUDE (record + blkt_offset), msr->swapflag);
-      ms_strncpcleantail (calibration.inputchannel, pMS2B390_INPUTCHANNEL (record + blkt_offset),
-                          3);
-      calibration.refamplitude = 0.0;
-      calibration.sineperiod = 0.0;
-      calibration.stepbetween = 0.0;
-      calibration.inputunits[0] = '\0';
-      calibration.coupling[0] = '\0';
-      calibration.rolloff[0] = '\0';
-      calibration.noise[0] = '\0';
-      calibration.next = NULL;
-
-      if (mseh_add_calibration_r (msr, NULL, &calibration, &parsestate))
-      {
-        ms_log (2, "%s: Problem mapping Blockette 390 to extra headers\n", msr->sid);
-        goto error_return;
-      }
-    }
-
-    /* Blockette 395, calibration abort */
-    else if (blkt_type == 395)
-    {
-      memset (&calibration, 0, sizeof (calibration));
-
-      strncpy (calibration.type, "ABORT", sizeof (calibration.type));
-
-      calibration.begintime = NSTUNSET;
-
-      calibration.endtime =
-          ms_btime2nstime ((uint8_t *)pMS2B395_YEAR (record + blkt_offset), msr->swapflag);
-
-      calibration.steps = -1;
-      calibration.firstpulsepositive = -1;
-      calibration.alternatesign = -1;
-      calibration.trigger[0] = '\0';
-      calibration.continued = -1;
-      calibration.amplituderange[0] = '\0';
-      calibration.duration = 0.0;
-      calibration.amplitude = 0.0;
-      calibration.inputchannel[0] = '\0';
-      calibration.refamplitude = 0.0;
-      calibration.sineperiod = 0.0;
-      calibration.stepbetween = 0.0;
-      calibration.inputunits[0] = '\0';
-      calibration.coupling[0] = '\0';
-      calibration.rolloff[0] = '\0';
-      calibration.noise[0] = '\0';
-      calibration.next = NULL;
-
-      if (mseh_add_calibration_r (msr, NULL, &calibration, &parsestate))
-      {
-        ms_log (2, "%s: Problem mapping Blockette 395 to extra headers\n", msr->sid);
-        goto error_return;
-      }
-    }
-
-    /* Blockette 400, beam blockette */
-    else if (blkt_type == 400)
-    {
-      ms_log (1, "%s: WARNING Blockette 400 is present but discarded\n", msr->sid);
-    }
-
-    /* Blockette 400, beam delay blockette */
-    else if (blkt_type == 405)
-    {
-      ms_log (1, "%s: WARNING Blockette 405 is present but discarded\n", msr->sid);
-    }
-
-    /* Blockette 500, timing blockette */
-    else if (blkt_type == 500)
-    {
-      memset (&exception, 0, sizeof (exception));
-
-      exception.vcocorrection =
-          HO4f (*pMS2B500_VCOCORRECTION (record + blkt_offset), msr->swapflag);
-
-      exception.time =
-          ms_btime2nstime ((uint8_t *)pMS2B500_YEAR (record + blkt_offset), msr->swapflag);
-
-      /* Apply microsecond precision if non-zero, only to a valid decoded time */
-      if (*pMS2B500_MICROSECOND (record + blkt_offset) != 0 && exception.time != NSTUNSET &&
-          exception.time != NSTERROR)
-      {
-        exception.time +=
-            (nstime_t)*pMS2B500_MICROSECOND (record + blkt_offset) * (NSTMODULUS / 1000000);
-      }
-
-      exception.receptionquality = *pMS2B500_RECEPTIONQUALITY (record + blkt_offset);
-      exception.count = HO4u (*pMS2B500_EXCEPTIONCOUNT (record + blkt_offset), msr->swapflag);
-      ms_strncpopen (exception.type, pMS2B500_EXCEPTIONTYPE (record + blkt_offset),
-                     (int)sizeof (exception.type));
-      ms_strncpopen (exception.clockstatus, pMS2B500_CLOCKSTATUS (record + blkt_offset),
-                     (int)sizeof (exception.clockstatus));
-
-      if (mseh_add_timing_exception_r (msr, NULL, &exception, &parsestate))
-      {
-        ms_log (2, "%s: Problem mapping Blockette 500 to extra headers\n", msr->sid);
-        goto error_return;
-      }
-
-      /* Clock model maps to a single value at /FDSN/Clock/Model */
-      ms_strncpcleantail (sval, pMS2B500_CLOCKMODEL (record + blkt_offset), 32);
-      mseh_set_ptr_r (msr, "/FDSN/Clock/Model", sval, 's', &parsestate);
-    }
-
-    else if (blkt_type == 1000)
-    {
-      B1000offset = blkt_offset;
+      B1000offset = blkt_offset;
 
       /* Calculate record length in bytes as 2^(B1000->reclen).  Reject an
        * out-of-range exponent (which would be an undefined shift, and far
@@ -943,33 +1040,6 @@ msr3_unpack_mseed2 (const char *record, int reclen, MS3Record **ppmsr, uint32_t
       msr->encoding = *pMS2B1000_ENCODING (record + blkt_offset);
     }
 
-    else if (blkt_type == 1001)
-    {
-      B1001offset = blkt_offset;
-
-      /* Optimization: if no other extra headers yet, directly print this common value */
-      if (parsestate == NULL && msr->extra == NULL)
-      {
-        length = snprintf (sval, sizeof (sval), "{\"FDSN\":{\"Time\":{\"Quality\":%d}}}",
-                           *pMS2B1001_TIMINGQUALITY (record + blkt_offset));
-
-        if (!(msr->extra = (char *)libmseed_memory.malloc (length + 1)))
-        {
-          ms_log (2, "%s: Cannot allocate memory for extra headers\n", msr->sid);
-          goto error_return;
-        }
-        memcpy (msr->extra, sval, length + 1);
-
-        msr->extralength = length;
-      }
-      /* Otherwise add it to existing headers */
-      else
-      {
-        ival = *pMS2B1001_TIMINGQUALITY (record + blkt_offset);
-        mseh_set_ptr_r (msr, "/FDSN/Time/Quality", &ival, 'i', &parsestate);
-      }
-    }
-
     else if (blkt_type == 2000)
     {
       ms_log (1, "%s: WARNING Blockette 2000 is present but discarded\n", msr->sid);
@@ -1083,6 +1153,10 @@ msr3_unpack_mseed2 (const char *record, int reclen, MS3Record **ppmsr, uint32_t
     msr->swapflag |= MSSWAP_PAYLOAD;
   }
 
+  /* Track deferred extra headers, cleared by msr3_init() otherwise */
+  if (extrapending && lm_extrapending_set (msr, 1))
+    goto error_return;
+
   /* Unpack the data samples if requested */
   if ((flags & MSF_UNPACKDATA) && msr->samplecnt > 0)
   {
@@ -1101,7 +1175,7 @@ msr3_unpack_mseed2 (const char *record, int reclen, MS3Record **ppmsr, uint32_t
   else
   {
     if (msr->datasamples)
-      libmseed_memory.free (msr->datasamples);
+      lm_memory ()->free (msr->datasamples);
 
     msr->datasamples = NULL;
     msr->datasize = 0;
@@ -1242,9 +1316,8 @@ msr3_data_bounds (const MS3Record *msr, uint32_t *dataoffset, uint32_t *datasize
  * text characters, 32-bit integers, 32-bit floats or 64-bit
  * floats in host byte order.
  *
- * An internal buffer is allocated if the encoded data is not aligned
- * for the sample size, which is a decent indicator of the alignment
- * needed for decoding efficiently.
+ * The encoded data is decoded in place, it does not need to be
+ * aligned for the sample size.
  *
  * @param[in] msr Target ::MS3Record to unpack data samples
  * @param[in] verbose Flag to control verbosity, 0 means no diagnostic output
@@ -1256,13 +1329,9 @@ msr3_data_bounds (const MS3Record *msr, uint32_t *dataoffset, uint32_t *datasize
 int64_t
 msr3_unpack_data (MS3Record *msr, int8_t verbose)
 {
-  uint32_t datasize;      /* length of data payload in bytes */
   int64_t nsamples;       /* number of samples unpacked */
   size_t unpacksize;      /* byte size of unpacked samples */
   uint8_t samplesize = 0; /* size of the data samples in bytes */
-  uint32_t dataoffset = 0;
-  const char *encoded = NULL;
-  char *encoded_allocated = NULL;
 
   if (!msr)
   {
@@ -1273,43 +1342,8 @@ msr3_unpack_data (MS3Record *msr, int8_t verbose)
   if (msr->samplecnt <= 0)
     return 0;
 
-  if (!msr->record)
-  {
-    ms_log (2, "%s: Raw record pointer is unset\n", msr->sid);
-    return MS_GENERROR;
-  }
-
-  /* Sanity check record length */
-  if (msr->reclen < 0)
-  {
-    ms_log (2, "%s: Record size unknown\n", msr->sid);
-    return MS_NOTSEED;
-  }
-  else if (msr->reclen < MINRECLEN || msr->reclen > MAXRECLEN)
-  {
-    ms_log (2, "%s: Unsupported record length: %d\n", msr->sid, msr->reclen);
-    return MS_OUTOFRANGE;
-  }
-
-  if (msr->samplecnt > INT32_MAX)
-  {
-    ms_log (2, "%s: Too many samples to unpack: %" PRId64 "\n", msr->sid, msr->samplecnt);
-    return MS_GENERROR;
-  }
-
-  /* Determine offset to data and length of data payload */
-  if (msr3_data_bounds (msr, &dataoffset, &datasize))
-    return MS_GENERROR;
-
-  /* Sanity check data offset before creating a pointer based on the value */
-  if (dataoffset < MINRECLEN || dataoffset >= (uint32_t)msr->reclen)
-  {
-    ms_log (2, "%s: Data offset value is not valid: %u\n", msr->sid, dataoffset);
-    return MS_GENERROR;
-  }
-
   /* Fallback encoding for when encoding is unknown (legacy bare SEED data records) */
-  if (msr->encoding < 0)
+  if (msr->record && msr->encoding < 0)
   {
     if (verbose > 2)
       ms_log (0, "%s: No data encoding (no blockette 1000?), assuming Steim-1\n", msr->sid);
@@ -1317,26 +1351,8 @@ msr3_unpack_data (MS3Record *msr, int8_t verbose)
     msr->encoding = DE_STEIM1;
   }
 
-  if (ms_encoding_sizetype ((uint8_t)msr->encoding, &samplesize, NULL))
-  {
-    ms_log (2, "%s: Cannot determine sample size for encoding: %u\n", msr->sid, msr->encoding);
-    return MS_GENERROR;
-  }
-
-  encoded = msr->record + dataoffset;
-
-  /* Copy encoded data to aligned/malloc'd buffer if not aligned for sample size */
-  if (samplesize && !is_aligned (encoded, samplesize))
-  {
-    if ((encoded_allocated = (char *)libmseed_memory.malloc (datasize)) == NULL)
-    {
-      ms_log (2, "Cannot allocate memory for encoded data\n");
-      return MS_GENERROR;
-    }
-
-    memcpy (encoded_allocated, encoded, datasize);
-    encoded = encoded_allocated;
-  }
+  if ((nsamples = lm_unpack_data_size (msr, &samplesize, NULL)) < 0)
+    return nsamples;
 
   /* Calculate buffer size needed for unpacked samples */
   unpacksize = (size_t)msr->samplecnt * samplesize;
@@ -1346,7 +1362,7 @@ msr3_unpack_data (MS3Record *msr, int8_t verbose)
   {
     void *resized;
 
-    if (libmseed_prealloc_block_size)
+    if (lm_prealloc_block_size ())
     {
       size_t current_size = msr->datasize;
       resized = libmseed_memory_prealloc (msr->datasamples, unpacksize, &current_size);
@@ -1356,7 +1372,7 @@ msr3_unpack_data (MS3Record *msr, int8_t verbose)
     }
     else
     {
-      resized = libmseed_memory.realloc (msr->datasamples, unpacksize);
+      resized = lm_memory ()->realloc (msr->datasamples, unpacksize);
 
       if (resized != NULL)
         msr->datasize = unpacksize;
@@ -1365,8 +1381,6 @@ msr3_unpack_data (MS3Record *msr, int8_t verbose)
     if (resized == NULL)
     {
       ms_log (2, "%s: Cannot (re)allocate memory\n", msr->sid);
-      if (encoded_allocated)
-        libmseed_memory.free (encoded_allocated);
       return MS_GENERROR;
     }
 
@@ -1375,21 +1389,14 @@ msr3_unpack_data (MS3Record *msr, int8_t verbose)
   else
   {
     if (msr->datasamples)
-      libmseed_memory.free (msr->datasamples);
+      lm_memory ()->free (msr->datasamples);
     msr->datasamples = NULL;
     msr->datasize = 0;
     msr->numsamples = 0;
   }
 
-  if (verbose > 2)
-    ms_log (0, "%s: Unpacking %" PRId64 " samples\n", msr->sid, msr->samplecnt);
-
-  nsamples = ms_decode_data (encoded, datasize, (uint8_t)msr->encoding, msr->samplecnt,
-                             msr->datasamples, msr->datasize, &(msr->sampletype),
-                             (msr->swapflag & MSSWAP_PAYLOAD), msr->sid, verbose);
-
-  if (encoded_allocated)
-    libmseed_memory.free (encoded_allocated);
+  nsamples = lm_unpack_data_to (msr, msr->datasamples, msr->datasize, &(msr->sampletype),
+                                verbose);
 
   if (nsamples > 0)
     msr->numsamples = nsamples;
@@ -1397,6 +1404,362 @@ msr3_unpack_data (MS3Record *msr, int8_t verbose)
   return nsamples;
 } /* End of msr3_unpack_data() */
 
+/* Records with deferred extra headers, keyed by the address of the
+ * MS3Record and valid only for the raw record that was parsed.  Striped
+ * by address so that threads parsing their own records rarely share a
+ * lock, the count of each stripe is read without the lock to skip the
+ * common case of no pending records. */
+#define LM_PENDINGSTRIPES 16
+
+typedef struct LMExtraPending
+{
+  const MS3Record *msr;
+  const char *record;
+} LMExtraPending;
+
+typedef struct LMPendingStripe
+{
+  lmp_staticmutex_t lock;
+  uint32_t count;
+  uint32_t size;
+  LMExtraPending *entries;
+} LMPendingStripe;
+
+#define LM_PENDINGSTRIPE_INITIALIZER {LMP_STATICMUTEX_INITIALIZER, 0, 0, NULL}
+
+static LMPendingStripe pendingstripes[LM_PENDINGSTRIPES] = {
+    LM_PENDINGSTRIPE_INITIALIZER, LM_PENDINGSTRIPE_INITIALIZER, LM_PENDINGSTRIPE_INITIALIZER,
+    LM_PENDINGSTRIPE_INITIALIZER, LM_PENDINGSTRIPE_INITIALIZER, LM_PENDINGSTRIPE_INITIALIZER,
+    LM_PENDINGSTRIPE_INITIALIZER, LM_PENDINGSTRIPE_INITIALIZER, LM_PENDINGSTRIPE_INITIALIZER,
+    LM_PENDINGSTRIPE_INITIALIZER, LM_PENDINGSTRIPE_INITIALIZER, LM_PENDINGSTRIPE_INITIALIZER,
+    LM_PENDINGSTRIPE_INITIALIZER, LM_PENDINGSTRIPE_INITIALIZER, LM_PENDINGSTRIPE_INITIALIZER,
+    LM_PENDINGSTRIPE_INITIALIZER};
+
+static LMPendingStripe *
+lm_pendingstripe (const MS3Record *msr)
+{
+  uintptr_t key = (uintptr_t)msr;
+
+  return &pendingstripes[((key >> 4) ^ (key >> 12)) % LM_PENDINGSTRIPES];
+}
+
+/***************************************************************************
+ * Return 1 if mapping extra headers is deferred for a record, otherwise 0.
+ ***************************************************************************/
+int
+lm_extrapending (const MS3Record *msr)
+{
+  LMPendingStripe *stripe = lm_pendingstripe (msr);
+  uint32_t idx;
+  int pending = 0;
+
+  if (lmp_atomic_load32 (&stripe->count) == 0)
+    return 0;
+
+  lmp_staticmutex_lock (&stripe->lock);
+
+  for (idx = 0; idx < stripe->count; idx++)
+  {
+    if (stripe->entries[idx].msr == msr)
+    {
+      pending = (stripe->entries[idx].record == msr->record);
+      break;
+    }
+  }
+
+  lmp_staticmutex_unlock (&stripe->lock);
+
+  return pending;
+} /* End of lm_extrapending() */
+
+/***************************************************************************
+ * Set or clear deferred extra headers for a record, a pending record is
+ * tied to the raw record at MS3Record.record.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+int
+lm_extrapending_set (const MS3Record *msr, int pending)
+{
+  LMPendingStripe *stripe = lm_pendingstripe (msr);
+  LMExtraPending *entries;
+  uint32_t size;
+  uint32_t idx;
+  int retval = 0;
+
+  if (!pending && lmp_atomic_load32 (&stripe->count) == 0)
+    return 0;
+
+  lmp_staticmutex_lock (&stripe->lock);
+
+  for (idx = 0; idx < stripe->count; idx++)
+  {
+    if (stripe->entries[idx].msr == msr)
+      break;
+  }
+
+  if (idx < stripe->count)
+  {
+    if (pending)
+    {
+      stripe->entries[idx].record = msr->record;
+    }
+    else
+    {
+      stripe->entries[idx] = stripe->entries[stripe->count - 1];
+      lmp_atomic_store32 (&stripe->count, stripe->count - 1);
+    }
+  }
+  else if (pending)
+  {
+    if (stripe->count == stripe->size)
+    {
+      size = (stripe->size) ? stripe->size * 2 : 8;
+      entries = (LMExtraPending *)libmseed_memory.realloc (stripe->entries,
+                                                           size * sizeof (LMExtraPending));
+
+      if (entries)
+      {
+        stripe->entries = entries;
+        stripe->size = size;
+      }
+    }
+
+    if (stripe->count < stripe->size)
+    {
+      stripe->entries[stripe->count].msr = msr;
+      stripe->entries[stripe->count].record = msr->record;
+      lmp_atomic_store32 (&stripe->count, stripe->count + 1);
+    }
+    else
+    {
+      ms_log (2, "Cannot allocate memory\n");
+      retval = -1;
+    }
+  }
+
+  lmp_staticmutex_unlock (&stripe->lock);
+
+  return retval;
+} /* End of lm_extrapending_set() */
+
+/** ************************************************************************
+ * @brief Map deferred miniSEED 2 blockettes to extra headers
+ *
+ * When a miniSEED 2 record is parsed with ::MSF_DEFEREXTRA the fixed
+ * header flags and blockettes that map to extra headers are not
+ * converted to JSON, which is relatively expensive.  Instead
+ * they are marked as pending internally and ::MS3Record.extra is left
+ * unpopulated.  This routine performs the deferred conversion using
+ * the record at ::MS3Record.record, which must still be available.
+ *
+ * The library routines that use extra headers, such as the mseh_*
+ * family, msr3_print(), msr3_duplicate() and the packing routines,
+ * call this routine as needed.  Callers that access ::MS3Record.extra
+ * directly must call it first.
+ *
+ * Records without pending extra headers are not modified.
+ *
+ * @param[in] msr ::MS3Record with deferred extra headers
+ * @param[in] verbose Flag to control verbosity, 0 means no diagnostic output
+ *
+ * @return length of extra headers on success or negative libmseed error code.
+ *
+ * @ref MessageOnError - this function logs a message on error
+ ***************************************************************************/
+int
+msr3_unpack_extra (MS3Record *msr, int8_t verbose)
+{
+  LM_PARSED_JSON *parsestate = NULL;
+  const char *record;
+  int8_t swapflag;
+  int blkt_offset;
+  int blkt_length;
+  uint16_t blkt_type;
+  uint16_t next_blkt;
+
+  if (!msr)
+  {
+    ms_log (2, "%s(): Required input not defined: 'msr'\n", __func__);
+    return MS_GENERROR;
+  }
+
+  if (!lm_extrapending (msr))
+    return msr->extralength;
+
+  if (!msr->record || msr->formatversion != 2)
+  {
+    ms_log (2, "%s: Raw miniSEED 2 record is not available for extra headers\n", msr->sid);
+    return MS_GENERROR;
+  }
+
+  if (verbose > 2)
+    ms_log (0, "%s: Mapping deferred blockettes to extra headers\n", msr->sid);
+
+  /* Clear first, the mseh_* routines used for mapping check this flag */
+  lm_extrapending_set (msr, 0);
+
+  record = msr->record;
+  swapflag = (msr->swapflag & MSSWAP_HEADER) ? 1 : 0;
+
+  ms2_fsdh_extra (msr, record, swapflag, &parsestate);
+
+  /* Traverse the blockette chain, already validated when parsed */
+  blkt_offset = HO2u (*pMS2FSDH_BLOCKETTEOFFSET (record), swapflag);
+
+  while (blkt_offset >= MS2FSDH_LENGTH && (blkt_offset + 4) <= msr->reclen)
+  {
+    memcpy (&blkt_type, record + blkt_offset, 2);
+    memcpy (&next_blkt, record + blkt_offset + 2, 2);
+
+    if (swapflag)
+    {
+      ms_gswap2 (&blkt_type);
+      ms_gswap2 (&next_blkt);
+    }
+
+    if (blkt_type == 2000 && (blkt_offset + 6) > msr->reclen)
+      break;
+
+    blkt_length = ms2_blktlen (blkt_type, record + blkt_offset, swapflag);
+
+    /* Skip unknown blockettes as the parser does */
+    if (blkt_length == 0)
+    {
+      if (next_blkt > blkt_offset)
+      {
+        blkt_offset = next_blkt;
+        continue;
+      }
+
+      break;
+    }
+
+    if ((blkt_offset + blkt_length) > msr->reclen)
+      break;
+
+    if (ms2_blkt_hasextra (blkt_type) &&
+        ms2_blkt_extra (msr, record, blkt_offset, blkt_type, swapflag, &parsestate))
+    {
+      if (parsestate)
+        mseh_free_parsestate (&parsestate);
+      return MS_GENERROR;
+    }
+
+    if (next_blkt && next_blkt < (blkt_offset + blkt_length))
+      break;
+
+    blkt_offset = next_blkt;
+  }
+
+  /* Serialize extra header JSON structure and free parsed state */
+  if (parsestate)
+  {
+    mseh_serialize (msr, &parsestate);
+    mseh_free_parsestate (&parsestate);
+  }
+
+  return msr->extralength;
+} /* End of msr3_unpack_extra() */
+
+/***************************************************************************
+ * Validate the data payload of a record and determine the decoded sample
+ * size and type without decoding.
+ *
+ * Returns 0 on success and a negative libmseed error code on error.
+ ***************************************************************************/
+int64_t
+lm_unpack_data_size (const MS3Record *msr, uint8_t *samplesize, char *sampletype)
+{
+  uint8_t encoding;
+
+  if (!msr->record)
+  {
+    ms_log (2, "%s: Raw record pointer is unset\n", msr->sid);
+    return MS_GENERROR;
+  }
+
+  /* Sanity check record length */
+  if (msr->reclen < 0)
+  {
+    ms_log (2, "%s: Record size unknown\n", msr->sid);
+    return MS_NOTSEED;
+  }
+  else if (msr->reclen < MINRECLEN || msr->reclen > MAXRECLEN)
+  {
+    ms_log (2, "%s: Unsupported record length: %d\n", msr->sid, msr->reclen);
+    return MS_OUTOFRANGE;
+  }
+
+  if (msr->samplecnt > INT32_MAX)
+  {
+    ms_log (2, "%s: Too many samples to unpack: %" PRId64 "\n", msr->sid, msr->samplecnt);
+    return MS_GENERROR;
+  }
+
+  /* Fallback encoding for when encoding is unknown (legacy bare SEED data records) */
+  encoding = (msr->encoding < 0) ? DE_STEIM1 : (uint8_t)msr->encoding;
+
+  if (ms_encoding_sizetype (encoding, samplesize, sampletype))
+  {
+    ms_log (2, "%s: Cannot determine sample size for encoding: %u\n", msr->sid, encoding);
+    return MS_GENERROR;
+  }
+
+  return 0;
+} /* End of lm_unpack_data_size() */
+
+/***************************************************************************
+ * Decode the data samples of a record to a supplied buffer.
+ *
+ * The record at ::MS3Record.record must be available.  Unlike
+ * msr3_unpack_data() the record is not modified, decoded samples are
+ * placed in @p output, which must be large enough for
+ * ::MS3Record.samplecnt samples, and the sample type is returned via
+ * @p sampletype.
+ *
+ * Returns number of samples decoded or negative libmseed error code.
+ ***************************************************************************/
+int64_t
+lm_unpack_data_to (const MS3Record *msr, void *output, uint64_t outputsize, char *sampletype,
+                   int8_t verbose)
+{
+  uint32_t datasize;      /* length of data payload in bytes */
+  int64_t nsamples;       /* number of samples unpacked */
+  uint8_t samplesize = 0; /* size of the data samples in bytes */
+  uint32_t dataoffset = 0;
+  const char *encoded = NULL;
+
+  if (msr->samplecnt <= 0)
+    return 0;
+
+  if ((nsamples = lm_unpack_data_size (msr, &samplesize, NULL)) < 0)
+    return nsamples;
+
+  /* Determine offset to data and length of data payload */
+  if (msr3_data_bounds (msr, &dataoffset, &datasize))
+    return MS_GENERROR;
+
+  /* Sanity check data offset before creating a pointer based on the value */
+  if (dataoffset < MINRECLEN || dataoffset >= (uint32_t)msr->reclen)
+  {
+    ms_log (2, "%s: Data offset value is not valid: %u\n", msr->sid, dataoffset);
+    return MS_GENERROR;
+  }
+
+  encoded = msr->record + dataoffset;
+
+  if (verbose > 2)
+    ms_log (0, "%s: Unpacking %" PRId64 " samples\n", msr->sid, msr->samplecnt);
+
+  nsamples = ms_decode_data (encoded, datasize,
+                             (msr->encoding < 0) ? DE_STEIM1 : (uint8_t)msr->encoding,
+                             msr->samplecnt, output, outputsize, sampletype,
+                             (msr->swapflag & MSSWAP_PAYLOAD), msr->sid, verbose);
+
+  return nsamples;
+} /* End of lm_unpack_data_to() */
+
 /** ************************************************************************
  * @brief Decode data samples to a supplied buffer
  *
@@ -1516,7 +1879,7 @@ ms_decode_data (const void *input, uint64_t inputsize, uint8_t encoding, uint64_
       ms_log (0, "%s: Decoding INT16 data samples\n", (sid) ? sid : "");
 
     nsamples =
-        msr_decode_int16 ((int16_t *)input, samplecount, (int32_t *)output, decodedsize, swapflag);
+        msr_decode_int16 (input, samplecount, (int32_t *)output, decodedsize, swapflag);
     break;
 
   case DE_INT32:
@@ -1524,7 +1887,7 @@ ms_decode_data (const void *input, uint64_t inputsize, uint8_t encoding, uint64_
       ms_log (0, "%s: Decoding INT32 data samples\n", (sid) ? sid : "");
 
     nsamples =
-        msr_decode_int32 ((int32_t *)input, samplecount, (int32_t *)output, decodedsize, swapflag);
+        msr_decode_int32 (input, samplecount, (int32_t *)output, decodedsize, swapflag);
     break;
 
   case DE_FLOAT32:
@@ -1532,7 +1895,7 @@ ms_decode_data (const void *input, uint64_t inputsize, uint8_t encoding, uint64_
       ms_log (0, "%s: Decoding FLOAT32 data samples\n", (sid) ? sid : "");
 
     nsamples =
-        msr_decode_float32 ((float *)input, samplecount, (float *)output, decodedsize, swapflag);
+        msr_decode_float32 (input, samplecount, (float *)output, decodedsize, swapflag);
     break;
 
   case DE_FLOAT64:
@@ -1540,14 +1903,14 @@ ms_decode_data (const void *input, uint64_t inputsize, uint8_t encoding, uint64_
       ms_log (0, "%s: Decoding FLOAT64 data samples\n", (sid) ? sid : "");
 
     nsamples =
-        msr_decode_float64 ((double *)input, samplecount, (double *)output, decodedsize, swapflag);
+        msr_decode_float64 (input, samplecount, (double *)output, decodedsize, swapflag);
     break;
 
   case DE_STEIM1:
     if (verbose > 1)
       ms_log (0, "%s: Decoding Steim1 data frames\n", (sid) ? sid : "");
 
-    nsamples = msr_decode_steim1 ((int32_t *)input, inputsize, samplecount, (int32_t *)output,
+    nsamples = msr_decode_steim1 (input, inputsize, samplecount, (int32_t *)output,
                                   decodedsize, (sid) ? sid : "", swapflag);
 
     if (nsamples < 0)
@@ -1562,7 +1925,7 @@ ms_decode_data (const void *input, uint64_t inputsize, uint8_t encoding, uint64_
     if (verbose > 1)
       ms_log (0, "%s: Decoding Steim2 data frames\n", (sid) ? sid : "");
 
-    nsamples = msr_decode_steim2 ((int32_t *)input, inputsize, samplecount, (int32_t *)output,
+    nsamples = msr_decode_steim2 (input, inputsize, samplecount, (int32_t *)output,
                                   decodedsize, (sid) ? sid : "", swapflag);
 
     if (nsamples < 0)
@@ -1588,7 +1951,7 @@ ms_decode_data (const void *input, uint64_t inputsize, uint8_t encoding, uint64_
                 (sid) ? sid : "");
     }
 
-    nsamples = msr_decode_geoscope ((char *)input, samplecount, (float *)output, decodedsize,
+    nsamples = msr_decode_geoscope ((const char *)input, samplecount, (float *)output, decodedsize,
                                     encoding, (sid) ? sid : "", swapflag);
     break;
 
@@ -1597,14 +1960,14 @@ ms_decode_data (const void *input, uint64_t inputsize, uint8_t encoding, uint64_
       ms_log (0, "%s: Decoding CDSN encoded data samples\n", (sid) ? sid : "");
 
     nsamples =
-        msr_decode_cdsn ((int16_t *)input, samplecount, (int32_t *)output, decodedsize, swapflag);
+        msr_decode_cdsn (input, samplecount, (int32_t *)output, decodedsize, swapflag);
     break;
 
   case DE_SRO:
     if (verbose > 1)
       ms_log (0, "%s: Decoding SRO encoded data samples\n", (sid) ? sid : "");
 
-    nsamples = msr_decode_sro ((int16_t *)input, samplecount, (int32_t *)output, decodedsize,
+    nsamples = msr_decode_sro (input, samplecount, (int32_t *)output, decodedsize,
                                (sid) ? sid : "", swapflag);
     break;
 
@@ -1613,7 +1976,7 @@ ms_decode_data (const void *input, uint64_t inputsize, uint8_t encoding, uint64_
       ms_log (0, "%s: Decoding DWWSSN encoded data samples\n", (sid) ? sid : "");
 
     nsamples =
-        msr_decode_dwwssn ((int16_t *)input, samplecount, (int32_t *)output, decodedsize, swapflag);
+        msr_decode_dwwssn (input, samplecount, (int32_t *)output, decodedsize, swapflag);
     break;
 
   default:
@@ -32,6 +32,10 @@ extern int64_t msr3_unpack_mseed3 (const char *record, int reclen, MS3Record **p
 extern int64_t msr3_unpack_mseed2 (const char *record, int reclen, MS3Record **ppmsr,
                                    uint32_t flags, int8_t verbose);
 
+extern int64_t lm_unpack_data_size (const MS3Record *msr, uint8_t *samplesize, char *sampletype);
+extern int64_t lm_unpack_data_to (const MS3Record *msr, void *output, uint64_t outputsize,
+                                 char *sampletype, int8_t verbose);
+
 extern double ms_nomsamprate (int factor, int multiplier);
 extern char *ms2_recordsid (const char *record, char *sid, int sidlen);
 extern const char *ms2_blktdesc (uint16_t blkttype);
@@ -35,6 +35,12 @@
 #define MAX16 0x7FFFul   /* maximum 16 bit positive # */
 #define MAX24 0x7FFFFFul /* maximum 24 bit positive # */
 
+/* Encoded input is only read via memcpy(), never dereferenced as a
+ * typed pointer, so it need not be aligned for the sample size.  This
+ * is common with miniSEED 3 records where the identifier and extra
+ * headers have arbitrary lengths.  Compilers reduce such copies to
+ * single (unaligned) loads on platforms that support them. */
+
 /************************************************************************
  * msr_decode_int16:
  *
@@ -44,9 +50,10 @@
  * Return number of samples in output buffer on success, -1 on error.
  ************************************************************************/
 int64_t
-msr_decode_int16 (int16_t *input, uint64_t samplecount, int32_t *output, uint64_t outputlength,
+msr_decode_int16 (const void *input, uint64_t samplecount, int32_t *output, uint64_t outputlength,
                   int swapflag)
 {
+  const uint8_t *encoded = (const uint8_t *)input;
   int16_t sample;
   uint64_t idx;
 
@@ -58,7 +65,7 @@ msr_decode_int16 (int16_t *input, uint64_t samplecount, int32_t *output, uint64_
 
   for (idx = 0; idx < samplecount && outputlength >= sizeof (int32_t); idx++)
   {
-    sample = input[idx];
+    memcpy (&sample, encoded + idx * sizeof (int16_t), sizeof (int16_t));
 
     if (swapflag)
       ms_gswap2 (&sample);
@@ -80,9 +87,10 @@ msr_decode_int16 (int16_t *input, uint64_t samplecount, int32_t *output, uint64_
  * Return number of samples in output buffer on success, -1 on error.
  ************************************************************************/
 int64_t
-msr_decode_int32 (int32_t *input, uint64_t samplecount, int32_t *output, uint64_t outputlength,
+msr_decode_int32 (const void *input, uint64_t samplecount, int32_t *output, uint64_t outputlength,
                   int swapflag)
 {
+  const uint8_t *encoded = (const uint8_t *)input;
   int32_t sample;
   uint64_t idx;
 
@@ -94,7 +102,7 @@ msr_decode_int32 (int32_t *input, uint64_t samplecount, int32_t *output, uint64_
 
   for (idx = 0; idx < samplecount && outputlength >= sizeof (int32_t); idx++)
   {
-    sample = input[idx];
+    memcpy (&sample, encoded + idx * sizeof (int32_t), sizeof (int32_t));
 
     if (swapflag)
       ms_gswap4 (&sample);
@@ -116,9 +124,10 @@ msr_decode_int32 (int32_t *input, uint64_t samplecount, int32_t *output, uint64_
  * Return number of samples in output buffer on success, -1 on error.
  ************************************************************************/
 int64_t
-msr_decode_float32 (float *input, uint64_t samplecount, float *output, uint64_t outputlength,
+msr_decode_float32 (const void *input, uint64_t samplecount, float *output, uint64_t outputlength,
                     int swapflag)
 {
+  const uint8_t *encoded = (const uint8_t *)input;
   float sample;
   uint64_t idx;
 
@@ -130,7 +139,7 @@ msr_decode_float32 (float *input, uint64_t samplecount, float *output, uint64_t
 
   for (idx = 0; idx < samplecount && outputlength >= sizeof (float); idx++)
   {
-    memcpy (&sample, &input[idx], sizeof (float));
+    memcpy (&sample, encoded + idx * sizeof (float), sizeof (float));
 
     if (swapflag)
       ms_gswap4 (&sample);
@@ -152,9 +161,10 @@ msr_decode_float32 (float *input, uint64_t samplecount, float *output, uint64_t
  * Return number of samples in output buffer on success, -1 on error.
  ************************************************************************/
 int64_t
-msr_decode_float64 (double *input, uint64_t samplecount, double *output, uint64_t outputlength,
+msr_decode_float64 (const void *input, uint64_t samplecount, double *output, uint64_t outputlength,
                     int swapflag)
 {
+  const uint8_t *encoded = (const uint8_t *)input;
   double sample;
   uint64_t idx;
 
@@ -166,7 +176,7 @@ msr_decode_float64 (double *input, uint64_t samplecount, double *output, uint64_
 
   for (idx = 0; idx < samplecount && outputlength >= sizeof (double); idx++)
   {
-    memcpy (&sample, &input[idx], sizeof (double));
+    memcpy (&sample, encoded + idx * sizeof (double), sizeof (double));
 
     if (swapflag)
       ms_gswap8 (&sample);
@@ -188,7 +198,7 @@ msr_decode_float64 (double *input, uint64_t samplecount, double *output, uint64_
  * Return number of samples in output buffer on success, -1 on error.
  ************************************************************************/
 int64_t
-msr_decode_steim1 (int32_t *input, uint64_t inputlength, uint64_t samplecount, int32_t *output,
+msr_decode_steim1 (const void *input, uint64_t inputlength, uint64_t samplecount, int32_t *output,
                    uint64_t outputlength, const char *srcname, int swapflag)
 {
   uint32_t frame[16]; /* Frame, 16 x 32-bit quantities = 64 bytes */
@@ -231,7 +241,7 @@ msr_decode_steim1 (int32_t *input, uint64_t inputlength, uint64_t samplecount, i
   for (frameidx = 0, outputidx = 0; frameidx < maxframes && outputidx < samplecount; frameidx++)
   {
     /* Copy frame, each is 16x32-bit quantities = 64 bytes */
-    memcpy (frame, input + (16 * frameidx), 64);
+    memcpy (frame, (const uint8_t *)input + (64 * frameidx), 64);
     diffidx = 0;
 
     /* Save forward integration constant (X0) and reverse integration constant (Xn)
@@ -354,7 +364,7 @@ msr_decode_steim1 (int32_t *input, uint64_t inputlength, uint64_t samplecount, i
  * Return number of samples in output buffer on success, -1 on error.
  ************************************************************************/
 int64_t
-msr_decode_steim2 (int32_t *input, uint64_t inputlength, uint64_t samplecount, int32_t *output,
+msr_decode_steim2 (const void *input, uint64_t inputlength, uint64_t samplecount, int32_t *output,
                    uint64_t outputlength, const char *srcname, int swapflag)
 {
   uint32_t frame[16]; /* Frame, 16 x 32-bit quantities = 64 bytes */
@@ -423,7 +433,7 @@ msr_decode_steim2 (int32_t *input, uint64_t inputlength, uint64_t samplecount, i
   for (frameidx = 0, outputidx = 0; frameidx < maxframes && outputidx < samplecount; frameidx++)
   {
     /* Copy frame, each is 16x32-bit quantities = 64 bytes */
-    memcpy (frame, input + (16 * frameidx), 64);
+    memcpy (frame, (const uint8_t *)input + (64 * frameidx), 64);
     diffidx = 0;
 
     /* Save forward integration constant (X0) and reverse integration constant (Xn)
@@ -625,7 +635,7 @@ msr_decode_steim2 (int32_t *input, uint64_t inputlength, uint64_t samplecount, i
  * @ref MessageOnError - this function logs a message on error
  ************************************************************************/
 int64_t
-msr_decode_geoscope (char *input, uint64_t samplecount, float *output, uint64_t outputlength,
+msr_decode_geoscope (const char *input, uint64_t samplecount, float *output, uint64_t outputlength,
                      int encoding, const char *srcname, int swapflag)
 {
   uint64_t idx = 0;
@@ -770,7 +780,7 @@ msr_decode_geoscope (char *input, uint64_t samplecount, float *output, uint64_t
  * Return number of samples in output buffer on success, -1 on error.
  ************************************************************************/
 int64_t
-msr_decode_cdsn (int16_t *input, uint64_t samplecount, int32_t *output, uint64_t outputlength,
+msr_decode_cdsn (const void *input, uint64_t samplecount, int32_t *output, uint64_t outputlength,
                  int swapflag)
 {
   uint64_t idx = 0;
@@ -788,7 +798,7 @@ msr_decode_cdsn (int16_t *input, uint64_t samplecount, int32_t *output, uint64_t
 
   for (idx = 0; idx < samplecount && outputlength >= sizeof (int32_t); idx++)
   {
-    memcpy (&sint, &input[idx], sizeof (int16_t));
+    memcpy (&sint, (const uint8_t *)input + idx * sizeof (uint16_t), sizeof (uint16_t));
     if (swapflag)
       ms_gswap2 (&sint);
 
@@ -859,7 +869,7 @@ msr_decode_cdsn (int16_t *input, uint64_t samplecount, int32_t *output, uint64_t
  * Return number of samples in output buffer on success, -1 on error.
  ************************************************************************/
 int64_t
-msr_decode_sro (int16_t *input, uint64_t samplecount, int32_t *output, uint64_t outputlength,
+msr_decode_sro (const void *input, uint64_t samplecount, int32_t *output, uint64_t outputlength,
                 const char *srcname, int swapflag)
 {
   uint64_t idx = 0;
@@ -884,7 +894,7 @@ msr_decode_sro (int16_t *input, uint64_t samplecount, int32_t *output, uint64_t
 
   for (idx = 0; idx < samplecount && outputlength >= sizeof (int32_t); idx++)
   {
-    memcpy (&sint, &input[idx], sizeof (int16_t));
+    memcpy (&sint, (const uint8_t *)input + idx * sizeof (uint16_t), sizeof (uint16_t));
     if (swapflag)
       ms_gswap2 (&sint);
 
@@ -927,7 +937,7 @@ msr_decode_sro (int16_t *input, uint64_t samplecount, int32_t *output, uint64_t
  * Return number of samples in output buffer on success, -1 on error.
  ************************************************************************/
 int64_t
-msr_decode_dwwssn (int16_t *input, uint64_t samplecount, int32_t *output, uint64_t outputlength,
+msr_decode_dwwssn (const void *input, uint64_t samplecount, int32_t *output, uint64_t outputlength,
                    int swapflag)
 {
   uint64_t idx = 0;
@@ -942,7 +952,7 @@ msr_decode_dwwssn (int16_t *input, uint64_t samplecount, int32_t *output, uint64
 
   for (idx = 0; idx < samplecount && outputlength >= sizeof (int32_t); idx++)
   {
-    memcpy (&sint, &input[idx], sizeof (uint16_t));
+    memcpy (&sint, (const uint8_t *)input + idx * sizeof (uint16_t), sizeof (uint16_t));
     if (swapflag)
       ms_gswap2 (&sint);
     sample = (int32_t)sint;
@@ -0,0 +1,651 @@
+/***************************************************************************
+ * Buffered writing of miniSEED records to files.
+ *
+ * A writer keeps an output file open and collects records in a large
+ * buffer that is written with a single system call when full, instead
+ * of a call per record.  A record that does not fit in the buffer is
+ * written together with the buffer contents using a gather write.
+ *
+ * This file is part of the miniSEED Library.
+ *
+ * Copyright (c) 2026 Chad Trabant, EarthScope Data Services
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+/* Define _GNU_SOURCE to get fallocate() on Linux */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE 1
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "internalstate.h"
+#include "mseedformat.h"
+
+#if !defined(LMP_WIN)
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#if defined(LMP_WIN)
+#define lm_open _open
+#define lm_write _write
+#define lm_close _close
+#define lm_lseek _lseeki64
+#define LM_WRITEFLAGS (_O_WRONLY | _O_CREAT | _O_BINARY)
+#define LM_TRUNCFLAG _O_TRUNC
+#define LM_APPENDFLAG _O_APPEND
+#define LM_CREATEMODE (_S_IREAD | _S_IWRITE)
+#else
+#define lm_open open
+#define lm_write write
+#define lm_close close
+#define lm_lseek lseek
+#define LM_WRITEFLAGS (O_WRONLY | O_CREAT | O_CLOEXEC)
+#define LM_TRUNCFLAG O_TRUNC
+#define LM_APPENDFLAG O_APPEND
+#define LM_CREATEMODE 0666
+#endif
+
+/* Size of the buffer collecting records */
+#define LM_WRITER_BUFSIZE 1048576
+
+struct MS3Writer
+{
+  char *path;           /* Path of the output, for messages */
+  int fd;               /* Descriptor of the output */
+  int ownfd;            /* Descriptor was opened by the writer */
+  int append;           /* File was opened for appending */
+  char *buffer;         /* Records not yet written */
+  size_t bufsize;       /* Size of buffer */
+  size_t length;        /* Length of records in buffer */
+  int64_t position;     /* Offset in the file of the start of the buffer, -1 if unknown */
+  int64_t preallocated; /* End of space preallocated in the file, 0 if none */
+  int error;            /* A write has failed */
+};
+
+/* Write two blocks of data in order, either of which may be empty,
+ * retrying partial writes.  Returns 0 on success and -1 on error. */
+static int
+writer_writeall (MS3Writer *writer, const char *first, size_t firstlen, const char *second,
+                 size_t secondlen)
+{
+#if !defined(LMP_WIN)
+  struct iovec iov[2];
+  int iovcnt = 0;
+  ssize_t rv;
+
+  if (firstlen > 0)
+  {
+    iov[iovcnt].iov_base = (void *)first;
+    iov[iovcnt].iov_len = firstlen;
+    iovcnt++;
+  }
+  if (secondlen > 0)
+  {
+    iov[iovcnt].iov_base = (void *)second;
+    iov[iovcnt].iov_len = secondlen;
+    iovcnt++;
+  }
+
+  while (iovcnt > 0)
+  {
+    if ((rv = writev (writer->fd, iov, iovcnt)) < 0)
+    {
+      if (errno == EINTR)
+        continue;
+
+      ms_log (2, "Error writing to output file %s: %s\n", writer->path, strerror (errno));
+      return -1;
+    }
+
+    if (writer->position >= 0)
+      writer->position += rv;
+
+    /* Advance past the data written */
+    while (iovcnt > 0 && (size_t)rv >= iov[0].iov_len)
+    {
+      rv -= (ssize_t)iov[0].iov_len;
+      iov[0] = iov[1];
+      iovcnt--;
+    }
+
+    if (iovcnt > 0)
+    {
+      iov[0].iov_base = (char *)iov[0].iov_base + rv;
+      iov[0].iov_len -= (size_t)rv;
+    }
+  }
+#else
+  const char *data[2] = {first, second};
+  size_t datalen[2] = {firstlen, secondlen};
+  int rv;
+  int idx;
+
+  for (idx = 0; idx < 2; idx++)
+  {
+    while (datalen[idx] > 0)
+    {
+      rv = lm_write (writer->fd, data[idx],
+                     (unsigned int)((datalen[idx] > INT_MAX) ? INT_MAX : datalen[idx]));
+
+      if (rv < 0)
+      {
+        ms_log (2, "Error writing to output file %s: %s\n", writer->path, strerror (errno));
+        return -1;
+      }
+
+      if (writer->position >= 0)
+        writer->position += rv;
+
+      data[idx] += rv;
+      datalen[idx] -= (size_t)rv;
+    }
+  }
+#endif
+
+  return 0;
+} /* End of writer_writeall() */
+
+/***************************************************************************
+ * Open a file for writing with a buffered writer collecting up to
+ * bufsize bytes of records, at most LM_WRITER_BUFSIZE.  Writers used
+ * for a single call, e.g. by msr3_writemseed(), size the buffer to the
+ * records expected instead of allocating the full buffer.
+ *
+ * See ms3_writer_open() for details.
+ *
+ * Returns a new MS3Writer on success and NULL on error.
+ *
+ * @ref MessageOnError - this function logs a message on error
+ ***************************************************************************/
+MS3Writer *
+lm_writer_open (const char *mspath, int8_t overwrite, size_t bufsize)
+{
+  MS3Writer *writer;
+
+  if (!mspath)
+  {
+    ms_log (2, "%s(): Required input not defined: 'mspath'\n", __func__);
+    return NULL;
+  }
+
+  if (!(writer = (MS3Writer *)lm_memory ()->malloc (sizeof (MS3Writer))))
+  {
+    ms_log (2, "Cannot allocate memory for writer\n");
+    return NULL;
+  }
+
+  memset (writer, 0, sizeof (MS3Writer));
+  writer->fd = -1;
+  writer->bufsize = (bufsize > LM_WRITER_BUFSIZE) ? LM_WRITER_BUFSIZE : bufsize;
+
+  if (!(writer->path = (char *)lm_memory ()->malloc (strlen (mspath) + 1)) ||
+      !(writer->buffer = (char *)lm_memory ()->malloc (writer->bufsize)))
+  {
+    ms_log (2, "Cannot allocate memory for writer\n");
+    lm_memory ()->free (writer->path);
+    lm_memory ()->free (writer);
+    return NULL;
+  }
+
+  strcpy (writer->path, mspath);
+
+  /* Write to stdout, after any output already buffered by stdio */
+  if (strcmp (mspath, "-") == 0)
+  {
+    fflush (stdout);
+    writer->fd = fileno (stdout);
+    writer->position = -1;
+  }
+  else
+  {
+    writer->fd = lm_open (mspath, LM_WRITEFLAGS | ((overwrite) ? LM_TRUNCFLAG : LM_APPENDFLAG),
+                          LM_CREATEMODE);
+
+    if (writer->fd < 0)
+    {
+      ms_log (2, "Cannot open output file %s: %s\n", mspath, strerror (errno));
+      lm_memory ()->free (writer->buffer);
+      lm_memory ()->free (writer->path);
+      lm_memory ()->free (writer);
+      return NULL;
+    }
+
+    writer->ownfd = 1;
+    writer->append = (overwrite) ? 0 : 1;
+    writer->position = (int64_t)lm_lseek (writer->fd, 0, SEEK_END);
+  }
+
+  return writer;
+} /* End of lm_writer_open() */
+
+/** ************************************************************************
+ * @brief Open a file for writing miniSEED records with a buffered writer
+ *
+ * The returned ::MS3Writer keeps the file open and collects records
+ * written with ms3_writer_write(), or by using ms3_writer_handler() as
+ * the record handler of msr3_pack() or mstl3_pack(), in a large buffer
+ * that is written to the file when full.  Writing many records, or
+ * calling msr3_writemseed_w() or mstl3_writemseed_w() many times,
+ * thereby avoids a system call per record and opening the file for
+ * each call.
+ *
+ * The @p overwrite flag controls whether a existing file is
+ * overwritten or not.  If true (non-zero) any existing file will be
+ * replaced.  If false (zero) new records will be appended to an
+ * existing file.  In either case, new files will be created if they
+ * do not yet exist.  If @p mspath is "-" records are written to
+ * standard output.
+ *
+ * The writer must be closed with ms3_writer_close() to write the
+ * buffered records.
+ *
+ * @param[in] mspath File for output records
+ * @param[in] overwrite Flag to control overwriting versus appending
+ *
+ * @returns a new ::MS3Writer on success and NULL on error.
+ *
+ * @ref MessageOnError - this function logs a message on error
+ ***************************************************************************/
+MS3Writer *
+ms3_writer_open (const char *mspath, int8_t overwrite)
+{
+  return lm_writer_open (mspath, overwrite, LM_WRITER_BUFSIZE);
+} /* End of ms3_writer_open() */
+
+/** ************************************************************************
+ * @brief Preallocate space in the file of a writer
+ *
+ * Advise the file system that @p size bytes will be written after the
+ * current end of the file, so that the space can be allocated in large
+ * contiguous extents.  The size of the file is not changed, and space
+ * not written is released when the writer is closed.
+ *
+ * Preallocation is only supported on Linux and for regular files, it
+ * is otherwise ignored.  It is also ignored for files opened for
+ * appending, as other processes may append to the file and unwritten
+ * space could not be released without the risk of removing their data.
+ *
+ * @param[in] writer ::MS3Writer of the file
+ * @param[in] size Number of bytes expected to be written
+ *
+ * @returns 0 on success, including when preallocation is not supported,
+ * and -1 on error.
+ *
+ * @ref MessageOnError - this function logs a message on error
+ ***************************************************************************/
+int
+ms3_writer_preallocate (MS3Writer *writer, int64_t size)
+{
+  if (!writer || size < 0)
+  {
+    ms_log (2, "%s(): Required input not defined or invalid size\n", __func__);
+    return -1;
+  }
+
+#if defined(__linux__) && defined(FALLOC_FL_KEEP_SIZE)
+  int64_t offset;
+
+  if (!writer->ownfd || writer->append || writer->position < 0 || size == 0)
+    return 0;
+
+  offset = writer->position + (int64_t)writer->length;
+
+  if (fallocate (writer->fd, FALLOC_FL_KEEP_SIZE, (off_t)offset, (off_t)size) == 0)
+  {
+    if (offset + size > writer->preallocated)
+      writer->preallocated = offset + size;
+  }
+#endif
+
+  return 0;
+} /* End of ms3_writer_preallocate() */
+
+/** ************************************************************************
+ * @brief Write a miniSEED record with a writer
+ *
+ * The record is copied to the buffer of the writer, which is written
+ * to the file when full.  A record larger than the space remaining in
+ * the buffer is written directly, together with the buffered records.
+ *
+ * @param[in] writer ::MS3Writer of the file
+ * @param[in] record Record to write
+ * @param[in] reclen Length of the record
+ *
+ * @returns 0 on success and -1 on error, after which all writes fail.
+ *
+ * @ref MessageOnError - this function logs a message on error
+ ***************************************************************************/
+int
+ms3_writer_write (MS3Writer *writer, const char *record, int reclen)
+{
+  if (!writer || !record || reclen < 0)
+  {
+    ms_log (2, "%s(): Required input not defined: 'writer' or 'record'\n", __func__);
+    return -1;
+  }
+
+  if (writer->error)
+    return -1;
+
+  if ((size_t)reclen <= writer->bufsize - writer->length)
+  {
+    memcpy (writer->buffer + writer->length, record, (size_t)reclen);
+    writer->length += (size_t)reclen;
+
+    if (writer->length == writer->bufsize)
+      return ms3_writer_flush (writer);
+
+    return 0;
+  }
+
+  if (writer_writeall (writer, writer->buffer, writer->length, record, (size_t)reclen))
+  {
+    writer->error = 1;
+    return -1;
+  }
+
+  writer->length = 0;
+
+  return 0;
+} /* End of ms3_writer_write() */
+
+/** ************************************************************************
+ * @brief Record handler writing records with a writer
+ *
+ * A record handler for msr3_pack(), mstl3_pack() and other packing
+ * routines, where the handler data is an ::MS3Writer.  A failure to
+ * write is reported by ms3_writer_flush() and ms3_writer_close().
+ *
+ * @param[in] record Record to write
+ * @param[in] reclen Length of the record
+ * @param[in] writer ::MS3Writer of the file
+ ***************************************************************************/
+void
+ms3_writer_handler (char *record, int reclen, void *writer)
+{
+  ms3_writer_write ((MS3Writer *)writer, record, reclen);
+} /* End of ms3_writer_handler() */
+
+/** ************************************************************************
+ * @brief Write the records buffered by a writer to its file
+ *
+ * @param[in] writer ::MS3Writer of the file
+ *
+ * @returns 0 on success and -1 on error, including an earlier error
+ * writing records.
+ *
+ * @ref MessageOnError - this function logs a message on error
+ ***************************************************************************/
+int
+ms3_writer_flush (MS3Writer *writer)
+{
+  if (!writer)
+  {
+    ms_log (2, "%s(): Required input not defined: 'writer'\n", __func__);
+    return -1;
+  }
+
+  if (writer->error)
+    return -1;
+
+  if (writer->length > 0)
+  {
+    if (writer_writeall (writer, writer->buffer, writer->length, NULL, 0))
+    {
+      writer->error = 1;
+      return -1;
+    }
+
+    writer->length = 0;
+  }
+
+  return 0;
+} /* End of ms3_writer_flush() */
+
+/** ************************************************************************
+ * @brief Write the buffered records, close the file and free a writer
+ *
+ * @param[in,out] ppwriter Pointer to the ::MS3Writer to close, set to NULL
+ *
+ * @returns 0 on success and -1 on error, including an earlier error
+ * writing records.
+ *
+ * @ref MessageOnError - this function logs a message on error
+ ***************************************************************************/
+int
+ms3_writer_close (MS3Writer **ppwriter)
+{
+  MS3Writer *writer;
+  int rv;
+
+  if (!ppwriter || !*ppwriter)
+    return 0;
+
+  writer = *ppwriter;
+
+  rv = ms3_writer_flush (writer);
+
+  if (writer->ownfd)
+  {
+#if !defined(LMP_WIN)
+    struct stat st;
+
+    /* Release preallocated space that was not written, only if the file
+     * was not appended to and did not grow beyond the records written */
+    if (!writer->append && writer->preallocated > writer->position && writer->position >= 0 &&
+        fstat (writer->fd, &st) == 0 && (int64_t)st.st_size <= writer->position &&
+        ftruncate (writer->fd, (off_t)writer->position))
+    {
+      ms_log (1, "Cannot release preallocated space of %s: %s\n", writer->path,
+              strerror (errno));
+    }
+#endif
+
+    if (lm_close (writer->fd) && rv == 0)
+    {
+      ms_log (2, "Error closing output file %s: %s\n", writer->path, strerror (errno));
+      rv = -1;
+    }
+  }
+
+  lm_memory ()->free (writer->buffer);
+  lm_memory ()->free (writer->path);
+  lm_memory ()->free (writer);
+
+  *ppwriter = NULL;
+
+  return rv;
+} /* End of ms3_writer_close() */
+
+/** ************************************************************************
+ * @brief Write miniSEED for an ::MS3Record with a writer
+ *
+ * Pack ::MS3Record data into miniSEED record(s) by calling
+ * msr3_pack_next() and write them with an ::MS3Writer.  This is
+ * msr3_writemseed() for a file that is kept open.
+ *
+ * @param[in] writer ::MS3Writer of the output file
+ * @param[in,out] msr ::MS3Record containing data to write
+ * @param[in] flags Flags controlling data packing, see msr3_pack()
+ * @param[in] verbose Controls verbosity, 0 means no diagnostic output
+ *
+ * @returns the number of records written on success and -1 on error.
+ *
+ * @ref MessageOnError - this function logs a message on error
+ *
+ * @see msr3_writemseed()
+ ***************************************************************************/
+int64_t
+msr3_writemseed_w (MS3Writer *writer, MS3Record *msr, uint32_t flags, int8_t verbose)
+{
+  MS3RecordPacker *packer;
+  int64_t packedrecords = 0;
+  char *record = NULL;
+  int32_t reclen = 0;
+  int result;
+
+  if (!writer || !msr)
+  {
+    ms_log (2, "%s(): Required input not defined: 'writer' or 'msr'\n", __func__);
+    return -1;
+  }
+
+  packer = msr3_pack_init (msr, flags, verbose);
+  if (!packer)
+    return -1;
+
+  while ((result = msr3_pack_next (packer, &record, &reclen)) == 1)
+  {
+    if (ms3_writer_write (writer, record, reclen))
+    {
+      packedrecords = -1;
+      break;
+    }
+
+    packedrecords++;
+  }
+
+  /* A negative result indicates a packing error */
+  if (result < 0 && packedrecords >= 0)
+    packedrecords = -1;
+
+  msr3_pack_free (&packer, NULL);
+
+  return packedrecords;
+} /* End of msr3_writemseed_w() */
+
+/* Estimate the size of records packed from a trace list with a fixed
+ * width encoding, returns 0 for other encodings */
+static int64_t
+writer_estimate (MS3TraceList *mstl, int maxreclen, int8_t encoding, uint32_t flags)
+{
+  MS3TraceID *id;
+  MS3TraceSeg *seg;
+  int64_t datasize;
+  int64_t records;
+  int64_t size = 0;
+  int samplesize;
+  int payload;
+
+  switch (encoding)
+  {
+  case DE_TEXT:
+    samplesize = 1;
+    break;
+  case DE_INT16:
+    samplesize = 2;
+    break;
+  case DE_INT32:
+  case DE_FLOAT32:
+    samplesize = 4;
+    break;
+  case DE_FLOAT64:
+    samplesize = 8;
+    break;
+  default:
+    return 0;
+  }
+
+  if (maxreclen < 0)
+    maxreclen = MS_PACK_DEFAULT_RECLEN;
+
+  for (id = mstl->traces.next[0]; id; id = id->next[0])
+  {
+    /* Payload of a record, less the fixed header, identifier and
+     * blockettes, generously rounded */
+    payload = maxreclen - ((flags & MSF_PACKVER2) ? 128 : MS3FSDH_LENGTH + LM_SIDLEN);
+
+    if (payload < samplesize)
+      return 0;
+
+    for (seg = id->first; seg; seg = seg->next)
+    {
+      datasize = seg->numsamples * samplesize;
+      records = (datasize + payload - 1) / payload;
+
+      if (flags & MSF_PACKVER2)
+        size += records * maxreclen;
+      else
+        size += datasize + records * (maxreclen - payload);
+    }
+  }
+
+  return size;
+} /* End of writer_estimate() */
+
+/** ************************************************************************
+ * @brief Write miniSEED from an ::MS3TraceList container with a writer
+ *
+ * Pack ::MS3TraceList data into miniSEED record(s) by calling
+ * mstl3_pack() and write them with an ::MS3Writer.  This is
+ * mstl3_writemseed() for a file that is kept open.
+ *
+ * For the fixed width encodings, text, integers and floats, the size
+ * of the output is estimated and preallocated with
+ * ms3_writer_preallocate().
+ *
+ * @param[in] writer ::MS3Writer of the output file
+ * @param[in,out] mstl ::MS3TraceList containing data to write
+ * @param[in] maxreclen The maximum record length to create
+ * @param[in] encoding encoding Encoding for data samples, see msr3_pack()
+ * @param[in] flags Flags controlling data packing, see mstl3_pack() and msr3_pack()
+ * @param[in] verbose Controls verbosity, 0 means no diagnostic output
+ *
+ * @returns the number of records written on success and -1 on error.
+ *
+ * @ref MessageOnError - this function logs a message on error
+ *
+ * @see mstl3_writemseed()
+ ***************************************************************************/
+int64_t
+mstl3_writemseed_w (MS3Writer *writer, MS3TraceList *mstl, int maxreclen, int8_t encoding,
+                    uint32_t flags, int8_t verbose)
+{
+  int64_t packedrecords;
+
+  if (!writer || !mstl)
+  {
+    ms_log (2, "%s(): Required input not defined: 'writer' or 'mstl'\n", __func__);
+    return -1;
+  }
+
+  /* Do not modify the trace list during packing */
+  flags |= MSF_MAINTAINMSTL;
+
+  /* Pack all data */
+  flags |= MSF_FLUSHDATA;
+
+  if (ms3_writer_preallocate (writer, writer_estimate (mstl, maxreclen, encoding, flags)))
+    return -1;
+
+  packedrecords = mstl3_pack (mstl, ms3_writer_handler, writer, maxreclen, encoding, NULL, flags,
+                              verbose, NULL);
+
+  /* The record handler cannot signal a write failure, check the writer */
+  if (packedrecords >= 0 && writer->error)
+  {
+    ms_log (2, "Error writing to output file %s\n", writer->path);
+    packedrecords = -1;
+  }
+
+  return packedrecords;
+} /* End of mstl3_writemseed_w() */
@@ -0,0 +1,511 @@
+/***************************************************************************
+ * archivewriter.c - Write records to files named by a path template
+ *
+ * Reorganizing data into an archive, such as an SDS structure, writes
+ * each record to a file determined by its source identifier and time.
+ * Opening and closing the destination for every record is slow, and
+ * keeping every destination open exhausts file descriptors.  These
+ * routines keep a bounded set of open files in least recently used
+ * order, each with a buffer of records written in bulk.
+ *
+ * Records are appended to existing files, and missing directories in
+ * the path are created.
+ *
+ * Written by Chad Trabant, EarthScope Data Services
+ ***************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "archivewriter.h"
+
+/* FNV-1a hash of a path */
+static uint32_t
+ar_hash (const char *path)
+{
+  uint32_t hash = 2166136261u;
+
+  while (*path)
+  {
+    hash ^= (uint8_t)*path++;
+    hash *= 16777619u;
+  }
+
+  return hash;
+}
+
+/* Return non-zero if an identifier code cannot be used in a path, a
+ * code must not contain '/' or be '.' or '..' to stay within the
+ * directories of the template */
+static int
+ar_unsafecode (const char *code)
+{
+  return (strchr (code, '/') || !strcmp (code, ".") || !strcmp (code, ".."));
+}
+
+/***************************************************************************
+ * Expand the template for a record into path.
+ *
+ * The template codes are:
+ *   %n network, %s station, %l location, %c channel
+ *   %Y year, %j day of year, %m month, %d day of month, %H hour
+ *   %v publication version, %% a literal '%'
+ *
+ * Returns 0 on success, 1 if the identifier codes of the record cannot
+ * be used in a path and -1 on error.
+ ***************************************************************************/
+static int
+ar_expand (const char *template, const MS3Record *msr, char *path, size_t pathsize)
+{
+  const char *net = NULL;
+  const char *sta = NULL;
+  const char *loc = NULL;
+  const char *chan = NULL;
+  const char *tp;
+  char value[16];
+  const char *field;
+  size_t length = 0;
+  size_t fieldlength;
+  uint32_t handle;
+  uint16_t year = 0;
+  uint16_t yday = 0;
+  uint8_t hour = 0;
+  int month = 0;
+  int mday = 0;
+  int timeset = 0;
+
+  for (tp = template; *tp; tp++)
+  {
+    if (*tp != '%')
+    {
+      if (length + 1 >= pathsize)
+        return -1;
+
+      path[length++] = *tp;
+      continue;
+    }
+
+    tp++;
+    field = value;
+
+    switch (*tp)
+    {
+    case 'n':
+    case 's':
+    case 'l':
+    case 'c':
+      if (!net)
+      {
+        if ((handle = ms_sid_intern (msr->sid)) == 0 ||
+            ms_sid2nslc_interned (handle, &net, &sta, &loc, &chan))
+        {
+          ms_log (2, "%s: Cannot parse source identifier\n", msr->sid);
+          return -1;
+        }
+
+        if (ar_unsafecode (net) || ar_unsafecode (sta) || ar_unsafecode (loc) ||
+            ar_unsafecode (chan))
+          return 1;
+      }
+
+      field = (*tp == 'n') ? net : (*tp == 's') ? sta : (*tp == 'l') ? loc : chan;
+      break;
+    case 'Y':
+    case 'j':
+    case 'm':
+    case 'd':
+    case 'H':
+      if (!timeset)
+      {
+        if (ms_nstime2time (msr->starttime, &year, &yday, &hour, NULL, NULL, NULL) ||
+            ms_doy2md (year, yday, &month, &mday))
+        {
+          ms_log (2, "%s: Cannot convert start time\n", msr->sid);
+          return -1;
+        }
+
+        timeset = 1;
+      }
+
+      if (*tp == 'Y')
+        snprintf (value, sizeof (value), "%04d", year);
+      else if (*tp == 'j')
+        snprintf (value, sizeof (value), "%03d", yday);
+      else if (*tp == 'm')
+        snprintf (value, sizeof (value), "%02d", month);
+      else if (*tp == 'd')
+        snprintf (value, sizeof (value), "%02d", mday);
+      else
+        snprintf (value, sizeof (value), "%02d", hour);
+      break;
+    case 'v':
+      snprintf (value, sizeof (value), "%d", msr->pubversion);
+      break;
+    case '%':
+      field = "%";
+      break;
+    default:
+      return -1;
+    }
+
+    fieldlength = strlen (field);
+
+    if (length + fieldlength >= pathsize)
+      return -1;
+
+    memcpy (path + length, field, fieldlength);
+    length += fieldlength;
+  }
+
+  path[length] = '\0';
+
+  return 0;
+} /* End of ar_expand() */
+
+/***************************************************************************
+ * Create the missing parent directories of path.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+ar_mkdirs (const char *path)
+{
+  char dir[AR_MAXPATH];
+  char *cp;
+
+  strcpy (dir, path);
+
+  for (cp = dir + 1; *cp; cp++)
+  {
+    if (*cp != '/')
+      continue;
+
+    *cp = '\0';
+    if (mkdir (dir, 0777) && errno != EEXIST)
+      return -1;
+    *cp = '/';
+  }
+
+  return 0;
+} /* End of ar_mkdirs() */
+
+/***************************************************************************
+ * Write data to a file, retrying partial writes.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+ar_writefile (ArchiveFile *file, const char *data, size_t length)
+{
+  size_t offset = 0;
+  ssize_t rv;
+
+  while (offset < length)
+  {
+    if ((rv = write (file->fd, data + offset, length - offset)) < 0)
+    {
+      if (errno == EINTR)
+        continue;
+
+      ms_log (2, "Cannot write %s: %s\n", file->path, strerror (errno));
+      return -1;
+    }
+
+    offset += (size_t)rv;
+  }
+
+  return 0;
+} /* End of ar_writefile() */
+
+/* Write the buffered records of a file */
+static int
+ar_flush (ArchiveFile *file)
+{
+  int rv = ar_writefile (file, file->buffer, file->length);
+
+  file->length = 0;
+
+  return rv;
+}
+
+/* Remove a file from the hash table */
+static void
+ar_unhash (ArchiveWriter *ar, ArchiveFile *file)
+{
+  ArchiveFile **link = &ar->buckets[file->hash & (ar->nbuckets - 1)];
+
+  while (*link != file)
+    link = &(*link)->hashnext;
+
+  *link = file->hashnext;
+}
+
+/* Remove a file from the least recently used list */
+static void
+ar_unlink (ArchiveWriter *ar, ArchiveFile *file)
+{
+  if (file->prev)
+    file->prev->next = file->next;
+  else
+    ar->head = file->next;
+
+  if (file->next)
+    file->next->prev = file->prev;
+  else
+    ar->tail = file->prev;
+
+  file->prev = file->next = NULL;
+}
+
+/***************************************************************************
+ * Flush and close a file, releasing it for reuse.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+ar_closefile (ArchiveWriter *ar, ArchiveFile *file)
+{
+  int rv = ar_flush (file);
+
+  if (close (file->fd) && !rv)
+  {
+    ms_log (2, "Cannot close %s: %s\n", file->path, strerror (errno));
+    rv = -1;
+  }
+
+  ar_unhash (ar, file);
+  ar_unlink (ar, file);
+  file->fd = -1;
+  file->length = 0;
+
+  return rv;
+} /* End of ar_closefile() */
+
+/***************************************************************************
+ * Open a file for appending, closing the least recently used file if
+ * the maximum number of files are open.
+ *
+ * Returns the file on success and NULL on error.
+ ***************************************************************************/
+static ArchiveFile *
+ar_openfile (ArchiveWriter *ar, const char *path, uint32_t hash)
+{
+  ArchiveFile *file;
+  int flags = O_WRONLY | O_CREAT | O_APPEND;
+  int fd;
+
+  if ((fd = open (path, flags, 0666)) < 0 && errno == ENOENT && !ar_mkdirs (path))
+    fd = open (path, flags, 0666);
+
+  if (fd < 0)
+  {
+    ms_log (2, "Cannot open %s: %s\n", path, strerror (errno));
+    return NULL;
+  }
+
+  if (ar->spare)
+  {
+    file = ar->spare;
+    ar->spare = NULL;
+  }
+  else if (ar->used < ar->maxopen)
+  {
+    file = &ar->files[ar->used];
+
+    if ((file->buffer = (char *)malloc (ar->buffersize)) == NULL)
+    {
+      ms_log (2, "Cannot allocate output buffer\n");
+      close (fd);
+      return NULL;
+    }
+
+    ar->used++;
+  }
+  else
+  {
+    file = ar->tail;
+
+    /* The file is released even if it cannot be written, keep it for reuse */
+    if (ar_closefile (ar, file))
+    {
+      ar->spare = file;
+      close (fd);
+      return NULL;
+    }
+  }
+
+  strcpy (file->path, path);
+  file->hash = hash;
+  file->fd = fd;
+  file->length = 0;
+
+  file->hashnext = ar->buckets[hash & (ar->nbuckets - 1)];
+  ar->buckets[hash & (ar->nbuckets - 1)] = file;
+
+  ar->opens++;
+
+  return file;
+} /* End of ar_openfile() */
+
+/***************************************************************************
+ * Initialize an ArchiveWriter for the specified path template.  A
+ * maxopen of 0 selects AR_MAXOPEN and a buffersize of 0 selects
+ * AR_BUFFERSIZE.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+int
+ar_init (ArchiveWriter *ar, const char *template, int maxopen, size_t buffersize)
+{
+  const char *tp;
+
+  if (!ar || !template)
+    return -1;
+
+  memset (ar, 0, sizeof (ArchiveWriter));
+
+  for (tp = strchr (template, '%'); tp; tp = strchr (tp + 2, '%'))
+  {
+    if (!tp[1] || !strchr ("nslcYjmdHv%", tp[1]))
+    {
+      ms_log (2, "Unrecognized archive template code: %%%c\n", tp[1]);
+      return -1;
+    }
+  }
+
+  ar->template = template;
+  ar->maxopen = (maxopen > 0) ? maxopen : AR_MAXOPEN;
+  ar->buffersize = (buffersize > 0) ? buffersize : AR_BUFFERSIZE;
+
+  for (ar->nbuckets = 16; ar->nbuckets < (uint32_t)ar->maxopen * 2;)
+    ar->nbuckets *= 2;
+
+  if ((ar->files = (ArchiveFile *)calloc (ar->maxopen, sizeof (ArchiveFile))) == NULL ||
+      (ar->buckets = (ArchiveFile **)calloc (ar->nbuckets, sizeof (ArchiveFile *))) == NULL)
+  {
+    ms_log (2, "Cannot allocate archive writer\n");
+    free (ar->files);
+    ar->files = NULL;
+    return -1;
+  }
+
+  return 0;
+} /* End of ar_init() */
+
+/***************************************************************************
+ * Append a record to the file named by expanding the template for it.
+ * Records with identifier codes that cannot be used in a path, codes
+ * containing '/' or that are '.' or '..', are skipped with a warning.
+ *
+ * Returns 0 on success, 1 if the record was skipped and -1 on error.
+ ***************************************************************************/
+int
+ar_write (ArchiveWriter *ar, const MS3Record *msr)
+{
+  ArchiveFile *file;
+  char path[AR_MAXPATH];
+  uint32_t hash;
+  int rv;
+
+  if (!ar || !ar->files || !msr || !msr->record)
+    return -1;
+
+  if ((rv = ar_expand (ar->template, msr, path, sizeof (path))) > 0)
+  {
+    ms_log (1, "%s: Skipping record, identifier codes cannot be used in an archive path\n",
+            msr->sid);
+    return 1;
+  }
+  else if (rv < 0)
+  {
+    ms_log (2, "%s: Cannot generate archive path from template: %s\n", msr->sid, ar->template);
+    return -1;
+  }
+
+  /* Most records go to the same file as the previous record */
+  if (ar->head && !strcmp (ar->head->path, path))
+  {
+    file = ar->head;
+  }
+  else
+  {
+    hash = ar_hash (path);
+
+    for (file = ar->buckets[hash & (ar->nbuckets - 1)]; file; file = file->hashnext)
+    {
+      if (file->hash == hash && !strcmp (file->path, path))
+        break;
+    }
+
+    if (file)
+      ar_unlink (ar, file);
+    else if ((file = ar_openfile (ar, path, hash)) == NULL)
+      return -1;
+
+    /* Insert at head of least recently used list */
+    file->next = ar->head;
+    if (ar->head)
+      ar->head->prev = file;
+    ar->head = file;
+    if (!ar->tail)
+      ar->tail = file;
+  }
+
+  if (file->length + msr->reclen > ar->buffersize && ar_flush (file))
+    return -1;
+
+  /* Write records larger than the buffer directly */
+  if ((size_t)msr->reclen > ar->buffersize)
+  {
+    if (ar_writefile (file, msr->record, msr->reclen))
+      return -1;
+  }
+  else
+  {
+    memcpy (file->buffer + file->length, msr->record, msr->reclen);
+    file->length += msr->reclen;
+  }
+
+  ar->records++;
+
+  return 0;
+} /* End of ar_write() */
+
+/***************************************************************************
+ * Flush and close all open files and release the writer.  The record and
+ * file open counts remain available in the ArchiveWriter.
+ *
+ * Returns 0 on success and -1 if any file could not be written.
+ ***************************************************************************/
+int
+ar_close (ArchiveWriter *ar)
+{
+  int rv = 0;
+  int idx;
+
+  if (!ar || !ar->files)
+    return -1;
+
+  while (ar->head)
+  {
+    if (ar_closefile (ar, ar->head))
+      rv = -1;
+  }
+
+  for (idx = 0; idx < ar->used; idx++)
+    free (ar->files[idx].buffer);
+
+  free (ar->files);
+  free (ar->buckets);
+  ar->files = NULL;
+  ar->buckets = NULL;
+  ar->spare = NULL;
+  ar->used = 0;
+
+  return rv;
+} /* End of ar_close() */
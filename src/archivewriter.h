@@ -0,0 +1,62 @@
+/***************************************************************************
+ * archivewriter.h - Write records to files named by a path template
+ *
+ * Declarations for the routines in archivewriter.c.
+ *
+ * Written by Chad Trabant, EarthScope Data Services
+ ***************************************************************************/
+
+#ifndef ARCHIVEWRITER_H
+#define ARCHIVEWRITER_H 1
+
+#include <stdint.h>
+
+#include <libmseed.h>
+
+/* Default maximum number of open files and output buffer size in bytes */
+#define AR_MAXOPEN 64
+#define AR_BUFFERSIZE 65536
+
+/* Maximum length of a generated path */
+#define AR_MAXPATH 4096
+
+/* Open output file of an ArchiveWriter */
+typedef struct ArchiveFile
+{
+  char path[AR_MAXPATH];        /* Path of the file */
+  uint32_t hash;                /* Hash of path */
+  int fd;                       /* File descriptor, -1 if not open */
+  char *buffer;                 /* Records not yet written */
+  size_t length;                /* Bytes of buffer in use */
+  struct ArchiveFile *prev;     /* More recently used file */
+  struct ArchiveFile *next;     /* Less recently used file */
+  struct ArchiveFile *hashnext; /* Next file in the same hash bucket */
+} ArchiveFile;
+
+/* Writer of records to files named by a path template.
+ *
+ * Records are appended to the file named by expanding the template for
+ * each record.  Up to a maximum number of files are kept open, each with
+ * a buffer of records, the least recently used file is flushed and
+ * closed when another must be opened. */
+typedef struct ArchiveWriter
+{
+  const char *template;  /* Path template */
+  int maxopen;           /* Maximum number of open files */
+  size_t buffersize;     /* Size of each file buffer in bytes */
+  ArchiveFile *files;    /* Array of maxopen files */
+  int used;              /* Number of entries of files in use */
+  ArchiveFile **buckets; /* Hash table of open files by path */
+  uint32_t nbuckets;     /* Number of hash buckets, a power of 2 */
+  ArchiveFile *head;     /* Most recently used file */
+  ArchiveFile *tail;     /* Least recently used file */
+  ArchiveFile *spare;    /* Released file to reuse, not in the lists */
+  uint64_t records;      /* Number of records written */
+  uint64_t opens;        /* Number of times a file was opened */
+} ArchiveWriter;
+
+extern int ar_init (ArchiveWriter *ar, const char *template, int maxopen, size_t buffersize);
+extern int ar_write (ArchiveWriter *ar, const MS3Record *msr);
+extern int ar_close (ArchiveWriter *ar);
+
+#endif
@@ -0,0 +1,367 @@
+/***************************************************************************
+ * asyncwriter.c - Asynchronous buffered output to a file descriptor
+ *
+ * Writing each record or block of samples to the output on the reading
+ * thread stalls parsing whenever the output is slow, such as a network
+ * file system or a pipe into another program.  These routines copy the
+ * output into large buffers that are written by a separate thread, so
+ * that reading, parsing and writing overlap.
+ *
+ * Output is identical to writing the same data sequentially.
+ *
+ * Written by Chad Trabant, EarthScope Data Services
+ ***************************************************************************/
+
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "asyncwriter.h"
+
+#ifndef IOV_MAX
+#define IOV_MAX 16
+#endif
+
+/* Return a monotonic time in nanoseconds */
+static int64_t
+aw_now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/***************************************************************************
+ * Write all of the specified buffers, retrying partial writes.
+ *
+ * Returns 0 on success and an errno value on error.
+ ***************************************************************************/
+static int
+aw_writev (int fd, struct iovec *iov, int iovcnt, uint64_t *written)
+{
+  ssize_t rv;
+
+  while (iovcnt > 0)
+  {
+    if ((rv = writev (fd, iov, iovcnt)) < 0)
+    {
+      if (errno == EINTR)
+        continue;
+
+      return errno;
+    }
+
+    *written += (uint64_t)rv;
+
+    /* Skip fully written buffers and advance into a partially written one */
+    while (iovcnt > 0 && (size_t)rv >= iov->iov_len)
+    {
+      rv -= (ssize_t)iov->iov_len;
+      iov++;
+      iovcnt--;
+    }
+
+    if (iovcnt > 0)
+    {
+      iov->iov_base = (char *)iov->iov_base + rv;
+      iov->iov_len -= (size_t)rv;
+    }
+  }
+
+  return 0;
+} /* End of aw_writev() */
+
+/***************************************************************************
+ * Writer thread: wait for queued buffers and write all that are queued
+ * at once, until the writer is closing and the queue is empty.  After an
+ * error buffers are released without writing so the caller never waits
+ * indefinitely.
+ ***************************************************************************/
+static void *
+aw_thread (void *arg)
+{
+  AsyncWriter *aw = (AsyncWriter *)arg;
+  struct iovec iov[IOV_MAX];
+  int64_t start;
+  int iovcnt;
+  int error;
+  int idx;
+
+  pthread_mutex_lock (&aw->lock);
+
+  for (;;)
+  {
+    if (aw->queued == 0)
+    {
+      if (aw->closing)
+        break;
+
+      start = aw_now ();
+      while (aw->queued == 0 && !aw->closing)
+        pthread_cond_wait (&aw->cond, &aw->lock);
+      aw->writerwait += aw_now () - start;
+
+      continue;
+    }
+
+    iovcnt = (aw->queued < IOV_MAX) ? aw->queued : IOV_MAX;
+    for (idx = 0; idx < iovcnt; idx++)
+    {
+      iov[idx].iov_base = aw->buffers[(aw->head + idx) % aw->nbuffers];
+      iov[idx].iov_len = aw->lengths[(aw->head + idx) % aw->nbuffers];
+    }
+    error = aw->error;
+
+    /* Queued buffers are not modified by the caller, write without the lock */
+    pthread_mutex_unlock (&aw->lock);
+
+    if (!error)
+      error = aw_writev (aw->fd, iov, iovcnt, &aw->written);
+
+    pthread_mutex_lock (&aw->lock);
+
+    if (error && !aw->error)
+      aw->error = error;
+
+    aw->head = (aw->head + iovcnt) % aw->nbuffers;
+    aw->queued -= iovcnt;
+    pthread_cond_signal (&aw->cond);
+  }
+
+  pthread_mutex_unlock (&aw->lock);
+
+  return NULL;
+} /* End of aw_thread() */
+
+/***************************************************************************
+ * Queue the buffer being filled and wait for a free buffer to fill.
+ *
+ * Returns 0 on success and -1 if a write has failed.
+ ***************************************************************************/
+static int
+aw_queue (AsyncWriter *aw)
+{
+  int64_t start;
+  int error;
+
+  pthread_mutex_lock (&aw->lock);
+
+  aw->queued++;
+  pthread_cond_signal (&aw->cond);
+
+  if (aw->queued == aw->nbuffers)
+  {
+    start = aw_now ();
+    while (aw->queued == aw->nbuffers)
+      pthread_cond_wait (&aw->cond, &aw->lock);
+    aw->callerwait += aw_now () - start;
+  }
+
+  aw->fill = (aw->head + aw->queued) % aw->nbuffers;
+  aw->lengths[aw->fill] = 0;
+  error = aw->error;
+
+  pthread_mutex_unlock (&aw->lock);
+
+  if (error)
+  {
+    errno = error;
+    return -1;
+  }
+
+  return 0;
+} /* End of aw_queue() */
+
+/***************************************************************************
+ * Initialize an AsyncWriter for the specified file descriptor and start
+ * its writer thread.  A size of 0 selects AW_BUFFERSIZE and a number of
+ * buffers less than 2 selects AW_BUFFERS.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+int
+aw_init (AsyncWriter *aw, int fd, size_t size, int nbuffers)
+{
+  int idx;
+
+  if (!aw || fd < 0)
+    return -1;
+
+  memset (aw, 0, sizeof (AsyncWriter));
+
+  aw->fd = fd;
+  aw->size = (size) ? size : AW_BUFFERSIZE;
+  aw->nbuffers = (nbuffers >= 2) ? nbuffers : AW_BUFFERS;
+
+  if ((aw->buffers = (char **)calloc (aw->nbuffers, sizeof (char *))) == NULL ||
+      (aw->lengths = (size_t *)calloc (aw->nbuffers, sizeof (size_t))) == NULL)
+    goto failed;
+
+  for (idx = 0; idx < aw->nbuffers; idx++)
+  {
+    if ((aw->buffers[idx] = (char *)malloc (aw->size)) == NULL)
+      goto failed;
+  }
+
+  if (pthread_mutex_init (&aw->lock, NULL))
+    goto failed;
+
+  if (pthread_cond_init (&aw->cond, NULL))
+  {
+    pthread_mutex_destroy (&aw->lock);
+    goto failed;
+  }
+
+  if (pthread_create (&aw->thread, NULL, aw_thread, aw))
+  {
+    pthread_cond_destroy (&aw->cond);
+    pthread_mutex_destroy (&aw->lock);
+    goto failed;
+  }
+
+  return 0;
+
+failed:
+  if (aw->buffers)
+  {
+    for (idx = 0; idx < aw->nbuffers; idx++)
+      free (aw->buffers[idx]);
+    free (aw->buffers);
+  }
+  free (aw->lengths);
+  aw->buffers = NULL;
+  aw->lengths = NULL;
+
+  return -1;
+} /* End of aw_init() */
+
+/***************************************************************************
+ * Append data to the output, queuing buffers to the writer thread as
+ * they are filled.
+ *
+ * Returns 0 on success and -1 if a write has failed, with errno set to
+ * the error of the failed write.
+ ***************************************************************************/
+int
+aw_write (AsyncWriter *aw, const void *data, size_t length)
+{
+  const char *bytes = (const char *)data;
+  size_t count;
+
+  if (!aw || !aw->buffers)
+    return -1;
+
+  while (length > 0)
+  {
+    count = aw->size - aw->lengths[aw->fill];
+    if (count > length)
+      count = length;
+
+    memcpy (aw->buffers[aw->fill] + aw->lengths[aw->fill], bytes, count);
+    aw->lengths[aw->fill] += count;
+    bytes += count;
+    length -= count;
+
+    if (aw->lengths[aw->fill] == aw->size && aw_queue (aw))
+      return -1;
+  }
+
+  return 0;
+} /* End of aw_write() */
+
+/***************************************************************************
+ * Reserve space for length bytes in the buffer being filled, queuing
+ * the buffer first if the space does not fit, so that output can be
+ * produced in place.  The data is added to the output with aw_commit().
+ *
+ * Returns a pointer to the space on success and NULL if the length is
+ * larger than a buffer or a write has failed, with errno set.
+ ***************************************************************************/
+void *
+aw_reserve (AsyncWriter *aw, size_t length)
+{
+  if (!aw || !aw->buffers || length > aw->size)
+  {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  if (aw->size - aw->lengths[aw->fill] < length && aw_queue (aw))
+    return NULL;
+
+  return aw->buffers[aw->fill] + aw->lengths[aw->fill];
+} /* End of aw_reserve() */
+
+/***************************************************************************
+ * Add length bytes produced in the space returned by aw_reserve() to
+ * the output.
+ *
+ * Returns 0 on success and -1 if a write has failed, with errno set to
+ * the error of the failed write.
+ ***************************************************************************/
+int
+aw_commit (AsyncWriter *aw, size_t length)
+{
+  if (!aw || !aw->buffers || length > aw->size - aw->lengths[aw->fill])
+  {
+    errno = EINVAL;
+    return -1;
+  }
+
+  aw->lengths[aw->fill] += length;
+
+  if (aw->lengths[aw->fill] == aw->size && aw_queue (aw))
+    return -1;
+
+  return 0;
+} /* End of aw_commit() */
+
+/***************************************************************************
+ * Queue any remaining data, wait for the writer thread to write all
+ * buffers and release them.  The file descriptor is not closed.  The
+ * wait statistics remain available in the AsyncWriter.
+ *
+ * Returns 0 on success and -1 if any write failed, with errno set to
+ * the error of the first failed write.
+ ***************************************************************************/
+int
+aw_close (AsyncWriter *aw)
+{
+  int idx;
+
+  if (!aw || !aw->buffers)
+    return -1;
+
+  pthread_mutex_lock (&aw->lock);
+  if (aw->lengths[aw->fill] > 0)
+    aw->queued++;
+  aw->closing = 1;
+  pthread_cond_signal (&aw->cond);
+  pthread_mutex_unlock (&aw->lock);
+
+  pthread_join (aw->thread, NULL);
+
+  pthread_cond_destroy (&aw->cond);
+  pthread_mutex_destroy (&aw->lock);
+
+  for (idx = 0; idx < aw->nbuffers; idx++)
+    free (aw->buffers[idx]);
+  free (aw->buffers);
+  free (aw->lengths);
+  aw->buffers = NULL;
+  aw->lengths = NULL;
+
+  if (aw->error)
+  {
+    errno = aw->error;
+    return -1;
+  }
+
+  return 0;
+} /* End of aw_close() */
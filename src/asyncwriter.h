@@ -0,0 +1,53 @@
+/***************************************************************************
+ * asyncwriter.h - Asynchronous buffered output to a file descriptor
+ *
+ * Declarations for the routines in asyncwriter.c.
+ *
+ * Written by Chad Trabant, EarthScope Data Services
+ ***************************************************************************/
+
+#ifndef ASYNCWRITER_H
+#define ASYNCWRITER_H 1
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* Default size of each output buffer in bytes and number of buffers */
+#define AW_BUFFERSIZE 1048576
+#define AW_BUFFERS 4
+
+/* Asynchronous buffered writer.
+ *
+ * Data is copied into the current buffer, full buffers are queued to a
+ * writer thread that writes all queued buffers with one writev() call.
+ * The caller only waits when every buffer is queued, allowing reading
+ * and parsing to overlap with writing to slow outputs.  The time each
+ * side spends waiting for the other is recorded. */
+typedef struct AsyncWriter
+{
+  int fd;                /* Destination file descriptor */
+  char **buffers;        /* Ring of output buffers */
+  size_t *lengths;       /* Bytes in use of each buffer */
+  int nbuffers;          /* Number of buffers */
+  size_t size;           /* Size of each buffer in bytes */
+  int head;              /* First queued buffer */
+  int queued;            /* Number of queued buffers, following head */
+  int fill;              /* Buffer being filled by the caller */
+  int closing;           /* Set when no more buffers will be queued */
+  int error;             /* errno of the first failed write, or 0 */
+  uint64_t written;      /* Bytes written to the output */
+  int64_t callerwait;    /* Nanoseconds the caller waited for a free buffer */
+  int64_t writerwait;    /* Nanoseconds the writer waited for a queued buffer */
+  pthread_t thread;      /* Writer thread */
+  pthread_mutex_t lock;  /* Protects head, queued, closing and error */
+  pthread_cond_t cond;   /* Signaled when a buffer is queued or written */
+} AsyncWriter;
+
+extern int aw_init (AsyncWriter *aw, int fd, size_t size, int nbuffers);
+extern int aw_write (AsyncWriter *aw, const void *data, size_t length);
+extern void *aw_reserve (AsyncWriter *aw, size_t length);
+extern int aw_commit (AsyncWriter *aw, size_t length);
+extern int aw_close (AsyncWriter *aw);
+
+#endif
@@ -13,18 +13,27 @@
 
 #include <ctype.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
 
 #include <libmseed.h>
 
+#include "archivewriter.h"
+#include "asyncwriter.h"
+#include "samplewriter.h"
+
 static int processparam (int argcount, char **argvec);
 static char *getoptval (int argcount, char **argvec, int argopt);
 static long getoptint (int argcount, char **argvec, int argopt);
 static double getoptdouble (int argcount, char **argvec, int argopt);
 static int lisnumber (char *number);
+static AsyncWriter *openoutput (AsyncWriter *aw, const char *filename);
+static int closeoutput (AsyncWriter *aw, const char *filename);
+static int convertrecord (AsyncWriter *aw, MS3Record *msr);
 static int addfile (char *filename);
 static int addlistfile (char *filename);
 static int addmatch (const char *pattern);
@@ -32,9 +41,19 @@ static int addreject (const char *pattern);
 static int my_globmatch (const char *string, const char *pattern);
 static void usage (void);
 
-#define VERSION "4.3.0"
+#define VERSION "4.4.0"
 #define PACKAGE "msi"
 
+/* Number of URL inputs transferred, and of local files read into
+ * memory, ahead of the input being read */
+#define URLPREFETCH 4
+#define FILEPREFETCH 32
+
+/* Length of the miniSEED 3 fixed header and the largest miniSEED 2
+ * record length, for records converted between versions */
+#define MS3FIXEDLENGTH 40
+#define MS2MAXRECLEN 131072
+
 static int8_t verbose = 0;
 static int8_t ppackets = 0; /* Controls printing of header/blockettes */
 static int8_t printdata = 0; /* Controls printing of sample values: 1=first 6, 2=all*/
@@ -48,6 +67,8 @@ static int8_t tracegaps = 0; /* Controls printing of gaps with a trace list */
 static ms_timeformat_t timeformat = ISOMONTHDAY_Z; /* Time string format for trace or gap lists */
 static int8_t splitversion = 0; /* Control grouping of data publication versions */
 static int8_t skipnotdata = 0; /* Controls skipping of non-miniSEED data */
+static int8_t nocache = 0; /* Controls dropping of input from the page cache */
+static int8_t outversion = 0; /* Format version to convert output records to, 0 = unchanged */
 static double mingap = 0; /* Minimum gap/overlap seconds when printing gap list */
 static double *mingapptr = NULL;
 static double maxgap = 0; /* Maximum gap/overlap seconds when printing gap list */
@@ -55,6 +76,7 @@ static double *maxgapptr = NULL;
 static int reccntdown = -1;
 static char *binfile = NULL;
 static char *outfile = NULL;
+static char *archivetemplate = NULL;
 static nstime_t starttime = NSTERROR; /* Limit to records containing or after starttime */
 static nstime_t endtime = NSTERROR; /* Limit to records containing or before endtime */
 static double timetol; /* Time tolerance for continuous traces */
@@ -87,20 +109,32 @@ int
 main (int argc, char **argv)
 {
   struct filelink *flp;
+  struct filelink *pflp;
+  struct filelink *fflp;
   MS3Record *msr = 0;
   MS3TraceList *mstl = 0;
   MS3FileParam *msfp = NULL;
-  FILE *bfp = 0;
-  FILE *ofp = 0;
+  AsyncWriter binwriter;
+  AsyncWriter outwriter;
+  AsyncWriter *bwp = NULL;
+  AsyncWriter *owp = NULL;
+  ArchiveWriter archivewriter;
+  SampleWriter samplewriter = {0};
   int retcode = MS_NOERROR;
+  int outputerror = 0;
 
   uint32_t flags = 0;
   int dataflag = 0;
   int64_t totalrecs = 0;
   int64_t totalsamps = 0;
   int64_t totalfiles = 0;
+  int64_t offset;
+  int64_t zoffset;
+  int64_t zskip;
+  int idx;
 
   char stime[40];
+  char zposition[44];
 
   /* Set default error message prefix */
   ms_loginit (NULL, NULL, NULL, "ERROR: ");
@@ -113,49 +147,62 @@ main (int argc, char **argv)
   ms_readleapseconds ("LIBMSEED_LEAPSECOND_FILE");
 
   /* Open the integer output file if specified */
-  if (binfile)
-  {
-    if (strcmp (binfile, "-") == 0)
-    {
-      bfp = stdout;
-    }
-    else if ((bfp = fopen (binfile, "wb")) == NULL)
-    {
-      ms_log (2, "Cannot open binary data output file: %s (%s)\n",
-              binfile, strerror (errno));
-      return 1;
-    }
-  }
+  if (binfile && (bwp = openoutput (&binwriter, binfile)) == NULL)
+    return 1;
 
-  /* Open the output file if specified */
+  /* Open the output file if specified, sharing the writer when both are stdout */
   if (outfile)
   {
-    if (strcmp (outfile, "-") == 0)
-    {
-      ofp = stdout;
-    }
-    else if ((ofp = fopen (outfile, "wb")) == NULL)
-    {
-      ms_log (2, "Cannot open output file: %s (%s)\n",
-              outfile, strerror (errno));
+    if (bwp && strcmp (binfile, "-") == 0 && strcmp (outfile, "-") == 0)
+      owp = bwp;
+    else if ((owp = openoutput (&outwriter, outfile)) == NULL)
       return 1;
-    }
   }
 
+  /* Initialize the archive writer if a path template is specified */
+  if (archivetemplate && ar_init (&archivewriter, archivetemplate, AR_MAXOPEN, AR_BUFFERSIZE))
+    return 1;
+
   if (printdata || binfile)
     dataflag = 1;
 
+  /* Sample values are printed through a buffered writer to stdout */
+  if (printdata && sw_init (&samplewriter, stdout, SW_BUFFERSIZE))
+  {
+    ms_log (2, "Cannot allocate sample output buffer\n");
+    return 1;
+  }
+
   flags |= MSF_VALIDATECRC;
   flags |= MSF_PNAMERANGE;
 
+  /* Extra headers are only used when printing details, which maps them on demand */
+  flags |= MSF_DEFEREXTRA;
+
   if (skipnotdata)
     flags |= MSF_SKIPNOTDATA;
 
+  if (nocache)
+    flags |= MSF_NOCACHE;
+
+  /* Read ahead while converting records, which only copies each record */
+  if (outversion)
+    flags |= MSF_READAHEAD;
+
   if (tracegapsum || tracegaponly)
     mstl = mstl3_init (NULL);
 
   flp = filelist;
 
+  /* Start transfers of the first URL inputs, following inputs are
+   * prefetched as each input is completed */
+  pflp = (libmseed_url_support ()) ? filelist : NULL;
+  for (idx = 0; pflp && idx <= URLPREFETCH; idx++, pflp = pflp->next)
+    ms3_url_prefetch (pflp->filename, flags);
+
+  for (idx = 0, fflp = filelist; fflp && idx <= FILEPREFETCH; idx++, fflp = fflp->next)
+    ms3_file_prefetch (fflp->filename, flags);
+
   while (flp != 0)
   {
     if (verbose >= 2)
@@ -257,7 +304,20 @@ main (int argc, char **argv)
       if (!tracegaponly)
       {
         if (printoffset)
-          ms_log (0, "%-14" PRId64, (msfp->streampos - msr->reclen));
+        {
+          offset = msfp->streampos - msr->reclen;
+
+          /* Offsets in compressed input include the compressed frame and offset within it */
+          if (ms3_compressed_offset (msfp, offset, &zoffset, &zskip) == 0)
+          {
+            snprintf (zposition, sizeof (zposition), "%" PRId64 "+%" PRId64, zoffset, zskip);
+            ms_log (0, "%-14" PRId64 "%-22s", offset, zposition);
+          }
+          else
+          {
+            ms_log (0, "%-14" PRId64, offset);
+          }
+        }
 
         if (printlatency)
           ms_log (0, "%-10.6g secs ", msr3_host_latency (msr));
@@ -317,6 +377,9 @@ main (int argc, char **argv)
             }
           }
           else
+          {
+            /* Format sample values into the bulk writer, which is flushed
+             * before any other output is logged */
             for (cnt = 0, line = 0; line < lines; line++)
             {
               for (col = 0; col < 6; col++)
@@ -326,23 +389,33 @@ main (int argc, char **argv)
                   sptr = (char *)msr->datasamples + (cnt * samplesize);
 
                   if (msr->sampletype == 'i')
-                    ms_log (0, "%10d  ", *(int32_t *)sptr);
+                    sw_int32 (&samplewriter, *(int32_t *)sptr, 10);
 
                   else if (msr->sampletype == 'f')
-                    ms_log (0, "%10.8g  ", *(float *)sptr);
+                    sw_real (&samplewriter, *(float *)sptr, 10, 8);
 
                   else if (msr->sampletype == 'd')
-                    ms_log (0, "%10.10g  ", *(double *)sptr);
+                    sw_real (&samplewriter, *(double *)sptr, 10, 10);
+
+                  sw_string (&samplewriter, "  ", 2);
 
                   cnt++;
                 }
               }
-              ms_log (0, "\n");
+              sw_string (&samplewriter, "\n", 1);
 
               /* If only printing the first 6 samples break out here */
               if (printdata == 1)
                 break;
             }
+
+            if (sw_flush (&samplewriter))
+            {
+              ms_log (2, "Cannot write sample values: %s\n", strerror (errno));
+              outputerror = 1;
+              break;
+            }
+          }
         }
 
         if (binfile)
@@ -351,7 +424,13 @@ main (int argc, char **argv)
 
           if (samplesize)
           {
-            fwrite (msr->datasamples, samplesize, msr->numsamples, bfp);
+            if (aw_write (bwp, msr->datasamples, (size_t)samplesize * msr->numsamples))
+            {
+              ms_log (2, "Cannot write binary data output file: %s (%s)\n",
+                      binfile, strerror (errno));
+              outputerror = 1;
+              break;
+            }
           }
           else
           {
@@ -363,15 +442,42 @@ main (int argc, char **argv)
 
       if (outfile)
       {
-        fwrite (msr->record, 1, msr->reclen, ofp);
+        if (outversion && msr->formatversion != outversion)
+        {
+          if (convertrecord (owp, msr))
+          {
+            outputerror = 1;
+            break;
+          }
+        }
+        else if (aw_write (owp, msr->record, msr->reclen))
+        {
+          ms_log (2, "Cannot write output file: %s (%s)\n", outfile, strerror (errno));
+          outputerror = 1;
+          break;
+        }
+      }
+
+      if (archivetemplate && ar_write (&archivewriter, msr) < 0)
+      {
+        outputerror = 1;
+        break;
       }
     }
 
-    /* Print error if not EOF and not counting down records */
-    if (retcode != MS_ENDOFFILE && reccntdown != 0)
+    /* Stop on an output error, or print error if not EOF and not counting
+     * down records, writing output already queued before exiting */
+    if (outputerror || (retcode != MS_ENDOFFILE && reccntdown != 0))
     {
-      ms_log (2, "Cannot read %s: %s\n", flp->filename, ms_errorstr (retcode));
+      if (!outputerror)
+        ms_log (2, "Cannot read %s: %s\n", flp->filename, ms_errorstr (retcode));
       ms3_readmsr_r (&msfp, &msr, NULL, 0, 0);
+      if (bwp)
+        closeoutput (bwp, binfile);
+      if (owp && owp != bwp)
+        closeoutput (owp, outfile);
+      if (archivetemplate)
+        ar_close (&archivewriter);
       exit (1);
     }
 
@@ -381,17 +487,46 @@ main (int argc, char **argv)
     totalfiles++;
     flp = flp->next;
 
+    if (pflp)
+    {
+      ms3_url_prefetch (pflp->filename, flags);
+      pflp = pflp->next;
+    }
+
+    if (fflp)
+    {
+      ms3_file_prefetch (fflp->filename, flags);
+      fflp = fflp->next;
+    }
+
     /* Stop if the record count limit has been reached */
     if (reccntdown == 0)
       break;
   } /* End of looping over file list */
 
-  /* Close output files, leaving stdout open for any remaining output */
-  if (binfile && bfp != stdout)
-    fclose (bfp);
+  /* Cancel transfers and reads of inputs not read */
+  if (libmseed_url_support ())
+    ms3_url_prefetch (NULL, 0);
+  ms3_file_prefetch (NULL, 0);
 
-  if (outfile && ofp != stdout)
-    fclose (ofp);
+  /* Write remaining output and close output files, leaving stdout open */
+  if (bwp && closeoutput (bwp, binfile))
+    outputerror = 1;
+
+  if (owp && owp != bwp && closeoutput (owp, outfile))
+    outputerror = 1;
+
+  if (archivetemplate)
+  {
+    if (ar_close (&archivewriter))
+      outputerror = 1;
+    else if (verbose)
+      ms_log (1, "Wrote %" PRIu64 " records to archive, %" PRIu64 " file opens\n",
+              archivewriter.records, archivewriter.opens);
+  }
+
+  if (outputerror)
+    return 1;
 
   if (tracegapsum || tracegaponly)
   {
@@ -416,9 +551,181 @@ main (int argc, char **argv)
   if (mstl)
     mstl3_free (&mstl, 0);
 
+  sw_free (&samplewriter);
+
   return 0;
 } /* End of main() */
 
+/***************************************************************************
+ * openoutput():
+ * Open an output file, or stdout for "-", and start an asynchronous
+ * writer for it.
+ *
+ * Returns the writer on success, and NULL on failure
+ ***************************************************************************/
+static AsyncWriter *
+openoutput (AsyncWriter *aw, const char *filename)
+{
+  int fd;
+
+  if (strcmp (filename, "-") == 0)
+  {
+    /* Write any pending output before writing to the descriptor directly */
+    fflush (stdout);
+    fd = STDOUT_FILENO;
+  }
+  else if ((fd = open (filename, O_WRONLY | O_CREAT | O_TRUNC, 0666)) < 0)
+  {
+    ms_log (2, "Cannot open output file: %s (%s)\n", filename, strerror (errno));
+    return NULL;
+  }
+
+  if (aw_init (aw, fd, AW_BUFFERSIZE, AW_BUFFERS))
+  {
+    ms_log (2, "Cannot start output writer for %s\n", filename);
+    if (fd != STDOUT_FILENO)
+      close (fd);
+    return NULL;
+  }
+
+  return aw;
+} /* End of openoutput() */
+
+/***************************************************************************
+ * closeoutput():
+ * Write any remaining output and close the output file, leaving stdout
+ * open.  In verbose mode the time that reading and writing each waited
+ * on the other is reported.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+closeoutput (AsyncWriter *aw, const char *filename)
+{
+  int rv;
+
+  rv = aw_close (aw);
+
+  if (rv || (aw->fd != STDOUT_FILENO && close (aw->fd)))
+  {
+    ms_log (2, "Cannot write output file: %s (%s)\n", filename, strerror (errno));
+    return -1;
+  }
+
+  if (verbose)
+    ms_log (1, "Wrote %" PRIu64 " bytes to %s, reading waited %.3f seconds, writing waited %.3f seconds\n",
+            aw->written, filename, (double)aw->callerwait / 1e9, (double)aw->writerwait / 1e9);
+
+  return 0;
+} /* End of closeoutput() */
+
+/***************************************************************************
+ * convertrecord():
+ * Repack a record to the output format version directly into the output
+ * buffer, copying the encoded data from the read buffer without decoding
+ * samples.  Records converted to version 2 are written with the smallest
+ * power of 2 record length that holds the header and data.  Records
+ * with samples in an unknown encoding are skipped with a warning.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+convertrecord (AsyncWriter *aw, MS3Record *msr)
+{
+  MS3Record v2msr;
+  uint32_t dataoffset;
+  uint32_t datasize;
+  uint32_t needed;
+  size_t length;
+  char *record;
+  int headerlen;
+  int reclen;
+  char stime[40];
+
+  /* Encoded data is copied and must be in a known encoding, e.g. not
+   * miniSEED 2 without Blockette 1000 */
+  if (msr->samplecnt > 0 && ms_encoding_sizetype ((uint8_t)msr->encoding, NULL, NULL))
+  {
+    ms_nstime2timestr_n (msr->starttime, stime, sizeof (stime), timeformat, NANO);
+    ms_log (1, "Skipping %s, %s, cannot convert unknown or unsupported encoding %d (%s)\n",
+            msr->sid, stime, msr->encoding, ms_encodingstr (msr->encoding));
+    return 0;
+  }
+
+  if (msr3_data_bounds (msr, &dataoffset, &datasize))
+  {
+    ms_log (2, "%s: Cannot determine data bounds for conversion\n", msr->sid);
+    return -1;
+  }
+
+  /* Map deferred extra headers, they determine the length of the new header
+   * and are not carried by the copy of the record used for version 2 */
+  if (msr3_unpack_extra (msr, verbose) < 0)
+    return -1;
+
+  if (outversion == 3)
+  {
+    length = MS3FIXEDLENGTH + strlen (msr->sid) + msr->extralength + datasize;
+
+    if ((record = (char *)aw_reserve (aw, length)) == NULL)
+    {
+      ms_log (2, "Cannot write output file: %s (%s)\n", outfile, strerror (errno));
+      return -1;
+    }
+
+    if ((reclen = msr3_repack_mseed3 (msr, record, (uint32_t)length, verbose)) < 0)
+    {
+      ms_log (2, "%s: Cannot convert record to miniSEED 3\n", msr->sid);
+      return -1;
+    }
+  }
+  else
+  {
+    if ((record = (char *)aw_reserve (aw, MS2MAXRECLEN)) == NULL)
+    {
+      ms_log (2, "Cannot write output file: %s (%s)\n", outfile, strerror (errno));
+      return -1;
+    }
+
+    /* Pack the header once with the largest record length to determine its
+     * length, the data offset is rounded up to 64 bytes for Steim encodings */
+    v2msr = *msr;
+    v2msr.reclen = MS2MAXRECLEN;
+
+    if ((headerlen = msr3_pack_header2 (&v2msr, record, MS2MAXRECLEN, verbose)) < 0)
+    {
+      ms_log (2, "%s: Cannot convert record to miniSEED 2\n", msr->sid);
+      return -1;
+    }
+
+    needed = (uint32_t)headerlen;
+    if (msr->encoding == DE_STEIM1 || msr->encoding == DE_STEIM2)
+      needed = (needed + 63) / 64 * 64;
+    needed += datasize;
+
+    for (v2msr.reclen = 128; (uint32_t)v2msr.reclen < needed && v2msr.reclen < MS2MAXRECLEN;)
+      v2msr.reclen *= 2;
+
+    if ((uint32_t)v2msr.reclen < needed ||
+        (reclen = msr3_repack_mseed2 (&v2msr, record, (uint32_t)v2msr.reclen, verbose)) < 0)
+    {
+      ms_log (2, "%s: Cannot convert record to miniSEED 2, %u bytes of header and data\n",
+              msr->sid, needed);
+      return -1;
+    }
+
+    reclen = v2msr.reclen;
+  }
+
+  if (aw_commit (aw, (size_t)reclen))
+  {
+    ms_log (2, "Cannot write output file: %s (%s)\n", outfile, strerror (errno));
+    return -1;
+  }
+
+  return 0;
+} /* End of convertrecord() */
+
 /***************************************************************************
  * parameter_proc():
  * Process the command line parameters.
@@ -491,6 +798,10 @@ processparam (int argcount, char **argvec)
     {
       skipnotdata = 1;
     }
+    else if (strcmp (argvec[optind], "-nc") == 0)
+    {
+      nocache = 1;
+    }
     else if (strncmp (argvec[optind], "-p", 2) == 0)
     {
       ppackets += strspn (&argvec[optind][1], "p");
@@ -584,6 +895,22 @@ processparam (int argcount, char **argvec)
     {
       outfile = getoptval (argcount, argvec, optind++);
     }
+    else if (strcmp (argvec[optind], "-ov") == 0)
+    {
+      long version = getoptint (argcount, argvec, optind++);
+
+      if (version != 2 && version != 3)
+      {
+        ms_log (2, "Output format version must be 2 or 3: %ld\n", version);
+        exit (1);
+      }
+
+      outversion = (int8_t)version;
+    }
+    else if (strcmp (argvec[optind], "-A") == 0)
+    {
+      archivetemplate = getoptval (argcount, argvec, optind++);
+    }
     else if (strncmp (argvec[optind], "-", 1) == 0 &&
              strlen (argvec[optind]) > 1)
     {
@@ -635,6 +962,12 @@ processparam (int argcount, char **argvec)
     }
   }
 
+  if (outversion && !outfile)
+  {
+    ms_log (2, "Output format version (-ov) requires an output file (-o)\n\n");
+    exit (1);
+  }
+
   /* Make sure input file were specified */
   if (!filelist)
   {
@@ -1249,6 +1582,7 @@ usage (void)
            "                Patterns are applied to: 'FDSN:NET_STA_LOC_BAND_SOURCE_SS'\n"
            " -n count     Only process count number of records\n"
            " -snd         Skip non-miniSEED data\n"
+           " -nc          Do not keep input files in the page cache, for large scans\n"
            "\n"
            " ## Output options ##\n"
            " -p           Print details of header, multiple flags can be used\n"
@@ -1277,6 +1611,10 @@ usage (void)
            " ## Data output options ##\n"
            " -b binfile   Unpack/decompress data and write binary samples to binfile\n"
            " -o outfile   Write processed records to outfile\n"
+           " -ov version  Convert records written to outfile to format version 2 or 3\n"
+           " -A template  Write processed records to files named by a path template\n"
+           "                codes: %%n %%s %%l %%c (codes) %%Y %%j %%m %%d %%H (time) %%v %%%%\n"
+           "                e.g. SDS: '%%Y/%%n/%%s/%%c.D/%%n.%%s.%%l.%%c.D.%%Y.%%j'\n"
            "\n"
            " files        File(s) of miniSEED records, list files prefixed with '@'\n"
            "\n");
@@ -0,0 +1,253 @@
+/***************************************************************************
+ * samplewriter.c - Buffered text output of data sample values
+ *
+ * Printing each sample value with its own formatted log call is slow
+ * for large amounts of data.  These routines format values directly
+ * into a large buffer that is written to the output stream in bulk.
+ *
+ * Output is identical to the printf() conversions they replace:
+ * sw_int32() matches "%*d" and sw_real() matches "%*.*g".
+ *
+ * Written by Chad Trabant, EarthScope Data Services
+ ***************************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "samplewriter.h"
+
+/* Maximum length of a single formatted value, including padding */
+#define SW_MAXITEM 64
+
+/* Powers of ten, indexed by %g precision, used to detect values that
+ * %g prints in plain integer form */
+static const int64_t sw_pow10[] = {1,
+                                   10,
+                                   100,
+                                   1000,
+                                   10000,
+                                   100000,
+                                   1000000,
+                                   10000000,
+                                   100000000,
+                                   1000000000,
+                                   10000000000,
+                                   100000000000,
+                                   1000000000000,
+                                   10000000000000,
+                                   100000000000000,
+                                   1000000000000000};
+
+#define SW_MAXFASTPRECISION 15
+
+/***************************************************************************
+ * Initialize a SampleWriter with a buffer of the specified size, a size
+ * of 0 selects SW_BUFFERSIZE.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+int
+sw_init (SampleWriter *sw, FILE *output, size_t size)
+{
+  if (!sw || !output)
+    return -1;
+
+  if (size < SW_MAXITEM)
+    size = SW_BUFFERSIZE;
+
+  if ((sw->buffer = (char *)malloc (size)) == NULL)
+    return -1;
+
+  sw->output = output;
+  sw->size = size;
+  sw->length = 0;
+  sw->error = 0;
+
+  return 0;
+} /* End of sw_init() */
+
+/***************************************************************************
+ * Write any buffered output to the output stream.
+ *
+ * Returns 0 on success and -1 on write error.
+ ***************************************************************************/
+int
+sw_flush (SampleWriter *sw)
+{
+  if (!sw || !sw->buffer)
+    return -1;
+
+  if (sw->length > 0)
+  {
+    if (fwrite (sw->buffer, 1, sw->length, sw->output) != sw->length)
+      sw->error = 1;
+
+    sw->length = 0;
+  }
+
+  return (sw->error) ? -1 : 0;
+} /* End of sw_flush() */
+
+/***************************************************************************
+ * Flush any buffered output and release the buffer.
+ ***************************************************************************/
+void
+sw_free (SampleWriter *sw)
+{
+  if (!sw || !sw->buffer)
+    return;
+
+  sw_flush (sw);
+  free (sw->buffer);
+  sw->buffer = NULL;
+  sw->size = 0;
+} /* End of sw_free() */
+
+/* Make room for an item of up to SW_MAXITEM bytes */
+static inline int
+sw_reserve (SampleWriter *sw)
+{
+  if ((sw->size - sw->length) < SW_MAXITEM)
+    return sw_flush (sw);
+
+  return 0;
+}
+
+/* Write the decimal digits of 'value' backwards from 'end', returning
+ * the start of the digits */
+static inline char *
+sw_digits (char *end, uint64_t value)
+{
+  do
+  {
+    *--end = (char)('0' + (value % 10));
+    value /= 10;
+  } while (value);
+
+  return end;
+}
+
+/* Append an integer, right-justified to 'width' like "%*d" */
+static int
+sw_integer (SampleWriter *sw, int64_t value, int width)
+{
+  char scratch[24];
+  char *end = scratch + sizeof (scratch);
+  char *start;
+  uint64_t magnitude;
+  int length;
+
+  if (width > SW_MAXITEM - 24)
+    width = SW_MAXITEM - 24;
+
+  if (sw_reserve (sw))
+    return -1;
+
+  magnitude = (value < 0) ? (uint64_t)0 - (uint64_t)value : (uint64_t)value;
+  start = sw_digits (end, magnitude);
+
+  if (value < 0)
+    *--start = '-';
+
+  length = (int)(end - start);
+
+  if (length < width)
+  {
+    memset (sw->buffer + sw->length, ' ', width - length);
+    sw->length += width - length;
+  }
+
+  memcpy (sw->buffer + sw->length, start, length);
+  sw->length += length;
+
+  return 0;
+}
+
+/***************************************************************************
+ * Append a 32-bit integer formatted like printf("%*d", width, value).
+ *
+ * Returns 0 on success and -1 on write error.
+ ***************************************************************************/
+int
+sw_int32 (SampleWriter *sw, int32_t value, int width)
+{
+  return sw_integer (sw, value, width);
+} /* End of sw_int32() */
+
+/***************************************************************************
+ * Append a floating point value formatted like
+ * printf("%*.*g", width, precision, value).
+ *
+ * Integral values that %g prints without exponent or fraction, common
+ * for data converted from counts, are formatted directly.  All other
+ * values are formatted with snprintf() to guarantee identical output.
+ *
+ * Returns 0 on success and -1 on write error.
+ ***************************************************************************/
+int
+sw_real (SampleWriter *sw, double value, int width, int precision)
+{
+  int64_t limit;
+  int length;
+
+  if (precision == 0)
+    precision = 1;
+
+  /* %g prints integral values smaller than 10^precision as plain
+   * integers, negative zero is the exception as it prints as "-0" */
+  if (precision > 0 && precision <= SW_MAXFASTPRECISION)
+  {
+    limit = sw_pow10[precision];
+
+    if (value > -(double)limit && value < (double)limit && value == (double)(int64_t)value &&
+        !(value == 0.0 && signbit (value)))
+    {
+      return sw_integer (sw, (int64_t)value, width);
+    }
+  }
+
+  if (width > SW_MAXITEM - 32)
+    width = SW_MAXITEM - 32;
+
+  if (sw_reserve (sw))
+    return -1;
+
+  length = snprintf (sw->buffer + sw->length, sw->size - sw->length, "%*.*g", width, precision,
+                     value);
+
+  if (length < 0 || (size_t)length >= sw->size - sw->length)
+    return -1;
+
+  sw->length += length;
+
+  return 0;
+} /* End of sw_real() */
+
+/***************************************************************************
+ * Append a string of the specified length.
+ *
+ * Returns 0 on success and -1 on write error.
+ ***************************************************************************/
+int
+sw_string (SampleWriter *sw, const char *string, size_t length)
+{
+  size_t count;
+
+  while (length > 0)
+  {
+    if (sw->length == sw->size && sw_flush (sw))
+      return -1;
+
+    count = sw->size - sw->length;
+    if (count > length)
+      count = length;
+
+    memcpy (sw->buffer + sw->length, string, count);
+    sw->length += count;
+    string += count;
+    length -= count;
+  }
+
+  return 0;
+} /* End of sw_string() */
@@ -0,0 +1,40 @@
+/***************************************************************************
+ * samplewriter.h - Buffered text output of data sample values
+ *
+ * Declarations for the routines in samplewriter.c.
+ *
+ * Written by Chad Trabant, EarthScope Data Services
+ ***************************************************************************/
+
+#ifndef SAMPLEWRITER_H
+#define SAMPLEWRITER_H 1
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* Default output buffer size in bytes */
+#define SW_BUFFERSIZE 65536
+
+/* Buffered writer of formatted sample values.
+ *
+ * Values are formatted directly into the buffer, which is written to
+ * the output stream when full and by sw_flush().  Callers must flush
+ * before anything else is written to the same stream. */
+typedef struct SampleWriter
+{
+  FILE *output;  /* Destination stream */
+  char *buffer;  /* Output buffer */
+  size_t size;   /* Size of buffer in bytes */
+  size_t length; /* Bytes of buffer in use */
+  int error;     /* Set when a write to the output stream fails */
+} SampleWriter;
+
+extern int sw_init (SampleWriter *sw, FILE *output, size_t size);
+extern int sw_flush (SampleWriter *sw);
+extern void sw_free (SampleWriter *sw);
+
+extern int sw_int32 (SampleWriter *sw, int32_t value, int width);
+extern int sw_real (SampleWriter *sw, double value, int width, int precision);
+extern int sw_string (SampleWriter *sw, const char *string, size_t length);
+
+#endif